@@ -114,6 +114,7 @@ struct DeviceData
 	VkBool32 samplerAnisotropy;							//!< Does physical device supports Anisotropic Filtering (AF)?
 	VkBool32 largePoints;
 	VkBool32 wideLines;
+	VkBool32 multiDrawIndirect;							//!< Can vkCmdDrawIndexedIndirect take drawCount > 1? (if not, one indirect draw per command is recorded)
 
 	// Others
 	VkFormat depthFormat;
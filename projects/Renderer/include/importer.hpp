@@ -2,6 +2,7 @@
 #define TEXTURE_HPP
 
 #include <list>
+#include <memory>
 //#include <unordered_map>			// For storing unique vertices from the model
 
 #include <glm/glm.hpp>
@@ -44,10 +45,13 @@
 // Definitions ----------
 
 struct VertexData;
+class SharedIndexBuffer;
+class VertexArena;
 class VerticesLoader;
 class VLModule;
 	class VLM_fromFile;
 	class VLM_fromBuffer;
+	class VLM_fromArena;
 
 class Shader;
 class ShaderLoader;
@@ -95,11 +99,83 @@ struct VertexData
 	uint32_t					 vertexCount;
 	VkBuffer					 vertexBuffer;			//!< Opaque handle to a buffer object (here, vertex buffer).
 	VkDeviceMemory				 vertexBufferMemory;	//!< Opaque handle to a device memory object (here, memory for the vertex buffer).
+	int32_t						 vertexOffset = 0;		//!< First vertex of this model in vertexBuffer (used as vertexOffset/firstVertex in draw calls)
+	std::shared_ptr<VertexArena> arena;					//!< If not null, vertexBuffer belongs to this object (don't free it, release arenaSlot).
+	unsigned					 arenaSlot = 0;
 
 	// Indices
 	uint32_t					 indexCount;			// <<< BUG WITH POINTS (= 7340144)
 	VkBuffer					 indexBuffer;			//!< Opaque handle to a buffer object (here, index buffer).
 	VkDeviceMemory				 indexBufferMemory;		//!< Opaque handle to a device memory object (here, memory for the index buffer).
+	std::shared_ptr<SharedIndexBuffer> sharedIndices;	//!< If not null, indexBuffer belongs to this object (don't free it, release it).
+};
+
+/**
+	Indices shared by many models with the same index layout (example: terrain chunks with the same number of vertices). 
+	The index buffer is uploaded when the first model using it is loaded, and freed when the last one is destroyed, so only one buffer (and memory allocation) exists for all of them.
+*/
+class SharedIndexBuffer
+{
+public:
+	SharedIndexBuffer(const std::vector<uint16_t>& indices);
+
+	const std::vector<uint16_t> indices;
+
+	void release(VulkanEnvironment* e);		//!< Called by each model using the buffer when it's destroyed. The last one frees the buffer.
+	unsigned getCounter();					//!< Number of models using the index buffer
+
+private:
+	friend class VLModule;
+
+	VkBuffer indexBuffer;
+	VkDeviceMemory indexBufferMemory;
+	unsigned counter;						//!< Number of models using the index buffer (0: not uploaded)
+	std::mutex mutBuffer;					//!< for indexBuffer, indexBufferMemory & counter
+};
+
+/**
+	Large device local vertex buffers (pages) divided into fixed-size slots. Models with the same vertex data size (example: terrain chunks) take a slot each, so they share a few buffers and memory allocations instead of having their own. 
+	A model takes a free slot when loaded (a new page is created if there is none) and gives it back when destroyed. Models draw using their slot's first vertex as vertexOffset. 
+	Slots can also be filled directly (upload()) and drawn by a single model attached to the arena (VLM_fromArena) with indirect draws (one per slot), so that many objects need only one model (one pipeline, one descriptor set...).
+	Pages are freed when the last slot is released and no model is attached, or when the last attached model is released (slots filled for it are discarded).
+*/
+class VertexArena
+{
+public:
+	VertexArena(size_t slotSize, size_t vertexSize, unsigned slotsPerPage = 128, unsigned maxPages = 0);
+
+	static const unsigned noSlot = ~0u;		//!< Returned when the arena is full. Also used as arenaSlot by models attached to the arena.
+
+	const size_t slotSize;					//!< Bytes per slot
+	const size_t vertexSize;				//!< Bytes per vertex
+	const unsigned slotsPerPage;
+	const unsigned maxPages;				//!< Max. number of pages (0: no limit)
+
+	void upload(const std::vector<const void*>& vertexSets, size_t bytes, std::vector<unsigned>& slots, VulkanEnvironment* e);	//!< Upload some vertex sets (bytes each) to free slots (using a single staging buffer and a single submission). slots[i] == noSlot if there was no room for vertexSets[i].
+	void attach(VertexData& result, VulkanEnvironment* e);	//!< Make result use the first page (the arena must have a single page). Detached in release(noSlot, e).
+	void release(unsigned slot, VulkanEnvironment* e);		//!< Called by each model using a slot when it's destroyed. The last one frees the pages.
+	uint32_t getFirstVertex(unsigned slot);					//!< First vertex of a slot in its page (vertexOffset for draws)
+	size_t getNumPages();
+	size_t getNumSlotsUsed();
+
+private:
+	friend class VLModule;
+
+	struct Page
+	{
+		VkBuffer buffer;
+		VkDeviceMemory memory;
+	};
+
+	std::vector<Page> pages;
+	std::vector<unsigned> freeSlots;		//!< Free list (slot = page * slotsPerPage + position in page)
+	unsigned slotsUsed;
+	unsigned attached;						//!< Number of models attached to the arena
+	std::mutex mutArena;					//!< for pages, freeSlots, slotsUsed & attached
+
+	void newPage(VulkanEnvironment* e);						//!< Create a page and add its slots to the free list. Call it with mutArena locked.
+	bool takeSlot(unsigned& slot, VulkanEnvironment* e);	//!< Take a free slot (a new page is created if there is none). Returns false if maxPages is reached. Call it with mutArena locked.
+	void freePages(VulkanEnvironment* e);					//!< Free the pages if no slot is used and no model is attached. Call it with mutArena locked.
 };
 
 /// (ADT) Vertices Loader Module (VLM) used in VerticesLoader for loading vertices from any source.
@@ -107,13 +183,17 @@ class VLModule
 {
 protected:
 	const size_t vertexSize;	//!< Size (bytes) of a vertex object
+	std::shared_ptr<SharedIndexBuffer> sharedIndices;	//!< If not null, this index buffer is used instead of the raw indices
+	std::shared_ptr<VertexArena> vertexArena;			//!< If not null, vertices are uploaded to a slot of this arena instead of to their own buffer
 
 	virtual void getRawData(VertexSet& destVertices, std::vector<uint16_t>& destIndices, ResourcesLoader& destResources) = 0;					//!< Get raw vertex data (vertices & indices)
 	void createBuffers(VertexData& result, const VertexSet& rawVertices, const std::vector<uint16_t>& rawIndices, VulkanEnvironment* e);	//!< Upload raw vertex data to Vulkan (i.e., create Vulkan buffers)
 
 	void createVertexBuffer(const VertexSet& rawVertices, VertexData& result, VulkanEnvironment* e);									//!< Vertex buffer creation.
 	void createIndexBuffer(const std::vector<uint16_t>& rawIndices, VertexData& result, VulkanEnvironment* e);							//!< Index buffer creation
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VulkanEnvironment* e);
+	void useSharedIndexBuffer(VertexData& result, VulkanEnvironment* e);																//!< Take the shared index buffer (upload it if no model is using it)
+	bool useVertexArena(const VertexSet& rawVertices, VertexData& result, VulkanEnvironment* e);										//!< Upload vertices to a free slot of the vertex arena. Returns false if they don't fit in a slot or the arena is full.
+	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VulkanEnvironment* e, VkDeviceSize dstOffset = 0);
 
 	glm::vec3 getVertexTangent(const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3, const glm::vec2 uv1, const glm::vec2 uv2, const glm::vec2 uv3);
 
@@ -122,7 +202,7 @@ public:
 	virtual ~VLModule() { };
 	virtual VLModule* clone() = 0;		//!< Create a new object of children type and return its pointer.
 
-	void loadVertices(VertexData& result, ResourcesLoader* resources, VulkanEnvironment* e);
+	virtual void loadVertices(VertexData& result, ResourcesLoader* resources, VulkanEnvironment* e);
 };
 
 class VLM_fromBuffer : public VLModule
@@ -134,7 +214,20 @@ class VLM_fromBuffer : public VLModule
 
 public:
 	VLM_fromBuffer(const void* verticesData, size_t vertexSize, size_t vertexCount, const std::vector<uint16_t>& indices);
+	VLM_fromBuffer(const void* verticesData, size_t vertexSize, size_t vertexCount, std::shared_ptr<SharedIndexBuffer> indices, std::shared_ptr<VertexArena> arena = nullptr);
+	VLModule* clone() override;
+};
+
+/// Use the whole vertex arena (and a shared index buffer). Vertices are uploaded to the arena's slots later (VertexArena::upload) and drawn with indirect draw commands (ModelDataInfo::maxIndirectDraws).
+class VLM_fromArena : public VLModule
+{
+	void getRawData(VertexSet& destVertices, std::vector<uint16_t>& destIndices, ResourcesLoader& destResources) override;
+
+public:
+	VLM_fromArena(std::shared_ptr<VertexArena> arena, std::shared_ptr<SharedIndexBuffer> indices);
 	VLModule* clone() override;
+
+	void loadVertices(VertexData& result, ResourcesLoader* resources, VulkanEnvironment* e) override;
 };
 
 /// Process a graphics file (obj, ...) and get the meshes. <<< Problem: This takes all the meshes in each node and stores them together. However, meshes from different nodes have their own indices, all of them in the range [0, number of vertices in the mesh). Since each mesh is an independent object, they cannot be put together without messing up with the indices (they should be stored as different models). 
@@ -166,6 +259,8 @@ public:
 	VerticesLoader();
 	VerticesLoader(std::string& filePath);	//!< From file (vertexSize == (3+3+2) * sizeof(float))
 	VerticesLoader(size_t vertexSize, const void* verticesData, size_t vertexCount, std::vector<uint16_t>& indices);	//!< From buffers
+	VerticesLoader(size_t vertexSize, const void* verticesData, size_t vertexCount, std::shared_ptr<SharedIndexBuffer> indices, std::shared_ptr<VertexArena> arena = nullptr);	//!< From buffers, with an index buffer shared with other models (and, optionally, a slot in a vertex arena)
+	VerticesLoader(std::shared_ptr<VertexArena> arena, std::shared_ptr<SharedIndexBuffer> indices);	//!< The whole vertex arena (for indirect drawing)
 	VerticesLoader(const VerticesLoader& obj);	//!< Copy constructor (necessary because loader can be freed in destructor)
 	~VerticesLoader();
 
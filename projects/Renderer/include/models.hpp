@@ -42,6 +42,8 @@ struct ModelDataInfo
 	size_t maxDescriptorsCount_fs;
 	size_t UBOsize_vs;
 	size_t UBOsize_fs;
+	bool storageBuffer_vs;						// If true, the vertex shader buffer is a storage buffer (std430) instead of a UBO (useful for big arrays of per-object data)
+	uint32_t maxIndirectDraws;					// If > 0, the model is drawn with vkCmdDrawIndexedIndirect using this many commands (ModelData::drawCommands)
 	bool transparency;
 	uint32_t renderPassIndex;
 	VkCullModeFlagBits cullMode;
@@ -123,6 +125,8 @@ public:
 
 	UBO							 vsUBO;					//!< Stores the set of UBOs that will be passed to the vertex shader
 	UBO							 fsUBO;					//!< Stores the UBO that will be passed to the fragment shader
+	UBO							 drawCommands;			//!< Indirect draw commands (VkDrawIndexedIndirectCommand[maxIndirectDraws]). Commands with instanceCount == 0 draw nothing, so they can be edited without recording the command buffers again.
+	const uint32_t				 maxIndirectDraws;		//!< If 0, the model is drawn with vkCmdDrawIndexed/vkCmdDraw
 	VkDescriptorSetLayout		 descriptorSetLayout;	//!< Opaque handle to a descriptor set layout object (combines all of the descriptor bindings).
 	VkDescriptorPool			 descriptorPool;		//!< Opaque handle to a descriptor pool object.
 	std::vector<VkDescriptorSet> descriptorSets;		//!< List. Opaque handle to a descriptor set object. One for each swap chain image.
@@ -118,6 +118,7 @@ class Renderer
 
 	size_t						currentFrame;				//!< Frame to process next (0 or 1).
 	size_t						commandsCount;				//!< Number of drawing commands sent to the command buffer. For debugging purposes.
+	float						recordingTime;				//!< Time (ms) spent in the last createCommandBuffers(). For debugging purposes.
 
 	// Main methods:
 
@@ -212,11 +213,18 @@ public:
 	/// Make a model the last to be drawn within its own layer. Useful for transparent objects.
 	void toLastDraw(modelIter model);
 
+	/// Upload some vertex sets (bytes each) to free slots of a vertex arena (see VertexArena::upload()). Slots are drawn by a model attached to the arena using indirect draw commands (ModelData::drawCommands).
+	void uploadVertices(std::shared_ptr<VertexArena> arena, const std::vector<const void*>& vertexSets, size_t bytes, std::vector<unsigned>& slots);
+
+	/// Give back a slot taken with uploadVertices().
+	void releaseVertices(std::shared_ptr<VertexArena> arena, unsigned slot);
+
 	TimerSet&	getTimer();		//!< Returns the timer object (provides access to time data).
 	size_t		getRendersCount(modelIter model);
 	size_t		getFrameCount();
 	size_t		getModelsCount();
 	size_t		getCommandsCount();
+	float		getRecordingTime();	//!< Returns time (ms) spent recording the command buffers the last time they were updated
 	size_t		loadedModels();		//!< Returns number of models in Renderer:models
 	size_t		loadedShaders();	//!< Returns number of shaders in Renderer:shaders
 	size_t		loadedTextures();	//!< Returns number of textures in Renderer:textures
@@ -72,7 +72,7 @@ void printVec(const T& vec)
 
 /// Print string (or any printable object)
 template<typename T>
-void printS(const T& vec) { std::cout << T << std::endl; }
+void printS(const T& vec) { std::cout << vec << std::endl; }
 
 // Vertex sets -----------------------------------------------------------------
 
@@ -147,10 +147,11 @@ private:
 	VulkanEnvironment* e;
 
 public:
-	UBO(VulkanEnvironment* e, size_t maxUBOcount, size_t UBOsize, VkDeviceSize minUBOffsetAlignment);	//!< Constructor. Parameters: maxUBOcount (max. number of UBOs), uboType (defines what a single UBO contains), minUBOffsetAlignment (alignment for each UBO required by the GPU).
+	UBO(VulkanEnvironment* e, size_t maxUBOcount, size_t UBOsize, VkDeviceSize minUBOffsetAlignment, VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);	//!< Constructor. Parameters: maxUBOcount (max. number of UBOs), uboType (defines what a single UBO contains), minUBOffsetAlignment (alignment for each UBO required by the GPU), usage (uniform, storage or indirect buffer).
 	~UBO() = default;
 
 	const size_t				maxUBOcount;			//!< Number of UBOs
+	const VkBufferUsageFlags	usage;					//!< VK_BUFFER_USAGE_ ... UNIFORM_BUFFER_BIT (default), STORAGE_BUFFER_BIT (std430 layout, may end with a runtime array), INDIRECT_BUFFER_BIT (draw commands)
 	VkDeviceSize				range;					//!< Size (bytes) of each aligned UBO (example: 4) (at least, minUBOffsetAlignment)
 	size_t						totalBytes;				//!< Size (bytes) of the set of UBOs (example: 12)
 
@@ -159,6 +160,7 @@ public:
 	std::vector<VkDeviceMemory>	uniformBuffersMemory;	//!< Opaque handle to a device memory object (here, memory for the uniform buffer). One for each swap chain image.
 
 	uint8_t* getUBOptr(size_t UBOindex);
+	VkDescriptorType getDescriptorType() const;			//!< Descriptor type for binding this buffer (uniform or storage buffer)
 	void createUniformBuffers();						//!< Create uniform buffers (type of descriptors that can be bound) (VkBuffer & VkDeviceMemory), one for each swap chain image. At least one is created (if count == 0, a buffer of size "range" is created).
 	void destroyUniformBuffers();						//!< Destroy the uniform buffers (VkBuffer) and their memories (VkDeviceMemory).
 };
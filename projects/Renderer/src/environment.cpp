@@ -64,6 +64,7 @@ void DeviceData::fillWithDeviceData(VkPhysicalDevice physicalDevice)
 	samplerAnisotropy = deviceFeatures.samplerAnisotropy;
 	largePoints = deviceFeatures.largePoints;
 	wideLines = deviceFeatures.wideLines;
+	multiDrawIndirect = deviceFeatures.multiDrawIndirect;
 
 	/// Find the right format for a depth image. Select a format with a depth component that supports usage as depth attachment. We don't need a specific format because we won't be directly accessing the texels from the program. It just needs to have a reasonable accuracy (usually, at least 24 bits). Several formats fit this requirement: VK_FORMAT_ ... D32_SFLOAT (32-bit signed float depth), D32_SFLOAT_S8_UINT (32-bit signed float depth and 8 bit stencil), D24_UNORM_S8_UINT (24-bit float depth and 8 bit stencil).
 	depthFormat = findSupportedFormat(physicalDevice,
@@ -110,7 +111,8 @@ void DeviceData::printData()
 			   
 		<< "   samplerAnisotropy: " << samplerAnisotropy << '\n'
 		<< "   largePoints: " << largePoints << '\n'
-		<< "   wideLines: " << wideLines << '\n';
+		<< "   wideLines: " << wideLines << '\n'
+		<< "   multiDrawIndirect: " << multiDrawIndirect << '\n';
 }
 
 //VkSwapchainKHR							swapChain;				//!< Swap chain object.
@@ -719,6 +721,7 @@ void VulkanCore::createLogicalDevice()
 	deviceFeatures.samplerAnisotropy = deviceData.samplerAnisotropy ? VK_TRUE : VK_FALSE;	// Anisotropic filtering is an optional device feature (most modern graphics cards support it, but we should check it in isDeviceSuitable)
 	deviceFeatures.sampleRateShading = (add_SS ? VK_TRUE : VK_FALSE);						// Enable sample shading feature for the device
 	deviceFeatures.wideLines = (deviceData.wideLines ? VK_TRUE : VK_FALSE);					// Enable line width configuration (in VkPipeline)
+	deviceFeatures.multiDrawIndirect = (deviceData.multiDrawIndirect ? VK_TRUE : VK_FALSE);	// Enable drawCount > 1 in vkCmdDrawIndexedIndirect
 
 	// Describe queue parameters
 	VkDeviceCreateInfo createInfo{};
@@ -68,8 +68,11 @@ void VLModule::loadVertices(VertexData& result, ResourcesLoader* resources, Vulk
 
 void VLModule::createBuffers(VertexData& result, const VertexSet& rawVertices, const std::vector<uint16_t>& rawIndices, VulkanEnvironment* e)
 {
-	createVertexBuffer(rawVertices, result, e);
-	createIndexBuffer(rawIndices, result, e);
+	if (!vertexArena || !useVertexArena(rawVertices, result, e))
+		createVertexBuffer(rawVertices, result, e);
+
+	if (sharedIndices) useSharedIndexBuffer(result, e);
+	else createIndexBuffer(rawIndices, result, e);
 }
 
 void VLModule::createVertexBuffer(const VertexSet& rawVertices, VertexData& result, VulkanEnvironment* e)
@@ -118,6 +121,7 @@ void VLModule::createVertexBuffer(const VertexSet& rawVertices, VertexData& resu
 		result.vertexBufferMemory);
 
 	result.vertexCount = rawVertices.getNumVertex();
+	result.vertexOffset = 0;
 
 	// Move the vertex data to the device local buffer
 	copyBuffer(stagingBuffer, result.vertexBuffer, bufferSize, e);
@@ -175,12 +179,71 @@ void VLModule::createIndexBuffer(const std::vector<uint16_t>& rawIndices, Vertex
 	e->c.memAllocObjects--;
 }
 
+void VLModule::useSharedIndexBuffer(VertexData& result, VulkanEnvironment* e)
+{
+	#ifdef DEBUG_RESOURCES
+		std::cout << typeid(*this).name() << "::" << __func__ << std::endl;
+	#endif
+
+	const std::lock_guard<std::mutex> lock(sharedIndices->mutBuffer);
+
+	if (!sharedIndices->counter)		// First model using it: upload it
+	{
+		VertexData shared;
+		createIndexBuffer(sharedIndices->indices, shared, e);
+		sharedIndices->indexBuffer = shared.indexBuffer;
+		sharedIndices->indexBufferMemory = shared.indexBufferMemory;
+	}
+
+	sharedIndices->counter++;
+
+	result.indexCount = sharedIndices->indices.size();
+	result.indexBuffer = sharedIndices->indexBuffer;
+	result.indexBufferMemory = sharedIndices->indexBufferMemory;
+	result.sharedIndices = sharedIndices;
+}
+
+bool VLModule::useVertexArena(const VertexSet& rawVertices, VertexData& result, VulkanEnvironment* e)
+{
+	#ifdef DEBUG_RESOURCES
+		std::cout << typeid(*this).name() << "::" << __func__ << std::endl;
+	#endif
+
+	VkDeviceSize bufferSize = rawVertices.totalBytes();
+	if (bufferSize > vertexArena->slotSize || vertexSize != vertexArena->vertexSize)
+	{
+		std::cout << "Vertex data doesn't fit in a vertex arena slot (" << bufferSize << " bytes). A new buffer is used." << std::endl;
+		return false;
+	}
+
+	std::vector<unsigned> slots;
+	vertexArena->upload({ rawVertices.data() }, bufferSize, slots, e);
+	if (slots[0] == VertexArena::noSlot)
+	{
+		std::cout << "Vertex arena is full. A new buffer is used." << std::endl;
+		return false;
+	}
+
+	{
+		const std::lock_guard<std::mutex> lock(vertexArena->mutArena);
+		result.vertexBuffer = vertexArena->pages[slots[0] / vertexArena->slotsPerPage].buffer;
+	}
+
+	result.vertexCount = rawVertices.getNumVertex();
+	result.vertexBufferMemory = VK_NULL_HANDLE;
+	result.vertexOffset = vertexArena->getFirstVertex(slots[0]);
+	result.arena = vertexArena;
+	result.arenaSlot = slots[0];
+
+	return true;
+}
+
 /**
 	@brief Copies some amount of data (size) from srcBuffer into dstBuffer. Used in createVertexBuffer() and createIndexBuffer().
 
 	Memory transfer operations are executed using command buffers (like drawing commands), so we allocate a temporary command buffer. You may wish to create a separate command pool for these kinds of short-lived buffers, because the implementation could apply memory allocation optimizations. You should use the VK_COMMAND_POOL_CREATE_TRANSIENT_BIT flag during command pool generation in that case.
 */
-void VLModule::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VulkanEnvironment* e)
+void VLModule::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VulkanEnvironment* e, VkDeviceSize dstOffset)
 {
 	#ifdef DEBUG_MODELS
 		std::cout << typeid(*this).name() << "::" << __func__ << std::endl;
@@ -192,7 +255,7 @@ void VLModule::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize s
 	VkBufferCopy copyRegion{};
 	copyRegion.size = size;
 	copyRegion.srcOffset = 0;	// Optional
-	copyRegion.dstOffset = 0;	// Optional
+	copyRegion.dstOffset = dstOffset;
 
 	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
@@ -224,8 +287,34 @@ VLM_fromBuffer::VLM_fromBuffer(const void* verticesData, size_t vertexSize, size
 	rawIndices = indices;
 }
 
+VLM_fromBuffer::VLM_fromBuffer(const void* verticesData, size_t vertexSize, size_t vertexCount, std::shared_ptr<SharedIndexBuffer> indices, std::shared_ptr<VertexArena> arena)
+	: VLModule(vertexSize)
+{
+	rawVertices.reset(vertexSize, vertexCount, verticesData);
+	sharedIndices = indices;
+	vertexArena = arena;
+}
+
 VLModule* VLM_fromBuffer::clone() { return new VLM_fromBuffer(*this); }
 
+VLM_fromArena::VLM_fromArena(std::shared_ptr<VertexArena> arena, std::shared_ptr<SharedIndexBuffer> indices)
+	: VLModule(arena->vertexSize)
+{
+	sharedIndices = indices;
+	vertexArena = arena;
+}
+
+VLModule* VLM_fromArena::clone() { return new VLM_fromArena(*this); }
+
+void VLM_fromArena::getRawData(VertexSet& destVertices, std::vector<uint16_t>& destIndices, ResourcesLoader& destResources) { }
+
+void VLM_fromArena::loadVertices(VertexData& result, ResourcesLoader* resources, VulkanEnvironment* e)
+{
+	vertexArena->attach(result, e);
+	result.arena = vertexArena;
+	useSharedIndexBuffer(result, e);
+}
+
 void VLM_fromBuffer::getRawData(VertexSet& destVertices, std::vector<uint16_t>& destIndices, ResourcesLoader& destResources)
 {
 	destVertices = rawVertices;
@@ -339,6 +428,183 @@ void VLM_fromFile::processMeshes(const aiScene* scene, std::vector<aiMesh*> &mes
 }
 
 
+SharedIndexBuffer::SharedIndexBuffer(const std::vector<uint16_t>& indices)
+	: indices(indices), indexBuffer(VK_NULL_HANDLE), indexBufferMemory(VK_NULL_HANDLE), counter(0) { }
+
+void SharedIndexBuffer::release(VulkanEnvironment* e)
+{
+	const std::lock_guard<std::mutex> lock(mutBuffer);
+
+	if (!counter) return;
+	if (--counter) return;
+
+	if (indices.size())
+	{
+		vkDestroyBuffer(e->c.device, indexBuffer, nullptr);
+		vkFreeMemory(e->c.device, indexBufferMemory, nullptr);
+		e->c.memAllocObjects--;
+	}
+
+	indexBuffer = VK_NULL_HANDLE;
+	indexBufferMemory = VK_NULL_HANDLE;
+}
+
+unsigned SharedIndexBuffer::getCounter()
+{
+	const std::lock_guard<std::mutex> lock(mutBuffer);
+	return counter;
+}
+
+VertexArena::VertexArena(size_t slotSize, size_t vertexSize, unsigned slotsPerPage, unsigned maxPages)
+	: slotSize(slotSize), vertexSize(vertexSize), slotsPerPage(slotsPerPage), maxPages(maxPages), slotsUsed(0), attached(0) { }
+
+void VertexArena::upload(const std::vector<const void*>& vertexSets, size_t bytes, std::vector<unsigned>& slots, VulkanEnvironment* e)
+{
+	slots.assign(vertexSets.size(), noSlot);
+	if (bytes > slotSize || vertexSets.empty()) return;
+
+	const std::lock_guard<std::mutex> lock(mutArena);
+
+	size_t count = 0;
+	while (count < vertexSets.size() && takeSlot(slots[count], e)) count++;
+	if (!count) return;
+
+	// Copy all the vertex sets to a single staging buffer
+	VkBuffer	   stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+
+	createBuffer(
+		e,
+		bytes * count,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer,
+		stagingBufferMemory);
+
+	void* data;
+	vkMapMemory(e->c.device, stagingBufferMemory, 0, bytes * count, 0, &data);
+	for (size_t i = 0; i < count; i++)
+		memcpy((uint8_t*)data + i * bytes, vertexSets[i], bytes);
+	vkUnmapMemory(e->c.device, stagingBufferMemory);
+
+	// Copy each vertex set to its slot (one copy command per page, one submission)
+	std::vector<std::vector<VkBufferCopy>> regions(pages.size());
+	for (size_t i = 0; i < count; i++)
+	{
+		VkBufferCopy copyRegion{};
+		copyRegion.size = bytes;
+		copyRegion.srcOffset = i * bytes;
+		copyRegion.dstOffset = (slots[i] % slotsPerPage) * slotSize;
+		regions[slots[i] / slotsPerPage].push_back(copyRegion);
+	}
+
+	VkCommandBuffer commandBuffer = e->beginSingleTimeCommands();
+
+	for (size_t i = 0; i < pages.size(); i++)
+		if (regions[i].size())
+			vkCmdCopyBuffer(commandBuffer, stagingBuffer, pages[i].buffer, regions[i].size(), regions[i].data());
+
+	e->endSingleTimeCommands(commandBuffer);
+
+	vkDestroyBuffer(e->c.device, stagingBuffer, nullptr);
+	vkFreeMemory(e->c.device, stagingBufferMemory, nullptr);
+	e->c.memAllocObjects--;
+}
+
+void VertexArena::attach(VertexData& result, VulkanEnvironment* e)
+{
+	const std::lock_guard<std::mutex> lock(mutArena);
+
+	if (pages.empty()) newPage(e);
+	if (pages.size() > 1) std::cout << "Only the first page of the vertex arena is drawn by attached models" << std::endl;
+	attached++;
+
+	result.vertexCount = (slotSize * slotsPerPage) / vertexSize;
+	result.vertexBuffer = pages[0].buffer;
+	result.vertexBufferMemory = VK_NULL_HANDLE;
+	result.vertexOffset = 0;
+	result.arenaSlot = noSlot;
+}
+
+void VertexArena::release(unsigned slot, VulkanEnvironment* e)
+{
+	const std::lock_guard<std::mutex> lock(mutArena);
+
+	if (slot == noSlot)
+	{
+		if (!--attached) slotsUsed = 0;		// Slots filled for the attached models are discarded with them
+	}
+	else if (pages.size())
+	{
+		freeSlots.push_back(slot);
+		slotsUsed--;
+	}
+
+	freePages(e);
+}
+
+uint32_t VertexArena::getFirstVertex(unsigned slot) { return ((slot % slotsPerPage) * slotSize) / vertexSize; }
+
+void VertexArena::newPage(VulkanEnvironment* e)
+{
+	Page page;
+
+	createBuffer(
+		e,
+		slotSize * slotsPerPage,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		page.buffer,
+		page.memory);
+
+	unsigned firstSlot = pages.size() * slotsPerPage;
+	for (unsigned i = slotsPerPage; i > 0; i--)		// Lower slots are taken first
+		freeSlots.push_back(firstSlot + i - 1);
+
+	pages.push_back(page);
+}
+
+bool VertexArena::takeSlot(unsigned& slot, VulkanEnvironment* e)
+{
+	if (freeSlots.empty())
+	{
+		if (maxPages && pages.size() >= maxPages) return false;
+		newPage(e);
+	}
+
+	slot = freeSlots.back();
+	freeSlots.pop_back();
+	slotsUsed++;
+	return true;
+}
+
+void VertexArena::freePages(VulkanEnvironment* e)
+{
+	if (slotsUsed || attached) return;
+
+	for (Page& page : pages)
+	{
+		vkDestroyBuffer(e->c.device, page.buffer, nullptr);
+		vkFreeMemory(e->c.device, page.memory, nullptr);
+		e->c.memAllocObjects--;
+	}
+
+	pages.clear();
+	freeSlots.clear();
+}
+
+size_t VertexArena::getNumPages()
+{
+	const std::lock_guard<std::mutex> lock(mutArena);
+	return pages.size();
+}
+
+size_t VertexArena::getNumSlotsUsed()
+{
+	const std::lock_guard<std::mutex> lock(mutArena);
+	return slotsUsed;
+}
+
 VerticesLoader::VerticesLoader() : loader(nullptr) { }
 
 VerticesLoader::VerticesLoader(std::string& filePath)
@@ -353,6 +619,18 @@ VerticesLoader::VerticesLoader(size_t vertexSize, const void* verticesData, size
 	loader = new VLM_fromBuffer(verticesData, vertexSize, vertexCount, indices);
 }
 
+VerticesLoader::VerticesLoader(size_t vertexSize, const void* verticesData, size_t vertexCount, std::shared_ptr<SharedIndexBuffer> indices, std::shared_ptr<VertexArena> arena)
+	: loader(nullptr)
+{ 
+	loader = new VLM_fromBuffer(verticesData, vertexSize, vertexCount, indices, arena);
+}
+
+VerticesLoader::VerticesLoader(std::shared_ptr<VertexArena> arena, std::shared_ptr<SharedIndexBuffer> indices)
+	: loader(nullptr)
+{ 
+	loader = new VLM_fromArena(arena, indices);
+}
+
 VerticesLoader::VerticesLoader(const VerticesLoader& obj)
 {
 	if (obj.loader) loader = obj.loader->clone();
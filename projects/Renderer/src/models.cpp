@@ -16,6 +16,8 @@ ModelDataInfo::ModelDataInfo()
 	maxDescriptorsCount_fs(1), 
 	UBOsize_vs(8),
 	UBOsize_fs(8),
+	storageBuffer_vs(false),
+	maxIndirectDraws(0),
 	transparency(false),
 	renderPassIndex(0),
 	cullMode(VK_CULL_MODE_BACK_BIT)
@@ -29,8 +31,10 @@ ModelData::ModelData(VulkanEnvironment& environment, ModelDataInfo& modelInfo)
 	vertexType(modelInfo.vertexType),
 	hasTransparencies(modelInfo.transparency),
 	cullMode(modelInfo.cullMode),
-	vsUBO(e, modelInfo.maxDescriptorsCount_vs, modelInfo.UBOsize_vs, e->c.deviceData.minUniformBufferOffsetAlignment),
+	vsUBO(e, modelInfo.maxDescriptorsCount_vs, modelInfo.UBOsize_vs, e->c.deviceData.minUniformBufferOffsetAlignment, modelInfo.storageBuffer_vs ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT),
 	fsUBO(e, modelInfo.maxDescriptorsCount_fs, modelInfo.UBOsize_fs, e->c.deviceData.minUniformBufferOffsetAlignment),
+	drawCommands(e, 1, modelInfo.maxIndirectDraws * sizeof(VkDrawIndexedIndirectCommand), sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT),
+	maxIndirectDraws(modelInfo.maxIndirectDraws),
 	renderPassIndex(modelInfo.renderPassIndex),
 	layer(modelInfo.layer),
 	activeInstances(modelInfo.activeInstances),
@@ -80,6 +84,7 @@ ModelData& ModelData::fullConstruction(std::list<Shader>& loadedShaders, std::li
 
 	vsUBO.createUniformBuffers();
 	fsUBO.createUniformBuffers();
+	drawCommands.createUniformBuffers();
 	createDescriptorPool();
 	createDescriptorSets();
 
@@ -102,7 +107,7 @@ void ModelData::createDescriptorSetLayout()
 	{
 		VkDescriptorSetLayoutBinding vsUboLayoutBinding{};
 		vsUboLayoutBinding.binding = bindNumber++;
-		vsUboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;			// VK_DESCRIPTOR_TYPE_ ... UNIFORM_BUFFER, UNIFORM_BUFFER_DYNAMIC
+		vsUboLayoutBinding.descriptorType = vsUBO.getDescriptorType();					// VK_DESCRIPTOR_TYPE_ ... UNIFORM_BUFFER, UNIFORM_BUFFER_DYNAMIC, STORAGE_BUFFER
 		vsUboLayoutBinding.descriptorCount = vsUBO.maxUBOcount;							// In case you want to specify an array of UBOs <<< (example: for specifying a transformation for each bone in a skeleton for skeletal animation).
 		vsUboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;						// Tell in which shader stages the descriptor will be referenced. This field can be a combination of VkShaderStageFlagBits values or the value VK_SHADER_STAGE_ALL_GRAPHICS.
 		vsUboLayoutBinding.pImmutableSamplers = nullptr;								// [Optional] Only relevant for image sampling related descriptors.
@@ -373,7 +378,7 @@ void ModelData::createDescriptorPool()
 
 	if (vsUBO.range)
 	{
-		pool.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;								// VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER or VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+		pool.type = vsUBO.getDescriptorType();										// VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC or VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
 		pool.descriptorCount = static_cast<uint32_t>(e->swapChain.images.size());	// Number of descriptors of this type to allocate
 		poolSizes.push_back(pool);
 	}
@@ -480,7 +485,7 @@ void ModelData::createDescriptorSets()
 			descriptor.dstSet = descriptorSets[i];
 			descriptor.dstBinding = binding++;
 			descriptor.dstArrayElement = 0;
-			descriptor.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			descriptor.descriptorType = vsUBO.getDescriptorType();
 			descriptor.descriptorCount = vsUBO.maxUBOcount;
 			descriptor.pBufferInfo = bufferInfo_vs.data();
 			descriptor.pImageInfo = nullptr;
@@ -552,6 +557,7 @@ void ModelData::recreate_Pipeline_Descriptors()
 
 	vsUBO.createUniformBuffers();	// Uniform buffers depend on the number of swap chain images.
 	fsUBO.createUniformBuffers();
+	drawCommands.createUniformBuffers();
 	createDescriptorPool();				// Descriptor pool depends on the swap chain images.
 	createDescriptorSets();				// Descriptor sets
 }
@@ -569,6 +575,7 @@ void ModelData::cleanup_Pipeline_Descriptors()
 	// Uniform buffers & memory
 	vsUBO.destroyUniformBuffers();
 	fsUBO.destroyUniformBuffers();
+	drawCommands.destroyUniformBuffers();
 
 	// Descriptor pool & Descriptor set (When a descriptor pool is destroyed, all descriptor-sets allocated from the pool are implicitly/automatically freed and become invalid)
 	vkDestroyDescriptorPool(e->c.device, descriptorPool, nullptr);
@@ -584,7 +591,12 @@ void ModelData::cleanup()
 	vkDestroyDescriptorSetLayout(e->c.device, descriptorSetLayout, nullptr);
 
 	// Index
-	if (vert.indexCount)
+	if (vert.sharedIndices)
+	{
+		vert.sharedIndices->release(e);
+		vert.sharedIndices.reset();
+	}
+	else if (vert.indexCount)
 	{
 		vkDestroyBuffer(e->c.device, vert.indexBuffer, nullptr);
 		vkFreeMemory(e->c.device, vert.indexBufferMemory, nullptr);
@@ -592,9 +604,17 @@ void ModelData::cleanup()
 	}
 
 	// Vertex
-	vkDestroyBuffer(e->c.device, vert.vertexBuffer, nullptr);
-	vkFreeMemory(e->c.device, vert.vertexBufferMemory, nullptr);
-	e->c.memAllocObjects--;
+	if (vert.arena)
+	{
+		vert.arena->release(vert.arenaSlot, e);
+		vert.arena.reset();
+	}
+	else
+	{
+		vkDestroyBuffer(e->c.device, vert.vertexBuffer, nullptr);
+		vkFreeMemory(e->c.device, vert.vertexBufferMemory, nullptr);
+		e->c.memAllocObjects--;
+	}
 }
 
 void ModelData::deleteLoader()
@@ -216,6 +216,7 @@ Renderer::Renderer(void(*graphicsUpdate)(Renderer&, glm::mat4 view, glm::mat4 pr
 	userUpdate(graphicsUpdate), 
 	currentFrame(0), 
 	commandsCount(0),
+	recordingTime(0),
 	worker(500, models, modelsToLoad, modelsToDelete, textures, shaders, updateCommandBuffer)
 { 
 	#ifdef DEBUG_RENDERER
@@ -239,6 +240,7 @@ void Renderer::createCommandBuffers()
 		std::cout << typeid(*this).name() << "::" << __func__ << " BEGIN" << std::endl;
 	#endif
 
+	std::chrono::high_resolution_clock::time_point recordingStart = std::chrono::high_resolution_clock::now();
 	commandsCount = 0;
 
 	// Commmand buffer allocation
@@ -322,10 +324,18 @@ void Renderer::createCommandBuffers()
 				else
 					vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, it->pipelineLayout, 0, 1, &it->descriptorSets[i], 0, 0);
 
-				if (it->vert.indexCount)		// has indices
-					vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(it->vert.indexCount), it->activeInstances, 0, 0, 0);
+				if (it->maxIndirectDraws)		// draw commands are read from drawCommands (they can change without recording the command buffer again)
+				{
+					if (e.c.deviceData.multiDrawIndirect)
+						vkCmdDrawIndexedIndirect(commandBuffers[i], it->drawCommands.uniformBuffers[i], 0, it->maxIndirectDraws, sizeof(VkDrawIndexedIndirectCommand));
+					else
+						for (uint32_t k = 0; k < it->maxIndirectDraws; k++)
+							vkCmdDrawIndexedIndirect(commandBuffers[i], it->drawCommands.uniformBuffers[i], k * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+				}
+				else if (it->vert.indexCount)	// has indices
+					vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(it->vert.indexCount), it->activeInstances, 0, it->vert.vertexOffset, 0);
 				else
-					vkCmdDraw(commandBuffers[i], it->vert.vertexCount, it->activeInstances, 0, 0);
+					vkCmdDraw(commandBuffers[i], it->vert.vertexCount, it->activeInstances, it->vert.vertexOffset, 0);
 
 				commandsCount++;
 			}
@@ -370,6 +380,7 @@ void Renderer::createCommandBuffers()
 	}
 	
 	updateCommandBuffer = false;
+	recordingTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - recordingStart).count();
 	
 	#if defined(DEBUG_RENDERER) || defined(DEBUG_COMMANDBUFFERS)
 		std::cout << typeid(*this).name() << "::" << __func__ << " END" << std::endl;
@@ -823,6 +834,14 @@ void Renderer::updateStates(uint32_t currentImage)
 				memcpy(data, it->fsUBO.ubo.data(), it->fsUBO.totalBytes);
 				vkUnmapMemory(e.c.device, it->fsUBO.uniformBuffersMemory[currentImage]);
 			}
+
+			if (it->drawCommands.totalBytes)
+			{
+				void* data;
+				vkMapMemory(e.c.device, it->drawCommands.uniformBuffersMemory[currentImage], 0, it->drawCommands.totalBytes, 0, &data);
+				memcpy(data, it->drawCommands.ubo.data(), it->drawCommands.totalBytes);
+				vkUnmapMemory(e.c.device, it->drawCommands.uniformBuffersMemory[currentImage]);
+			}
 		}
 
 	// - UPDATE COMMAND BUFFER
@@ -851,6 +870,17 @@ void Renderer::toLastDraw(modelIter model)
 	lastModelsToDraw.push_back(model);
 }
 
+void Renderer::uploadVertices(std::shared_ptr<VertexArena> arena, const std::vector<const void*>& vertexSets, size_t bytes, std::vector<unsigned>& slots)
+{
+	#ifdef DEBUG_RENDERER
+		std::cout << typeid(*this).name() << "::" << __func__ << std::endl;
+	#endif
+
+	arena->upload(vertexSets, bytes, slots, &e);
+}
+
+void Renderer::releaseVertices(std::shared_ptr<VertexArena> arena, unsigned slot) { arena->release(slot, &e); }
+
 TimerSet& Renderer::getTimer() { return timer; }
 
 size_t Renderer::getRendersCount(modelIter model) { return model->activeInstances; }
@@ -859,6 +889,8 @@ size_t Renderer::getModelsCount() { return models[0].size() + models[1].size();
 
 size_t Renderer::getCommandsCount() { return commandsCount; }
 
+float Renderer::getRecordingTime() { return recordingTime; }
+
 size_t Renderer::loadedModels() { return models[0].size() + models[1].size(); }
 
 size_t Renderer::loadedShaders() { return shaders.size(); }
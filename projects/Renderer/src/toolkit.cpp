@@ -1,5 +1,6 @@
 
 #include<iostream>
+#include <algorithm>
 
 #include <glm/gtc/type_ptr.hpp>
 
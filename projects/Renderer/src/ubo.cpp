@@ -11,9 +11,10 @@ Sizes size;
 // (Set of) Uniform Buffer Objects -----------------------------------------------------------------
 
 /// Constructor. Computes sizes (range, totalBytes) and allocates buffers (ubo, offsets).
-UBO::UBO(VulkanEnvironment* e, size_t maxUBOcount, size_t UBOsize, VkDeviceSize minUBOffsetAlignment)
+UBO::UBO(VulkanEnvironment* e, size_t maxUBOcount, size_t UBOsize, VkDeviceSize minUBOffsetAlignment, VkBufferUsageFlags usage)
 	: e(e), 
 	maxUBOcount(maxUBOcount), 
+	usage(usage), 
 	range(UBOsize ? minUBOffsetAlignment * (1 + UBOsize / minUBOffsetAlignment) : 0),
 	totalBytes(range * maxUBOcount),
 	ubo(totalBytes)
@@ -21,6 +22,11 @@ UBO::UBO(VulkanEnvironment* e, size_t maxUBOcount, size_t UBOsize, VkDeviceSize
 
 uint8_t* UBO::getUBOptr(size_t UBOindex) { return ubo.data() + UBOindex * range; }
 
+VkDescriptorType UBO::getDescriptorType() const
+{
+	return (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+}
+
 // (21)
 void UBO::createUniformBuffers()
 {
@@ -34,7 +40,7 @@ void UBO::createUniformBuffers()
 			createBuffer(
 				e,
 				maxUBOcount == 0 ? range : totalBytes,
-				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				usage,
 				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 				uniformBuffers[i],
 				uniformBuffersMemory[i]);
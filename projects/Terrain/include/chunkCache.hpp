@@ -0,0 +1,80 @@
+#ifndef CHUNKCACHE_HPP
+#define CHUNKCACHE_HPP
+
+#include <string>
+#include <unordered_map>
+#include <shared_mutex>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+
+/**
+	Persistent cache of chunks' vertex data, stored in an append-only memory-mapped file. Thread-safe (it can be shared by the 6 faces of a planet).
+	File layout:
+		- Header: magic, format version, configuration hash, record size, end of data.
+		- Records: key (uint64_t) + record data (recordSize bytes). Records are never modified nor removed.
+	The configuration hash identifies everything that defines the records' content (noise parameters, seeds, grid layout...). If the file was made with another hash or record size, it's discarded, so changing the noise invalidates the cache automatically.
+	The file grows by doubling its size and mapping it again. Reads copy data out of the mapping under a shared lock; appends take it exclusively.
+*/
+class ChunkDiskCache
+{
+public:
+	ChunkDiskCache(const std::string& path, uint64_t configHash, size_t recordSize);
+	~ChunkDiskCache();		//!< Unmaps the file and crops it to the end of data
+
+	bool read(uint64_t key, void* dest);				//!< Copy record "key" into "dest" (recordSize bytes). False if not found.
+	bool read(uint64_t key, const std::function<void(const unsigned char* record)>& decode);	//!< Call "decode" with record "key" (recordSize bytes, only valid during the call), without copying it. False if not found.
+	void write(uint64_t key, const void* src);			//!< Append a record (ignored if the key is already stored)
+	void addLoadTime(double ms);						//!< Time spent reading and decoding a record that was found
+	void addGenerationTime(double ms);					//!< Time spent generating a record that wasn't found (for comparing with load time)
+
+	bool isOpen() const;
+	size_t getRecordSize() const;
+	size_t numRecords();
+	size_t numHits() const;
+	size_t numMisses() const;
+	double getLoadTime() const;				//!< Average time (ms) passed to addLoadTime() per successful read()
+	double getGenerationTime() const;		//!< Average time (ms) passed to addGenerationTime()
+
+	static const uint32_t formatVersion;	//!< Increase it when the file layout or the records' meaning change (for instance, the shape of the Multinoise callbacks)
+
+private:
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t recordSize;
+		uint64_t configHash;
+		uint64_t dataEnd;				//!< Offset of the end of the last record
+	};
+
+	const std::string path;
+	const uint64_t configHash;
+	const size_t recordSize;
+
+	std::unordered_map<uint64_t, uint64_t> index;	//!< Key -> offset of the record's data
+	std::shared_mutex mutFile;						//!< for index and the mapping (exclusive when appending or remapping)
+	unsigned char* data;							//!< Mapped file (nullptr if the file couldn't be opened)
+	size_t capacity;								//!< Mapped bytes (file size)
+
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int file;
+#endif
+
+	std::atomic<size_t> hits, misses;
+	std::atomic<int64_t> loadTime, generationTime;	//!< Accumulated (nanoseconds; a load takes a few microseconds)
+
+	Header* header();
+	void reset();							//!< Empty the file and write a new header
+	bool mapFile(size_t size);				//!< Resize the file to "size" bytes and map it
+	void unmapFile();
+	bool resizeFile(size_t size);			//!< Call it while unmapped
+	void closeFile();
+};
+
+
+#endif
@@ -2,8 +2,10 @@
 #define COMPONENTS_HPP
 
 #include <iostream>
+#include <set>
 
 #include "terrain.hpp"
+#include "population.hpp"
 
 //#define GLM_FORCE_RADIANS
 //#define GLM_FORCE_DEPTH_ZERO_TO_ONE		// GLM uses OpenGL depth range [-1.0, 1.0]. This macro forces GLM to use Vulkan range [0.0, 1.0].
@@ -242,15 +244,6 @@ struct c_Model_planet : public c_Model
 	Planet* planet;
 };
 
-struct ModelParams
-{
-	ModelParams(glm::vec3& scale, glm::vec4& rotQuat, glm::vec3& pos) : scale(scale), rotQuat(rotQuat), pos(pos) { }
-
-	glm::vec3 scale = { 1, 1, 1 };
-	glm::vec4 rotQuat = { 1, 0, 0, 0 };
-	glm::vec3 pos = { 0, 0, 0 };		// glm::vec3 translation = { 0, 0, 0 };
-};
-
 /// Determines the Model matrix parameters (scale, rotation, translation/position)
 struct c_ModelParams : public Component
 {
@@ -274,8 +267,6 @@ struct c_Move : public Component
 
 bool itemSupported_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers);
 
-enum RotType {zAxisRandom, allAxesRandom, faceCam};
-
 /// Determines the distribution over a surface of one or more instances of the same model (or set of models).
 struct c_Distributor : public Component
 {
@@ -292,6 +283,7 @@ struct c_Distributor : public Component
 	void printInfo() const { };
 
 	std::map<unsigned, std::vector<ModelParams>> filledChunks;	//!< Stores chunk's population (distributed objects per chunk)
+	std::set<unsigned> orderedChunks;							//!< Chunks whose population is being computed in a worker thread (see PopulationQueue)
 
 	unsigned maxDepth, minDepth;
 	RotType rotType;			//!< Rotation type: 1 (Z axis, random), 2 (all axes, random), 3 (face cam)
@@ -11,6 +11,8 @@
 class EntityFactory : public MainEntityFactory
 {
 	Renderer& renderer;
+	std::shared_ptr<ThreadPool> threadPool;		//!< Worker threads shared by the terrains (planet, sea...) for computing their chunks
+	std::shared_ptr<ChunkScheduler> chunkScheduler;	//!< Shared by the terrains, so chunks' work per frame is bounded and ranked among all of them
 
 public:
 	EntityFactory(Renderer& renderer);
@@ -24,7 +26,7 @@ public:
 	std::vector<Component*> createSun(ShaderLoader Vshader, ShaderLoader Fshader, std::initializer_list<TextureLoader> textures);
 	std::vector<Component*> createSkyBox(ShaderLoader Vshader, ShaderLoader Fshader, std::vector<TextureLoader>& textures);
 	std::vector<Component*> createSphere(ShaderLoader Vshader, ShaderLoader Fshader, std::vector<TextureLoader>& textures);
-	std::vector<Component*> createPlanet(ShaderLoader Vshader, ShaderLoader Fshader, std::vector<TextureLoader>& textures);
+	std::vector<Component*> createPlanet(ShaderLoader Vshader, ShaderLoader VbatchShader, ShaderLoader Fshader, std::vector<TextureLoader>& textures);	//!< VbatchShader: vertex shader for drawing each planet face with a single model (see ChunkBatch)
 	std::vector<Component*> createPlant(ShaderLoader Vshader, ShaderLoader Fshader, std::initializer_list<TextureLoader> textures, VerticesLoader& vertexData, const c_Lights* c_lights);
 	std::vector<Component*> createGrass(ShaderLoader Vshader, ShaderLoader Fshader, std::initializer_list<TextureLoader> textures, VerticesLoader& vertexData, const c_Lights* c_lights);
 	std::vector<Component*> createRock(ShaderLoader Vshader, ShaderLoader Fshader, std::initializer_list<TextureLoader> textures, VerticesLoader& vertexData, const c_Lights* c_lights);
@@ -32,9 +34,4 @@ public:
 	std::vector<std::vector<Component*>> createTree(std::initializer_list<ShaderLoader> trunkShaders, std::initializer_list<ShaderLoader> branchShaders, std::initializer_list<TextureLoader> tex_trunk, std::initializer_list<TextureLoader> tex_branch, VerticesLoader& vertexData_trunk, VerticesLoader& vertexData_branches, const c_Lights* c_lights);
 };
 
-bool grass_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers);
-bool plant_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers);
-bool tree_callback (const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers);
-bool stone_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers);
-
 #endif
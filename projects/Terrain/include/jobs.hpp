@@ -0,0 +1,139 @@
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+
+/**
+	Pool of worker threads that execute jobs (std::function<void()>) taken from a FIFO queue.
+	Used for computing terrain (chunks' vertices) out of the render thread.
+	Process:
+		1. Constructor() (starts worker threads)
+		2. submit() (enqueue jobs) / parallelFor() (run N jobs and wait for them)
+		3. Destructor() (pending jobs are executed before joining threads)
+*/
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned numThreads = 0);		//!< If numThreads == 0, hardware_concurrency - 1 threads are used (at least 1).
+	~ThreadPool();
+
+	void submit(std::function<void()> job);												//!< Enqueue a job. Thread-safe.
+	void parallelFor(size_t count, const std::function<void(size_t)>& job);			//!< Run job(i) for i in [0, count) using the workers and the calling thread. Returns when all of them are done.
+
+	unsigned getNumThreads() const;
+	size_t getNumPendingJobs();					//!< Jobs enqueued but not started yet
+	size_t getNumCompletedJobs() const;			//!< Jobs completed since construction
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutJobs;							//!< for jobs and runThreads
+	std::condition_variable cvJobs;
+	bool runThreads;
+	std::atomic<size_t> completedJobs;
+
+	void workerLoop();
+};
+
+
+/**
+	Bounded queue for several producer and consumer threads that doesn't use locks (D. Vyukov's algorithm).
+	Each cell has a sequence number that tells whether it's free for the producer that reaches it, or full for the consumer that reaches it. Threads claim positions with a CAS and never wait for each other.
+	Capacity is rounded up to a power of 2. push() fails when the queue is full.
+*/
+template<typename T>
+class LockFreeQueue
+{
+public:
+	LockFreeQueue(size_t capacity);
+
+	bool push(const T& item);		//!< False if the queue is full. Thread-safe.
+	bool pop(T& item);				//!< False if the queue is empty. Thread-safe.
+	size_t capacity() const { return mask + 1; }
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	size_t mask;
+	alignas(64) std::atomic<size_t> enqueuePos;		//!< Separate cache lines, so producers and consumers don't invalidate each other's
+	alignas(64) std::atomic<size_t> dequeuePos;
+};
+
+template<typename T>
+LockFreeQueue<T>::LockFreeQueue(size_t capacity)
+	: enqueuePos(0), dequeuePos(0)
+{
+	size_t size = 2;
+	while (size < capacity) size *= 2;
+
+	cells.reset(new Cell[size]);
+	mask = size - 1;
+
+	for (size_t i = 0; i < size; i++)
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template<typename T>
+bool LockFreeQueue<T>::push(const T& item)
+{
+	size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		Cell& cell = cells[pos & mask];
+		intptr_t diff = (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)pos;
+
+		if (diff == 0)				// Free: claim it
+		{
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				cell.item = item;
+				cell.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0) return false;		// Full (the cell still holds an item of the previous lap)
+		else pos = enqueuePos.load(std::memory_order_relaxed);		// Another producer took it
+	}
+}
+
+template<typename T>
+bool LockFreeQueue<T>::pop(T& item)
+{
+	size_t pos = dequeuePos.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		Cell& cell = cells[pos & mask];
+		intptr_t diff = (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+
+		if (diff == 0)				// Full: claim it
+		{
+			if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				item = std::move(cell.item);		// The cell doesn't keep resources of the item
+				cell.sequence.store(pos + mask + 1, std::memory_order_release);		// Free for the next lap
+				return true;
+			}
+		}
+		else if (diff < 0) return false;		// Empty
+		else pos = dequeuePos.load(std::memory_order_relaxed);		// Another consumer took it
+	}
+}
+
+
+#endif
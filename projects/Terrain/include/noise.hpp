@@ -2,6 +2,9 @@
 #define NOISE_HPP
 
 #include <array>
+#include <vector>
+#include <memory>
+#include <cstdint>
 
 #include "FastNoiseLite.h"
 //#include "FastNoise/FastNoise.h"
@@ -14,6 +17,7 @@
 //#define DEBUG_NOISE
 
 
+class ThreadPool;
 class Noiser;
 class SimpleNoise;
 class Multinoise;
@@ -22,7 +26,67 @@ class FractalNoise_Exp;
 class FractalNoise_SplinePts;
 
 
-/// Noise generator
+/// FNV-1a hash of "size" bytes, continuing from "hash". Used for building configuration hashes (see Noiser::getConfigHash()).
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+
+/// Instruction sets the batch loops of the noises are compiled for (see runNoiseKernel()). AVX2 is used without FMA, so both give the same output.
+enum class NoiseIsa { generic, avx2 };
+
+NoiseIsa getNoiseIsa();                     //!< Instruction set of the batch loops: the best one the CPU supports (chosen at startup), unless setNoiseIsa() was called
+bool setNoiseIsa(NoiseIsa isa);             //!< Run the batch loops with this instruction set (for comparing them). False if the CPU or the build doesn't support it. Call it while no noise is being computed.
+const char* getNoiseIsaName(NoiseIsa isa);
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define NOISE_KERNEL inline __attribute__((always_inline))     //!< Batch loop called from runNoiseKernel(). Always inlined, so the kernels compile it for their instruction set (flatten alone gives up on functions with big stack arrays).
+#else
+    #define NOISE_KERNEL inline
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #define NOISE_ISA_DISPATCH
+
+    /// kernel() compiled for AVX2. Every call it makes is inlined into it (flatten), so the loops inside are compiled for AVX2 too (8 floats per vector).
+    template<typename F>
+    __attribute__((target("avx2"), flatten)) void runNoiseKernel_avx2(F& kernel) { kernel(); }
+#endif
+
+/// Run a batch loop (a lambda) with the instruction set of getNoiseIsa(). Only the code inlined into it benefits: virtual calls run the generic code (batch loops dispatch again inside them).
+/// Only loops that vectorize are worth it (the Perlin octave loops and the combining loops of NoiseGraph). Loops that call FastNoiseLite point by point stay generic: inlined into the AVX2 kernel they ran ~10% slower.
+/// Call it once per sub-batch (noiseBatchSize points), not around the loop over sub-batches: GCC then can't prove the lane count is a multiple of the vector width, and leaves the loops scalar.
+template<typename F>
+inline void runNoiseKernel(F&& kernel)
+{
+#ifdef NOISE_ISA_DISPATCH
+    if (getNoiseIsa() == NoiseIsa::avx2) return runNoiseKernel_avx2(kernel);
+#endif
+    kernel();
+}
+
+/**
+    Octaves of a fractal noise worth sampling with a given footprint (spacing between samples). "frequency" is the frequency of the first octave in input units. Footprint 0: all octaves.
+    Octaves whose wavelength is <= 2 * footprint are skipped (they are above the Nyquist limit and only alias). The last one kept fades out instead of being cut off: its weight goes from 1 (wavelength >= 4 * footprint) to 0 (wavelength = 2 * footprint), so the noise changes continuously with the footprint.
+    Returns the octaves as a real number: octave i weighs min(1, octaves - i) (e.g. 5.25: 5 full octaves and a 6th one with weight 0.25). The first octave never fades (>= 1).
+*/
+inline float getLodOctaves(int numOctaves, float frequency, float lacunarity, float footprint)
+{
+    if (footprint <= 0) return (float)numOctaves;
+
+    int octaves = 1;
+
+    for (frequency *= lacunarity; octaves < numOctaves && footprint < 0.5f / frequency; frequency *= lacunarity)     // Nyquist limit
+        octaves++;
+
+    if (octaves == 1) return 1;
+    float fade = 0.5f / (frequency / lacunarity * footprint) - 1;      // Last octave kept: wavelength / (2 * footprint) - 1
+    return octaves - 1 + (fade < 1 ? fade : 1);
+}
+
+/// Footprint that gives the same noise as "footprint" (see getLodOctaves()): 0 if every octave keeps its full weight (same output as getNoise()), otherwise the footprint itself (clamped where only the first octave is left).
+float getLodFootprint(int numOctaves, float frequency, float lacunarity, float footprint);
+
+
+/// Noise generator. getNoise() must be reentrant (no mutable state), since chunks are computed concurrently in worker threads (see ThreadPool).
 class Noiser
 {
 public:
@@ -32,8 +96,21 @@ public:
     virtual float getNoise(float x, float y, float z) = 0;
     virtual float getNoise(float x, float y) = 0;
 
+    /// Batch evaluation: out[i] = getNoise(xs[i], ys[i], zs[i]) for i in [0, n). Default implementation loops over getNoise(). Subclasses override it to avoid one virtual call per sample.
+    /// footprint: Spacing between the samples (world units), e.g. the vertex stride of a chunk. Fractal noises skip or fade the octaves finer than it (see getLodOctaves()). 0: all octaves (same as getNoise()).
+    virtual void getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint = 0);
+    virtual void getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint = 0);
+
+    /// Noise and its gradient (grad = d(noise)/d(x,y,z)). Default implementation uses central differences (6 extra samples). Subclasses with analyticGradient() == true compute it exactly in the same pass.
+    virtual float getNoiseGrad(float x, float y, float z, glm::vec3& grad);
+    virtual void getNoiseGradBatch(const float* xs, const float* ys, const float* zs, float* out, glm::vec3* grads, size_t n, float footprint = 0);
+    virtual bool analyticGradient() const { return false; }   //!< True if getNoiseGrad() is exact and about as cheap as getNoise()
+    virtual float getLodFootprint(float) const { return 0; }    //!< Footprint that gives the same 3D batch output as "footprint" (0 if no octave is skipped or faded, so output is the same as getNoise() and samples can be cached, see HeightCache).
+    virtual uint64_t getConfigHash() const { return 0; }      //!< Hash of the parameters that define the noise (same hash, same output). 0 if unknown (the noise can't be cached on disk).
+
     /// Used for testing purposes. Checks the noise values for a size x size terrain and outputs the absolute maximum and minimum
-    void noiseTester(Noiser* noiser, size_t size) const;        //!< Range: [min, max]
+    void noiseTester(Noiser* noiser, size_t size, ThreadPool* threadPool = nullptr) const;     //!< Range: [min, max]
+    std::array<float, 2> getNoiseRange(size_t size, ThreadPool* threadPool = nullptr);         //!< Range ({min, max}) of the 2D noise at the integer points of [0, size) x [0, size). Rows are computed in parallel if there is a thread pool.
 };
 
 
@@ -51,6 +128,9 @@ public:
 
     float getNoise(float x, float y, float z) override;
     float getNoise(float x, float y) override;
+    void getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint = 0) override;   //!< Single octave: footprint is ignored
+    void getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint = 0) override;
+    uint64_t getConfigHash() const override;
 };
 
 
@@ -58,6 +138,8 @@ public:
 float default3D_callback(float x, float y, float z, std::vector<std::shared_ptr<Noiser>>& noisers);
 float default2D_callback(float x, float y, std::vector<std::shared_ptr<Noiser>>& noisers);
 float getNoise_C_E_PV(float x, float y, float z, std::vector<std::shared_ptr<Noiser>>& noisers);
+void getNoiseBatch_C_E_PV(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint, std::vector<std::shared_ptr<Noiser>>& noisers);    //!< Batch version of getNoise_C_E_PV
+void getNoiseGradBatch_C_E_PV(const float* xs, const float* ys, const float* zs, float* out, glm::vec3* grads, size_t n, float footprint, std::vector<std::shared_ptr<Noiser>>& noisers);   //!< Batch version of getNoise_C_E_PV that also outputs the gradient (chain rule)
 
 /// Noise generator that mixes outputs of different Noiser objects.
 class Multinoise : public Noiser
@@ -66,13 +148,22 @@ class Multinoise : public Noiser
 
     float(*getNoise2D_callback) (float x, float y, std::vector<std::shared_ptr<Noiser>>& noisers);            //!< Callback (stablish here how the different noises interact to produce the final noise)
     float(*getNoise3D_callback) (float x, float y, float z, std::vector<std::shared_ptr<Noiser>>& noisers);   //!< Callback (stablish here how the different noises interact to produce the final noise)
+    void(*getNoiseBatch3D_callback) (const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint, std::vector<std::shared_ptr<Noiser>>& noisers);    //!< Batch equivalent of getNoise3D_callback (optional). If nullptr, getNoise3D_callback is called per sample (and footprint is ignored).
+    void(*getNoiseGradBatch3D_callback) (const float* xs, const float* ys, const float* zs, float* out, glm::vec3* grads, size_t n, float footprint, std::vector<std::shared_ptr<Noiser>>& noisers);   //!< Equivalent of getNoiseBatch3D_callback that also outputs gradients (optional). If nullptr, gradients are computed with central differences.
 
 public:
-    Multinoise(std::vector<std::shared_ptr<Noiser>>& noisers, float(*getNoise3D)(float, float, float, std::vector<std::shared_ptr<Noiser>>&) = default3D_callback, float(*getNoise2D)(float, float, std::vector<std::shared_ptr<Noiser>>&) = default2D_callback);
+    Multinoise(std::vector<std::shared_ptr<Noiser>>& noisers, float(*getNoise3D)(float, float, float, std::vector<std::shared_ptr<Noiser>>&) = default3D_callback, float(*getNoise2D)(float, float, std::vector<std::shared_ptr<Noiser>>&) = default2D_callback, void(*getNoiseBatch3D)(const float*, const float*, const float*, float*, size_t, float, std::vector<std::shared_ptr<Noiser>>&) = nullptr, void(*getNoiseGradBatch3D)(const float*, const float*, const float*, float*, glm::vec3*, size_t, float, std::vector<std::shared_ptr<Noiser>>&) = nullptr);
     ~Multinoise() { };
 
     float getNoise(float x, float y, float z) override;
     float getNoise(float x, float y) override;
+    void getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint = 0) override;
+    void getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint = 0) override;   //!< 2D noise has no batch callback: footprint is ignored
+    float getNoiseGrad(float x, float y, float z, glm::vec3& grad) override;
+    void getNoiseGradBatch(const float* xs, const float* ys, const float* zs, float* out, glm::vec3* grads, size_t n, float footprint = 0) override;
+    bool analyticGradient() const override;    //!< True if there is a gradient callback and all the noisers used have analytic gradient
+    float getLodFootprint(float footprint) const override;     //!< The biggest of the noisers' ones (0 if there is no batch callback)
+    uint64_t getConfigHash() const override;   //!< Combines the noisers' hashes (callbacks are code, not parameters, so they are not included; PlanetGrid::getConfigHash() samples the output too)
 };
 
 
@@ -80,6 +171,23 @@ class FractalNoise : public Noiser
 {
 protected:
     FastNoiseLite noise;
+    const float frequency = 0.01f;          //!< FastNoiseLite frequency
+    float fractalBounding;                  //!< Same normalization factor FastNoiseLite applies to the octaves' sum
+    float coordScale;                       //!< Factor applied to the input coordinates before sampling (1 / scale; scale in FractalNoise_SplinePts)
+    std::vector<FastNoiseLite> lodNoise;    //!< lodNoise[i]: Same noise with only i + 1 octaves (for footprints that skip the finest ones)
+    std::vector<float> lodBounding;         //!< lodBounding[i]: Factor that turns lodNoise[i]'s output into the sum of its octaves normalized by fractalBounding (FastNoiseLite normalizes each number of octaves differently)
+    std::vector<FastNoiseLite> octaveNoise; //!< octaveNoise[i]: Octave i + 1 alone (for fading the last octave without sampling the others twice)
+    std::vector<float> octaveAmplitude;     //!< octaveAmplitude[i]: Weight of octaveNoise[i] in the normalized sum
+
+    float getNumOctaves(float footprint) const;                                 //!< Octaves worth sampling with this footprint (see getLodOctaves())
+    float getLodNoise(float octaves, float x, float y, float z);                //!< Same as noise.GetNoise(x, y, z), but only with the first "octaves" octaves (the last one weighted by its fractional part)
+    float getLodNoise(float octaves, float x, float y);
+    void getLodNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint);  //!< out[i] = getLodNoise(getNumOctaves(footprint), xs[i], ys[i], zs[i]) (noise coordinates). Perlin noise is computed octave by octave over the whole batch, which vectorizes (see NoiseFbm::valueBatch()). Other types, point by point.
+    void getLodNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint);                   //!< 2D version. Here the footprint is in noise coordinates (2D and 3D scale coordinates differently in FractalNoise_SplinePts).
+    float getRawNoiseGrad(float x, float y, float z, glm::vec3& grad, float octaves);  //!< Same as getLodNoise(octaves, x, y, z), plus its gradient. Only for NoiseType_Perlin (otherwise, central differences are used).
+    float getLodNoiseGrad(float x, float y, float z, glm::vec3& grad, float octaves);  //!< getNoiseGrad() with only the first "octaves" octaves
+    virtual float toNoiseCoord(float x) const { return x / scale; }                    //!< Input coordinate to noise coordinate (3D)
+    virtual float processNoiseGrad(float value, glm::vec3& grad);                      //!< Turn the raw noise and its gradient (getRawNoiseGrad() at toNoiseCoord()) into this noise's output (subclasses apply their processing)
 
     FastNoiseLite::NoiseType noiseType;     //!< FastnoiseLite::NoiseType_ ... OpenSimplex2, OpenSimplex2S, Cellular, Perlin, ValueCubic, Value
     int numOctaves;                         //!< Layers with different contributions each (by default, frequency doubles and amplitude halfs)
@@ -106,6 +214,13 @@ public:
 
     virtual float getNoise(float x, float y, float z) override;
     virtual float getNoise(float x, float y) override;
+    virtual void getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint = 0) override;
+    virtual void getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint = 0) override;
+    float getNoiseGrad(float x, float y, float z, glm::vec3& grad) override;
+    void getNoiseGradBatch(const float* xs, const float* ys, const float* zs, float* out, glm::vec3* grads, size_t n, float footprint = 0) override;
+    bool analyticGradient() const override;
+    float getLodFootprint(float footprint) const override;
+    uint64_t getConfigHash() const override;
 
     friend std::ostream& operator << (std::ostream& os, const FractalNoise& obj);
 };
@@ -152,17 +267,22 @@ public:
     // Get noise after the full process. Computations performed by FastNoise (Octaves, Lacunarity, Persistence) and this method (Scale, Multiplier, Degree).
     float getNoise(float x, float y, float z) override;
     float getNoise(float x, float y) override;
+    void getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint = 0) override;
+    void getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint = 0) override;
+    uint64_t getConfigHash() const override;
+
+protected:
+    float processNoiseGrad(float value, glm::vec3& grad) override;
 };
 
 
 class FractalNoise_SplinePts : public FractalNoise
 {
     float lerp(float a, float b, float t);
+    float applySpline(float value);                     //!< Map a noise value (range [-1, 1]) to its final value using the spline points
+    float applySpline(float value, float& slope);       //!< Same, but also outputs the derivative of the spline at that value
 
     std::vector<std::array<float, 2>> splinePts;       // pair(noiseValue, finalValue)  (noise values must cover range [-1, 1])
-  
-    float value;    // helper
-    unsigned i;     // helper
 
 public:
     FractalNoise_SplinePts(
@@ -177,6 +297,13 @@ public:
 
     float getNoise(float x, float y, float z) override;
     float getNoise(float x, float y) override;
+    void getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint = 0) override;
+    void getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint = 0) override;
+    uint64_t getConfigHash() const override;
+
+protected:
+    float toNoiseCoord(float x) const override { return x * scale; }
+    float processNoiseGrad(float value, glm::vec3& grad) override;
 };
 
 
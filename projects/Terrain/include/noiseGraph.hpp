@@ -0,0 +1,905 @@
+#ifndef NOISEGRAPH_HPP
+#define NOISEGRAPH_HPP
+
+#include <iostream>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <memory>
+#include <cstring>
+#include <cmath>
+#include <type_traits>
+#include <algorithm>
+#include <utility>
+
+#include "glm/glm.hpp"
+
+#include "noise.hpp"
+
+/*
+	Noise graphs composed at compile time: the type of the graph is the expression that computes the noise, so the compiler inlines the whole function into the batch loops (no virtual calls, no callbacks, no per-call allocations).
+	Every node evaluates its value (value()) and its value with gradient (dual()). Combinators use the same generic lambda for both (NoiseDual implements the chain rule).
+	Batches are evaluated node by node and octave by octave over the whole batch (valueBatch(), dualBatch()), so each loop is short and uniform and the compiler can vectorize it.
+
+	NoiseDual
+	Nodes:
+		NoisePerlin (source)
+		NoiseFbm (fractal)
+		NoiseSpline (remap with a uniform LUT)
+		NoiseCombine (arithmetic: noiseCombine(), operators +, -, *)
+	NoiseGraph (Noiser adapter)
+
+	Example (planet height): makeNoiseGraph(noiseCombine([](auto c, auto e, auto pv) { return e * (c * 200.f + pv * 600.f * noiseMax(c, 0.f)); }, C, E, PV))
+*/
+
+
+// NoiseDual -------------------------------
+
+/// Value and gradient of a noise at a point. Arithmetic operators apply the chain rule, so expressions written for float work for NoiseDual too (see noiseCombine()).
+struct NoiseDual
+{
+	float value;
+	glm::vec3 grad;
+
+	NoiseDual(float value = 0, glm::vec3 grad = glm::vec3(0)) : value(value), grad(grad) { }
+};
+
+inline NoiseDual operator+(const NoiseDual& a, const NoiseDual& b) { return NoiseDual(a.value + b.value, a.grad + b.grad); }
+inline NoiseDual operator-(const NoiseDual& a, const NoiseDual& b) { return NoiseDual(a.value - b.value, a.grad - b.grad); }
+inline NoiseDual operator*(const NoiseDual& a, const NoiseDual& b) { return NoiseDual(a.value * b.value, a.grad * b.value + b.grad * a.value); }
+inline NoiseDual operator+(const NoiseDual& a, float b) { return NoiseDual(a.value + b, a.grad); }
+inline NoiseDual operator+(float a, const NoiseDual& b) { return NoiseDual(a + b.value, b.grad); }
+inline NoiseDual operator-(const NoiseDual& a, float b) { return NoiseDual(a.value - b, a.grad); }
+inline NoiseDual operator-(float a, const NoiseDual& b) { return NoiseDual(a - b.value, -b.grad); }
+inline NoiseDual operator*(const NoiseDual& a, float b) { return NoiseDual(a.value * b, a.grad * b); }
+inline NoiseDual operator*(float a, const NoiseDual& b) { return NoiseDual(a * b.value, b.grad * a); }
+
+inline float noiseMax(float a, float b) { return a > b ? a : b; }
+inline NoiseDual noiseMax(const NoiseDual& a, float b) { return a.value > b ? a : NoiseDual(b); }	//!< Gradient of the selected side
+inline float noiseMin(float a, float b) { return a < b ? a : b; }
+inline NoiseDual noiseMin(const NoiseDual& a, float b) { return a.value < b ? a : NoiseDual(b); }
+
+
+// Nodes -------------------------------
+
+const size_t noiseBatchSize = 256;		//!< Max. points per valueBatch() / dualBatch() call (NoiseGraph splits bigger batches), so nodes keep their intermediate results on the stack
+
+/// Points processed by the inner loops of a batch of n points: n rounded up to the widest vector (8 floats, AVX2; see runNoiseKernel()). With -O2, GCC only vectorizes loops whose trip count is a multiple of the vector width (no scalar epilogue). The extra lanes are computed on padding and discarded.
+inline size_t noiseBatchLanes(size_t n) { return (n + 7) & ~size_t(7); }
+
+/**
+	Base of the graph nodes (only used for recognizing them in operators). A node provides:
+		float value(float x, float y, float z, float footprint) const		(footprint: spacing between samples, see Noiser::getNoiseBatch(). 0: full detail)
+		NoiseDual dual(float x, float y, float z, float footprint) const	(gradient with respect to x, y, z)
+		void valueBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint) const		(value() of n <= noiseBatchSize points. Same results.)
+		void dualBatch(const float* xs, const float* ys, const float* zs, NoiseDual* out, size_t n, float footprint) const	(dual() of n <= noiseBatchSize points. Same results.)
+		float lodFootprint(float footprint) const							(see Noiser::getLodFootprint())
+		uint64_t hash(uint64_t hash) const									(continue a configuration hash with its parameters, see Noiser::getConfigHash())
+*/
+struct NoiseNode { };
+
+template<typename T> struct IsNoiseNode : std::is_base_of<NoiseNode, T> { };
+
+/// Single octave of Perlin noise, identical to FastNoiseLite's SinglePerlin (same hashing, gradients and interpolation). Range: [-1, 1]. Used as source of NoiseFbm. The batch versions repeat the computation inside their loops (a call per point wouldn't be inlined there, and the loop wouldn't vectorize). 2D noise isn't a slice of 3D noise: FastNoiseLite uses other gradients for it.
+struct NoisePerlin
+{
+	static float value(int seed, float x, float y, float z);
+	static NoiseDual dual(int seed, float x, float y, float z);
+	static void valueBatch(int seed, const float* px, const float* py, const float* pz, float weight, float* sum, size_t n);							//!< sum[i] += value(seed, px[i], py[i], pz[i]) * weight. px, py, pz hold noiseBatchLanes(n) points.
+	static void dualBatch(int seed, const float* px, const float* py, const float* pz, float weight, float gradWeight, NoiseDual* sum, size_t n);	//!< sum[i] += dual(seed, px[i], py[i], pz[i]) (value * weight, gradient * gradWeight). px, py, pz hold noiseBatchLanes(n) points.
+	static void valueBatch(int seed, const float* px, const float* py, float weight, float* sum, size_t n);											//!< 2D: sum[i] += (FastNoiseLite's 2D SinglePerlin at px[i], py[i]) * weight. px, py hold noiseBatchLanes(n) points.
+
+private:
+	static constexpr int primeX = 501125321, primeY = 1136930381, primeZ = 1720413743;
+	static constexpr float normalizer = 0.964921414852142333984375f;
+	static constexpr float gradients[256] =		//!< FastNoiseLite's Lookup::Gradients3D
+	{
+		0, 1, 1, 0,  0,-1, 1, 0,  0, 1,-1, 0,  0,-1,-1, 0,
+		1, 0, 1, 0, -1, 0, 1, 0,  1, 0,-1, 0, -1, 0,-1, 0,
+		1, 1, 0, 0, -1, 1, 0, 0,  1,-1, 0, 0, -1,-1, 0, 0,
+		0, 1, 1, 0,  0,-1, 1, 0,  0, 1,-1, 0,  0,-1,-1, 0,
+		1, 0, 1, 0, -1, 0, 1, 0,  1, 0,-1, 0, -1, 0,-1, 0,
+		1, 1, 0, 0, -1, 1, 0, 0,  1,-1, 0, 0, -1,-1, 0, 0,
+		0, 1, 1, 0,  0,-1, 1, 0,  0, 1,-1, 0,  0,-1,-1, 0,
+		1, 0, 1, 0, -1, 0, 1, 0,  1, 0,-1, 0, -1, 0,-1, 0,
+		1, 1, 0, 0, -1, 1, 0, 0,  1,-1, 0, 0, -1,-1, 0, 0,
+		0, 1, 1, 0,  0,-1, 1, 0,  0, 1,-1, 0,  0,-1,-1, 0,
+		1, 0, 1, 0, -1, 0, 1, 0,  1, 0,-1, 0, -1, 0,-1, 0,
+		1, 1, 0, 0, -1, 1, 0, 0,  1,-1, 0, 0, -1,-1, 0, 0,
+		0, 1, 1, 0,  0,-1, 1, 0,  0, 1,-1, 0,  0,-1,-1, 0,
+		1, 0, 1, 0, -1, 0, 1, 0,  1, 0,-1, 0, -1, 0,-1, 0,
+		1, 1, 0, 0, -1, 1, 0, 0,  1,-1, 0, 0, -1,-1, 0, 0,
+		1, 1, 0, 0,  0,-1, 1, 0, -1, 1, 0, 0,  0,-1,-1, 0
+	};
+
+	static constexpr float normalizer2D = 1.4247691104677813f;
+	static constexpr float gradients2D[256] =	//!< FastNoiseLite's Lookup::Gradients2D
+	{
+		0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+		0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+		0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+		-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+		-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+		-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+		0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+		0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+		0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+		-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+		-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+		-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+		0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+		0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+		0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+		-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+		-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+		-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+		0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+		0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+		0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+		-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+		-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+		-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+		0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+		0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+		0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+		-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+		-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+		-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+		0.38268343236509f, 0.923879532511287f, 0.923879532511287f, 0.38268343236509f, 0.923879532511287f, -0.38268343236509f, 0.38268343236509f, -0.923879532511287f,
+		-0.38268343236509f, -0.923879532511287f, -0.923879532511287f, -0.38268343236509f, -0.923879532511287f, 0.38268343236509f, -0.38268343236509f, 0.923879532511287f
+	};
+
+	static int hashCoords(int seed, int xPrimed, int yPrimed, int zPrimed);		//!< Index of a corner gradient
+	static int hashCoords(int seed, int xPrimed, int yPrimed);					//!< Index of a corner gradient (2D)
+};
+
+/**
+	Fractal Brownian motion of a source (like FastNoiseLite's FBm with weighted strength = 0, and FractalNoise): sum of octaves with increasing frequency (lacunarity) and decreasing amplitude (gain), normalized to the source's range.
+	Coordinates are multiplied by "frequency" first (FractalNoise_SplinePts uses frequency = 0.01 * scale). Octaves finer than the footprint are skipped, and the last one kept is faded (see getLodOctaves()).
+*/
+template<typename Source = NoisePerlin>
+class NoiseFbm : public NoiseNode
+{
+public:
+	NoiseFbm(int seed, int numOctaves, float lacunarity, float gain, float frequency);
+
+	float value(float x, float y, float z, float footprint) const;
+	NoiseDual dual(float x, float y, float z, float footprint) const;
+	void valueBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint) const;
+	void dualBatch(const float* xs, const float* ys, const float* zs, NoiseDual* out, size_t n, float footprint) const;
+	void valueBatch(const float* xs, const float* ys, float* out, size_t n, float footprint) const;		//!< 2D FBm of the source's 2D noise (like FastNoiseLite's). Not part of the node interface (graphs are 3D); used by FractalNoise's 2D batches.
+	float lodFootprint(float footprint) const { return getLodFootprint(numOctaves, frequency, lacunarity, footprint); }
+	uint64_t hash(uint64_t hash) const;
+
+private:
+	int seed;
+	int numOctaves;
+	float lacunarity;
+	float gain;
+	float frequency;
+	float fractalBounding;		//!< 1 / sum of the octaves' amplitudes
+};
+
+/**
+	Remap of a node's value with a piecewise linear spline (points (input, output) covering [-1, 1], as in FractalNoise_SplinePts), precomputed in a uniform LUT of lutSize cells. Lookups are O(1) (no search of the segment).
+	Error with respect to the exact spline is only found in the cells that contain a spline point: at most |slope change| * (2 / lutSize) / 4.
+*/
+template<typename Node, unsigned lutSize = 1024>
+class NoiseSpline : public NoiseNode
+{
+public:
+	NoiseSpline(const Node& input, std::vector<std::array<float, 2>> points);
+
+	float value(float x, float y, float z, float footprint) const;
+	NoiseDual dual(float x, float y, float z, float footprint) const;
+	void valueBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint) const;
+	void dualBatch(const float* xs, const float* ys, const float* zs, NoiseDual* out, size_t n, float footprint) const;
+	float lodFootprint(float footprint) const { return input.lodFootprint(footprint); }
+	uint64_t hash(uint64_t hash) const;
+
+	float remap(float value, float& slope) const;		//!< Spline at "value" (and its derivative)
+
+private:
+	Node input;
+	std::vector<std::array<float, 2>> points;
+	std::array<float, lutSize + 1> lut;					//!< Spline at -1 + 2 * i / lutSize
+};
+
+/**
+	Arithmetic combination of nodes: f(input values...). f must be a generic callable (e.g. a lambda with "auto" parameters) that works with float and with NoiseDual (operators +, -, *, noiseMax(), noiseMin()), so the same expression computes values and gradients. Each input is evaluated once.
+	f is code, not parameters, so it's not included in hash() (like Multinoise callbacks). PlanetGrid::getConfigHash() samples the output, so a change in f still invalidates the disk cache.
+*/
+template<typename F, typename... Nodes>
+class NoiseCombine : public NoiseNode
+{
+public:
+	NoiseCombine(F f, const Nodes&... inputs) : f(f), inputs(inputs...) { }
+
+	float value(float x, float y, float z, float footprint) const { return std::apply([&](const Nodes&... node) { return f(node.value(x, y, z, footprint)...); }, inputs); }
+	NoiseDual dual(float x, float y, float z, float footprint) const { return std::apply([&](const Nodes&... node) { return NoiseDual(f(node.dual(x, y, z, footprint)...)); }, inputs); }
+	void valueBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint) const { combineBatch<float>(xs, ys, zs, out, n, footprint, std::index_sequence_for<Nodes...>()); }
+	void dualBatch(const float* xs, const float* ys, const float* zs, NoiseDual* out, size_t n, float footprint) const { combineBatch<NoiseDual>(xs, ys, zs, out, n, footprint, std::index_sequence_for<Nodes...>()); }
+	float lodFootprint(float footprint) const { return std::apply([&](const Nodes&... node) { return std::max({ 0.f, node.lodFootprint(footprint)... }); }, inputs); }		//!< The biggest of the inputs' ones
+	uint64_t hash(uint64_t hash) const
+	{
+		const char* name = "NoiseCombine";
+		hash = hashBytes(name, strlen(name), hash);
+		std::apply([&](const Nodes&... node) { ((hash = node.hash(hash)), ...); }, inputs);
+		return hash;
+	}
+
+private:
+	F f;
+	std::tuple<Nodes...> inputs;
+
+	/// Each input over the whole batch (into a buffer of its own), then f over the whole batch
+	template<typename T, size_t... I>
+	void combineBatch(const float* xs, const float* ys, const float* zs, T* out, size_t n, float footprint, std::index_sequence<I...>) const
+	{
+		T in[sizeof...(Nodes)][noiseBatchSize];
+
+		if constexpr (std::is_same_v<T, float>)
+			(std::get<I>(inputs).valueBatch(xs, ys, zs, in[I], n, footprint), ...);
+		else
+			(std::get<I>(inputs).dualBatch(xs, ys, zs, in[I], n, footprint), ...);
+
+		for (size_t i = 0; i < n; i++)
+			out[i] = T(f(in[I][i]...));
+	}
+};
+
+template<typename F, typename... Nodes>
+NoiseCombine<F, Nodes...> noiseCombine(F f, const Nodes&... inputs) { return NoiseCombine<F, Nodes...>(f, inputs...); }
+
+template<typename A, typename B, typename = std::enable_if_t<IsNoiseNode<A>::value && IsNoiseNode<B>::value>>
+auto operator+(const A& a, const B& b) { return noiseCombine([](auto u, auto v) { return u + v; }, a, b); }
+
+template<typename A, typename B, typename = std::enable_if_t<IsNoiseNode<A>::value && IsNoiseNode<B>::value>>
+auto operator-(const A& a, const B& b) { return noiseCombine([](auto u, auto v) { return u - v; }, a, b); }
+
+template<typename A, typename B, typename = std::enable_if_t<IsNoiseNode<A>::value && IsNoiseNode<B>::value>>
+auto operator*(const A& a, const B& b) { return noiseCombine([](auto u, auto v) { return u * v; }, a, b); }
+
+template<typename A, typename = std::enable_if_t<IsNoiseNode<A>::value>>
+auto operator+(const A& a, float k) { return noiseCombine([k](auto u) { return u + k; }, a); }
+
+template<typename A, typename = std::enable_if_t<IsNoiseNode<A>::value>>
+auto operator*(const A& a, float k) { return noiseCombine([k](auto u) { return u * k; }, a); }
+
+template<typename A, typename = std::enable_if_t<IsNoiseNode<A>::value>>
+auto operator*(float k, const A& a) { return a * k; }
+
+
+// NoiseGraph -------------------------------
+
+/// Noiser adapter of a graph, so it can be used wherever a Noiser is expected (PlanetGrid, HeightCache, Planet...). Gradients are analytic. 2D noise is the graph at z = 0.
+template<typename Node>
+class NoiseGraph : public Noiser
+{
+	Node root;
+
+public:
+	NoiseGraph(const Node& root) : root(root) { }
+
+	float getNoise(float x, float y, float z) override { return root.value(x, y, z, 0); }
+	float getNoise(float x, float y) override { return root.value(x, y, 0, 0); }
+
+	void getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint = 0) override
+	{
+		for (size_t first = 0; first < n; first += noiseBatchSize)
+			runNoiseKernel([&] { root.valueBatch(xs + first, ys + first, zs + first, out + first, std::min(noiseBatchSize, n - first), footprint); });
+	}
+
+	void getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint = 0) override
+	{
+		const float zs[noiseBatchSize] = { };
+
+		for (size_t first = 0; first < n; first += noiseBatchSize)
+			runNoiseKernel([&] { root.valueBatch(xs + first, ys + first, zs, out + first, std::min(noiseBatchSize, n - first), footprint); });
+	}
+
+	float getNoiseGrad(float x, float y, float z, glm::vec3& grad) override
+	{
+		NoiseDual result = root.dual(x, y, z, 0);
+		grad = result.grad;
+		return result.value;
+	}
+
+	void getNoiseGradBatch(const float* xs, const float* ys, const float* zs, float* out, glm::vec3* grads, size_t n, float footprint = 0) override
+	{
+		NoiseDual result[noiseBatchSize];
+
+		for (size_t first = 0; first < n; first += noiseBatchSize)
+		{
+			size_t count = std::min(noiseBatchSize, n - first);
+			runNoiseKernel([&] { root.dualBatch(xs + first, ys + first, zs + first, result, count, footprint); });
+
+			for (size_t i = 0; i < count; i++)
+			{
+				out[first + i] = result[i].value;
+				grads[first + i] = result[i].grad;
+			}
+		}
+	}
+
+	bool analyticGradient() const override { return true; }
+	float getLodFootprint(float footprint) const override { return root.lodFootprint(footprint); }
+
+	uint64_t getConfigHash() const override
+	{
+		const char* name = "NoiseGraph";
+		return root.hash(hashBytes(name, strlen(name)));
+	}
+};
+
+template<typename Node>
+std::shared_ptr<Noiser> makeNoiseGraph(const Node& root) { return std::make_shared<NoiseGraph<Node>>(root); }
+
+
+// Definitions ----------------------------------------------------------------
+
+inline int NoisePerlin::hashCoords(int seed, int xPrimed, int yPrimed, int zPrimed)
+{
+	int hash = seed ^ xPrimed ^ yPrimed ^ zPrimed;
+	hash *= 0x27d4eb2d;
+	hash ^= hash >> 15;
+	return hash & (63 << 2);
+}
+
+inline int NoisePerlin::hashCoords(int seed, int xPrimed, int yPrimed)
+{
+	int hash = seed ^ xPrimed ^ yPrimed;
+	hash *= 0x27d4eb2d;
+	hash ^= hash >> 15;
+	return hash & (127 << 1);
+}
+
+inline float NoisePerlin::value(int seed, float x, float y, float z)
+{
+	int x0 = (x >= 0 ? (int)x : (int)x - 1);
+	int y0 = (y >= 0 ? (int)y : (int)y - 1);
+	int z0 = (z >= 0 ? (int)z : (int)z - 1);
+
+	float xd0 = x - x0, yd0 = y - y0, zd0 = z - z0;
+	float xd1 = xd0 - 1, yd1 = yd0 - 1, zd1 = zd0 - 1;
+
+	// Quintic interpolation weights
+	float xs = xd0 * xd0 * xd0 * (xd0 * (xd0 * 6 - 15) + 10);
+	float ys = yd0 * yd0 * yd0 * (yd0 * (yd0 * 6 - 15) + 10);
+	float zs = zd0 * zd0 * zd0 * (zd0 * (zd0 * 6 - 15) + 10);
+
+	x0 *= primeX;
+	y0 *= primeY;
+	z0 *= primeZ;
+	int x1 = x0 + primeX;
+	int y1 = y0 + primeY;
+	int z1 = z0 + primeZ;
+
+	auto corner = [seed](int xp, int yp, int zp, float xd, float yd, float zd)
+	{
+		int i = hashCoords(seed, xp, yp, zp);
+		return xd * gradients[i] + yd * gradients[i | 1] + zd * gradients[i | 2];
+	};
+
+	float n000 = corner(x0, y0, z0, xd0, yd0, zd0), n100 = corner(x1, y0, z0, xd1, yd0, zd0);
+	float n010 = corner(x0, y1, z0, xd0, yd1, zd0), n110 = corner(x1, y1, z0, xd1, yd1, zd0);
+	float n001 = corner(x0, y0, z1, xd0, yd0, zd1), n101 = corner(x1, y0, z1, xd1, yd0, zd1);
+	float n011 = corner(x0, y1, z1, xd0, yd1, zd1), n111 = corner(x1, y1, z1, xd1, yd1, zd1);
+
+	// Trilinear interpolation
+	float xf00 = n000 + xs * (n100 - n000);
+	float xf10 = n010 + xs * (n110 - n010);
+	float xf01 = n001 + xs * (n101 - n001);
+	float xf11 = n011 + xs * (n111 - n011);
+
+	float yf0 = xf00 + ys * (xf10 - xf00);
+	float yf1 = xf01 + ys * (xf11 - xf01);
+
+	return (yf0 + zs * (yf1 - yf0)) * normalizer;
+}
+
+inline NoiseDual NoisePerlin::dual(int seed, float x, float y, float z)
+{
+	int x0 = (x >= 0 ? (int)x : (int)x - 1);
+	int y0 = (y >= 0 ? (int)y : (int)y - 1);
+	int z0 = (z >= 0 ? (int)z : (int)z - 1);
+
+	float xd0 = x - x0, yd0 = y - y0, zd0 = z - z0;
+	float xd1 = xd0 - 1, yd1 = yd0 - 1, zd1 = zd0 - 1;
+
+	// Quintic interpolation weights and their derivatives
+	float xs = xd0 * xd0 * xd0 * (xd0 * (xd0 * 6 - 15) + 10);
+	float ys = yd0 * yd0 * yd0 * (yd0 * (yd0 * 6 - 15) + 10);
+	float zs = zd0 * zd0 * zd0 * (zd0 * (zd0 * 6 - 15) + 10);
+	float dxs = 30 * xd0 * xd0 * (xd0 * (xd0 - 2) + 1);
+	float dys = 30 * yd0 * yd0 * (yd0 * (yd0 - 2) + 1);
+	float dzs = 30 * zd0 * zd0 * (zd0 * (zd0 - 2) + 1);
+
+	x0 *= primeX;
+	y0 *= primeY;
+	z0 *= primeZ;
+	int x1 = x0 + primeX;
+	int y1 = y0 + primeY;
+	int z1 = z0 + primeZ;
+
+	// Corner gradients and their contributions
+	auto gradient = [seed](int xp, int yp, int zp)
+	{
+		int i = hashCoords(seed, xp, yp, zp);
+		return glm::vec3(gradients[i], gradients[i | 1], gradients[i | 2]);
+	};
+
+	glm::vec3 g000 = gradient(x0, y0, z0), g100 = gradient(x1, y0, z0);
+	glm::vec3 g010 = gradient(x0, y1, z0), g110 = gradient(x1, y1, z0);
+	glm::vec3 g001 = gradient(x0, y0, z1), g101 = gradient(x1, y0, z1);
+	glm::vec3 g011 = gradient(x0, y1, z1), g111 = gradient(x1, y1, z1);
+
+	float n000 = xd0 * g000.x + yd0 * g000.y + zd0 * g000.z, n100 = xd1 * g100.x + yd0 * g100.y + zd0 * g100.z;
+	float n010 = xd0 * g010.x + yd1 * g010.y + zd0 * g010.z, n110 = xd1 * g110.x + yd1 * g110.y + zd0 * g110.z;
+	float n001 = xd0 * g001.x + yd0 * g001.y + zd1 * g001.z, n101 = xd1 * g101.x + yd0 * g101.y + zd1 * g101.z;
+	float n011 = xd0 * g011.x + yd1 * g011.y + zd1 * g011.z, n111 = xd1 * g111.x + yd1 * g111.y + zd1 * g111.z;
+
+	// Trilinear interpolation (value and gradient)
+	float xf00 = n000 + xs * (n100 - n000);
+	float xf10 = n010 + xs * (n110 - n010);
+	float xf01 = n001 + xs * (n101 - n001);
+	float xf11 = n011 + xs * (n111 - n011);
+	glm::vec3 dxf00 = g000 + xs * (g100 - g000) + glm::vec3(dxs * (n100 - n000), 0, 0);
+	glm::vec3 dxf10 = g010 + xs * (g110 - g010) + glm::vec3(dxs * (n110 - n010), 0, 0);
+	glm::vec3 dxf01 = g001 + xs * (g101 - g001) + glm::vec3(dxs * (n101 - n001), 0, 0);
+	glm::vec3 dxf11 = g011 + xs * (g111 - g011) + glm::vec3(dxs * (n111 - n011), 0, 0);
+
+	float yf0 = xf00 + ys * (xf10 - xf00);
+	float yf1 = xf01 + ys * (xf11 - xf01);
+	glm::vec3 dyf0 = dxf00 + ys * (dxf10 - dxf00) + glm::vec3(0, dys * (xf10 - xf00), 0);
+	glm::vec3 dyf1 = dxf01 + ys * (dxf11 - dxf01) + glm::vec3(0, dys * (xf11 - xf01), 0);
+
+	return NoiseDual(
+		(yf0 + zs * (yf1 - yf0)) * normalizer,
+		(dyf0 + zs * (dyf1 - dyf0) + glm::vec3(0, 0, dzs * (yf1 - yf0))) * normalizer);
+}
+
+NOISE_KERNEL void NoisePerlin::valueBatch(int seed, const float* px, const float* py, const float* pz, float weight, float* sum, size_t n)
+{
+	float values[noiseBatchSize];		// Local output: it can't alias the inputs, so the loop needs no run-time alias checks
+	size_t lanes = noiseBatchLanes(n);
+
+	for (size_t i = 0; i < lanes; i++)
+	{
+		float x = px[i], y = py[i], z = pz[i];
+		int x0 = (x >= 0 ? (int)x : (int)x - 1);
+		int y0 = (y >= 0 ? (int)y : (int)y - 1);
+		int z0 = (z >= 0 ? (int)z : (int)z - 1);
+
+		float xd0 = x - x0, yd0 = y - y0, zd0 = z - z0;
+		float xd1 = xd0 - 1, yd1 = yd0 - 1, zd1 = zd0 - 1;
+
+		// Quintic interpolation weights
+		float xs = xd0 * xd0 * xd0 * (xd0 * (xd0 * 6 - 15) + 10);
+		float ys = yd0 * yd0 * yd0 * (yd0 * (yd0 * 6 - 15) + 10);
+		float zs = zd0 * zd0 * zd0 * (zd0 * (zd0 * 6 - 15) + 10);
+
+		x0 *= primeX;
+		y0 *= primeY;
+		z0 *= primeZ;
+		int x1 = x0 + primeX;
+		int y1 = y0 + primeY;
+		int z1 = z0 + primeZ;
+
+		auto corner = [seed](int xp, int yp, int zp, float xd, float yd, float zd)
+		{
+			int i = hashCoords(seed, xp, yp, zp);
+			return xd * gradients[i] + yd * gradients[i | 1] + zd * gradients[i | 2];
+		};
+
+		float n000 = corner(x0, y0, z0, xd0, yd0, zd0), n100 = corner(x1, y0, z0, xd1, yd0, zd0);
+		float n010 = corner(x0, y1, z0, xd0, yd1, zd0), n110 = corner(x1, y1, z0, xd1, yd1, zd0);
+		float n001 = corner(x0, y0, z1, xd0, yd0, zd1), n101 = corner(x1, y0, z1, xd1, yd0, zd1);
+		float n011 = corner(x0, y1, z1, xd0, yd1, zd1), n111 = corner(x1, y1, z1, xd1, yd1, zd1);
+
+		// Trilinear interpolation
+		float xf00 = n000 + xs * (n100 - n000);
+		float xf10 = n010 + xs * (n110 - n010);
+		float xf01 = n001 + xs * (n101 - n001);
+		float xf11 = n011 + xs * (n111 - n011);
+
+		float yf0 = xf00 + ys * (xf10 - xf00);
+		float yf1 = xf01 + ys * (xf11 - xf01);
+
+		values[i] = (yf0 + zs * (yf1 - yf0)) * normalizer * weight;
+	}
+
+	for (size_t i = 0; i < std::min(n, lanes); i++)		// n <= lanes: the min only spares GCC a 'maybe uninitialized' warning when the loop is inlined into a kernel
+		sum[i] += values[i];
+}
+
+NOISE_KERNEL void NoisePerlin::dualBatch(int seed, const float* px, const float* py, const float* pz, float weight, float gradWeight, NoiseDual* sum, size_t n)
+{
+	float values[noiseBatchSize], gradX[noiseBatchSize], gradY[noiseBatchSize], gradZ[noiseBatchSize];		// Local outputs (see valueBatch())
+	size_t lanes = noiseBatchLanes(n);
+
+	for (size_t i = 0; i < lanes; i++)
+	{
+		float x = px[i], y = py[i], z = pz[i];
+		int x0 = (x >= 0 ? (int)x : (int)x - 1);
+		int y0 = (y >= 0 ? (int)y : (int)y - 1);
+		int z0 = (z >= 0 ? (int)z : (int)z - 1);
+
+		float xd0 = x - x0, yd0 = y - y0, zd0 = z - z0;
+		float xd1 = xd0 - 1, yd1 = yd0 - 1, zd1 = zd0 - 1;
+
+		// Quintic interpolation weights and their derivatives
+		float xs = xd0 * xd0 * xd0 * (xd0 * (xd0 * 6 - 15) + 10);
+		float ys = yd0 * yd0 * yd0 * (yd0 * (yd0 * 6 - 15) + 10);
+		float zs = zd0 * zd0 * zd0 * (zd0 * (zd0 * 6 - 15) + 10);
+		float dxs = 30 * xd0 * xd0 * (xd0 * (xd0 - 2) + 1);
+		float dys = 30 * yd0 * yd0 * (yd0 * (yd0 - 2) + 1);
+		float dzs = 30 * zd0 * zd0 * (zd0 * (zd0 - 2) + 1);
+
+		x0 *= primeX;
+		y0 *= primeY;
+		z0 *= primeZ;
+		int x1 = x0 + primeX;
+		int y1 = y0 + primeY;
+		int z1 = z0 + primeZ;
+
+		// Corner gradients (component "axis" of corner h: gradients[h | axis]) and their contributions
+		auto lerp = [](auto a, auto b, float t) { return a + t * (b - a); };
+		auto dot = [](int h, float xd, float yd, float zd) { return xd * gradients[h] + yd * gradients[h | 1] + zd * gradients[h | 2]; };
+
+		int h000 = hashCoords(seed, x0, y0, z0), h100 = hashCoords(seed, x1, y0, z0);
+		int h010 = hashCoords(seed, x0, y1, z0), h110 = hashCoords(seed, x1, y1, z0);
+		int h001 = hashCoords(seed, x0, y0, z1), h101 = hashCoords(seed, x1, y0, z1);
+		int h011 = hashCoords(seed, x0, y1, z1), h111 = hashCoords(seed, x1, y1, z1);
+
+		float n000 = dot(h000, xd0, yd0, zd0), n100 = dot(h100, xd1, yd0, zd0);
+		float n010 = dot(h010, xd0, yd1, zd0), n110 = dot(h110, xd1, yd1, zd0);
+		float n001 = dot(h001, xd0, yd0, zd1), n101 = dot(h101, xd1, yd0, zd1);
+		float n011 = dot(h011, xd0, yd1, zd1), n111 = dot(h111, xd1, yd1, zd1);
+
+		// Trilinear interpolation (value and gradient). Each axis' weight adds its derivative to that component of the gradient.
+		float xf00 = lerp(n000, n100, xs);
+		float xf10 = lerp(n010, n110, xs);
+		float xf01 = lerp(n001, n101, xs);
+		float xf11 = lerp(n011, n111, xs);
+
+		float yf0 = lerp(xf00, xf10, ys);
+		float yf1 = lerp(xf01, xf11, ys);
+		values[i] = lerp(yf0, yf1, zs) * normalizer * weight;
+
+		auto corner = [](int h) { return glm::vec3(gradients[h], gradients[h | 1], gradients[h | 2]); };
+		glm::vec3 dxf00 = lerp(corner(h000), corner(h100), xs) + glm::vec3(dxs * (n100 - n000), 0, 0);
+		glm::vec3 dxf10 = lerp(corner(h010), corner(h110), xs) + glm::vec3(dxs * (n110 - n010), 0, 0);
+		glm::vec3 dxf01 = lerp(corner(h001), corner(h101), xs) + glm::vec3(dxs * (n101 - n001), 0, 0);
+		glm::vec3 dxf11 = lerp(corner(h011), corner(h111), xs) + glm::vec3(dxs * (n111 - n011), 0, 0);
+
+		glm::vec3 dyf0 = lerp(dxf00, dxf10, ys) + glm::vec3(0, dys * (xf10 - xf00), 0);
+		glm::vec3 dyf1 = lerp(dxf01, dxf11, ys) + glm::vec3(0, dys * (xf11 - xf01), 0);
+
+		glm::vec3 grad = (lerp(dyf0, dyf1, zs) + glm::vec3(0, 0, dzs * (yf1 - yf0))) * normalizer * gradWeight;
+		gradX[i] = grad.x;
+		gradY[i] = grad.y;
+		gradZ[i] = grad.z;
+	}
+
+	for (size_t i = 0; i < std::min(n, lanes); i++)
+	{
+		sum[i].value += values[i];
+		sum[i].grad += glm::vec3(gradX[i], gradY[i], gradZ[i]);
+	}
+}
+
+NOISE_KERNEL void NoisePerlin::valueBatch(int seed, const float* px, const float* py, float weight, float* sum, size_t n)
+{
+	float values[noiseBatchSize];		// Local output (see the 3D version)
+	size_t lanes = noiseBatchLanes(n);
+
+	for (size_t i = 0; i < lanes; i++)
+	{
+		float x = px[i], y = py[i];
+		int x0 = (x >= 0 ? (int)x : (int)x - 1);
+		int y0 = (y >= 0 ? (int)y : (int)y - 1);
+
+		float xd0 = x - x0, yd0 = y - y0;
+		float xd1 = xd0 - 1, yd1 = yd0 - 1;
+
+		// Quintic interpolation weights
+		float xs = xd0 * xd0 * xd0 * (xd0 * (xd0 * 6 - 15) + 10);
+		float ys = yd0 * yd0 * yd0 * (yd0 * (yd0 * 6 - 15) + 10);
+
+		x0 *= primeX;
+		y0 *= primeY;
+		int x1 = x0 + primeX;
+		int y1 = y0 + primeY;
+
+		auto corner = [seed](int xp, int yp, float xd, float yd)
+		{
+			int i = hashCoords(seed, xp, yp);
+			return xd * gradients2D[i] + yd * gradients2D[i | 1];
+		};
+
+		float n00 = corner(x0, y0, xd0, yd0), n10 = corner(x1, y0, xd1, yd0);
+		float n01 = corner(x0, y1, xd0, yd1), n11 = corner(x1, y1, xd1, yd1);
+
+		// Bilinear interpolation
+		float xf0 = n00 + xs * (n10 - n00);
+		float xf1 = n01 + xs * (n11 - n01);
+
+		values[i] = (xf0 + ys * (xf1 - xf0)) * normalizer2D * weight;
+	}
+
+	for (size_t i = 0; i < std::min(n, lanes); i++)
+		sum[i] += values[i];
+}
+
+template<typename Source>
+NoiseFbm<Source>::NoiseFbm(int seed, int numOctaves, float lacunarity, float gain, float frequency)
+	: seed(seed), numOctaves(numOctaves), lacunarity(lacunarity), gain(gain), frequency(frequency)
+{
+	float amplitude = std::abs(gain);		// Same computation as FastNoiseLite::CalculateFractalBounding
+	float totalAmplitude = 1;
+	for (int i = 1; i < numOctaves; i++)
+	{
+		totalAmplitude += amplitude;
+		amplitude *= std::abs(gain);
+	}
+	fractalBounding = 1 / totalAmplitude;
+}
+
+template<typename Source>
+float NoiseFbm<Source>::value(float x, float y, float z, float footprint) const
+{
+	float octaves = getLodOctaves(numOctaves, frequency, lacunarity, footprint);
+	x *= frequency;
+	y *= frequency;
+	z *= frequency;
+
+	float sum = 0;
+	float amp = fractalBounding;
+
+	for (int i = 0; i < octaves; i++)
+	{
+		float weight = amp * std::min(1.f, octaves - i);		// The last octave may be faded
+		sum += Source::value(seed + i, x, y, z) * weight;
+
+		x *= lacunarity;
+		y *= lacunarity;
+		z *= lacunarity;
+		amp *= gain;
+	}
+
+	return sum;
+}
+
+template<typename Source>
+NoiseDual NoiseFbm<Source>::dual(float x, float y, float z, float footprint) const
+{
+	float octaves = getLodOctaves(numOctaves, frequency, lacunarity, footprint);
+	x *= frequency;
+	y *= frequency;
+	z *= frequency;
+
+	NoiseDual sum;
+	float amp = fractalBounding;
+	float freq = frequency;		// d(octave coordinates) / d(input coordinates)
+
+	for (int i = 0; i < octaves; i++)
+	{
+		NoiseDual octave = Source::dual(seed + i, x, y, z);
+		float weight = amp * std::min(1.f, octaves - i);
+		sum.value += octave.value * weight;
+		sum.grad += octave.grad * (weight * freq);
+
+		x *= lacunarity;
+		y *= lacunarity;
+		z *= lacunarity;
+		freq *= lacunarity;
+		amp *= gain;
+	}
+
+	return sum;
+}
+
+template<typename Source>
+NOISE_KERNEL void NoiseFbm<Source>::valueBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint) const
+{
+	float octaves = getLodOctaves(numOctaves, frequency, lacunarity, footprint);
+	float px[noiseBatchSize], py[noiseBatchSize], pz[noiseBatchSize];		// Coordinates of the current octave (padded with zeros up to noiseBatchLanes(n))
+	float amp = fractalBounding;
+	size_t lanes = noiseBatchLanes(n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		px[i] = xs[i] * frequency;
+		py[i] = ys[i] * frequency;
+		pz[i] = zs[i] * frequency;
+		out[i] = 0;
+	}
+
+	for (size_t i = n; i < lanes; i++)
+		px[i] = py[i] = pz[i] = 0;
+
+	for (int o = 0; o < octaves; o++)
+	{
+		Source::valueBatch(seed + o, px, py, pz, amp * std::min(1.f, octaves - o), out, n);
+
+		for (size_t i = 0; i < lanes; i++)
+		{
+			px[i] *= lacunarity;
+			py[i] *= lacunarity;
+			pz[i] *= lacunarity;
+		}
+		amp *= gain;
+	}
+}
+
+template<typename Source>
+NOISE_KERNEL void NoiseFbm<Source>::dualBatch(const float* xs, const float* ys, const float* zs, NoiseDual* out, size_t n, float footprint) const
+{
+	float octaves = getLodOctaves(numOctaves, frequency, lacunarity, footprint);
+	float px[noiseBatchSize], py[noiseBatchSize], pz[noiseBatchSize];
+	float amp = fractalBounding;
+	float freq = frequency;
+	size_t lanes = noiseBatchLanes(n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		px[i] = xs[i] * frequency;
+		py[i] = ys[i] * frequency;
+		pz[i] = zs[i] * frequency;
+		out[i] = NoiseDual();
+	}
+
+	for (size_t i = n; i < lanes; i++)
+		px[i] = py[i] = pz[i] = 0;
+
+	for (int o = 0; o < octaves; o++)
+	{
+		float weight = amp * std::min(1.f, octaves - o);
+		Source::dualBatch(seed + o, px, py, pz, weight, weight * freq, out, n);
+
+		for (size_t i = 0; i < lanes; i++)
+		{
+			px[i] *= lacunarity;
+			py[i] *= lacunarity;
+			pz[i] *= lacunarity;
+		}
+		freq *= lacunarity;
+		amp *= gain;
+	}
+}
+
+template<typename Source>
+NOISE_KERNEL void NoiseFbm<Source>::valueBatch(const float* xs, const float* ys, float* out, size_t n, float footprint) const
+{
+	float octaves = getLodOctaves(numOctaves, frequency, lacunarity, footprint);
+	float px[noiseBatchSize], py[noiseBatchSize];
+	float amp = fractalBounding;
+	size_t lanes = noiseBatchLanes(n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		px[i] = xs[i] * frequency;
+		py[i] = ys[i] * frequency;
+		out[i] = 0;
+	}
+
+	for (size_t i = n; i < lanes; i++)
+		px[i] = py[i] = 0;
+
+	for (int o = 0; o < octaves; o++)
+	{
+		Source::valueBatch(seed + o, px, py, amp * std::min(1.f, octaves - o), out, n);
+
+		for (size_t i = 0; i < lanes; i++)
+		{
+			px[i] *= lacunarity;
+			py[i] *= lacunarity;
+		}
+		amp *= gain;
+	}
+}
+
+template<typename Source>
+uint64_t NoiseFbm<Source>::hash(uint64_t hash) const
+{
+	const char* name = "NoiseFbm";
+	hash = hashBytes(name, strlen(name), hash);
+	hash = hashBytes(&seed, sizeof(seed), hash);
+	hash = hashBytes(&numOctaves, sizeof(numOctaves), hash);
+	hash = hashBytes(&lacunarity, sizeof(lacunarity), hash);
+	hash = hashBytes(&gain, sizeof(gain), hash);
+	return hashBytes(&frequency, sizeof(frequency), hash);
+}
+
+template<typename Node, unsigned lutSize>
+NoiseSpline<Node, lutSize>::NoiseSpline(const Node& input, std::vector<std::array<float, 2>> points)
+	: input(input), points(points)
+{
+	// If the spline points provided are not enough or don't cover range [-1, 1], you will get noise == 0.
+	if (points.size() < 2)
+	{
+		std::cout << "Not enough spline points provided!" << std::endl;
+		this->points = { {-1, 0}, {1, 0} };
+	}
+	else if (points[0][0] != -1.f || points[points.size() - 1][0] != 1.f)
+	{
+		std::cout << "The provided spline points don't cover range [-1, 1]!" << std::endl;
+		this->points = { {-1, 0}, {1, 0} };
+	}
+
+	size_t segment = 1;
+	for (unsigned i = 0; i <= lutSize; i++)
+	{
+		float x = -1 + 2.f * i / lutSize;
+		while (segment < this->points.size() - 1 && x > this->points[segment][0]) segment++;
+
+		const std::array<float, 2>& a = this->points[segment - 1];
+		const std::array<float, 2>& b = this->points[segment];
+		lut[i] = a[1] + (b[1] - a[1]) * (x - a[0]) / (b[0] - a[0]);
+	}
+}
+
+template<typename Node, unsigned lutSize>
+float NoiseSpline<Node, lutSize>::remap(float value, float& slope) const
+{
+	float t = (value + 1) * (lutSize / 2.f);
+	t = (t > 0 ? (t < lutSize ? t : (float)lutSize) : 0);
+	unsigned i = (unsigned)t;
+	i = (i < lutSize ? i : lutSize - 1);
+
+	slope = (lut[i + 1] - lut[i]) * (lutSize / 2.f);
+	return lut[i] + (lut[i + 1] - lut[i]) * (t - i);
+}
+
+template<typename Node, unsigned lutSize>
+float NoiseSpline<Node, lutSize>::value(float x, float y, float z, float footprint) const
+{
+	float slope;
+	return remap(input.value(x, y, z, footprint), slope);
+}
+
+template<typename Node, unsigned lutSize>
+NoiseDual NoiseSpline<Node, lutSize>::dual(float x, float y, float z, float footprint) const
+{
+	float slope;
+	NoiseDual in = input.dual(x, y, z, footprint);
+	float value = remap(in.value, slope);
+	return NoiseDual(value, in.grad * slope);		// Chain rule
+}
+
+template<typename Node, unsigned lutSize>
+void NoiseSpline<Node, lutSize>::valueBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint) const
+{
+	float slope;
+	input.valueBatch(xs, ys, zs, out, n, footprint);
+
+	for (size_t i = 0; i < n; i++)
+		out[i] = remap(out[i], slope);
+}
+
+template<typename Node, unsigned lutSize>
+void NoiseSpline<Node, lutSize>::dualBatch(const float* xs, const float* ys, const float* zs, NoiseDual* out, size_t n, float footprint) const
+{
+	float slope;
+	input.dualBatch(xs, ys, zs, out, n, footprint);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		out[i].value = remap(out[i].value, slope);
+		out[i].grad *= slope;
+	}
+}
+
+template<typename Node, unsigned lutSize>
+uint64_t NoiseSpline<Node, lutSize>::hash(uint64_t hash) const
+{
+	const char* name = "NoiseSpline";
+	unsigned size = lutSize;
+	hash = hashBytes(name, strlen(name), input.hash(hash));
+	hash = hashBytes(&size, sizeof(size), hash);
+	return hashBytes(points.data(), points.size() * sizeof(points[0]), hash);
+}
+
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef PLANETPATCH_HPP
+#define PLANETPATCH_HPP
+
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "noise.hpp"
+#include "slabPool.hpp"
+
+/*
+	Terrain generation of planet chunks. It doesn't depend on the renderer, so it can be used (and measured) without a window or a GPU device (see TerrainBenchmark).
+
+	HeightCache
+	PlanetVertex
+	PlanetPatch (HeightCache, PlanetVertex)
+	Ground height queries
+*/
+
+// Height cache -------------------------------
+
+/**
+	Cache of noise samples (height and gradient) of a cube face. Shared by all the chunks of a PlanetGrid (thread-safe).
+	Samples are keyed on their integer coordinates in the lattice of the deepest level (stride = rootCellSize / ((numSideVertex - 1) * 2^(numLevels - 1))). 
+	Since the number of side vertices is X·2^n+1, every vertex of any depth lies on this lattice, so a child reuses 1 of each 2 samples (per side) of its parent, and neighbours share their border rows/columns.
+	Eviction: Two generations of samples. When the recent one is full (maxSamples / 2), it becomes the old one and the old one is discarded. Samples found in the old generation are moved to the recent one.
+	Samples are allocated in a slab pool, and both generations reserve their buckets, so a full cache reuses its memory instead of allocating a node per sample.
+	Only samples with all the octaves (footprint 0) are cached, since they are right for any chunk (borders of every chunk, and every vertex of the chunks that keep all the octaves). Samples with a LOD footprint (see Noiser::getLodFootprint()) are computed on every request, so a coarse chunk's samples (fewer octaves) don't leak into finer chunks nor evict the shared ones.
+*/
+class HeightCache
+{
+public:
+	HeightCache(glm::vec3 cubeSideCenter, float latticeStride, size_t maxSamples);
+
+	/// Get heights (and gradients, if grads != nullptr) of a set of points. Cached samples are reused; the rest are computed with a single batch call and cached. With footprint != 0, all of them are computed and none is cached.
+	void getHeights(Noiser& noiseGen, const glm::vec3* cubePos, const float* xs, const float* ys, const float* zs, float* heights, glm::vec3* grads, size_t n, float footprint = 0);
+	void setMaxSamples(size_t maxSamples);		//!< 0 disables caching (counters keep working)
+
+	size_t numSamples();						//!< Samples currently cached
+	size_t numRequested() const;				//!< Samples requested since construction
+	size_t numNoiseCalls() const;				//!< Samples computed with the noise generator since construction
+
+private:
+	struct Sample
+	{
+		float height;
+		glm::vec3 grad;
+	};
+
+	typedef std::unordered_map<uint64_t, Sample, std::hash<uint64_t>, std::equal_to<uint64_t>, PoolAllocator<std::pair<const uint64_t, Sample>>> SampleMap;		//!< Nodes (and buckets) in slab pools
+
+	SampleMap recent, old;
+	std::mutex mutSamples;						//!< for recent, old and maxSamples
+	const glm::vec3 origin;
+	const float latticeStride;
+	size_t maxSamples;
+	std::atomic<size_t> requested, noiseCalls;
+
+	uint64_t getKey(const glm::vec3& cubePos) const;		//!< Pack the lattice coordinates (21 bits each)
+	bool find(uint64_t key, Sample& sample);				//!< Call it with mutSamples locked
+};
+
+
+
+// Planet patch -------------------------------
+
+enum side{ right, left, up, down };
+
+/**
+	Compact vertex of a PlanetChunk (12 bytes, instead of 36 bytes of vt_333). 
+	Position is reconstructed in the vertex shader from the vertex index and the chunk's grid (see PlanetChunk::getShaderParams()).
+	Vertex type (gap fixing) is deduced from the vertex index too.
+*/
+struct PlanetVertex
+{
+	float height;				//!< Height over the sphere (radius)
+	uint16_t normal[2];			//!< Octahedral-encoded normal (snorm16)
+	uint16_t gapFix[2];			//!< Extra heights for x2 and x4 depth differences (half floats)
+};
+
+/**
+	Vertex data of a rectangular patch of a cube face projected on a sphere and displaced by noise (the terrain of a PlanetChunk or a SphereChunk).
+	Steps of generate(): heights (noise), normals (analytic if the noise provides gradients; from the triangles otherwise), gap-fixing data, and packing into PlanetVertex (optional).
+	Heights are computed with the patch's footprint (its vertex spacing on the sphere), so the noise skips (and fades) the octaves too fine for it (see Noiser::getNoiseBatch()). Border vertices keep all the octaves, so they match the ones of neighbours of any depth (no cracks), and the footprint grows from 0 to the patch's one over the first lodFadeRings rings of vertices, so there is no step next to the border.
+	Its arrays (results and scratch arrays) have a few fixed sizes per grid, so they take memory from slab pools (PooledVector) instead of the heap.
+*/
+class PlanetPatch
+{
+public:
+	PlanetPatch(glm::vec3 baseCenter, glm::vec3 xAxis, glm::vec3 yAxis, float stride, unsigned numHorVertex, unsigned numVertVertex, float radius, glm::vec3 nucleus, Noiser* noiseGen = nullptr, HeightCache* heightCache = nullptr, bool skipFineOctaves = false);	//!< If noiseGen == nullptr, heights are 0 (sphere).
+
+	/// Time spent in each step of generate() (ms)
+	struct Times
+	{
+		double heights;
+		double normals;
+		double gapFixes;
+		double packing;
+	};
+
+	/// Totals of the generate() calls of the process (all threads)
+	struct Stats
+	{
+		size_t patches;
+		Times times;
+	};
+
+	void generate(bool pack);					//!< Compute the vertex data. If pack == true, it's left in compactVertex (and vertex is freed). Otherwise, it's left in vertex.
+
+	PooledVector<float> vertex;					//!< [n][9] (position[3], normal[3], gap-fix data[3]) (vt_333)
+	PooledVector<PlanetVertex> compactVertex;	//!< Packed vertex data (if generate(true))
+	Times times;								//!< Times of the last generate()
+	float footprint;							//!< Footprint used by the last generate() in the interior (0 if the noise didn't skip octaves)
+	bool skipFineOctaves;						//!< Skip the octaves finer than the vertex spacing in the interior (see Noiser::getLodFootprint()). If false, every vertex gets all the octaves.
+
+	static const unsigned numAttribs = 9;
+	static const unsigned lodFadeRings = 4;		//!< Rings of vertices (from the border inwards) over which the footprint grows from 0 to the patch's one
+	static void getFaceAxes(glm::vec3 cubePlane, glm::vec3& xAxis, glm::vec3& yAxis);	//!< Relative XY axes of a cube face (cubePlane must contain 2 zeros)
+	static Stats getStats();
+
+private:
+	const glm::vec3 baseCenter;		//!< Center of the patch in the cube face
+	const glm::vec3 xAxis, yAxis;	//!< Relative XY coordinate system of the cube face
+	const glm::vec3 nucleus;
+	const float stride;
+	const float radius;
+	const unsigned numHorVertex, numVertVertex;
+	Noiser* noiseGen;
+	HeightCache* heightCache;		//!< Optional (nullptr if not used)
+
+	static Stats totals;
+	static std::mutex mutTotals;	//!< for totals
+
+	float getFootprint() const;		//!< Smallest spacing between vertices on the sphere (the projection shrinks the stride by radius * h / d^2 in the radial direction, where h is the distance from the nucleus to the face, and d, to the vertex; the farthest corner is taken)
+	void getHeights(const glm::vec3* cubePos, const float* xs, const float* ys, const float* zs, float* heights, glm::vec3* grads, size_t n, float footprint);	//!< Through the height cache, if there is one. grads == nullptr if not analytic.
+	glm::vec3 getVertex(size_t i) const;
+	glm::vec3 getNormal(size_t i) const;
+	void computeGridNormals(unsigned numHorV, unsigned numVerV);	//!< Normals from the triangles of a numHorV x numVerV grid
+	void computeGapFixes();
+	void packVertices();			//!< Convert "vertex" into "compactVertex" and free "vertex"
+};
+
+void computeGridIndices(std::vector<uint16_t>& indices, unsigned numHorVertex, unsigned numVertVertex);		//!< 2 triangles per grid square
+
+
+// Ground height queries -------------------------------
+
+/// Coordinates (u, v) in [0, 1] of the point where the ray from the nucleus in direction "dir" meets a cube face (u grows along xAxis and v along -yAxis, like columns and rows of chunks in a DynamicGrid). dir must point towards the face (dot(dir, cubePlane) > 0). Clamped to the face.
+glm::vec2 getFaceCoords(const glm::vec3& dir, const glm::vec3& cubeSideCenter, const glm::vec3& cubePlane, const glm::vec3& xAxis, const glm::vec3& yAxis, float faceSide, const glm::vec3& nucleus);
+
+/// Bilinear interpolation of the heights of a grid of vertices (row-major, row 0 on the -yAxis side, as in PlanetPatch) at grid coordinates (col, row), clamped to the grid. height(i) returns the height of vertex i.
+template<typename F>
+float interpolateGridHeight(F height, unsigned numHorVertex, unsigned numVertVertex, float col, float row)
+{
+	col = std::clamp(col, 0.f, numHorVertex - 1.f);
+	row = std::clamp(row, 0.f, numVertVertex - 1.f);
+	unsigned c = std::min((unsigned)col, numHorVertex - 2);
+	unsigned r = std::min((unsigned)row, numVertVertex - 2);
+	float fc = col - c, fr = row - r;
+
+	size_t i = (size_t)r * numHorVertex + c;
+	float bottom = height(i) + (height(i + 1) - height(i)) * fc;
+	float top = height(i + numHorVertex) + (height(i + numHorVertex + 1) - height(i + numHorVertex)) * fc;
+	return bottom + (top - bottom) * fr;
+}
+
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef PLANETSCENE_HPP
+#define PLANETSCENE_HPP
+
+#include <memory>
+
+#include "glm/glm.hpp"
+
+#include "noise.hpp"
+#include "population.hpp"
+
+
+/*
+	Settings of the planet entity (see EntityFactory::createPlanet()) and of the items distributed over it, kept apart from the renderer so TerrainBenchmark builds the very same scene.
+*/
+
+// Planet (see Planet::Planet())
+const size_t planetRootCellSize = 100;
+const size_t planetSideVertex = 29;
+const size_t planetLevels = 7;
+const size_t planetMinLevel = 2;
+const float planetDistMultiplier = 1.2f;
+const float planetRadius = 2000;
+const glm::vec3 planetNucleus(0, 0, 0);
+
+std::shared_ptr<Noiser> createPlanetNoise();		//!< Terrain noise of the planet (noise graph, see noiseGraph.hpp)
+
+/// Distribution of an item entity over the planet's chunks (see c_Distributor)
+struct PlanetItems
+{
+	unsigned maxDepth, minDepth;
+	unsigned subGeometry;
+	PopulationRules rules;
+};
+
+// Item entities (see EntityFactory::createGrass(), createPlant(), createRock(), createTree() and createTreeBillboard())
+PlanetItems getGrassItems();
+PlanetItems getPlantItems();
+PlanetItems getStoneItems();
+PlanetItems getTreeItems();				//!< Trunk and branches
+PlanetItems getTreeBillboardItems();
+
+bool grass_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers);
+bool plant_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers);
+bool tree_callback (const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers);
+bool stone_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers);
+
+#endif
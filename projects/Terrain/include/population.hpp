@@ -0,0 +1,79 @@
+#ifndef POPULATION_HPP
+#define POPULATION_HPP
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "noise.hpp"
+#include "jobs.hpp"
+
+
+enum RotType {zAxisRandom, allAxesRandom, faceCam};
+
+struct ModelParams
+{
+	ModelParams() { }
+	ModelParams(const glm::vec3& scale, const glm::vec4& rotQuat, const glm::vec3& pos) : scale(scale), rotQuat(rotQuat), pos(pos) { }
+
+	glm::vec3 scale = { 1, 1, 1 };
+	glm::vec4 rotQuat = { 1, 0, 0, 0 };
+	glm::vec3 pos = { 0, 0, 0 };		// glm::vec3 translation = { 0, 0, 0 };
+};
+
+/// Vertices of a chunk (positions and normals), copied in the render thread. Populations are computed from it, so worker threads never read a chunk that may be evicted meanwhile.
+struct ChunkSurface
+{
+	unsigned chunkID;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+};
+
+/// Rules for distributing items over chunks (see c_Distributor)
+struct PopulationRules
+{
+	RotType rotType;
+	unsigned maxScale;
+	bool adaptToTerrainNormal;
+	bool(*itemSupported) (const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers);
+	std::vector<std::shared_ptr<Noiser>> noisers;
+};
+
+/// Items placed over a chunk (at most one per vertex). latLonQuat: Rotation shared by every item (see s_Distributor::getLatLonRotQuat()). Reentrant if rules.itemSupported is.
+void computePopulation(const ChunkSurface& surface, const PopulationRules& rules, const glm::vec4& latLonQuat, std::vector<ModelParams>& items);
+
+/// Population of a chunk computed for an owner (e.g. the entity of a c_Distributor)
+struct ChunkPopulation
+{
+	uint32_t owner;
+	unsigned chunkID;
+	std::shared_ptr<std::vector<ModelParams>> items;
+};
+
+/**
+	Computes chunks' populations (computePopulation()) in worker threads and hands them back to the render thread through a ready queue (LockFreeQueue).
+	Process:
+		1. order() (render thread): submit a job to the ThreadPool
+		2. pop() (render thread): take the populations computed so far
+	At most "capacity" populations are in flight (ordered and not popped), so the ready queue is never full. Without ThreadPool, populations are computed synchronously in order().
+	The ready queue is shared with the jobs, so this object can be destroyed while some of them are running (their populations are lost).
+*/
+class PopulationQueue
+{
+public:
+	PopulationQueue(std::shared_ptr<ThreadPool> threadPool, size_t capacity = 1024);
+
+	bool order(uint32_t owner, std::shared_ptr<const ChunkSurface> surface, const PopulationRules& rules, const glm::vec4& latLonQuat);	//!< False if there are "capacity" populations in flight (order it again later)
+	bool pop(ChunkPopulation& population);		//!< False if no population is ready
+	size_t getNumInFlight() const;
+
+private:
+	std::shared_ptr<ThreadPool> threadPool;
+	std::shared_ptr<LockFreeQueue<ChunkPopulation>> ready;
+	size_t capacity;
+	size_t inFlight;
+};
+
+#endif
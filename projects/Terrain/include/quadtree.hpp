@@ -0,0 +1,311 @@
+#ifndef QUADTREE_HPP
+#define QUADTREE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+/*
+	Linear quadtree. It doesn't depend on the renderer (see TerrainBenchmark).
+
+	Morton codes
+	LocationalIndex
+	LinearQuadtree
+*/
+
+// Morton codes -------------------------------
+
+/// Interleave the bits of cell coordinates x (even bits) and y (odd bits). Sorting cells by Morton code gives the order of a preorder traversal that visits the children of each node in order (x, y) = (0, 0), (1, 0), (0, 1), (1, 1).
+inline uint64_t mortonEncode(uint32_t x, uint32_t y)
+{
+	auto spread = [](uint64_t v)
+	{
+		v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+		v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+		v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+		v = (v | (v << 2)) & 0x3333333333333333ull;
+		v = (v | (v << 1)) & 0x5555555555555555ull;
+		return v;
+	};
+
+	return spread(x) | (spread(y) << 1);
+}
+
+/// Inverse of mortonEncode()
+inline void mortonDecode(uint64_t code, uint32_t& x, uint32_t& y)
+{
+	auto compact = [](uint64_t v)
+	{
+		v &= 0x5555555555555555ull;
+		v = (v | (v >> 1)) & 0x3333333333333333ull;
+		v = (v | (v >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+		v = (v | (v >> 4)) & 0x00FF00FF00FF00FFull;
+		v = (v | (v >> 8)) & 0x0000FFFF0000FFFFull;
+		v = (v | (v >> 16)) & 0x00000000FFFFFFFFull;
+		return (uint32_t)v;
+	};
+
+	x = compact(code);
+	y = compact(code >> 1);
+}
+
+/// Locational code: Morton code of a cell with a leading 1 bit that marks its depth (unique key for the cells of all depths, up to depth 31). The code of its parent is locationalCode >> 2.
+inline uint64_t locationalCode(unsigned depth, uint64_t code) { return (uint64_t)1 << 2 * depth | code; }
+
+
+// LocationalIndex -------------------------------
+
+/**
+	Hash table from locational codes to node indices (open addressing, linear probing, load factor <= 1/2).
+	Its memory is kept when it's cleared, so rebuilding it each time a tree changes doesn't allocate. Key 0 marks empty slots (it's not a valid locational code).
+*/
+class LocationalIndex
+{
+public:
+	static constexpr uint32_t none = UINT32_MAX;
+
+	LocationalIndex() : count(0), shift(64) { }
+
+	void clear()
+	{
+		std::fill(keys.begin(), keys.end(), 0);
+		count = 0;
+	}
+
+	void insert(uint64_t key, uint32_t value)
+	{
+		if (2 * (count + 1) > keys.size()) grow();
+
+		size_t mask = keys.size() - 1;
+		for (size_t i = slot(key); ; i = (i + 1) & mask)
+			if (!keys[i] || keys[i] == key)
+			{
+				if (!keys[i]) count++;
+				keys[i] = key;
+				values[i] = value;
+				return;
+			}
+	}
+
+	uint32_t find(uint64_t key) const		//!< Value of the key, or none
+	{
+		if (!count) return none;
+
+		size_t mask = keys.size() - 1;
+		for (size_t i = slot(key); keys[i]; i = (i + 1) & mask)
+			if (keys[i] == key) return values[i];
+
+		return none;
+	}
+
+	size_t size() const { return count; }
+
+private:
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> values;
+	size_t count;
+	unsigned shift;				//!< 64 - log2(capacity)
+
+	size_t slot(uint64_t key) const { return (key * 0x9E3779B97F4A7C15ull) >> shift; }	//!< Fibonacci hashing (high bits)
+
+	void grow()
+	{
+		std::vector<uint64_t> oldKeys(std::max<size_t>(keys.size() * 2, 64), 0);
+		std::vector<uint32_t> oldValues(oldKeys.size());
+		keys.swap(oldKeys);
+		values.swap(oldValues);
+		count = 0;
+
+		shift = 64;
+		for (size_t capacity = keys.size(); capacity > 1; capacity >>= 1) shift--;
+
+		for (size_t i = 0; i < oldKeys.size(); i++)
+			if (oldKeys[i]) insert(oldKeys[i], oldValues[i]);
+	}
+};
+
+
+// LinearQuadtree -------------------------------
+
+/**
+	Quadtree stored in a contiguous pool of nodes (no allocation per node). Nodes are referred to by their index in the pool, which stays valid until the node is removed (but references to nodes don't survive split()).
+	- The 4 children of a node are stored together (a block of 4 nodes, starting at a multiple of 4), in Morton order: child i covers the quadrant (x, y) = (i & 1, i >> 1) of its parent. Roots take a whole block too.
+	- Removed blocks go to a free list and are reused, so a tree that is updated each frame stops allocating once the pool is big enough.
+	- Each node knows its depth and Morton code (cell (x, y) of the 2^depth x 2^depth grid of its depth), so a node is addressed by (depth, code) from its root: find() descends along the 2-bit digits of the code.
+	- Traversals are iterative (a stack shared by all of them, with an entry per block instead of per node), so they can be nested. A visit may split the visited node or remove its children (they are read after the visit), but the rest of the tree mustn't be modified while traversing.
+	The pool may hold several trees (example: DynamicGrid keeps the drawn tree and the one being loaded).
+*/
+template<typename T>
+class LinearQuadtree
+{
+public:
+	struct Node
+	{
+		T element;
+		uint64_t code;			//!< Morton code of the node in its depth
+		uint32_t children;		//!< Index of the first child (the 4 children are consecutive), or none if it's a leaf
+		unsigned char depth;
+		unsigned char state;	//!< User-defined state of the node (0 by default). Used by DynamicGrid for the LOD state.
+	};
+
+	static constexpr uint32_t none = UINT32_MAX;
+
+	uint32_t addRoot(const T& element);										//!< Create a tree with one node (depth 0, code 0). Returns its index.
+	void split(uint32_t node, const T elements[4]);							//!< Create the 4 children of a leaf node (elements in Morton order)
+	template<typename F> void removeChildren(uint32_t node, F onRemove);	//!< Remove all the descendants of a node. onRemove(element) is called for each of them.
+	template<typename F> void removeTree(uint32_t root, F onRemove);		//!< Remove a tree created with addRoot() (onRemove is called for each node)
+	void clear();															//!< Remove all trees (the pool keeps its memory)
+	void reserve(size_t numNodes);
+
+	Node& operator[](uint32_t node) { return nodes[node]; }
+	const Node& operator[](uint32_t node) const { return nodes[node]; }
+	bool isLeaf(uint32_t node) const { return nodes[node].children == none; }
+	uint32_t getChild(uint32_t node, unsigned i) const { return nodes[node].children + i; }
+	size_t size() const { return nodes.size() - 4 * freeBlocks.size(); }	//!< Nodes in use (including the 3 unused nodes of each root block)
+	size_t capacity() const { return nodes.capacity(); }
+
+	/// Iterative preorder traversal (children in Morton order) of the subtree of "node". visit(index) returns true for visiting the children of a non-leaf node.
+	template<typename F> void traverse(uint32_t node, F visit);
+
+	/// Descend from "root" towards node (depth, code) until reaching it, a leaf, or a node for which stop(index) is true. Returns the last node visited.
+	template<typename F> uint32_t find(uint32_t root, unsigned depth, uint64_t code, F stop) const;
+	uint32_t find(uint32_t root, unsigned depth, uint64_t code) const { return find(root, depth, code, [](uint32_t) { return false; }); }
+
+	/// Map the locational codes of the nodes of a subtree to their indices, down to the nodes for which isLeaf(index) is true (or the leaves). Neighbours can be looked up there in O(1) (see DynamicGrid::getDrawnDepth()).
+	template<typename F> void indexNodes(uint32_t root, F isLeaf, LocationalIndex& dest);
+
+private:
+	std::vector<Node> nodes;
+	std::vector<uint32_t> freeBlocks;		//!< First node of each free block of 4 nodes
+	std::vector<uint32_t> stack;			//!< Shared by traversals
+
+	uint32_t newBlock();					//!< Index of the first node of a free block (reused, or appended to the pool)
+};
+
+
+// Definitions ----------------------------------------------------------------
+
+template<typename T>
+uint32_t LinearQuadtree<T>::addRoot(const T& element)
+{
+	uint32_t root = newBlock();
+	nodes[root] = { element, 0, none, 0, 0 };
+	return root;
+}
+
+template<typename T>
+void LinearQuadtree<T>::split(uint32_t node, const T elements[4])
+{
+	uint32_t first = newBlock();		// May reallocate the pool
+	Node& parent = nodes[node];
+	parent.children = first;
+
+	for (unsigned i = 0; i < 4; i++)
+		nodes[first + i] = { elements[i], parent.code << 2 | i, none, (unsigned char)(parent.depth + 1), 0 };
+}
+
+template<typename T>
+template<typename F>
+void LinearQuadtree<T>::removeChildren(uint32_t node, F onRemove)
+{
+	if (isLeaf(node)) return;
+
+	size_t base = stack.size();
+	stack.push_back(nodes[node].children);
+	nodes[node].children = none;
+
+	while (stack.size() > base)
+	{
+		uint32_t first = stack.back();
+		stack.pop_back();
+		freeBlocks.push_back(first);
+
+		for (uint32_t i = first; i < first + 4; i++)
+		{
+			onRemove(nodes[i].element);
+			if (nodes[i].children != none) stack.push_back(nodes[i].children);
+		}
+	}
+}
+
+template<typename T>
+template<typename F>
+void LinearQuadtree<T>::removeTree(uint32_t root, F onRemove)
+{
+	removeChildren(root, onRemove);
+	onRemove(nodes[root].element);
+	freeBlocks.push_back(root);
+}
+
+template<typename T>
+void LinearQuadtree<T>::clear()
+{
+	nodes.clear();
+	freeBlocks.clear();
+}
+
+template<typename T>
+void LinearQuadtree<T>::reserve(size_t numNodes) { nodes.reserve(numNodes); }
+
+template<typename T>
+template<typename F>
+void LinearQuadtree<T>::traverse(uint32_t node, F visit)
+{
+	if (!visit(node) || nodes[node].children == none) return;
+
+	// The stack keeps the next node to visit of each block being visited (blocks start at multiples of 4)
+	size_t base = stack.size();
+	stack.push_back(nodes[node].children);
+
+	while (stack.size() > base)
+	{
+		node = stack.back()++;
+		if ((stack.back() & 3) == 0) stack.pop_back();		// Last node of the block
+
+		if (visit(node) && nodes[node].children != none)
+			stack.push_back(nodes[node].children);
+	}
+}
+
+template<typename T>
+template<typename F>
+uint32_t LinearQuadtree<T>::find(uint32_t root, unsigned depth, uint64_t code, F stop) const
+{
+	uint32_t node = root;
+
+	for (unsigned d = 1; d <= depth; d++)
+	{
+		if (nodes[node].children == none || stop(node)) break;
+		node = nodes[node].children + ((code >> 2 * (depth - d)) & 3);
+	}
+
+	return node;
+}
+
+template<typename T>
+template<typename F>
+void LinearQuadtree<T>::indexNodes(uint32_t root, F isLeaf, LocationalIndex& dest)
+{
+	traverse(root, [&](uint32_t node)
+	{
+		dest.insert(locationalCode(nodes[node].depth, nodes[node].code), node);
+		return !isLeaf(node);
+	});
+}
+
+template<typename T>
+uint32_t LinearQuadtree<T>::newBlock()
+{
+	if (freeBlocks.size())
+	{
+		uint32_t first = freeBlocks.back();
+		freeBlocks.pop_back();
+		return first;
+	}
+
+	nodes.resize(nodes.size() + 4);
+	return (uint32_t)nodes.size() - 4;
+}
+
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef SLABPOOL_HPP
+#define SLABPOOL_HPP
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+
+
+/**
+	Pool of fixed-size slots, allocated in slabs (blocks of many slots). Freed slots go to a free list and are reused, and slabs are kept until the pool is destroyed, so a pool whose usage is stable (chunks loaded and evicted while flying) stops allocating.
+	Used for chunk objects (Chunk::operator new) and for the arrays of chunk generation (PooledVector). Both use the process-wide pools of get(), one per slot size. Thread-safe.
+*/
+class SlabPool
+{
+public:
+	SlabPool(size_t slotSize, size_t slotsPerSlab);
+	~SlabPool();
+
+	void* allocate();						//!< Slot of slotSize bytes (aligned as operator new)
+	void deallocate(void* slot);			//!< Return a slot of this pool
+
+	size_t getSlotSize() const;
+	size_t getNumSlabs();
+	size_t getNumInUse();					//!< Slots allocated and not freed
+	size_t getNumAllocations();				//!< Slots served since construction (from the free list or a new slab)
+
+	/// Totals of the process-wide pools
+	struct Stats
+	{
+		size_t pools;
+		size_t slabs;
+		size_t reservedBytes;		//!< Memory of the slabs
+		size_t inUseBytes;			//!< Memory of the slots in use
+		size_t allocations;			//!< Slots served
+	};
+
+	static SlabPool* get(size_t bytes);		//!< Process-wide pool for slots of this size (created on first use), or nullptr if pooling is disabled or the size is 0 or too big (then, use operator new).
+	static void setEnabled(bool enabled);	//!< Enable/disable the process-wide pools (enabled by default). Call it before allocating, since memory is freed where it was taken from.
+	static Stats getStats();
+
+	static const size_t maxSlotSize = 1 << 20;		//!< Bigger allocations aren't pooled
+	static const size_t slabSize = 1 << 20;			//!< Bytes per slab (at least 1 slot)
+
+private:
+	struct FreeSlot { FreeSlot* next; };
+
+	const size_t slotSize;
+	const size_t slotsPerSlab;
+	std::vector<void*> slabs;
+	FreeSlot* freeList;
+	size_t numInUse;
+	size_t numAllocations;
+	std::mutex mutPool;						//!< for slabs, freeList and counters
+
+	static std::atomic<bool> enabled;
+};
+
+/**
+	Allocator for std containers that takes memory from the process-wide slab pools (SlabPool::get()). Each size gets its own pool, so it's meant for arrays that are allocated with a few fixed sizes (chunk vertices, scratch arrays of chunk generation), not for growing containers.
+	It's stateless, so containers using it can exchange their memory (move, swap).
+*/
+template<typename T>
+class PoolAllocator
+{
+public:
+	typedef T value_type;
+
+	PoolAllocator() = default;
+	template<typename U> PoolAllocator(const PoolAllocator<U>&) { }
+
+	T* allocate(size_t n)
+	{
+		SlabPool* pool = SlabPool::get(n * sizeof(T));
+		return static_cast<T*>(pool ? pool->allocate() : ::operator new(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		SlabPool* pool = SlabPool::get(n * sizeof(T));
+		if (pool) pool->deallocate(p);
+		else ::operator delete(p);
+	}
+};
+
+template<typename T, typename U> bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+template<typename T, typename U> bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
+template<typename T> using PooledVector = std::vector<T, PoolAllocator<T>>;		//!< Vector with pooled memory (see PoolAllocator)
+
+
+#endif
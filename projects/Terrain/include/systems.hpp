@@ -119,19 +119,29 @@ public:
     void update(float timeStep) override;
 };
 
-/// It takes a set of chunks and distributes instances of the same item/s all over it (following some rules).
+/// It takes a set of chunks and distributes instances of the same item/s all over it (following some rules). Chunks' populations are computed in worker threads (see PopulationQueue), and each chunk is drawn with items once its population is ready.
 class s_Distributor : public System
 {
+    Planet* subscribedPlanet;
+    ChunkEventQueue* chunkEvents;                                                       //!< Chunk events of subscribedPlanet
+    std::vector<const Chunk*> activeChunks;                                             //!< Drawn chunks of subscribedPlanet (kept up to date with chunkEvents)
+    std::unique_ptr<PopulationQueue> populations;                                       //!< Chunks' populations computed in the worker threads of subscribedPlanet
+    bool populationsRefused;                                                            //!< Some population couldn't be ordered in the last update (too many in flight)
+    glm::vec3 lastCamPos, lastCamDir;                                                   //!< Camera of the last update of items
+    float lastFov;
+    size_t lastNumEntities;
+
+    bool updateChunks(Planet* planet, std::vector<unsigned>& evictedIds, bool& resynced);  //!< Apply chunk events to activeChunks and get the chunkIDs of evicted chunks. Returns true if activeChunks changed. If events were lost (or there's no subscription), activeChunks is taken from the planet again (resynced).
+    bool receivePopulations(Planet* planet, const std::vector<uint32_t>& entities);     //!< Store the populations computed since the last update in their c_Distributor (unless the chunk or the entity no longer exist). Returns true if some was stored.
+    void orderPopulation(uint32_t eId, c_Distributor* c_distrib, const Chunk* chunk, const glm::vec4& latLonQuat, std::map<const Chunk*, std::shared_ptr<const ChunkSurface>>& surfaces);     //!< Compute the population of a chunk in the worker threads. Surfaces copied in this update are reused by other entities.
     bool withinFOV(const glm::vec3& itemPos, const glm::vec3& camPos, const glm::vec3& camDir, float fov, float minDist) const;
     bool renderRequired(const Planet& planet, float minDepth, unsigned chunksCount);    //!< Evaluated each frame. Detect whether new chunks are available. If so, render the grass of these chunks.
     glm::vec4 getLatLonRotQuat(glm::vec3& normal);                                      //!< Rotation angles for grass to be vertically planted on ground (based on normal under camera).
     glm::vec3 getProjectionOnPlane(glm::vec3& normal, glm::vec3& vec);
     c_Model_planet* getPlanetComponent();                                               //!< Returns c_Model component that is UboType::planet and has no noise generator.
-    glm::vec4 getSecondQuat(const glm::vec3& pos, RotType rotationType);
-    glm::vec3 getScale(const glm::vec3& pos, unsigned maxScale);
 
 public:
-    s_Distributor() : System() { };
+    s_Distributor() : System(), subscribedPlanet(nullptr), chunkEvents(nullptr), populationsRefused(false), lastCamPos(0), lastCamDir(0), lastFov(0), lastNumEntities(0) { };
     ~s_Distributor() { };
 
     void update(float timeStep) override;
@@ -4,7 +4,11 @@
 #include <iostream>
 #include <cmath>
 #include <map>
+#include <unordered_map>
 #include <list>
+#include <memory>
+#include <atomic>
+#include <mutex>
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -15,78 +19,55 @@
 
 #include "noise.hpp"
 #include "common.hpp"
+#include "jobs.hpp"
+#include "chunkCache.hpp"
+#include "planetPatch.hpp"
+#include "quadtree.hpp"
+#include "slabPool.hpp"
+#include "population.hpp"
 
 /*
-	QuadNode
-
 	Chunk
 		PlainChunk
 		PlanetChunk
 			SphereChunk	
 
-	DynamicGrid (QuadNode)
+	DynamicGrid (LinearQuadtree)
 		TerrainGrid (PlainChunk)
 		PlanetGrid (SphericalChunk)
 			SphereGrid
 
-	Planet (PlanetGrid)
-		Sphere
-*/
-
-// -------------------------------
-
-/// Generic Binary Search Tree Node.
-template<typename T>
-class QuadNode
-{
-public:
-	//QuadNode() { };
-	QuadNode(const T& element, QuadNode* a = nullptr, QuadNode* b = nullptr, QuadNode* c = nullptr, QuadNode* d = nullptr) : element(element), a(a), b(b), c(c), d(d) { };
-	~QuadNode() { if (a) delete a; if (b) delete b; if (c) delete c; if (d) delete d; };
-
-	void setElement(const T& newElement) { element = newElement; }
-	void setA(QuadNode<T>* node) { a = node; }
-	void setB(QuadNode<T>* node) { b = node; }
-	void setC(QuadNode<T>* node) { c = node; }
-	void setD(QuadNode<T>* node) { d = node; }
-
-	T& getElement() { return element; }
-	QuadNode<T>* getA() { return a; }
-	QuadNode<T>* getB() { return b; }
-	QuadNode<T>* getC() { return c; }
-	QuadNode<T>* getD() { return d; }
+	ChunkBatch (Chunk)
 
-	bool isLeaf() { return !(a || b || c || d); }	//!< Is leaf if all subnodes are null; otherwise, it's not. Full binary tree: Every node either has zero children [leaf node] or two children. All leaf nodes have an element associated. There are no nodes with only one child. Each internal node has exactly two children.
-	//bool isLeaf_BST() { return (a); }	//!< For simple Binary Trees (BT).
+	ChunkScheduler (DynamicGrid, Chunk)
 
-private:
-	// Ways to deal with keys and comparing records: (1) Key / value pairs (our choice), (2) Especial comparison method, (3) Passing in a comparator function.
-	T element;
-	QuadNode<T>* a, *b, *c, *d;
-};
-
-template<typename T, typename V>
-void preorder(QuadNode<T>* root, V* visitor);
+	ChunkEventStream (ChunkEventQueue, ChunkEvent)
 
-template<typename T, typename V>
-void postorder(QuadNode<T>* root, V* visitor);
+	Planet (PlanetGrid)
+		Sphere
 
-template<typename T, typename V>
-void inorder(QuadNode<T>* root, V* visitor);
+	HeightCache, PlanetPatch (see planetPatch.hpp)
+	LinearQuadtree (see quadtree.hpp)
+	LockFreeQueue (see jobs.hpp)
+*/
 
+// -------------------------------
 
 // Chunk -------------------------------
 
-enum side{ right, left, up, down };
+extern const VertexType vt_planetCompact;	//!< (Height, Normal (oct), vertexFixes) (see PlanetVertex)
+
+/// State of the terrain (vertex data) of a chunk. Terrain may be computed in a worker thread (see DynamicGrid::orderTerrain()). Queued: waiting in a ChunkScheduler.
+enum class TerrainState{ none, queued, computing, computed };
 
 /**
-	Class used as the "element" of the QuadNode. Stores everything related to the object to render.
+	Class used as the "element" of the quadtree nodes (see DynamicGrid). Stores everything related to the object to render.
 	Process followed by DynamicGrid:
 	  1. computeIndices()
 	  2. getSubBaseCenters()
 	  3. Constructor()
-	  4. computeTerrain()
-	  5. render()
+	  4. computeTerrain() (render thread or worker thread)
+	  5. render() (render thread)
 	  6. updateUBOs()
 */
 class Chunk
@@ -105,7 +86,7 @@ protected:
 	int numAttribs;							//!< Number of attributes per vertex (9)
 
 	VerticesLoader* vertexData;
-	std::vector<float> vertex;				//!< VBO[n][9] (vertex position[3], normals[3], gap-fix data[3])
+	PooledVector<float> vertex;				//!< VBO[n][9] (vertex position[3], normals[3], gap-fix data[3])
 	std::vector<uint16_t> indices;			//!< EBO[m][3] (indices[3])
 
 	glm::vec3 getVertex(size_t position) const;
@@ -113,13 +94,35 @@ protected:
 	glm::vec3 getMajorAxis(glm::vec3 dir);
 	virtual void computeSizes() = 0;		//!< Compute base size and chunk size
 
+	virtual const VertexType& getVertexType() const;		//!< Vertex format sent to GPU (default: vt_333)
+	virtual const void* getVertexData() const;				//!< Vertex data sent to GPU (default: vertex)
+	virtual void getShaderParams(glm::vec4* params) const;	//!< 4 vec4 appended to the vertex shader UBO (after lights). Default: zeros.
+	void computeGeometricError();							//!< Compute geometricError. Call it at the end of computeTerrain().
+	void computeBounds();									//!< Compute bounding volumes and height range. Call it at the end of computeTerrain().
+	virtual float getVertexHeight(size_t i) const;			//!< Height of a vertex over the base surface (default: z)
+
+	friend class ChunkBatch;
+
 public:
 	Chunk(Renderer& renderer, glm::vec3 center, float stride, unsigned numHorVertex, unsigned numVertVertex, unsigned depth, unsigned chunkID);
 	virtual ~Chunk();
 
+	static void* operator new(size_t size);					//!< Chunks (of any subclass) are allocated in slab pools (SlabPool), so loading and evicting chunks reuses memory.
+	static void operator delete(void* chunk, size_t size);	//!< Size of the dynamic type (virtual destructor)
+
 	modelIter model;				//!< Model iterator. It has to be created with render(), which calls app->newModel()
 	bool modelOrdered;				//!< If true, the model creation has been ordered with app->newModel()
-	bool isVisible;					//!< Used during tree construction and loading for not rendering non-visible chunks in DynamicGrid.
+	unsigned batchSlot;				//!< Slot in the ChunkBatch of its grid (VertexArena::noSlot if the chunk isn't batched). Batched chunks have no model.
+	bool isVisible;					//!< Used during tree updates and loading for not rendering non-visible chunks in DynamicGrid.
+	unsigned numNodes;				//!< Number of tree nodes holding this chunk in DynamicGrid (chunks in a tree are not evicted).
+	float priority;					//!< Projected size (side / distance) at the last tree update. Used for ordering chunks' work (see ChunkScheduler).
+	float geometricError;			//!< Max. distance between the chunk's surface and its parent's (coarser) grid. Computed with the terrain (-1 before).
+	float detailError;				//!< Max. geometricError of its children (-1 if unknown), i.e., the error of this chunk with respect to the next LOD.
+	glm::vec3 boundMin, boundMax;	//!< AABB (computed with the terrain)
+	glm::vec3 boundCenter;			//!< Bounding sphere (computed with the terrain)
+	float boundRadius;
+	float minHeight, maxHeight;		//!< Height range of its vertices (computed with the terrain)
+	std::atomic<TerrainState> terrainState;		//!< Set to "computed" once computeTerrain() finished (it may run in a worker thread). render() requires it.
 
 	// ID data
 	const glm::vec3 majorAxis;		//!< Axis towards the chunk looks the most: 1 (x), 2, (-x), 3 (y), 4 (-y), 5 (z), 6 (-z)
@@ -134,16 +137,21 @@ public:
 	virtual glm::vec3 getCenter();
 	void deleteModel();
 
-	void render(std::vector<ShaderLoader>& shaders, std::vector<TextureLoader>& textures, std::vector<uint16_t>* indices, unsigned numLights, bool transparency);
+	void render(std::vector<ShaderLoader>& shaders, std::vector<TextureLoader>& textures, std::shared_ptr<SharedIndexBuffer> indices, std::shared_ptr<VertexArena> arena, unsigned numLights, bool transparency);	//!< If indices == nullptr, Chunk::indices are uploaded. If arena == nullptr, vertices get their own buffer.
 	void updateUBOs(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos, const LightSet& lights, float time, float camHeight, glm::vec3 planetCenter = glm::vec3(0,0,0));
 
 	void setSideDepths(unsigned a, unsigned b, unsigned c, unsigned d);
+	virtual glm::vec3 getVertexPos(size_t i) const;		//!< Position of a vertex, whatever the vertex format
+	virtual glm::vec3 getVertexNormal(size_t i) const;		//!< Normal of a vertex, whatever the vertex format
+	float getHeight(float col, float row) const;			//!< Height over the base surface at grid coordinates (col, row) (bilinear interpolation of vertex heights)
+	void getSurface(ChunkSurface& surface) const;			//!< Copy of its vertices (positions and normals), for computing its populations in worker threads (see PopulationQueue)
+	size_t getVertexBytes() const;							//!< Size of the vertex data (bytes)
 	glm::vec3 getGeoideCenter() const{ return geoideCenter; }
 	glm::vec3 getGroundCenter() const { return groundCenter; }
 	unsigned getNumVertex() const { return numHorVertex * numVertVertex; }
 	float getHorChunkSide() const { return horChunkSize; };
 	float getHorBaseSide() const { return horBaseSize; };
-	const std::vector<float>* getVertices() const { return &vertex; }
+	const PooledVector<float>* getVertices() const { return &vertex; }		//!< vt_333 data (empty if the chunk uses another format, like PlanetChunk)
 };
 
 /// Plain chunk with noise
@@ -178,21 +186,37 @@ class PlanetChunk : public Chunk
 {
 protected:
 	std::shared_ptr<Noiser> noiseGen;
+	std::shared_ptr<HeightCache> heightCache;		//!< Optional (nullptr if not used)
+	std::shared_ptr<ChunkDiskCache> diskCache;		//!< Optional. Terrain is read from it if found, or generated and stored there otherwise.
+	uint64_t diskKey;								//!< Key of this chunk in diskCache
+	bool skipFineOctaves;							//!< See PlanetPatch::skipFineOctaves
 	glm::vec3 nucleus;
 	float radius;
 	glm::vec3 xAxis, yAxis;			//!< Vectors representing the relative XY coordinate system of the cube side plane.
+	PooledVector<PlanetVertex> compactVertex;	//!< Compact vertex data. If not empty, it's used instead of "vertex" (which is freed).
 
-	void computeGridNormals(glm::vec3 pos0, glm::vec3 xAxis, glm::vec3 yAxis, unsigned numHorV, unsigned numVerV);
-	void computeGapFixes();
+	glm::vec3 getGridPoint(size_t i) const;		//!< Vertex position in the cube face
+	const VertexType& getVertexType() const override;
+	const void* getVertexData() const override;
+	void getShaderParams(glm::vec4* params) const override;		//!< (first grid point, radius), (column step, columns), (row step, first vertex index), (nucleus, 0)
 	void computeSizes() override;
+	bool readDiskRecord();						//!< Fill compactVertex with this chunk's record in diskCache. False if it's not there.
+	void writeDiskRecord();						//!< Store compactVertex in diskCache (see getDiskRecordSize())
 
 public:
-	PlanetChunk::PlanetChunk(Renderer& renderer, std::shared_ptr<Noiser> noiseGenerator, glm::vec3 cubeSideCenter, float stride, unsigned numHorVertex, unsigned numVertVertex, float radius, glm::vec3 nucleus, glm::vec3 cubePlane, unsigned depth = 0, unsigned chunkID = 0);
+	PlanetChunk(Renderer& renderer, std::shared_ptr<Noiser> noiseGenerator, glm::vec3 cubeSideCenter, float stride, unsigned numHorVertex, unsigned numVertVertex, float radius, glm::vec3 nucleus, glm::vec3 cubePlane, unsigned depth = 0, unsigned chunkID = 0, std::shared_ptr<HeightCache> heightCache = nullptr, bool skipFineOctaves = false);
 	virtual ~PlanetChunk() { };
 
 	virtual void computeTerrain(bool computeIndices) override;
 	void getSubBaseCenters(std::tuple<float, float, float>* centers) override;
+	void setDiskCache(std::shared_ptr<ChunkDiskCache> diskCache, uint64_t key);	//!< Records: compactVertex, with quantized interior heights (see getDiskRecordSize())
+	static size_t getDiskRecordSize(size_t numHorVertex, size_t numVertVertex);	//!< Bytes of a record in the disk cache: the interior's min. height and height step (2 floats), the border heights (float, exact, so chunks loaded and generated still match at their edges), the interior heights (uint16: steps over the min. height; 65535 steps cover the interior's height range), and the normals and gap fixes (4 uint16 per vertex, as in PlanetVertex). About 10 bytes per vertex, instead of 12.
+	PlanetPatch getPatch(Noiser* noiseGen, HeightCache* heightCache = nullptr) const;	//!< Patch that computeTerrain() generates, with any noise and cache (example: for regenerating the chunk with other settings, which may be changed in the patch before PlanetPatch::generate())
 	float getRadius();
+	glm::vec3 getFacePoint(float col, float row) const;		//!< Point of the cube face at grid coordinates (col, row) (see getHeight())
+	glm::vec3 getVertexPos(size_t i) const override;
+	glm::vec3 getVertexNormal(size_t i) const override;
+	float getVertexHeight(size_t i) const override;
 };
 
 
@@ -206,6 +230,153 @@ public:
 };
 
 
+// Chunk batch -------------------------------
+
+/**
+	Draws the chunks of a DynamicGrid with a single model (one pipeline, one descriptor set, one vkCmdDrawIndexedIndirect) instead of one model per chunk.
+	Chunks' vertices are uploaded to the slots of a single-page vertex arena. Per-chunk data (side depths and grid parameters) is stored in the vertex shader storage buffer, one element per slot (the shader gets the slot from gl_VertexIndex). Each slot has a draw command, whose instanceCount is 0 while the chunk is not drawn.
+	Therefore, adding, removing, showing or hiding chunks only changes buffers' contents, and command buffers are not recorded again.
+	Only chunks with the compact vertex format (PlanetChunk) are batched. The vertex shader must declare the storage buffer layout described in ChunkBatch() (see v_planetChunkBatch.vert).
+*/
+class ChunkBatch
+{
+public:
+	ChunkBatch(Renderer* renderer, const std::string& name, std::vector<ShaderLoader>& shaders, std::vector<TextureLoader>& textures, std::shared_ptr<SharedIndexBuffer> indices, size_t chunkBytes, unsigned capacity, unsigned numLights, bool transparency);
+
+	const unsigned capacity;			//!< Max. number of chunks
+
+	void addChunks(const std::vector<Chunk*>& newChunks);		//!< Upload chunks' vertices (single transfer) and set their data. Chunks that don't fit (or can't be batched) keep batchSlot == VertexArena::noSlot.
+	void removeChunk(Chunk* chunk);								//!< Release chunk's slot
+	void setDrawn(Chunk* chunk, bool drawn);					//!< Enable/disable the draw command of a chunk
+	bool isDrawn(const Chunk* chunk);
+	bool isReady();												//!< True when the model is fully constructed
+	void updateUBOs(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos, const LightSet& lights, float time, float camHeight, const std::vector<Chunk*>& drawnChunks);
+	void toLastDraw();
+	unsigned getNumChunks() const;
+
+private:
+	Renderer* renderer;
+	std::shared_ptr<VertexArena> arena;
+	std::shared_ptr<SharedIndexBuffer> indices;
+	modelIter model;
+	unsigned numChunks;
+	size_t chunkDataOffset;				//!< Offset (bytes) of the per-chunk data array in the vertex shader storage buffer (after globals and lights)
+	static const size_t chunkDataSize = 5 * sizeof(glm::vec4);	//!< sideDepthsDiff + 4 shader params
+
+	VkDrawIndexedIndirectCommand* getDrawCommand(unsigned slot);
+};
+
+
+// Chunk events -------------------------------
+
+class DynamicGrid;
+
+/// Lifecycle event of a chunk of a DynamicGrid (see ChunkEventStream)
+struct ChunkEvent
+{
+	enum Type : unsigned char
+	{
+		generated,		//!< Terrain computed (published by the thread that computed it)
+		uploaded,		//!< Vertex data sent to the GPU
+		activated,		//!< Drawn (visible leaf of the drawn tree)
+		deactivated,	//!< Not drawn anymore
+		evicted			//!< Deleted. "chunk" only identifies it (it mustn't be dereferenced).
+	};
+
+	Type type;
+	const DynamicGrid* grid;
+	const Chunk* chunk;
+	unsigned depth;
+	unsigned chunkID;
+};
+
+/**
+	Chunk events received by a subscriber of a ChunkEventStream (lock-free: grids push from the render thread and worker threads, and the subscriber pops from its own thread).
+	When it's full, new events are dropped and overflowed() returns true (once), so the subscriber can resynchronize (example: Planet::getActiveLeafChunks()).
+*/
+class ChunkEventQueue
+{
+public:
+	ChunkEventQueue(size_t capacity) : events(capacity), lost(false) { }
+
+	void push(const ChunkEvent& event) { if (!events.push(event)) lost = true; }
+	bool pop(ChunkEvent& event) { return events.pop(event); }		//!< False if there are no events
+	bool overflowed() { return lost.exchange(false); }				//!< True if some event was dropped since the last call
+
+private:
+	LockFreeQueue<ChunkEvent> events;
+	std::atomic<bool> lost;
+};
+
+/**
+	Publishes the lifecycle events of the chunks of a set of grids (example: the 6 faces of a Planet) to its subscribers, so they process what changed instead of polling chunks each frame.
+	Each subscriber gets its own ChunkEventQueue. Publishing doesn't lock, and it costs almost nothing when there are no subscribers.
+*/
+class ChunkEventStream
+{
+public:
+	static const unsigned maxSubscribers = 8;
+
+	ChunkEventStream() : numSubscribers(0) { }
+
+	ChunkEventQueue* subscribe(size_t capacity);	//!< New queue, owned by the stream (nullptr if there are maxSubscribers already). Call it from the render thread.
+	void publish(const ChunkEvent& event);			//!< Push the event to every queue. Thread-safe.
+
+private:
+	std::unique_ptr<ChunkEventQueue> queues[maxSubscribers];
+	std::atomic<unsigned> numSubscribers;			//!< Queues are created before this is incremented, so publishers only read complete queues
+};
+
+
+// Chunk scheduler -------------------------------
+
+/**
+	Orders the terrain computation of the chunks of all the DynamicGrid objects that share it (planet faces, sea...), so the work done per frame is bounded and the most important chunks go first.
+	Grids request chunks while updating their trees (thread-safe). Each frame, dispatch() ranks requests by chunk priority (projected size = side / distance; the screen-space factor is the same for every chunk, so it's ignored) and:
+		- Drops stale requests (chunks that left their grid's tree or aren't visible anymore because the camera moved on).
+		- Runs the rest in the ThreadPool, keeping at most 2 jobs per worker in flight (so new important requests don't wait behind old ones). Without ThreadPool, they are computed synchronously.
+	Work done in the render thread (synchronous computations and chunk uploads) is charged to a per-frame budget (ms). Grids limit their uploads with getUploadQuota() and chargeUploads().
+*/
+class ChunkScheduler
+{
+public:
+	ChunkScheduler(std::shared_ptr<ThreadPool> threadPool, float frameBudget = 4.f);
+	~ChunkScheduler();
+
+	void setFrameBudget(float ms);
+	void request(DynamicGrid* grid, Chunk* chunk);		//!< Enqueue a chunk whose terrain must be computed (its terrainState must be "queued"). Thread-safe.
+	void cancel(DynamicGrid* grid);						//!< Remove the requests of a grid. Call it before destroying the grid. Thread-safe.
+	void dispatch(size_t frame);						//!< Drop stale requests and run the rest by priority within the frame budget. Call it from the render thread (it may be called several times per frame).
+	size_t getUploadQuota() const;						//!< Number of chunks that can be uploaded in the current frame (at least 1 per frame)
+	void chargeUploads(float ms, size_t count);			//!< Charge some uploads to the current frame budget
+
+	size_t getQueueDepth();					//!< Requests waiting
+	unsigned getNumInFlight() const;		//!< Requests being computed in the ThreadPool
+	size_t getNumDropped() const;			//!< Stale requests dropped since construction
+	float getFrameTime() const;				//!< Budget spent in the current frame (ms)
+
+private:
+	struct Request
+	{
+		DynamicGrid* grid;
+		Chunk* chunk;
+	};
+
+	std::shared_ptr<ThreadPool> threadPool;
+	std::vector<Request> requests;
+	std::mutex mutRequests;					//!< for requests
+	std::atomic<unsigned> inFlight;
+	float frameBudget;
+	size_t frame;							//!< Current frame
+	float spent;							//!< Budget spent in the current frame (ms)
+	float uploadCost;						//!< Average cost of a chunk upload (ms)
+	size_t uploads;							//!< Chunks uploaded in the current frame
+	size_t dropped;
+
+	void run(const Request& request);
+};
+
+
 // Grid systems -------------------------------
 
 /**
@@ -219,17 +390,25 @@ public:
 		2. addTextures() (once)
 		3. addShaders() (once)
 		4. updateTree() (each frame)
-			- Chunk::getSubBaseCenters()
-			- Chunk::constructor()
-			- Chunk::computeTerrain()
-			- Chunk::render()
+			- updateTree_build() (can run in a worker thread)
+				- Chunk::getSubBaseCenters() (only for nodes that are split)
+				- Chunk::constructor() (only if the chunk is not in the registry)
+				- Chunk::computeTerrain() (runs in the ThreadPool, if set)
+			- updateTree_load() (render thread)
+				- Chunk::render()
+				- evictChunks() (when some split or merge is completed)
 		5. updateUBOs() (each frame)
 			- Chunk::updateUBOs()
+	LOD update: The tree persists across frames and only nodes whose LOD decision changed are split or merged.
+	Splits and merges are pending (the old chunks keep being drawn) until the new chunks are loaded. A split is completed as soon as the 4 children are loaded, and children that must be split start splitting then, so refinement
+	progresses level by level and each subtree is activated on its own (a slow chunk only holds back its own node).
+	A hysteresis band around the split distance avoids nodes flipping between split and merged at the boundary, and the tree isn't
+	updated until the camera moves more than a threshold. A new tree is only built when there's no tree yet (it's drawn as soon as its root is loaded) or the root chunk changes (it replaces the drawn one once it's loaded).
 */
 class DynamicGrid
 {
 public:
-	DynamicGrid(glm::vec3 camPos, Renderer* renderer, unsigned activeTree, size_t rootCellSize, size_t numSideVertex, size_t numLevels, size_t minLevel, float distMultiplier, bool transparency);
+	DynamicGrid(glm::vec3 camPos, Renderer* renderer, size_t rootCellSize, size_t numSideVertex, size_t numLevels, size_t minLevel, float distMultiplier, bool transparency);
 	virtual ~DynamicGrid();
 
 	//unsigned char* ubo;
@@ -237,26 +416,106 @@ public:
 	unsigned numLights;
 
 	void addResources(const std::vector<ShaderLoader>& shadersInfo, const std::vector<TextureLoader>& texturesInfo);		//!< Add textures and shaders info
-	void updateTree(glm::vec3 newCamPos, unsigned numLights);
+	void setThreadPool(std::shared_ptr<ThreadPool> threadPool);			//!< Compute chunks' terrain in these worker threads. If nullptr (default), terrain is computed synchronously.
+	void updateTree(glm::vec3 newCamPos, unsigned numLights);				//!< updateTree_build() + updateTree_load()
+	void updateTree_build(glm::vec3 newCamPos, unsigned numLights);		//!< Split or merge the nodes whose LOD changed and order their chunks' terrain. Doesn't use the Renderer, so grids can be updated concurrently.
+	void updateTree_load();													//!< Render the chunks with computed terrain and complete the splits and merges whose chunks are ready. Call it from the render thread.
 	void updateUBOs(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos, const LightSet& lights, float time, float groundHeight);
 	void toLastDraw();														//!< Call it after updateTree(), so the correct tree is put last to draw
-	void getActiveLeafChunks(std::vector<const Chunk*>& dest, unsigned depth);	//!< Get active chunks with depth >= X in the active tree 
-	bool contains(unsigned chunkId);
+	void getActiveLeafChunks(std::vector<const Chunk*>& dest, unsigned depth);	//!< Get drawn chunks with depth >= X
+	bool contains(unsigned chunkId);										//!< O(1). True if some chunk (any depth) has this chunkID.
+	void setMemoryBudget(size_t bytes);										//!< Approximate memory (CPU + GPU vertex data) that stored chunks can use. Least recently used inactive chunks are evicted when it's exceeded.
+	void setBatchShader(const ShaderLoader& vertexShader);					//!< Draw chunks with a ChunkBatch that uses this vertex shader (instead of one model per chunk). Call it after addResources().
+	void setScheduler(std::shared_ptr<ChunkScheduler> scheduler);			//!< Order chunks' terrain and uploads through this scheduler (may be shared by several grids). If nullptr (default), chunks are computed as soon as they are required (see setThreadPool()).
+	void setFrustum(const glm::mat4& view, const glm::mat4& proj);			//!< Cull chunks outside this view frustum (not generated, not drawn, not split). Call it each frame before updateTree(). If it's never called, there's no frustum culling.
+	void setScreenSpaceError(float fov, float viewportHeight, float maxPixelError = 2.f);	//!< Split chunks when their projected geometric error (pixels) exceeds maxPixelError, instead of by distance. Call it again when FOV or viewport change.
+	void setEventStream(std::shared_ptr<ChunkEventStream> events);		//!< Publish chunks' lifecycle events there (see ChunkEvent). Set it before the first update.
+	void setLodUpdate(float moveThreshold, float hysteresis);				//!< Camera displacement required for updating the tree (default: 1/10 of the smallest chunk side), and hysteresis band relative to the split distance (default: 0.1).
+	void setProgressiveActivation(bool enabled);							//!< Enable/disable progressive activation of split subtrees (enabled by default). If disabled, a split is completed once every leaf of its subtree is loaded, and the first tree, once it's fully loaded (for comparison).
+	size_t getNumSideVertex() const;										//!< Vertices per chunk side
+	unsigned getDrawnDepth(unsigned depth, uint64_t code) const;			//!< Depth of the drawn leaf that covers cell (depth, Morton code) of the grid, or "depth" if the cell is drawn at that depth or finer (or there's no drawn tree). One hash lookup per level of difference.
+	bool drawnTreeChanged() const;											//!< True if the last updateTree_load() changed the drawn tree (and so chunks' side depths)
+	void updateSideDepths();												//!< Compute the depth that each side of the drawn leaves must fit (called when the drawn tree changes). Call it again if a grid adjacent to this one changes (see getBorderSideDepth()).
 
 	// Testing
 	unsigned numChunks();				//!< Number of chunks (loaded and not loaded)
 	unsigned numChunksOrdered();		//!< Number of ordered chunks (those fully constructed or pending to be so)
-	unsigned numActiveLeafChunks();		//!< Number of leaf chunks in the active tree
+	unsigned numActiveLeafChunks();		//!< Number of drawn leaf chunks
+	unsigned numPendingNodes();			//!< Number of splits and merges waiting for their chunks to be loaded
+	unsigned numChunksComputed();		//!< Number of chunks whose terrain has been computed so far (chunks/second = increment per second)
+	size_t numRegistryHits() const;		//!< Chunks requested during tree construction that were already stored
+	size_t numRegistryMisses() const;	//!< Chunks requested during tree construction that had to be created
+	size_t numEvictions() const;		//!< Chunks evicted to keep within the memory budget
+	size_t getMemoryUsed() const;		//!< Approximate memory used by stored chunks (bytes)
+	size_t getUploadedBytes() const;	//!< Vertex data sent to GPU since construction (bytes)
+	unsigned numModels();				//!< Models used for drawing chunks (one per non-batched chunk, plus one per batch)
+	unsigned numCulledChunks() const;	//!< Chunks required by the tree but not visible (last tree update)
+	float getMinHeight() const;			//!< Lowest height of the chunks computed so far
+	float getMaxHeight() const;			//!< Highest height of the chunks computed so far
+	unsigned numCoarserBySSE() const;	//!< Nodes that the screen-space error didn't split and the distance test would have split (last tree update)
+	unsigned numFinerBySSE() const;		//!< Nodes that the screen-space error split and the distance test wouldn't have split (last tree update)
+	bool isSettled() const;				//!< True if the drawn tree has the LOD required at the last update: no new tree, split, merge or visible chunk waiting to be loaded, and no tree update pending
 
 protected:
-	std::map<std::tuple<float, float, float>, Chunk*> chunks;		//!< All chunks
-	QuadNode<Chunk*>* root[2];										//!< Active and non-active tree
-	std::vector<Chunk*> visibleLeafChunks[2];						//!< Visible leaf chunks of each tree
+	friend class ChunkScheduler;
+
+	/// Stored chunk. Registry entries are kept in LRU order (lru.front() = most recently used).
+	struct ChunkEntry
+	{
+		Chunk* chunk;
+		std::list<uint64_t>::iterator lruPos;
+	};
+
+	typedef LinearQuadtree<Chunk*> ChunkTree;
+
+	/// LOD state of a node (stored in ChunkTree::Node::state). Nodes not drawn yet (new tree, or subtree of a splitting node) are only leaf or split.
+	enum NodeState : unsigned char
+	{
+		leaf,			//!< Drawn (if visible)
+		splitting,		//!< Drawn while its children's chunks are loading
+		split,			//!< Children are drawn
+		merging			//!< Children are drawn while its chunk is loading
+	};
+
+	std::unordered_map<uint64_t, ChunkEntry> chunks;				//!< All chunks (key = getChunkKey())
+	std::list<uint64_t> lru;										//!< Keys of all chunks (most recently used first)
+	std::unordered_map<unsigned, unsigned> chunkIdCount;			//!< Number of chunks per chunkID (for contains(chunkId))
+	size_t memoryBudget;
+	size_t registryHits, registryMisses, evictions;
+	size_t vertexSize;												//!< Size of chunks' vertices (bytes)
+	size_t uploadedBytes;
+	ChunkTree tree;													//!< Nodes of the drawn tree and the new tree
+	uint32_t root;													//!< Drawn tree (ChunkTree::none if there's none)
+	uint32_t newRoot;												//!< Tree being loaded for replacing the drawn tree (when there's no tree yet or the root chunk changes)
+	uint64_t rootKey, newRootKey;									//!< Registry keys of the root chunks
+	std::vector<Chunk*> drawnChunks;								//!< Visible leaf chunks of the drawn tree (splitting nodes are leaves here; merging nodes aren't)
+	std::vector<uint32_t> pendingNodes;								//!< Nodes being split or merged
+	std::vector<uint32_t> mergeCandidates;							//!< Split nodes of the drawn tree that want to be merged, in preorder (see updateDrawnTree())
+	LocationalIndex drawnNodes;										//!< Nodes of the drawn tree down to the drawn leaves (key: locationalCode()). For neighbour lookups.
+	bool treeChanged;												//!< The drawn tree changed in the last updateTree_load()
+	std::vector<Chunk*> loadingChunks;								//!< Visible chunks in the trees that haven't been rendered yet
+	glm::vec3 updateCamPos;											//!< Camera position at the last tree update
+	bool treeSettled;												//!< False if the tree needs to be updated even if the camera doesn't move (some LOD change is waiting for a split or merge to be completed)
+	bool drawnDirty;												//!< drawnChunks must be recomputed (some chunk changed its visibility or was rendered)
+	bool gridHidden;												//!< True if the whole grid is culled (its root chunk isn't visible). Nothing is drawn.
+	bool useFrustum;
+	glm::vec4 frustumPlanes[6];										//!< Normalized planes (a point p is inside if dot(plane, (p, 1)) >= 0 for all of them)
+	glm::vec3 viewDir, updateViewDir;								//!< Camera direction (current and at the last tree update)
+	glm::mat4 lastProj;
+	float heightMin, heightMax;										//!< Height range of the chunks computed so far
+	unsigned culledChunks;
 	Renderer* renderer;
-	std::vector<uint16_t> indices;
+	std::shared_ptr<SharedIndexBuffer> indices;					//!< Index buffer shared by all chunks (they have the same number of vertices)
+	std::shared_ptr<VertexArena> vertexArena;					//!< Vertex buffers shared by all chunks (each chunk takes a slot). Created when the first chunk is rendered.
 	std::vector<ShaderLoader> shaders;
+	std::vector<ShaderLoader> batchShaders;						//!< Shaders for the ChunkBatch (if empty, chunks are not batched)
 	std::vector<TextureLoader> textures;
-	unsigned activeTree, nonActiveTree;
+	std::shared_ptr<ChunkBatch> batch;							//!< Created when the first chunk is rendered (if batchShaders is not empty)
+	std::shared_ptr<ThreadPool> threadPool;
+	std::shared_ptr<ChunkScheduler> scheduler;
+	std::atomic<unsigned> pendingJobs;								//!< Terrain jobs ordered and not finished yet
+	std::atomic<unsigned> computedChunks;
+	std::shared_ptr<ChunkEventStream> events;						//!< Optional (nullptr if not used)
 
 	// Configuration data
 	float rootCellSize;
@@ -264,27 +523,51 @@ protected:
 	size_t numLevels;			//!< Number of LOD
 	size_t minLevel;			//!< Minimum level used(from 0 to numLevels-1) (actual levels used = numLevels - minLevel) (example: 7-3=4 -> 800,400,200,100)
 	float distMultiplier;		//!< Relative distance (when distance camera-node's center is < relDist, the node is subdivided).
-	unsigned distMultRemove;	//!< Relative distance for removing chunks (when distance camera-node's center > distMultRemove, the node is deleted)
 	bool transparency;
-
-	void createTree(QuadNode<Chunk*>* node, size_t depth);			//!< Recursive
-	bool fullConstChunks(unsigned treeIndex);						//!< Check that visible nodes in a tree are ready (loaded).
-	void changeRenders(unsigned treeIndex, bool renderMode);		//!< Change number of renders of all visible chunks in a tree.
-	void putToLastDraw(unsigned treeIndex);							//!< Draw last all visible leaf chunks in a tree
-	void removeFarChunks(unsigned relDist, glm::vec3 camPosNow);	//!< Remove those chunks that are too far from camera
+	float moveThreshold;		//!< Minimum camera displacement for updating the tree
+	float lodHysteresis;		//!< Relative band around the split distance. Leaves are split below (1 - h) times the split distance, and split nodes are merged above (1 + h) times (same for the screen-space error).
+	float sseFactor;			//!< viewportHeight / (2 tan(fov / 2)). Projected error (pixels) = error * sseFactor / distance. If 0, chunks are split by distance.
+	float maxPixelError;		//!< Max. projected geometric error (pixels) of drawn chunks
+	unsigned sseCoarser, sseFiner;
+	bool progressiveActivation;	//!< See setProgressiveActivation()
+	static const unsigned arenaSlotsPerPage = 128;		//!< Chunks per vertex arena page (each page is one buffer and memory allocation)
+
+	bool wantsSplit(uint32_t node);									//!< LOD decision for a node (with hysteresis, so it depends on the current state of the node). Uses the screen-space error if it's set up and the node's error is known; otherwise, the distance.
+	float getNodeError(uint32_t node);								//!< Geometric error of a node's chunk with respect to the next LOD (-1 if unknown)
+	void updateDrawnTree();											//!< Update the nodes of the drawn tree (one traversal, see LinearQuadtree::traverse()). Splits and merges are pending until the new chunks are loaded.
+	void updateHiddenTree(uint32_t node, bool progressive);			//!< Update the subtree of a node that isn't drawn yet (one traversal). Splits and merges are applied at once. Chunks of its leaves are required, and those of its split nodes too if "progressive" (the subtree is activated progressively, so split nodes are drawn while their children load).
+	void splitNode(uint32_t node);									//!< Create the 4 children of a leaf node
+	void removeChildren(uint32_t node);								//!< Delete the subtrees of a node
+	void deleteTree(uint32_t root);									//!< Delete a node and its subtrees
+	void requireChunk(Chunk* chunk);								//!< Update chunk's visibility. If visible, order its terrain and put it in loadingChunks (if required).
+	void terrainComputed(Chunk* chunk);								//!< Mark chunk's terrain as computed (called by the thread that computed it)
+	void publish(ChunkEvent::Type type, const Chunk* chunk);		//!< Publish a chunk event (if there's an event stream)
+	void orderTerrain(Chunk* chunk);								//!< Compute chunk's terrain (through the ChunkScheduler or in the ThreadPool if they exist; otherwise, synchronously)
+	bool renderChunks();											//!< Render loading chunks whose terrain is computed (if there's a ChunkScheduler, the most important ones within the frame budget). Returns true if some chunk was rendered.
+	bool isReady(Chunk* chunk);										//!< True if the chunk is not visible or it's loaded
+	bool isSubtreeReady(uint32_t node);								//!< True if all the leaf chunks of a subtree are ready
+	bool isDrawnLeaf(uint32_t node);								//!< True if the node is a leaf in the drawn tree (leaf or splitting)
+	void activateChildren(uint32_t node);							//!< Children of a node whose split was completed start splitting if they have children (they were hidden nodes)
+	void getBounds(const Chunk* chunk, glm::vec3& center, float& radius);	//!< Chunk's bounding sphere. If its terrain isn't computed yet, a conservative one (chunk's side and grid's height range).
+	bool inFrustum(const glm::vec3& center, float radius);			//!< True if the sphere is inside or intersects the frustum (always true if there's no frustum)
+	void updateDrawnChunks();										//!< Recompute drawnChunks and show/hide chunks accordingly
+	void getDrawnChunks(uint32_t node, std::vector<Chunk*>& dest);
+	void setDrawn(Chunk* chunk, bool drawn);
+	void evictChunks();												//!< Remove least recently used chunks that are not in a tree until memory used <= memory budget
+	void removeChunk(uint64_t key);
+	size_t getChunkMemory() const;									//!< Approximate memory used by a chunk (CPU + GPU vertex data)
 	glm::vec4 getChunkIDs(unsigned parentID, unsigned depth);
+	Chunk* getChunk(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID);	//!< Get chunk from the registry (or create it) for a new node.
 
 	virtual glm::vec3 getChunkCenter(Chunk* chunk);					//!< Get chunk's center
-	virtual QuadNode<Chunk*>* getNode(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID) = 0;
+	virtual uint64_t getChunkKey(std::tuple<float, float, float> center, unsigned depth, unsigned chunkID);		//!< Registry key: (face, depth, chunkID)
+	virtual Chunk* newChunk(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID) = 0;
 	virtual std::tuple<float, float, float> closestCenter() = 0;	//!< Find closest center to the camera of the biggest chunk (i.e. lowest level chunk).
 
-	void restartSideDepths(QuadNode<Chunk*>* node);					//!< Recursive (Preorder traversal). Set side depths of all nodes in the tree to 0.
-	void updateChunksSideDepths(QuadNode<Chunk*>* node);			//!< Breath-first search for computing the depth that each side of the chunk must fit.
-	void updateChunksSideDepths_help(std::list<QuadNode<Chunk*>*>& queue, QuadNode<Chunk*>* currentNode); //!< Helper method. Computes the depth of each side of a chunk based on adjacent chunks (right and down).
+	virtual float getBorderSideDepth(uint32_t node, unsigned side);	//!< Side depth of a drawn leaf's side that lies on the grid's border. Default: 1000 (flag for grid boundaries).
 
-	void resetVisibility(QuadNode<Chunk*>* node);					//!< Recursive (Preorder traversal). Traverse tree and set all leaves (chunks) as visible.
 	virtual void updateVisibilityState();							//!< Update some parameters used in isVisible().
-	virtual bool isVisible(const Chunk* chunk);						//!< Check if a given chunk is visible (if not, it's not rendered).
+	virtual bool isVisible(const Chunk* chunk);						//!< Check if a given chunk is visible (if not, it's not generated nor rendered). Default: frustum culling.
 };
 
 
@@ -305,7 +588,8 @@ public:
 
 private:
 	Noiser* noiseGen;
-	QuadNode<Chunk*>* getNode(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID) override;
+	Chunk* newChunk(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID) override;
+	uint64_t getChunkKey(std::tuple<float, float, float> center, unsigned depth, unsigned chunkID) override;		//!< Key: (depth, center) (chunkIDs aren't stable here because the root follows the camera)
 	std::tuple<float, float, float> closestCenter() override;
 };
 
@@ -317,20 +601,43 @@ public:
 	virtual ~PlanetGrid() { }
 
 	float getRadius();
+	void setHeightCacheSize(size_t maxSamples);	//!< Maximum number of noise samples cached (0 disables the cache)
+	void setDiskCache(std::shared_ptr<ChunkDiskCache> diskCache);	//!< Read chunks' terrain from this persistent cache (generate and store it if not found). Set it before the first update.
+	void setSkipFineOctaves(bool enabled);		//!< Chunks skip the octaves finer than their vertex spacing (see PlanetPatch::skipFineOctaves). Default: only if the noise has octaves finer than the deepest level's vertex spacing (otherwise only coarse chunks drop a few octaves, which saves little time and makes them differ from their children). Set it before the first update.
+	bool skipsFineOctaves() const;
+	uint64_t getConfigHash() const;				//!< Hash of everything that defines chunks' terrain (noise and grid parameters, and noise values at fixed points, so changes in code such as combiners are detected). 0 if the noise has no hash.
+	void setOccluderRadius(float occluderRadius);	//!< Radius of the sphere that occludes chunks beyond the horizon (default: radius + lowest height of the grid). It should be the lowest ground radius of the planet.
+	size_t numNoiseCalls() const;				//!< Noise samples computed (i.e., not found in the cache) since construction
+	size_t numNoiseRequests() const;			//!< Noise samples required by chunks since construction
+	void setNeighbourFaces(PlanetGrid* const faces[6]);	//!< Find the faces adjacent to each side of this one (among the 6 faces of the planet), so chunk borders fit across cube edges
+	bool getGroundHeight(const glm::vec3& dir, float maxError, float& height);	//!< Height over the sphere in direction "dir" (from the nucleus, towards this face), interpolated from the finest computed chunk of the tree that covers it. False if there's none, or if it's not of the deepest level and its error estimate (see getNodeError()) exceeds maxError. Don't call it while the tree is updated.
 
 protected:
 	std::shared_ptr<Noiser> noiseGen;
+	std::shared_ptr<HeightCache> heightCache;
+	std::shared_ptr<ChunkDiskCache> diskCache;
+	bool skipFineOctaves;
 	float radius;
 	glm::vec3 nucleus;
 	glm::vec3 cubePlane;
 	glm::vec3 cubeSideCenter;
-	float dotHorizon;			// Minimum dot product. Chunks with lower dotHorizon aren't rendered
-
-	virtual QuadNode<Chunk*>* getNode(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID) override;
+	float occluderRadius;		//!< Horizon culling: sphere (center: nucleus) that occludes what is behind it
+	bool horizonCulling;		//!< False if the camera is inside the occluder
+	glm::vec3 horizonAxis;		//!< Direction nucleus-camera
+	float horizonPlane;			//!< Distance from nucleus to the plane of the horizon circle
+	float horizonCone;			//!< Half-angle of the occluder's shadow cone (apex: camera)
+	unsigned face;				//!< Cube face index (0: +x, 1: -x, 2: +y, 3: -y, 4: +z, 5: -z)
+	glm::vec3 xAxis, yAxis;		//!< Face axes (see PlanetPatch::getFaceAxes())
+	PlanetGrid* neighbourFaces[4];	//!< Faces adjacent to each side (right, left, up, down)
+
+	virtual Chunk* newChunk(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID) override;
+	uint64_t getChunkKey(std::tuple<float, float, float> center, unsigned depth, unsigned chunkID) override;
 	std::tuple<float, float, float> closestCenter() override;
 	void updateVisibilityState() override;
-	bool isVisible(const Chunk* chunk) override;
+	bool isVisible(const Chunk* chunk) override;					//!< Frustum and horizon culling
+	bool isOccluded(const glm::vec3& center, float radius);			//!< True if the sphere is completely hidden behind the occluder (horizon)
 	glm::vec3 getChunkCenter(Chunk* chunk) override;
+	float getBorderSideDepth(uint32_t node, unsigned side) override;	//!< Depth difference with the chunk of the adjacent face (the cell across the cube edge)
 };
 
 
@@ -339,7 +646,7 @@ class SphereGrid : public PlanetGrid
 public:
 	SphereGrid(Renderer* renderer, size_t rootCellSize, size_t numSideVertex, size_t numLevels, size_t minLevel, float distMultiplier, float radius, glm::vec3 nucleus, glm::vec3 cubePlane, glm::vec3 cubeSideCenter, bool transparency);
 	
-	QuadNode<Chunk*>* getNode(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID) override;
+	Chunk* newChunk(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID) override;
 };
 
 
@@ -355,30 +662,59 @@ public:
 		- DynamicGrid.addTextures()
 		- DynamicGrid.addShaders()
 	3. updateState() (each frame)
-		- DynamicGrid.updateTree()
+		- DynamicGrid.updateTree_build() (6 grids in parallel if a ThreadPool was set)
+		- DynamicGrid.updateTree_load()
 		- DynamicGrid.updateUBOs()
 */
 class Planet
 {
 public:
+	/// Totals of the 6 faces (see DynamicGrid's testing methods)
+	struct Counts
+	{
+		unsigned chunks, orderedChunks, activeLeafChunks, computedChunks, culledChunks, models;
+		size_t noiseCalls, noiseRequests;
+		size_t registryHits, registryMisses, evictions;
+		size_t memory, uploaded;		//!< Bytes
+		unsigned coarserBySSE, finerBySSE;
+		size_t heightQueries, heightFallbacks;		//!< Ground height queries, and those evaluated with noise
+	};
+
 	Planet(Renderer* renderer, std::shared_ptr<Noiser> noiseGenerator, size_t rootCellSize, size_t numSideVertex, size_t numLevels, size_t minLevel, float distMultiplier, float radius, glm::vec3 nucleus, bool transparency);
 	virtual ~Planet();
 
 	void addResources(const std::vector<ShaderLoader>& shaders, const std::vector<TextureLoader>& textures);							//!< Add textures and shader
+	void setThreadPool(std::shared_ptr<ThreadPool> threadPool);		//!< Compute chunks in these worker threads and update the 6 grids in parallel
+	void setHeightCacheSize(size_t maxSamples);						//!< Maximum number of noise samples cached per cube face (0 disables the cache)
+	void setSkipFineOctaves(bool enabled);							//!< Chunks of the 6 faces skip the octaves finer than their vertex spacing (see PlanetGrid::setSkipFineOctaves()). Call it before setDiskCache() and the first update.
+	bool skipsFineOctaves() const;
+	void setDiskCache(const std::string& path, uint64_t version = 0);	//!< Store chunks' terrain in a persistent file shared by the 6 faces (see ChunkDiskCache). It's discarded if the noise or the grid change (see PlanetGrid::getConfigHash()). Increase "version" to discard it anyway.
+	void setMemoryBudget(size_t bytes);								//!< Memory budget for stored chunks (split among the 6 faces)
+	void setBatchShader(const ShaderLoader& vertexShader);			//!< Draw each face with a single model and indirect draws (see ChunkBatch). Call it after addResources().
+	void setScheduler(std::shared_ptr<ChunkScheduler> scheduler);	//!< Order chunks' work of the 6 faces through this scheduler (see ChunkScheduler)
+	void setScreenSpaceError(float fov, float viewportHeight, float maxPixelError = 2.f);	//!< Split chunks by projected geometric error (see DynamicGrid::setScreenSpaceError())
+	void setProgressiveActivation(bool enabled);					//!< See DynamicGrid::setProgressiveActivation()
 	void updateState(const glm::vec3& camPos, const glm::mat4& view, const glm::mat4& proj, const LightSet& lights, float frameTime, float groundHeight);	//!< Update tree and UBOs
 	void toLastDraw();
-	float getGroundHeight(const glm::vec3& camPos);
+	float getGroundHeight(const glm::vec3& pos);					//!< Distance from the nucleus to the ground below "pos". Interpolated from the finest loaded chunk covering it (see setHeightQueryError()), or noise if there's none. 0 before addResources(). Call it from the render thread, not during updateState().
+	void getGroundHeights(const glm::vec3* points, float* heights, size_t count);	//!< getGroundHeight() of N points. Points without a loaded chunk are evaluated with batch noise calls (in the ThreadPool, if set).
+	void setHeightQueryError(float maxError);						//!< Max. error estimate of the chunks used by ground height queries (default: 0.1). Chunks of the deepest level are always used.
+	ChunkEventQueue* subscribeChunkEvents(size_t capacity = 4096);	//!< Receive the lifecycle events of the chunks of the 6 faces (see ChunkEventStream). nullptr if there are too many subscribers. Call it from the render thread.
 	void getActiveLeafChunks(std::vector<const Chunk*>& dest, unsigned depth) const;
 	std::shared_ptr<Noiser> getNoiseGen() const;
+	std::shared_ptr<ThreadPool> getThreadPool() const;				//!< nullptr if chunks are computed synchronously
 	float getSphereArea();							//!< Given planet radius, get sphere's area
 	glm::vec3 getBasicNormal(glm::vec3& camPos);	//!< Sphere normal at camera position
-	bool contains(unsigned chunkId);				// <<< this can be optimized if we could look for the chunk using a key (chunkId)
+	bool contains(unsigned chunkId);				//!< O(1). True if some face has a chunk with this chunkID.
+	bool isSettled() const;							//!< True if the 6 faces are settled (see DynamicGrid::isSettled())
+	Counts getCounts();
 	void printCounts();
 
 	const float radius;
 	const glm::vec3 nucleus;
 
 protected:
+	Renderer* renderer;
 	std::shared_ptr<Noiser> noiseGen;
 	PlanetGrid* planetGrid_pZ;
 	PlanetGrid* planetGrid_nZ;
@@ -386,10 +722,18 @@ protected:
 	PlanetGrid* planetGrid_nY;
 	PlanetGrid* planetGrid_pX;
 	PlanetGrid* planetGrid_nX;
+	std::shared_ptr<ThreadPool> threadPool;
+	std::shared_ptr<ChunkScheduler> scheduler;
+	std::shared_ptr<ChunkDiskCache> diskCache;
+	std::shared_ptr<ChunkEventStream> chunkEvents;
 
 	bool readyForUpdate;
+	float heightQueryError;
+	size_t heightQueries, heightFallbacks;		//!< Ground height queries, and those evaluated with noise
 
+	PlanetGrid* getFace(const glm::vec3& dir);		//!< Face that the direction "dir" (from the nucleus) points to
 	virtual float callBack_getFloorHeight(const glm::vec3& pos);	//!< Callback example
+	void linkFaces();				//!< Tell each face its neighbour faces (see PlanetGrid::setNeighbourFaces()) and the chunk event stream
 
 	//friend GrassSystem;
 };
@@ -412,7 +756,7 @@ bool grassSupported_callback(const glm::vec3& pos, float groundSlope);
 class GrassSystem
 {
 public:
-	GrassSystem(Renderer& renderer, float maxDist, bool(*grassSupported_callback)(const glm::vec3& pos, float groundSlope) = grassSupported_callback);
+	GrassSystem(Renderer& renderer, float maxDist, bool(*grassSupported_callback)(const glm::vec3& pos, float groundSlope) = ::grassSupported_callback);
 	~GrassSystem();
 
 	void createGrassModel(std::vector<ShaderLoader>& shaders, std::vector<TextureLoader>& textures, const LightSet* lights);
@@ -483,45 +827,4 @@ protected:
 };
 
 
-// Definitions ----------------------------------------------------------------
-
-template<typename T, typename V>
-void preorder(QuadNode<T>* root, V* visitor)
-{
-	if (!root) return;
-	visitor(root);
-	preorder(root.getLeft());
-	preorder(root.getRight());
-}
-/*
-template<typename T, typename V, typename A>
-void preorder(QuadNode<T>* root, V* visitor, A &params)
-{
-	if (!root) return;
-	visitor(root, params);
-	preorder(root.getLeft());
-	preorder(root.getRight());
-}
-*/
-template<typename T, typename V>
-void postorder(QuadNode<T>* root, V* visitor)
-{
-	if (!root) return;
-	inorder(root->getLeft());
-	inorder(root->getRight());
-	visitor(root);
-}
-
-template<typename T, typename V>
-void inorder(QuadNode<T>* root, V* visitor)
-{
-	if (!root) return;
-	inorder(root->getLeft());
-	visitor(root);
-	inorder(root->getRight());
-}
-
-//void updateUBOs_visitor(QuadNode<Chunk*>* node, const TerrainGrid &terrGrid);
-
-
 #endif
@@ -13,11 +13,15 @@ layout(set = 0, binding = 0) uniform ubobject {
     vec4 time;					// float
 	vec4 sideDepthsDiff;
 	LightPD light[NUMLIGHTS];	// n * (2 * vec4)
+	vec4 gridOrigin;			// xyz: first vertex in the cube face, w: radius
+	vec4 gridColumnStep;		// xyz: step between columns, w: number of columns
+	vec4 gridRowStep;			// xyz: step between rows, w: vertices per chunk
+	vec4 nucleus;				// vec3
 } ubo;
 
-layout(location = 0) in vec3    inPos;					// Each location has 16 bytes
-layout(location = 1) in vec3    inNormal;
-layout(location = 2) in vec3    inGapFix;
+layout(location = 0) in float   inHeight;				// Height over the sphere
+layout(location = 1) in vec2    inOctNormal;			// Octahedral-encoded normal
+layout(location = 2) in vec2    inExtraHeights;			// Gap fixes (x2 & x4)
 
 layout(location = 0)  		out vec3	outPos;			// Vertex position.
 layout(location = 1)  flat 	out vec3 	outCamPos;		// Camera position
@@ -31,6 +35,10 @@ layout(location = 13) flat	out LightPD outLight[NUMLIGHTS];
 
 void main()
 {
+	// Reconstruct vertex data from its position in the grid
+	vec3 inPos, inNormal, inGapFix;
+	planetGridVertex(gl_VertexIndex, ubo.gridOrigin, ubo.gridColumnStep, ubo.gridRowStep, ubo.nucleus, inHeight, inOctNormal, inExtraHeights, inPos, inNormal, inGapFix);
+	
 	gl_Position		= ubo.proj * ubo.view * ubo.model * vec4(fixedPos(inPos, inGapFix, ubo.sideDepthsDiff), 1.0);
 				    
 	outPos          = inPos;
@@ -12,6 +12,9 @@
 		TB3
 	Graphics:
 		fixedPos
+		gapFixType
+		octDecode
+		planetGridVertex
 		getTB
 		getTB3
 	Math:
@@ -139,6 +142,39 @@ TB3 getTB3(vec3 normal)
 	return tb;
 }
 
+// Vertex type used by fixedPos (0: interior, 1: right, 2: left, 3: up, 4: down) of a vertex in a square grid of chunk (h: column, v: row). Same as PlanetChunk::computeGapFixes().
+float gapFixType(int h, int v, int sideVertices)
+{
+	if(h == sideVertices - 1 && v > 0 && v < sideVertices - 1 && v % 4 != 0) return 1;
+	if(h == 0                && v > 0 && v < sideVertices - 1 && v % 4 != 0) return 2;
+	if(v == sideVertices - 1 && h > 0 && h < sideVertices - 1 && h % 4 != 0) return 3;
+	if(v == 0                && h > 0 && h < sideVertices - 1 && h % 4 != 0) return 4;
+	return 0;
+}
+
+// Decode octahedral-encoded normal
+vec3 octDecode(vec2 oct)
+{
+	vec3 normal = vec3(oct, 1. - abs(oct.x) - abs(oct.y));
+	float t = max(-normal.z, 0.);
+	normal.x += (normal.x >= 0. ? -t : t);
+	normal.y += (normal.y >= 0. ? -t : t);
+	return normalize(normal);
+}
+
+// Reconstruct a vertex of a planet chunk (PlanetChunk stores only height, normal and gap fixes per vertex) from its index and the chunk's grid (gridRowStep.w: vertices per chunk). Outputs: position, normal, and gap fix (type, extra heights) for fixedPos().
+void planetGridVertex(int vertexIndex, vec4 gridOrigin, vec4 gridColumnStep, vec4 gridRowStep, vec4 nucleus, float height, vec2 octNormal, vec2 extraHeights, out vec3 pos, out vec3 normal, out vec3 gapFix)
+{
+	int sideVertices = int(gridColumnStep.w);
+	int index        = vertexIndex % int(gridRowStep.w);	// vertexIndex includes the chunk offset in the vertex arena
+	int h            = index % sideVertices;
+	int v            = index / sideVertices;
+	vec3 cube        = gridOrigin.xyz + gridColumnStep.xyz * float(h) + gridRowStep.xyz * float(v);
+	pos              = normalize(cube - nucleus.xyz) * (gridOrigin.w + height);
+	normal           = octDecode(octNormal);
+	gapFix           = vec3(gapFixType(h, v, sideVertices), extraHeights);
+}
+
 
 // Math functions ------------------------------------------------------------------------
 
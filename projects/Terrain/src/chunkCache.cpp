@@ -0,0 +1,258 @@
+#include <iostream>
+#include <cstring>
+#include <mutex>
+#include <algorithm>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#include "chunkCache.hpp"
+
+
+const uint32_t ChunkDiskCache::formatVersion = 3;
+
+static const char cacheMagic[8] = { 'G', 'R', 'P', 'C', 'H', 'N', 'K', 0 };
+static const size_t minCapacity = 1 << 20;        // Initial file size (1 MB)
+
+ChunkDiskCache::ChunkDiskCache(const std::string& path, uint64_t configHash, size_t recordSize)
+    : path(path), configHash(configHash), recordSize(recordSize), data(nullptr), capacity(0), hits(0), misses(0), loadTime(0), generationTime(0)
+{
+    size_t fileSize = 0;
+
+#ifdef _WIN32
+    mapping = nullptr;
+    file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) file = nullptr;
+
+    LARGE_INTEGER size;
+    if (file && GetFileSizeEx(file, &size)) fileSize = size.QuadPart;
+#else
+    file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+    struct stat status;
+    if (file >= 0 && fstat(file, &status) == 0) fileSize = status.st_size;
+#endif
+
+    if (fileSize < sizeof(Header) || !mapFile(fileSize))
+    {
+        reset();
+        return;
+    }
+
+    Header* head = header();
+    if (memcmp(head->magic, cacheMagic, sizeof(cacheMagic)) || head->version != formatVersion || head->recordSize != recordSize || head->configHash != configHash || head->dataEnd < sizeof(Header) || head->dataEnd > capacity)
+    {
+        std::cout << "Chunk cache discarded (noise parameters or format changed): " << path << std::endl;
+        reset();
+        return;
+    }
+
+    // Index the records
+    size_t recordStride = sizeof(uint64_t) + recordSize;
+    uint64_t key;
+
+    for (uint64_t offset = sizeof(Header); offset + recordStride <= head->dataEnd; offset += recordStride)
+    {
+        memcpy(&key, data + offset, sizeof(key));
+        index[key] = offset + sizeof(key);
+    }
+
+    std::cout << "Chunk cache: " << index.size() << " chunks (" << path << ")" << std::endl;
+}
+
+ChunkDiskCache::~ChunkDiskCache()
+{
+    if (data)
+    {
+        uint64_t dataEnd = header()->dataEnd;
+        unmapFile();
+        resizeFile(dataEnd);        // Remove the unused capacity
+    }
+
+    closeFile();
+}
+
+bool ChunkDiskCache::read(uint64_t key, void* dest)
+{
+    return read(key, [this, dest](const unsigned char* record) { memcpy(dest, record, recordSize); });
+}
+
+bool ChunkDiskCache::read(uint64_t key, const std::function<void(const unsigned char* record)>& decode)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mutFile);      // The mapping can't move meanwhile
+
+        auto iter = index.find(key);
+        if (iter == index.end())
+        {
+            misses++;
+            return false;
+        }
+
+        decode(data + iter->second);
+    }
+
+    hits++;
+    return true;
+}
+
+void ChunkDiskCache::write(uint64_t key, const void* src)
+{
+    std::unique_lock<std::shared_mutex> lock(mutFile);
+
+    if (!data || index.find(key) != index.end()) return;
+
+    uint64_t offset = header()->dataEnd;
+    uint64_t end = offset + sizeof(key) + recordSize;
+
+    if (end > capacity)
+    {
+        size_t newCapacity = std::max<size_t>(capacity * 2, end);
+        unmapFile();
+
+        if (!mapFile(newCapacity))
+        {
+            std::cout << "Chunk cache can't grow (disabled): " << path << std::endl;
+            index.clear();
+            closeFile();
+            return;
+        }
+    }
+
+    memcpy(data + offset, &key, sizeof(key));
+    memcpy(data + offset + sizeof(key), src, recordSize);
+    header()->dataEnd = end;        // After the record, so an interrupted write leaves a consistent file
+    index[key] = offset + sizeof(key);
+}
+
+void ChunkDiskCache::addLoadTime(double ms) { loadTime += (int64_t)(ms * 1e6); }
+
+void ChunkDiskCache::addGenerationTime(double ms) { generationTime += (int64_t)(ms * 1e6); }
+
+bool ChunkDiskCache::isOpen() const { return data != nullptr; }
+
+size_t ChunkDiskCache::getRecordSize() const { return recordSize; }
+
+size_t ChunkDiskCache::numRecords()
+{
+    std::shared_lock<std::shared_mutex> lock(mutFile);
+    return index.size();
+}
+
+size_t ChunkDiskCache::numHits() const { return hits; }
+
+size_t ChunkDiskCache::numMisses() const { return misses; }
+
+double ChunkDiskCache::getLoadTime() const { return hits ? loadTime / 1e6 / hits : 0; }
+
+double ChunkDiskCache::getGenerationTime() const { return misses ? generationTime / 1e6 / misses : 0; }
+
+ChunkDiskCache::Header* ChunkDiskCache::header() { return (Header*)data; }
+
+void ChunkDiskCache::reset()
+{
+    index.clear();
+    if (data) unmapFile();
+
+    if (!resizeFile(0) || !mapFile(minCapacity))
+    {
+        std::cout << "Chunk cache can't be opened: " << path << std::endl;
+        closeFile();
+        return;
+    }
+
+    Header* head = header();
+    memcpy(head->magic, cacheMagic, sizeof(cacheMagic));
+    head->version = formatVersion;
+    head->recordSize = recordSize;
+    head->configHash = configHash;
+    head->dataEnd = sizeof(Header);
+}
+
+#ifdef _WIN32
+
+bool ChunkDiskCache::mapFile(size_t size)
+{
+    if (!file || !resizeFile(size)) return false;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xFFFFFFFF), nullptr);
+    if (!mapping) return false;
+
+    data = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        mapping = nullptr;
+        return false;
+    }
+
+    capacity = size;
+    return true;
+}
+
+void ChunkDiskCache::unmapFile()
+{
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+
+    data = nullptr;
+    mapping = nullptr;
+    capacity = 0;
+}
+
+bool ChunkDiskCache::resizeFile(size_t size)
+{
+    if (!file) return false;
+
+    LARGE_INTEGER distance;
+    distance.QuadPart = size;
+    return SetFilePointerEx(file, distance, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+}
+
+void ChunkDiskCache::closeFile()
+{
+    if (file) CloseHandle(file);
+    file = nullptr;
+}
+
+#else
+
+bool ChunkDiskCache::mapFile(size_t size)
+{
+    if (file < 0 || !resizeFile(size)) return false;
+
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (address == MAP_FAILED) return false;
+
+    data = (unsigned char*)address;
+    capacity = size;
+    return true;
+}
+
+void ChunkDiskCache::unmapFile()
+{
+    if (data) munmap(data, capacity);
+
+    data = nullptr;
+    capacity = 0;
+}
+
+bool ChunkDiskCache::resizeFile(size_t size)
+{
+    return file >= 0 && ftruncate(file, size) == 0;
+}
+
+void ChunkDiskCache::closeFile()
+{
+    if (file >= 0) close(file);
+    file = -1;
+}
+
+#endif
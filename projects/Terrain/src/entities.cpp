@@ -3,10 +3,11 @@
 
 #include "entities.hpp"
 #include "terrain.hpp"
+#include "planetScene.hpp"
 
 
 EntityFactory::EntityFactory(Renderer& renderer) 
-	: MainEntityFactory(), renderer(renderer) { };
+	: MainEntityFactory(), renderer(renderer), threadPool(std::make_shared<ThreadPool>()), chunkScheduler(std::make_shared<ChunkScheduler>(threadPool)) { };
 
 std::vector<Component*> EntityFactory::createNoPP(ShaderLoader Vshader, ShaderLoader Fshader, std::initializer_list<TextureLoader> textures)
 {
@@ -283,56 +284,38 @@ std::vector<Component*> EntityFactory::createSphere(ShaderLoader Vshader, Shader
 
 	Sphere* seaSphere = new Sphere(&renderer, 100, 21, 7, 2, 1.f, 2000, { 0.f, 0.f, 0.f }, true);
 	seaSphere->addResources(shaders, textures);
+	seaSphere->setThreadPool(threadPool);
+	seaSphere->setScheduler(chunkScheduler);
 
 	return std::vector<Component*>{ 
 		new c_Model_planet(seaSphere) 
 	};
 }
 
-std::vector<Component*> EntityFactory::createPlanet(ShaderLoader Vshader, ShaderLoader Fshader, std::vector<TextureLoader>& textures)
+std::vector<Component*> EntityFactory::createPlanet(ShaderLoader Vshader, ShaderLoader VbatchShader, ShaderLoader Fshader, std::vector<TextureLoader>& textures)
 {
-	// Create noise generator:
-
-	std::shared_ptr<Noiser> continentalness = std::make_shared<FractalNoise_SplinePts>(		// Range [-1, 1]
-		FastNoiseLite::NoiseType_Perlin,	// Noise type
-		4, 4.f, 0.3f,						// Octaves, Lacunarity (for frequency), Persistence (for amplitude)
-		0.1,								// Scale
-		4952,								// Seed
-		std::vector<std::array<float, 2>>{ {-1, -0.5}, {-0.1, -0.1}, { 0.1, 0.1 }, { 1, 1 } } );
-
-	std::shared_ptr<Noiser> erosion = std::make_shared<FractalNoise_SplinePts>(				// Rage [0, 1]
-		FastNoiseLite::NoiseType_Perlin,
-		2, 5.f, 0.3f,
-		0.1,
-		4953,
-		std::vector<std::array<float, 2>>{ {-1, 1}, { 0, 0.3 }, { 1, 0} } );
-
-	std::shared_ptr<Noiser> PV = std::make_shared<FractalNoise_SplinePts>(					// Range [-1, 1]
-		FastNoiseLite::NoiseType_Perlin,
-		2, 2.f, 0.3f,
-		0.5,
-		4954,
-		std::vector<std::array<float, 2>>{ {-1, 0}, { -0.3, 1 }, { 0.6, 0 }, { 1, 1 } });
-
-	std::shared_ptr<Noiser> temperature;
-
-	std::shared_ptr<Noiser> humidity;
-
-	std::vector<std::shared_ptr<Noiser>> noiserSet = { continentalness, erosion, PV, temperature, humidity };
-	std::shared_ptr<Noiser> multiNoise = std::make_shared<Multinoise>(noiserSet, getNoise_C_E_PV);
-	
-	// Create planet entity:
+	// Create planet entity (settings shared with TerrainBenchmark, see planetScene.hpp):
 
 	std::vector<ShaderLoader> shaders{ Vshader, Fshader };
 
-	Planet* planet = new Planet(&renderer, multiNoise, 100, 29, 7, 2, 1.2f, 2000, { 0.f, 0.f, 0.f }, false);
+	Planet* planet = new Planet(&renderer, createPlanetNoise(), planetRootCellSize, planetSideVertex, planetLevels, planetMinLevel, planetDistMultiplier, planetRadius, planetNucleus, false);
 	planet->addResources(shaders, textures);
+	planet->setBatchShader(VbatchShader);
+	planet->setThreadPool(threadPool);
+	planet->setScheduler(chunkScheduler);
+	planet->setDiskCache("planet.chunks");		// Persistent across runs (regenerated if the noise changes)
 	
 	return std::vector<Component*>{ 
 		new c_Model_planet(planet) 
 	};
 }
 
+/// Distributor of an item entity over the planet (see planetScene.hpp)
+c_Distributor* newDistributor(const PlanetItems& items)
+{
+	return new c_Distributor(items.maxDepth, items.minDepth, items.rules.rotType, items.rules.maxScale, items.rules.adaptToTerrainNormal, items.subGeometry, items.rules.itemSupported, items.rules.noisers);
+}
+
 std::vector<Component*> EntityFactory::createGrass(ShaderLoader Vshader, ShaderLoader Fshader, std::initializer_list<TextureLoader> textures, VerticesLoader& vertexData, const c_Lights* c_lights)
 {
 	const LightSet* lights;
@@ -342,10 +325,6 @@ std::vector<Component*> EntityFactory::createGrass(ShaderLoader Vshader, ShaderL
 		return std::vector<Component*>();
 	}
 
-	std::vector<std::shared_ptr<Noiser>> noiseSet;
-	//noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 1, 1111));
-	//noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 0.1, 1112));
-
 	//VerticesLoader vertexData(vertexDir + "grass.obj");
 	std::vector<ShaderLoader> shaders{ Vshader, Fshader };
 	std::vector<TextureLoader> textureSet{ textures };
@@ -371,21 +350,10 @@ std::vector<Component*> EntityFactory::createGrass(ShaderLoader Vshader, ShaderL
 	return std::vector<Component*>{
 		new c_Model_normal(model, UboType::mvpncl),
 		new c_ModelParams(),
-		new c_Distributor(6, 6, zAxisRandom, 2, true, 0, grass_callback, noiseSet)
+		newDistributor(getGrassItems())
 	};
 }
 
-bool grass_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers)
-{
-	float height = glm::distance(pos, glm::vec3(0, 0, 0));
-	if (groundSlope > 0.1 ||
-		height < 2010 ||
-		height > 2100)
-		return false;
-
-	return true;
-}
-
 std::vector<Component*> EntityFactory::createPlant(ShaderLoader Vshader, ShaderLoader Fshader, std::initializer_list<TextureLoader> textures, VerticesLoader& vertexData, const c_Lights* c_lights)
 {
 	const LightSet* lights;
@@ -395,10 +363,6 @@ std::vector<Component*> EntityFactory::createPlant(ShaderLoader Vshader, ShaderL
 		return std::vector<Component*>();
 	}
 
-	std::vector<std::shared_ptr<Noiser>> noiseSet;
-	noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 1, 1111));
-	noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 0.1, 1112));
-
 	//VerticesLoader vertexData(vertexDir + "grass.obj");
 	std::vector<ShaderLoader> shaders{ Vshader, Fshader };
 	std::vector<TextureLoader> textureSet{ textures };
@@ -424,23 +388,10 @@ std::vector<Component*> EntityFactory::createPlant(ShaderLoader Vshader, ShaderL
 	return std::vector<Component*>{
 		new c_Model_normal(model, UboType::mvpncl),
 		new c_ModelParams(),
-		new c_Distributor(6, 6, zAxisRandom, 2, false, 0, plant_callback, noiseSet)
+		newDistributor(getPlantItems())
 	};
 }
 
-bool plant_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers)
-{
-	float height = glm::distance(pos, glm::vec3(0, 0, 0));
-	if (groundSlope > 0.22 ||
-		height < 2010 ||
-		height > 2100 ||
-		noisers[0]->getNoise(pos.x, pos.y, pos.z) < 0 ||
-		noisers[1]->getNoise(pos.x, pos.y, pos.z) < 0.7)
-		return false;
-
-	return true;
-}
-
 std::vector<Component*> EntityFactory::createRock(ShaderLoader Vshader, ShaderLoader Fshader, std::initializer_list<TextureLoader> textures, VerticesLoader& vertexData, const c_Lights* c_lights)
 {
 	const LightSet* lights;
@@ -450,10 +401,6 @@ std::vector<Component*> EntityFactory::createRock(ShaderLoader Vshader, ShaderLo
 		return std::vector<Component*>();
 	}
 
-	std::vector<std::shared_ptr<Noiser>> noiseSet;
-	noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 1, 1113));
-	noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 0.0001, 1114));
-
 	//VerticesLoader vertexData(vertexDir + "rocks/free_rock/rock.obj");
 	std::vector<ShaderLoader> shaders{ Vshader, Fshader };
 	std::vector<TextureLoader> textureSet{ textures };
@@ -479,23 +426,10 @@ std::vector<Component*> EntityFactory::createRock(ShaderLoader Vshader, ShaderLo
 	return std::vector<Component*>{
 		new c_Model_normal(model, UboType::mvpncl),
 			new c_ModelParams(),
-			new c_Distributor(6, 6, allAxesRandom, 5, false, 0, stone_callback, noiseSet)
+			newDistributor(getStoneItems())
 	};
 }
 
-bool stone_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers)
-{
-	float height = glm::distance(pos, glm::vec3(0, 0, 0));
-	if (groundSlope > 0.22 ||
-		height < 2000 ||
-		height > 2100 ||
-		noisers[0]->getNoise(pos.x, pos.y, pos.z) < 0 ||
-		noisers[1]->getNoise(pos.x, pos.y, pos.z) < 0.95)
-		return false;
-
-	return true;
-}
-
 std::vector<std::vector<Component*>> EntityFactory::createTree(std::initializer_list<ShaderLoader> trunkShaders, std::initializer_list<ShaderLoader> branchShaders, std::initializer_list<TextureLoader> tex_trunk, std::initializer_list<TextureLoader> tex_branch, VerticesLoader& vertexData_trunk, VerticesLoader& vertexData_branches, const c_Lights* c_lights)
 {
 	const LightSet* lights;
@@ -505,9 +439,7 @@ std::vector<std::vector<Component*>> EntityFactory::createTree(std::initializer_
 		return std::vector<std::vector<Component*>>();
 	}
 
-	std::vector<std::shared_ptr<Noiser>> noiseSet;
-	noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 1, 1115));
-	noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 0.0001, 1116));
+	PlanetItems treeItems = getTreeItems();		// Shared by trunk and branches
 
 	std::vector<std::vector<Component*>> entities;
 
@@ -538,7 +470,7 @@ std::vector<std::vector<Component*>> EntityFactory::createTree(std::initializer_
 	entities.push_back(std::vector<Component*>{ 
 		new c_Model_normal(model, UboType::mvpncl),
 		new c_ModelParams(),
-		new c_Distributor(6, 6, zAxisRandom, 2, false, 0, tree_callback, noiseSet)
+		newDistributor(treeItems)
 	});
 	
 	// Branches:
@@ -568,7 +500,7 @@ std::vector<std::vector<Component*>> EntityFactory::createTree(std::initializer_
 	entities.push_back(std::vector<Component*>{ 
 		new c_Model_normal(model2, UboType::mvpncl),
 		new c_ModelParams(),
-		new c_Distributor(6, 6, zAxisRandom, 2, false, 0, tree_callback, noiseSet)
+		newDistributor(treeItems)
 	});
 	
 	return entities;
@@ -583,10 +515,6 @@ std::vector<Component*> EntityFactory::createTreeBillboard(ShaderLoader Vshader,
 		return std::vector<Component*>();
 	}
 
-	std::vector<std::shared_ptr<Noiser>> noiseSet;
-	noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 1, 1115));
-	noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 0.0001, 1116));
-
 	//VerticesLoader vertexData(vertexDir + "grass.obj");
 	std::vector<ShaderLoader> shaders{ Vshader, Fshader };
 	std::vector<TextureLoader> textureSet{ textures };
@@ -612,19 +540,6 @@ std::vector<Component*> EntityFactory::createTreeBillboard(ShaderLoader Vshader,
 	return std::vector<Component*>{
 		new c_Model_normal(model, UboType::mvpncl),
 			new c_ModelParams(),
-			new c_Distributor(5, 4, zAxisRandom, 2, false, 1, tree_callback, noiseSet)
+			newDistributor(getTreeBillboardItems())
 	};
-}
-
-bool tree_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers)
-{
-	float height = glm::distance(pos, glm::vec3(0, 0, 0));
-	if (groundSlope > 0.22 ||
-		height < 2010 || 
-		height > 2100 ||
-		noisers[0]->getNoise(pos.x, pos.y, pos.z) < 0 ||
-		noisers[1]->getNoise(pos.x, pos.y, pos.z) < 0.90)
-		return false;
-
-	return true;
 }
\ No newline at end of file
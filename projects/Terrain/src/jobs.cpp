@@ -0,0 +1,117 @@
+#include <memory>
+#include <algorithm>
+
+#include "jobs.hpp"
+
+
+ThreadPool::ThreadPool(unsigned numThreads)
+    : runThreads(true), completedJobs(0)
+{
+    if (!numThreads)
+    {
+        numThreads = std::thread::hardware_concurrency();
+        numThreads = (numThreads > 1 ? numThreads - 1 : 1);     // Leave one core for the render thread
+    }
+
+    for (unsigned i = 0; i < numThreads; i++)
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        const std::lock_guard<std::mutex> lock(mutJobs);
+        runThreads = false;
+    }
+
+    cvJobs.notify_all();
+
+    for (std::thread& worker : workers)
+        if (worker.joinable()) worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mutJobs);
+        jobs.push_back(std::move(job));
+    }
+
+    cvJobs.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& job)
+{
+    if (!count) return;
+
+    // State shared with the helper jobs. It's kept alive by them, so a helper that starts after this method returns finds no work and exits.
+    struct ForState
+    {
+        std::function<void(size_t)> job;
+        size_t count;
+        std::atomic<size_t> next, done;
+        std::mutex mutDone;
+        std::condition_variable cvDone;
+    };
+
+    std::shared_ptr<ForState> state = std::make_shared<ForState>();
+    state->job = job;
+    state->count = count;
+    state->next = 0;
+    state->done = 0;
+
+    auto runIterations = [state]()
+    {
+        size_t i;
+        while ((i = state->next++) < state->count)
+        {
+            state->job(i);
+
+            if (++state->done == state->count)
+            {
+                const std::lock_guard<std::mutex> lock(state->mutDone);
+                state->cvDone.notify_all();
+            }
+        }
+    };
+
+    size_t numHelpers = std::min(workers.size(), count - 1);
+    for (size_t i = 0; i < numHelpers; i++)
+        submit(runIterations);
+
+    runIterations();    // The calling thread works too (this way, it doesn't wait idle and can't be blocked by a busy pool)
+
+    std::unique_lock<std::mutex> lock(state->mutDone);
+    state->cvDone.wait(lock, [&state]() { return state->done == state->count; });
+}
+
+unsigned ThreadPool::getNumThreads() const { return workers.size(); }
+
+size_t ThreadPool::getNumPendingJobs()
+{
+    const std::lock_guard<std::mutex> lock(mutJobs);
+    return jobs.size();
+}
+
+size_t ThreadPool::getNumCompletedJobs() const { return completedJobs; }
+
+void ThreadPool::workerLoop()
+{
+    std::function<void()> job;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutJobs);
+            cvJobs.wait(lock, [this]() { return !runThreads || jobs.size(); });
+
+            if (jobs.empty()) return;       // runThreads == false and no pending jobs
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        job();
+        completedJobs++;
+    }
+}
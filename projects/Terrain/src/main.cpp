@@ -72,7 +72,7 @@ int main(int argc, char* argv[])
 			//em.addEntity(eFact.createPoints(shaderLoaders[0], shaderLoaders[1], { }));	// <<<
 			em.addEntity("axes", eFact.createAxes(shaderLoaders["v_lines"], shaderLoaders["f_lines"], {}));
 			//em.addEntity("grid", eFact.createGrid(shaderLoaders["v_lines"], shaderLoaders["f_lines"], { }));
-			em.addEntity("planet", eFact.createPlanet(shaderLoaders["v_planetChunk"], shaderLoaders["f_planetChunk"], soilTexInfos));
+			em.addEntity("planet", eFact.createPlanet(shaderLoaders["v_planetChunk"], shaderLoaders["v_planetChunkBatch"], shaderLoaders["f_planetChunk"], soilTexInfos));
 			//em.addEntity("sea", eFact.createSphere(shaderLoaders["v_seaPlanet"], shaderLoaders["f_seaPlanet"], seaTexInfos));
 			em.addEntity("grass", eFact.createGrass(
 				shaderLoaders["v_grass"], shaderLoaders["f_grass"],
@@ -200,6 +200,7 @@ void loadResourcesInfo()
 		shaderLoaders.insert(std::pair("f_plainChunk", ShaderLoader(shadersDir + "f_plainChunk.frag")));
 
 		shaderLoaders.insert(std::pair("v_planetChunk", ShaderLoader(shadersDir + "v_planetChunk.vert")));
+		shaderLoaders.insert(std::pair("v_planetChunkBatch", ShaderLoader(shadersDir + "v_planetChunkBatch.vert")));
 		shaderLoaders.insert(std::pair("f_planetChunk", ShaderLoader(shadersDir + "f_planetChunk.frag")));
 
 		shaderLoaders.insert(std::pair("v_sun", ShaderLoader(shadersDir + "v_sun.vert")));
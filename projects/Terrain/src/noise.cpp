@@ -1,29 +1,125 @@
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <cstring>
 #include <numbers>
 #include <random>
+#include <atomic>
 
 #include "noise.hpp"
+#include "noiseGraph.hpp"
+#include "jobs.hpp"
 
 
-void Noiser::noiseTester(Noiser* noiser, size_t size) const
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
 {
-    float max = 0, min = 0;
-    float noise;
+    const unsigned char* bytes = (const unsigned char*)data;
 
-    for (size_t i = 1; i != size; i++)
+    for (size_t i = 0; i < size; i++)
     {
-        std::cout << "%: " << 100 * (float)i / size << "     \r";   // Output computation progress
-        for (size_t j = 1; j != size; j++)
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static NoiseIsa getBestNoiseIsa()
+{
+#ifdef NOISE_ISA_DISPATCH
+    __builtin_cpu_init();       // It may run before the constructors that initialize the CPU data
+    if (__builtin_cpu_supports("avx2")) return NoiseIsa::avx2;
+#endif
+    return NoiseIsa::generic;
+}
+
+static std::atomic<NoiseIsa> noiseIsa(getBestNoiseIsa());
+
+NoiseIsa getNoiseIsa() { return noiseIsa.load(std::memory_order_relaxed); }
+
+bool setNoiseIsa(NoiseIsa isa)
+{
+    if (isa > getBestNoiseIsa()) return false;
+
+    noiseIsa = isa;
+    return true;
+}
+
+const char* getNoiseIsaName(NoiseIsa isa) { return isa == NoiseIsa::avx2 ? "avx2" : "generic"; }
+
+float getLodFootprint(int numOctaves, float frequency, float lacunarity, float footprint)
+{
+    if (getLodOctaves(numOctaves, frequency, lacunarity, footprint) >= numOctaves) return 0;
+    if (numOctaves < 2) return footprint;
+
+    return std::min(footprint, 0.5f / (frequency * lacunarity));      // Bigger footprints skip every octave but the first one
+}
+
+void Noiser::noiseTester(Noiser* noiser, size_t size, ThreadPool* threadPool) const
+{
+    std::array<float, 2> range = noiser->getNoiseRange(size, threadPool);
+    std::cout << "Range = [" << range[0] << ", " << range[1] << ']' << std::endl;
+}
+
+std::array<float, 2> Noiser::getNoiseRange(size_t size, ThreadPool* threadPool)
+{
+    if (!size) return { 0, 0 };
+    std::vector<std::array<float, 2>> rowRanges(size);     // Each row is reduced on its own, so rows can be computed concurrently
+
+    auto computeRow = [&](size_t i)
+    {
+        std::array<float, 2>& range = rowRanges[i];
+        range[0] = range[1] = getNoise(i, 0);
+
+        for (size_t j = 1; j < size; j++)
         {
-            noise = noiser->getNoise(i, j);
-            if (noise > max) max = noise;
-            else if (noise < min) min = noise;
+            float noise = getNoise(i, j);
+            range[0] = std::min(range[0], noise);
+            range[1] = std::max(range[1], noise);
         }
+    };
+
+    if (threadPool) threadPool->parallelFor(size, computeRow);
+    else for (size_t i = 0; i < size; i++) computeRow(i);
+
+    std::array<float, 2> range = rowRanges[0];
+    for (const std::array<float, 2>& rowRange : rowRanges)
+    {
+        range[0] = std::min(range[0], rowRange[0]);
+        range[1] = std::max(range[1], rowRange[1]);
     }
 
-    std::cout << "Range = [" << min << ", " << max << ']' << std::endl;
+    return range;
+}
+
+void Noiser::getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = getNoise(xs[i], ys[i], zs[i]);
+}
+
+void Noiser::getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = getNoise(xs[i], ys[i]);
+}
+
+float Noiser::getNoiseGrad(float x, float y, float z, glm::vec3& grad)
+{
+    const float h = 0.05f;      // Step (world units). Big enough for float precision at planet scale.
+
+    grad.x = (getNoise(x + h, y, z) - getNoise(x - h, y, z)) / (2 * h);
+    grad.y = (getNoise(x, y + h, z) - getNoise(x, y - h, z)) / (2 * h);
+    grad.z = (getNoise(x, y, z + h) - getNoise(x, y, z - h)) / (2 * h);
+
+    return getNoise(x, y, z);
+}
+
+void Noiser::getNoiseGradBatch(const float* xs, const float* ys, const float* zs, float* out, glm::vec3* grads, size_t n, float)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = getNoiseGrad(xs[i], ys[i], zs[i], grads[i]);
 }
 
 SimpleNoise::SimpleNoise(FastNoiseLite::NoiseType NoiseType, float scale, int seed)
@@ -42,8 +138,28 @@ float SimpleNoise::getNoise(float x, float y)
     return noise.GetNoise(x / scale, y / scale);
 }
 
+void SimpleNoise::getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = noise.GetNoise(xs[i] / scale, ys[i] / scale, zs[i] / scale);
+}
+
+void SimpleNoise::getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = noise.GetNoise(xs[i] / scale, ys[i] / scale);
+}
+
+uint64_t SimpleNoise::getConfigHash() const
+{
+    const char* name = "SimpleNoise";
+    uint64_t hash = hashBytes(name, strlen(name));
+    hash = hashBytes(&scale, sizeof(scale), hash);
+    return hashBytes(&seed, sizeof(seed), hash);
+}
+
 FractalNoise::FractalNoise(FastNoiseLite::NoiseType NoiseType, int NumOctaves, float Lacunarity, float Persistence, float Scale, float Multiplier, int Seed)
-    : Noiser(), noiseType(NoiseType), numOctaves(NumOctaves), lacunarity(Lacunarity), persistence(Persistence), scale(Scale), multiplier(Multiplier), seed(Seed)
+    : Noiser(), coordScale(1 / Scale), noiseType(NoiseType), numOctaves(NumOctaves), lacunarity(Lacunarity), persistence(Persistence), scale(Scale), multiplier(Multiplier), seed(Seed)
 {
     // Set FastNoiseLite object
     noise.SetNoiseType(noiseType);
@@ -53,7 +169,7 @@ FractalNoise::FractalNoise(FastNoiseLite::NoiseType NoiseType, int NumOctaves, f
     noise.SetFractalGain(persistence);
     noise.SetFractalOctaves(numOctaves);    // Set to 0 or 1 if getProcessedNoise is used
 
-    noise.SetFrequency(0.01f);
+    noise.SetFrequency(frequency);
     noise.SetFractalType(FastNoiseLite::FractalType::FractalType_FBm);
     noise.SetFractalWeightedStrength(0.0f);
 
@@ -70,6 +186,41 @@ FractalNoise::FractalNoise(FastNoiseLite::NoiseType NoiseType, int NumOctaves, f
     noise.SetDomainWarpAmp(1.0f);
     //noise.DomainWarp(FNfloat & x, FNfloat & y, FNfloat & z);
 
+    float amplitude = std::abs(persistence);    // Same computation as FastNoiseLite::CalculateFractalBounding
+    float totalAmplitude = 1;
+    for (int i = 1; i < numOctaves; i++)
+    {
+        totalAmplitude += amplitude;
+        amplitude *= std::abs(persistence);
+    }
+    fractalBounding = 1 / totalAmplitude;
+
+    // Same noise with fewer octaves. Each one's output is normalized by its own bounding (1 / sum of its amplitudes), which is undone with lodBounding.
+    amplitude = 1;
+    totalAmplitude = 0;
+    for (int i = 1; i < numOctaves; i++)
+    {
+        totalAmplitude += amplitude;
+        amplitude *= std::abs(persistence);
+        lodNoise.push_back(noise);
+        lodNoise.back().SetFractalOctaves(i);
+        lodBounding.push_back(totalAmplitude * fractalBounding);
+    }
+
+    // Octaves 1..n-1 alone (same seed, frequency and amplitude they have in the FBm)
+    float octaveFrequency = frequency;
+    amplitude = fractalBounding;
+    for (int i = 1; i < numOctaves; i++)
+    {
+        octaveFrequency *= lacunarity;
+        amplitude *= persistence;
+        octaveNoise.push_back(noise);
+        octaveNoise.back().SetFractalType(FastNoiseLite::FractalType::FractalType_None);
+        octaveNoise.back().SetFrequency(octaveFrequency);
+        octaveNoise.back().SetSeed(seed + i);
+        octaveAmplitude.push_back(amplitude);
+    }
+
     //float totalAmplitude = 0;
     //float amplitude = 1;
     //for (int i = 0; i < numOctaves; i++)
@@ -101,13 +252,295 @@ float FractalNoise::FractalNoise::getNoise(float x, float y)
     return multiplier * scale * noise.GetNoise(x/scale, y/scale);
 }
 
-Multinoise::Multinoise(std::vector<std::shared_ptr<Noiser>>& noisers, float(*getNoise3D)(float, float, float, std::vector<std::shared_ptr<Noiser>>&), float(*getNoise2D)(float, float, std::vector<std::shared_ptr<Noiser>>&))
-    : noisers(noisers), getNoise2D_callback(getNoise2D), getNoise3D_callback(getNoise3D) { };
+void FractalNoise::getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint)
+{
+    std::vector<float> px(n), py(n), pz(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        px[i] = xs[i] / scale;
+        py[i] = ys[i] / scale;
+        pz[i] = zs[i] / scale;
+    }
+
+    getLodNoiseBatch(px.data(), py.data(), pz.data(), out, n, footprint);
+
+    for (size_t i = 0; i < n; i++)
+        out[i] *= multiplier * scale;
+}
+
+void FractalNoise::getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint)
+{
+    std::vector<float> px(n), py(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        px[i] = xs[i] / scale;
+        py[i] = ys[i] / scale;
+    }
+
+    getLodNoiseBatch(px.data(), py.data(), out, n, footprint / scale);
+
+    for (size_t i = 0; i < n; i++)
+        out[i] *= multiplier * scale;
+}
+
+float FractalNoise::getNumOctaves(float footprint) const
+{
+    return getLodOctaves(numOctaves, frequency * coordScale, lacunarity, footprint);
+}
+
+float FractalNoise::getLodNoise(float octaves, float x, float y, float z)
+{
+    if (octaves >= numOctaves) return noise.GetNoise(x, y, z);
+
+    int full = (int)octaves;                    // The rest is the weight of the next octave (see getLodOctaves())
+    float fade = octaves - full;
+    float value = lodBounding[full - 1] * lodNoise[full - 1].GetNoise(x, y, z);
+
+    if (fade > 0) value += fade * octaveAmplitude[full - 1] * octaveNoise[full - 1].GetNoise(x, y, z);
+    return value;
+}
+
+float FractalNoise::getLodNoise(float octaves, float x, float y)
+{
+    if (octaves >= numOctaves) return noise.GetNoise(x, y);
+
+    int full = (int)octaves;
+    float fade = octaves - full;
+    float value = lodBounding[full - 1] * lodNoise[full - 1].GetNoise(x, y);
+
+    if (fade > 0) value += fade * octaveAmplitude[full - 1] * octaveNoise[full - 1].GetNoise(x, y);
+    return value;
+}
+
+void FractalNoise::getLodNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint)
+{
+    if (noiseType != FastNoiseLite::NoiseType_Perlin)
+    {
+        float octaves = getNumOctaves(footprint);
+
+        for (size_t i = 0; i < n; i++)
+            out[i] = getLodNoise(octaves, xs[i], ys[i], zs[i]);
+        return;
+    }
+
+    // Same FBm as FastNoiseLite's (with all the octaves, same output as noise.GetNoise()). NoiseFbm takes the footprint in noise coordinates.
+    NoiseFbm<> fbm(seed, numOctaves, lacunarity, persistence, frequency);
+
+    for (size_t first = 0; first < n; first += noiseBatchSize)
+        runNoiseKernel([&] { fbm.valueBatch(xs + first, ys + first, zs + first, out + first, std::min(noiseBatchSize, n - first), footprint * coordScale); });
+}
+
+void FractalNoise::getLodNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint)
+{
+    if (noiseType != FastNoiseLite::NoiseType_Perlin)
+    {
+        float octaves = getLodOctaves(numOctaves, frequency, lacunarity, footprint);
+
+        for (size_t i = 0; i < n; i++)
+            out[i] = getLodNoise(octaves, xs[i], ys[i]);
+        return;
+    }
+
+    NoiseFbm<> fbm(seed, numOctaves, lacunarity, persistence, frequency);
+
+    for (size_t first = 0; first < n; first += noiseBatchSize)
+        runNoiseKernel([&] { fbm.valueBatch(xs + first, ys + first, out + first, std::min(noiseBatchSize, n - first), footprint); });
+}
+
+float FractalNoise::getRawNoiseGrad(float x, float y, float z, glm::vec3& grad, float octaves)
+{
+    if (noiseType != FastNoiseLite::NoiseType_Perlin)
+    {
+        const float h = 0.05f / scale;
+
+        grad.x = (getLodNoise(octaves, x + h, y, z) - getLodNoise(octaves, x - h, y, z)) / (2 * h);
+        grad.y = (getLodNoise(octaves, x, y + h, z) - getLodNoise(octaves, x, y - h, z)) / (2 * h);
+        grad.z = (getLodNoise(octaves, x, y, z + h) - getLodNoise(octaves, x, y, z - h)) / (2 * h);
+        return getLodNoise(octaves, x, y, z);
+    }
+
+    // FBm (like FastNoiseLite::GenFractalFBm with weighted strength = 0)
+    x *= frequency;
+    y *= frequency;
+    z *= frequency;
+
+    int octaveSeed = seed;
+    float sum = 0;
+    float amp = fractalBounding;
+    float freq = frequency;         // d(octave coordinates) / d(input coordinates)
+    NoiseDual octave;
+    grad = glm::vec3(0, 0, 0);
+
+    for (int i = 0; i < octaves && i < numOctaves; i++)
+    {
+        float weight = amp * std::min(1.f, octaves - i);        // The last octave may be faded (see getLodOctaves())
+        octave = NoisePerlin::dual(octaveSeed++, x, y, z);       // Same as FastNoiseLite's SinglePerlin, plus its gradient
+        sum += octave.value * weight;
+        grad += octave.grad * (weight * freq);
+
+        x *= lacunarity;
+        y *= lacunarity;
+        z *= lacunarity;
+        freq *= lacunarity;
+        amp *= persistence;
+    }
+
+    return sum;
+}
+
+float FractalNoise::getNoiseGrad(float x, float y, float z, glm::vec3& grad)
+{
+    return getLodNoiseGrad(x, y, z, grad, numOctaves);
+}
+
+void FractalNoise::getNoiseGradBatch(const float* xs, const float* ys, const float* zs, float* out, glm::vec3* grads, size_t n, float footprint)
+{
+    if (noiseType != FastNoiseLite::NoiseType_Perlin)
+    {
+        float octaves = getNumOctaves(footprint);
+
+        for (size_t i = 0; i < n; i++)
+            out[i] = getLodNoiseGrad(xs[i], ys[i], zs[i], grads[i], octaves);
+        return;
+    }
+
+    // Same FBm as getRawNoiseGrad(), octave by octave over each sub-batch (see getLodNoiseBatch())
+    NoiseFbm<> fbm(seed, numOctaves, lacunarity, persistence, frequency);
+    float px[noiseBatchSize], py[noiseBatchSize], pz[noiseBatchSize];
+    NoiseDual result[noiseBatchSize];
+
+    for (size_t first = 0; first < n; first += noiseBatchSize)
+    {
+        size_t count = std::min(noiseBatchSize, n - first);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            px[i] = toNoiseCoord(xs[first + i]);
+            py[i] = toNoiseCoord(ys[first + i]);
+            pz[i] = toNoiseCoord(zs[first + i]);
+        }
+
+        runNoiseKernel([&] { fbm.dualBatch(px, py, pz, result, count, footprint * coordScale); });
+
+        for (size_t i = 0; i < count; i++)
+        {
+            grads[first + i] = result[i].grad;
+            out[first + i] = processNoiseGrad(result[i].value, grads[first + i]);
+        }
+    }
+}
+
+float FractalNoise::getLodNoiseGrad(float x, float y, float z, glm::vec3& grad, float octaves)
+{
+    float value = getRawNoiseGrad(toNoiseCoord(x), toNoiseCoord(y), toNoiseCoord(z), grad, octaves);
+    return processNoiseGrad(value, grad);
+}
+
+float FractalNoise::processNoiseGrad(float value, glm::vec3& grad)
+{
+    grad *= multiplier;         // multiplier * scale * d(noise(x/scale))/dx = multiplier * noise'
+    return multiplier * scale * value;
+}
+
+bool FractalNoise::analyticGradient() const { return noiseType == FastNoiseLite::NoiseType_Perlin; }
+
+float FractalNoise::getLodFootprint(float footprint) const { return ::getLodFootprint(numOctaves, frequency * coordScale, lacunarity, footprint); }
+
+uint64_t FractalNoise::getConfigHash() const
+{
+    const char* name = "FractalNoise";
+    uint64_t hash = hashBytes(name, strlen(name));
+    hash = hashBytes(&noiseType, sizeof(noiseType), hash);
+    hash = hashBytes(&frequency, sizeof(frequency), hash);
+    hash = hashBytes(&numOctaves, sizeof(numOctaves), hash);
+    hash = hashBytes(&lacunarity, sizeof(lacunarity), hash);
+    hash = hashBytes(&persistence, sizeof(persistence), hash);
+    hash = hashBytes(&scale, sizeof(scale), hash);
+    hash = hashBytes(&multiplier, sizeof(multiplier), hash);
+    return hashBytes(&seed, sizeof(seed), hash);
+}
+
+Multinoise::Multinoise(std::vector<std::shared_ptr<Noiser>>& noisers, float(*getNoise3D)(float, float, float, std::vector<std::shared_ptr<Noiser>>&), float(*getNoise2D)(float, float, std::vector<std::shared_ptr<Noiser>>&), void(*getNoiseBatch3D)(const float*, const float*, const float*, float*, size_t, float, std::vector<std::shared_ptr<Noiser>>&), void(*getNoiseGradBatch3D)(const float*, const float*, const float*, float*, glm::vec3*, size_t, float, std::vector<std::shared_ptr<Noiser>>&))
+    : noisers(noisers), getNoise2D_callback(getNoise2D), getNoise3D_callback(getNoise3D), getNoiseBatch3D_callback(getNoiseBatch3D), getNoiseGradBatch3D_callback(getNoiseGradBatch3D) { };
 
 float Multinoise::getNoise(float x, float y, float z) { return getNoise3D_callback(x, y, z, noisers); }
 
 float Multinoise::getNoise(float x, float y) { return getNoise2D_callback(x, y, noisers); }
 
+void Multinoise::getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint)
+{
+    if (getNoiseBatch3D_callback)
+        getNoiseBatch3D_callback(xs, ys, zs, out, n, footprint, noisers);
+    else
+        for (size_t i = 0; i < n; i++)
+            out[i] = getNoise3D_callback(xs[i], ys[i], zs[i], noisers);
+}
+
+void Multinoise::getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = getNoise2D_callback(xs[i], ys[i], noisers);
+}
+
+float Multinoise::getNoiseGrad(float x, float y, float z, glm::vec3& grad)
+{
+    if (!getNoiseGradBatch3D_callback) return Noiser::getNoiseGrad(x, y, z, grad);
+
+    float value;
+    getNoiseGradBatch3D_callback(&x, &y, &z, &value, &grad, 1, 0, noisers);
+    return value;
+}
+
+void Multinoise::getNoiseGradBatch(const float* xs, const float* ys, const float* zs, float* out, glm::vec3* grads, size_t n, float footprint)
+{
+    if (getNoiseGradBatch3D_callback)
+        getNoiseGradBatch3D_callback(xs, ys, zs, out, grads, n, footprint, noisers);
+    else
+        Noiser::getNoiseGradBatch(xs, ys, zs, out, grads, n);
+}
+
+bool Multinoise::analyticGradient() const
+{
+    if (!getNoiseGradBatch3D_callback) return false;
+
+    for (const std::shared_ptr<Noiser>& noiser : noisers)
+        if (noiser && !noiser->analyticGradient())
+            return false;
+
+    return true;
+}
+
+float Multinoise::getLodFootprint(float footprint) const
+{
+    float lodFootprint = 0;
+    if (!getNoiseBatch3D_callback) return lodFootprint;
+
+    for (const std::shared_ptr<Noiser>& noiser : noisers)
+        if (noiser)
+            lodFootprint = std::max(lodFootprint, noiser->getLodFootprint(footprint));
+
+    return lodFootprint;
+}
+
+uint64_t Multinoise::getConfigHash() const
+{
+    const char* name = "Multinoise";
+    uint64_t hash = hashBytes(name, strlen(name)), noiserHash;
+    bool analytic = analyticGradient();         // Normals are computed differently
+    hash = hashBytes(&analytic, sizeof(analytic), hash);
+
+    for (const std::shared_ptr<Noiser>& noiser : noisers)
+    {
+        noiserHash = (noiser ? noiser->getConfigHash() : 1);
+        if (!noiserHash) return 0;
+        hash = hashBytes(&noiserHash, sizeof(noiserHash), hash);
+    }
+
+    return hash;
+}
+
 float default3D_callback(float x, float y, float z, std::vector<std::shared_ptr<Noiser>>& noisers)
 {
     return noisers[0]->getNoise(x, y, z);
@@ -133,6 +566,46 @@ float getNoise_C_E_PV(float x, float y, float z, std::vector<std::shared_ptr<Noi
         PV * 600 * (continentalness > 0 ? continentalness : 0) );
 }
 
+void getNoiseBatch_C_E_PV(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint, std::vector<std::shared_ptr<Noiser>>& noisers)
+{
+    std::vector<float> erosion(n), PV(n);
+    float* continentalness = out;       // out is used as buffer for continentalness
+
+    noisers[0]->getNoiseBatch(xs, ys, zs, continentalness, n, footprint);
+    noisers[1]->getNoiseBatch(xs, ys, zs, erosion.data(), n, footprint);
+    noisers[2]->getNoiseBatch(xs, ys, zs, PV.data(), n, footprint);
+
+    for (size_t i = 0; i < n; i++)
+        out[i] =
+            erosion[i] * (
+            continentalness[i] * 200 +
+            PV[i] * 600 * (continentalness[i] > 0 ? continentalness[i] : 0) );
+}
+
+void getNoiseGradBatch_C_E_PV(const float* xs, const float* ys, const float* zs, float* out, glm::vec3* grads, size_t n, float footprint, std::vector<std::shared_ptr<Noiser>>& noisers)
+{
+    std::vector<float> continentalness(n), erosion(n), PV(n);
+    std::vector<glm::vec3> gradC(n), gradE(n), gradPV(n);
+    float positiveC;
+    glm::vec3 gradPositiveC;
+
+    noisers[0]->getNoiseGradBatch(xs, ys, zs, continentalness.data(), gradC.data(), n, footprint);
+    noisers[1]->getNoiseGradBatch(xs, ys, zs, erosion.data(), gradE.data(), n, footprint);
+    noisers[2]->getNoiseGradBatch(xs, ys, zs, PV.data(), gradPV.data(), n, footprint);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        positiveC     = (continentalness[i] > 0 ? continentalness[i] : 0);
+        gradPositiveC = (continentalness[i] > 0 ? gradC[i] : glm::vec3(0, 0, 0));
+
+        // f = E * (200 C + 600 PV C+)   >   grad(f) = grad(E) (200 C + 600 PV C+) + E (200 grad(C) + 600 (grad(PV) C+ + PV grad(C+)))
+        out[i] = erosion[i] * (continentalness[i] * 200 + PV[i] * 600 * positiveC);
+        grads[i] = 
+            gradE[i] * (continentalness[i] * 200 + PV[i] * 600 * positiveC) + 
+            erosion[i] * (gradC[i] * 200.f + (gradPV[i] * positiveC + PV[i] * gradPositiveC) * 600.f);
+    }
+}
+
 
 std::ostream& operator << (std::ostream& os, const FractalNoise& obj)
 {
@@ -197,6 +670,53 @@ float FractalNoise_Exp::getNoise(float x, float y)
     //return result * std::pow(result / maxHeight, curveDegree);
 }
 
+void FractalNoise_Exp::getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint)
+{
+    std::vector<float> px(n), py(n), pz(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        px[i] = xs[i] / scale;
+        py[i] = ys[i] / scale;
+        pz[i] = zs[i] / scale;
+    }
+
+    getLodNoiseBatch(px.data(), py.data(), pz.data(), out, n, footprint);
+
+    for (size_t i = 0; i < n; i++)
+        out[i] = multiplier * scale * std::pow(out[i], curveDegree);
+}
+
+void FractalNoise_Exp::getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint)
+{
+    std::vector<float> px(n), py(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        px[i] = xs[i] / scale;
+        py[i] = ys[i] / scale;
+    }
+
+    getLodNoiseBatch(px.data(), py.data(), out, n, footprint / scale);
+
+    for (size_t i = 0; i < n; i++)
+        out[i] = multiplier * scale * std::pow(out[i], curveDegree);
+}
+
+float FractalNoise_Exp::processNoiseGrad(float value, glm::vec3& grad)
+{
+    // d(m·s·N^k)/dx = m·s·k·N^(k-1)·N'/s
+    grad *= multiplier * curveDegree * (curveDegree ? std::pow(value, curveDegree - 1) : 0);
+    return multiplier * scale * std::pow(value, curveDegree);
+}
+
+uint64_t FractalNoise_Exp::getConfigHash() const
+{
+    const char* name = "FractalNoise_Exp";
+    uint64_t hash = hashBytes(name, strlen(name), FractalNoise::getConfigHash());
+    return hashBytes(&curveDegree, sizeof(curveDegree), hash);
+}
+
 FractalNoise_SplinePts::FractalNoise_SplinePts(
     FastNoiseLite::NoiseType NoiseType,
     int NumOctaves,
@@ -207,6 +727,8 @@ FractalNoise_SplinePts::FractalNoise_SplinePts(
     std::vector<std::array<float, 2>> splinePts)
     : FractalNoise(NoiseType, NumOctaves, Lacunarity, Persistence, scale, 1, Seed), splinePts(splinePts)
 {
+    coordScale = scale;     // Coordinates are multiplied by scale (not divided)
+
     // If the spline points provided are not enough or don't cover range [-1, 1], you will get noise == 0.
     if (splinePts.size() < 2)
     {
@@ -222,15 +744,31 @@ FractalNoise_SplinePts::FractalNoise_SplinePts(
 
 float FractalNoise_SplinePts::lerp(float a, float b, float t) { return a + (b - a) * t; }
 
-float FractalNoise_SplinePts::getNoise(float x, float y, float z)
+float FractalNoise_SplinePts::applySpline(float value)
 {
-    value = noise.GetNoise(x * scale, y * scale, z * scale);
-
-    for (i = 1; i < splinePts.size(); i++)
+    for (size_t i = 1; i < splinePts.size(); i++)
         if (value <= splinePts[i][0])
             return lerp(splinePts[i-1][1], splinePts[i][1], (value - splinePts[i - 1][0]) / (splinePts[i][0] - splinePts[i - 1][0]));   // get interpolated value
 
     return 0;
+}
+
+float FractalNoise_SplinePts::applySpline(float value, float& slope)
+{
+    for (size_t i = 1; i < splinePts.size(); i++)
+        if (value <= splinePts[i][0])
+        {
+            slope = (splinePts[i][1] - splinePts[i - 1][1]) / (splinePts[i][0] - splinePts[i - 1][0]);
+            return lerp(splinePts[i-1][1], splinePts[i][1], (value - splinePts[i - 1][0]) / (splinePts[i][0] - splinePts[i - 1][0]));
+        }
+
+    slope = 0;
+    return 0;
+}
+
+float FractalNoise_SplinePts::getNoise(float x, float y, float z)
+{
+    return applySpline(noise.GetNoise(x * scale, y * scale, z * scale));
     //return multiplier * scale * noise.GetNoise(x / scale, y / scale, z / scale);
 }
 
@@ -239,6 +777,55 @@ float FractalNoise_SplinePts::getNoise(float x, float y)
     return multiplier * scale * noise.GetNoise(x / scale, y / scale);
 }
 
+void FractalNoise_SplinePts::getNoiseBatch(const float* xs, const float* ys, const float* zs, float* out, size_t n, float footprint)
+{
+    std::vector<float> px(n), py(n), pz(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        px[i] = xs[i] * scale;
+        py[i] = ys[i] * scale;
+        pz[i] = zs[i] * scale;
+    }
+
+    getLodNoiseBatch(px.data(), py.data(), pz.data(), out, n, footprint);
+
+    for (size_t i = 0; i < n; i++)
+        out[i] = applySpline(out[i]);
+}
+
+float FractalNoise_SplinePts::processNoiseGrad(float value, glm::vec3& grad)
+{
+    float slope;
+    value = applySpline(value, slope);
+
+    grad *= slope * scale;      // Chain rule: spline'(N(x·s)) · N'(x·s) · s
+    return value;
+}
+
+void FractalNoise_SplinePts::getNoiseBatch(const float* xs, const float* ys, float* out, size_t n, float footprint)
+{
+    std::vector<float> px(n), py(n);
+
+    for (size_t i = 0; i < n; i++)     // 2D noise divides coordinates by scale
+    {
+        px[i] = xs[i] / scale;
+        py[i] = ys[i] / scale;
+    }
+
+    getLodNoiseBatch(px.data(), py.data(), out, n, footprint / scale);
+
+    for (size_t i = 0; i < n; i++)
+        out[i] *= multiplier * scale;
+}
+
+uint64_t FractalNoise_SplinePts::getConfigHash() const
+{
+    const char* name = "FractalNoise_SplinePts";
+    uint64_t hash = hashBytes(name, strlen(name), FractalNoise::getConfigHash());
+    return hashBytes(splinePts.data(), splinePts.size() * sizeof(splinePts[0]), hash);
+}
+
 
 // ----------------------------------------------------------------------------------
 
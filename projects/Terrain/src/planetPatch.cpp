@@ -0,0 +1,619 @@
+#include <chrono>
+
+#include "glm/gtc/packing.hpp"
+
+#include "planetPatch.hpp"
+
+
+// Height cache ---------------------------------------------------------------
+
+HeightCache::HeightCache(glm::vec3 cubeSideCenter, float latticeStride, size_t maxSamples)
+    : origin(cubeSideCenter), latticeStride(latticeStride), maxSamples(maxSamples), requested(0), noiseCalls(0)
+{
+    recent.reserve(maxSamples / 2);
+    old.reserve(maxSamples / 2);
+}
+
+void HeightCache::getHeights(Noiser& noiseGen, const glm::vec3* cubePos, const float* xs, const float* ys, const float* zs, float* heights, glm::vec3* grads, size_t n, float footprint)
+{
+    requested += n;
+
+    if (footprint)      // LOD samples aren't cached (see HeightCache)
+    {
+        noiseCalls += n;
+        if (grads) noiseGen.getNoiseGradBatch(xs, ys, zs, heights, grads, n, footprint);
+        else noiseGen.getNoiseBatch(xs, ys, zs, heights, n, footprint);
+        return;
+    }
+
+    PooledVector<uint64_t> keys(n);
+    PooledVector<size_t> missing;       // Indices of the samples not cached
+    missing.reserve(n);
+    Sample sample;
+
+    for (size_t i = 0; i < n; i++)
+        keys[i] = getKey(cubePos[i]);
+
+    {
+        const std::lock_guard<std::mutex> lock(mutSamples);
+
+        for (size_t i = 0; i < n; i++)
+            if (maxSamples && find(keys[i], sample))
+            {
+                heights[i] = sample.height;
+                if (grads) grads[i] = sample.grad;
+            }
+            else missing.push_back(i);
+    }
+
+    if (missing.empty()) return;
+    noiseCalls += missing.size();
+
+    // Compute missing samples (single batch call)
+    size_t numMissing = missing.size();
+    std::vector<float> mxs(numMissing), mys(numMissing), mzs(numMissing), mHeights(numMissing);
+    std::vector<glm::vec3> mGrads(grads ? numMissing : 0);
+
+    for (size_t i = 0; i < numMissing; i++)
+    {
+        mxs[i] = xs[missing[i]];
+        mys[i] = ys[missing[i]];
+        mzs[i] = zs[missing[i]];
+    }
+
+    if (grads)
+        noiseGen.getNoiseGradBatch(mxs.data(), mys.data(), mzs.data(), mHeights.data(), mGrads.data(), numMissing);
+    else
+        noiseGen.getNoiseBatch(mxs.data(), mys.data(), mzs.data(), mHeights.data(), numMissing);
+
+    for (size_t i = 0; i < numMissing; i++)
+    {
+        heights[missing[i]] = mHeights[i];
+        if (grads) grads[missing[i]] = mGrads[i];
+    }
+
+    // Cache them
+    const std::lock_guard<std::mutex> lock(mutSamples);
+    if (!maxSamples) return;
+
+    for (size_t i = 0; i < numMissing; i++)
+    {
+        if (recent.size() >= maxSamples / 2)
+        {
+            old.swap(recent);
+            recent.clear();
+        }
+
+        recent[keys[missing[i]]] = { mHeights[i], (grads ? mGrads[i] : glm::vec3(0, 0, 0)) };
+    }
+}
+
+void HeightCache::setMaxSamples(size_t maxSamples)
+{
+    const std::lock_guard<std::mutex> lock(mutSamples);
+
+    this->maxSamples = maxSamples;
+    recent.clear();
+    old.clear();
+    recent.reserve(maxSamples / 2);
+    old.reserve(maxSamples / 2);
+}
+
+size_t HeightCache::numSamples()
+{
+    const std::lock_guard<std::mutex> lock(mutSamples);
+    return recent.size() + old.size();
+}
+
+size_t HeightCache::numRequested() const { return requested; }
+
+size_t HeightCache::numNoiseCalls() const { return noiseCalls; }
+
+uint64_t HeightCache::getKey(const glm::vec3& cubePos) const
+{
+    const uint64_t mask = (1 << 21) - 1;
+
+    glm::vec3 lattice = (cubePos - origin) / latticeStride;
+
+    return
+        ((uint64_t)std::lround(lattice.x) & mask) << 42 |
+        ((uint64_t)std::lround(lattice.y) & mask) << 21 |
+        ((uint64_t)std::lround(lattice.z) & mask);
+}
+
+bool HeightCache::find(uint64_t key, Sample& sample)
+{
+    auto it = recent.find(key);
+    if (it != recent.end())
+    {
+        sample = it->second;
+        return true;
+    }
+
+    it = old.find(key);
+    if (it != old.end())
+    {
+        sample = it->second;
+        old.erase(it);
+
+        if (recent.size() >= maxSamples / 2)
+        {
+            old.swap(recent);
+            recent.clear();
+        }
+        recent[key] = sample;
+        return true;
+    }
+
+    return false;
+}
+
+
+// Planet patch ---------------------------------------------------------------
+
+PlanetPatch::Stats PlanetPatch::totals{ 0, { 0, 0, 0, 0 } };
+std::mutex PlanetPatch::mutTotals;
+
+PlanetPatch::PlanetPatch(glm::vec3 baseCenter, glm::vec3 xAxis, glm::vec3 yAxis, float stride, unsigned numHorVertex, unsigned numVertVertex, float radius, glm::vec3 nucleus, Noiser* noiseGen, HeightCache* heightCache, bool skipFineOctaves)
+    : times{ 0, 0, 0, 0 }, footprint(0), skipFineOctaves(skipFineOctaves), baseCenter(baseCenter), xAxis(xAxis), yAxis(yAxis), nucleus(nucleus), stride(stride), radius(radius), numHorVertex(numHorVertex), numVertVertex(numVertVertex), noiseGen(noiseGen), heightCache(heightCache)
+{ }
+
+void PlanetPatch::generate(bool pack)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // If the noise provides exact gradients, normals are computed from them. Otherwise, they are computed from the triangles, which requires a frame of extra vertices around the chunk.
+    bool analytic = (noiseGen && noiseGen->analyticGradient());
+    unsigned frame = (analytic ? 0 : 1);
+
+    // Vertex data (+ frame)
+    float horBaseSize = stride * (numHorVertex - 1);
+    float vertBaseSize = stride * (numVertVertex - 1);
+    glm::vec3 pos0 = baseCenter - (xAxis * horBaseSize / 2.f + yAxis * vertBaseSize / 2.f);   // Position of the initial coordinate in the cube side plane (lower left).
+    pos0 -= (xAxis * stride + yAxis * stride) * (float)frame;      // Set frame
+    unsigned tempNumHorV = numHorVertex  + 2 * frame;
+    unsigned tempNumVerV = numVertVertex + 2 * frame;
+    size_t tempNumVertex = tempNumHorV * tempNumVerV;
+    vertex.resize(tempNumVertex * numAttribs);
+    PooledVector<float> xs(tempNumVertex), ys(tempNumVertex), zs(tempNumVertex), heights(tempNumVertex);
+    PooledVector<glm::vec3> grads(analytic ? tempNumVertex : 0);
+    PooledVector<glm::vec3> cubes(tempNumVertex);
+    glm::vec3 unitVec, cube, sphere, ground, normal;
+    size_t index;
+
+    // Points on the sphere
+    for (size_t v = 0; v < tempNumVerV; v++)
+        for (size_t h = 0; h < tempNumHorV; h++)
+        {
+            index = v * tempNumHorV + h;
+
+            cube = pos0 + (xAxis * (float)h * stride) + (yAxis * (float)v * stride);
+            sphere = glm::normalize(cube - nucleus) * radius;
+            cubes[index] = cube;
+            xs[index] = sphere.x;
+            ys[index] = sphere.y;
+            zs[index] = sphere.z;
+        }
+
+    // Heights (whole grid in one call. Samples shared with parent and neighbour chunks are taken from the cache). Without noise, they are 0 (sphere).
+    footprint = (noiseGen && skipFineOctaves ? noiseGen->getLodFootprint(getFootprint()) : 0);
+
+    if (footprint == 0)
+        getHeights(cubes.data(), xs.data(), ys.data(), zs.data(), heights.data(), (analytic ? grads.data() : nullptr), tempNumVertex, 0);
+    else
+    {
+        // One call per ring of vertices: the border (and frame) with all the octaves (cached, shared with neighbours), and the next rings with a footprint that grows up to the patch's one (so the detail fades out smoothly instead of leaving a step next to the border)
+        auto getRing = [&](size_t v, size_t h)
+        {
+            size_t ring = std::min({ v, h, tempNumVerV - 1 - v, tempNumHorV - 1 - h });
+            return std::min(ring > frame ? ring - frame : 0, (size_t)lodFadeRings);
+        };
+
+        PooledVector<size_t> order(tempNumVertex);
+        PooledVector<float> oxs(tempNumVertex), oys(tempNumVertex), ozs(tempNumVertex), oHeights(tempNumVertex);
+        PooledVector<glm::vec3> oCubes(tempNumVertex), oGrads(analytic ? tempNumVertex : 0);
+        size_t count = 0, begin;
+
+        for (size_t ring = 0; ring <= lodFadeRings; ring++)
+        {
+            begin = count;
+
+            for (size_t v = 0; v < tempNumVerV; v++)
+                for (size_t h = 0; h < tempNumHorV; h++)
+                    if (getRing(v, h) == ring)
+                    {
+                        index = v * tempNumHorV + h;
+                        order[count] = index;
+                        oxs[count] = xs[index];
+                        oys[count] = ys[index];
+                        ozs[count] = zs[index];
+                        oCubes[count] = cubes[index];
+                        count++;
+                    }
+
+            getHeights(oCubes.data() + begin, oxs.data() + begin, oys.data() + begin, ozs.data() + begin, oHeights.data() + begin, (analytic ? oGrads.data() + begin : nullptr), count - begin, noiseGen->getLodFootprint(footprint * ring / lodFadeRings));
+        }
+
+        for (size_t i = 0; i < tempNumVertex; i++)
+        {
+            heights[order[i]] = oHeights[i];
+            if (analytic) grads[order[i]] = oGrads[i];
+        }
+    }
+
+    auto heightsEnd = std::chrono::steady_clock::now();
+    times.heights = std::chrono::duration<double, std::milli>(heightsEnd - start).count();
+
+    for (size_t i = 0; i < tempNumVertex; i++)
+    {
+        index = i * numAttribs;
+
+        // Positions (0, 1, 2)
+        sphere = glm::vec3(xs[i], ys[i], zs[i]);
+        unitVec = sphere / radius;
+        ground = sphere + unitVec * heights[i];
+        vertex[index + 0] = ground.x;
+        vertex[index + 1] = ground.y;
+        vertex[index + 2] = ground.z;
+        vertex[index + 6] = 0;          // Vertex type (default = 0)
+
+        // Normals (3, 4, 5)
+        if (analytic)
+        {
+            // Surface: p(u) = (radius + h(radius * u)) * u, with u = unit vector. Its normal is: u - (radius / (radius + h)) * tangential(grad(h))
+            normal = glm::normalize(unitVec - (radius / (radius + heights[i])) * (grads[i] - glm::dot(grads[i], unitVec) * unitVec));
+            vertex[index + 3] = normal.x;
+            vertex[index + 4] = normal.y;
+            vertex[index + 5] = normal.z;
+        }
+    }
+
+    if (!analytic)
+    {
+        // Normals (3, 4, 5) (+ frame)
+        computeGridNormals(tempNumHorV, tempNumVerV);
+
+        // Crop frame (relocate vertices in the vector and crop it)
+        size_t i = 0, j = 0;
+        for (size_t v = 1; v < (tempNumVerV - 1); v++)
+            for (size_t h = 1; h < (tempNumHorV - 1); h++)
+            {
+                index = (v * tempNumHorV + h) * numAttribs;
+
+                for(j = 0; j < numAttribs; j++)
+                    vertex[i++] = vertex[index + j];
+            }
+        vertex.resize(numHorVertex * numVertVertex * numAttribs);
+    }
+
+    auto normalsEnd = std::chrono::steady_clock::now();
+    times.normals = std::chrono::duration<double, std::milli>(normalsEnd - heightsEnd).count();
+
+    // Compute gap-fixing data (6, 7, 8).
+    computeGapFixes();
+
+    auto gapFixesEnd = std::chrono::steady_clock::now();
+    times.gapFixes = std::chrono::duration<double, std::milli>(gapFixesEnd - normalsEnd).count();
+
+    // Compact format (height, normal, gap fixes)
+    if (pack) packVertices();
+
+    times.packing = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gapFixesEnd).count();
+
+    const std::lock_guard<std::mutex> lock(mutTotals);
+    totals.patches++;
+    totals.times.heights += times.heights;
+    totals.times.normals += times.normals;
+    totals.times.gapFixes += times.gapFixes;
+    totals.times.packing += times.packing;
+}
+
+float PlanetPatch::getFootprint() const
+{
+    glm::vec3 normal = glm::cross(xAxis, yAxis);
+    float h = std::abs(glm::dot(baseCenter - nucleus, normal));
+    glm::vec3 halfX = xAxis * (stride * (numHorVertex - 1) / 2.f);
+    glm::vec3 halfY = yAxis * (stride * (numVertVertex - 1) / 2.f);
+    float maxDist2 = 0;
+
+    for (float sx : { -1.f, 1.f })
+        for (float sy : { -1.f, 1.f })
+        {
+            glm::vec3 corner = baseCenter + halfX * sx + halfY * sy - nucleus;
+            maxDist2 = std::max(maxDist2, glm::dot(corner, corner));
+        }
+
+    return stride * radius * h / maxDist2;
+}
+
+void PlanetPatch::getHeights(const glm::vec3* cubePos, const float* xs, const float* ys, const float* zs, float* heights, glm::vec3* grads, size_t n, float footprint)
+{
+    if (!n) return;
+
+    if (noiseGen && heightCache)
+        heightCache->getHeights(*noiseGen, cubePos, xs, ys, zs, heights, grads, n, footprint);
+    else if (noiseGen && grads)
+        noiseGen->getNoiseGradBatch(xs, ys, zs, heights, grads, n, footprint);
+    else if (noiseGen)
+        noiseGen->getNoiseBatch(xs, ys, zs, heights, n, footprint);
+}
+
+PlanetPatch::Stats PlanetPatch::getStats()
+{
+    const std::lock_guard<std::mutex> lock(mutTotals);
+    return totals;
+}
+
+void PlanetPatch::getFaceAxes(glm::vec3 cubePlane, glm::vec3& xAxis, glm::vec3& yAxis)
+{
+    if (cubePlane.x != 0)           // 1: (y, z)  // -1: (-y, z)
+    {
+        xAxis = glm::vec3(0, cubePlane.x, 0);
+        yAxis = glm::vec3(0, 0, 1);
+    }
+    else if (cubePlane.y != 0)      // 1: (-x, z)  // -1: (x, z)
+    {
+        xAxis = glm::vec3(-cubePlane.y, 0, 0);
+        yAxis = glm::vec3(0, 0, 1);
+    }
+    else if (cubePlane.z != 0)       // 1: (x, y)  // -1: (-x, y)
+    {
+        xAxis = glm::vec3(cubePlane.z, 0, 0);
+        yAxis = glm::vec3(0, 1, 0);
+    }
+    //else std::cout << "cubePlane parameter has wrong format" << std::endl;   // cubePlane must contain 2 zeros
+}
+
+glm::vec3 PlanetPatch::getVertex(size_t i) const { return glm::vec3(vertex[i * numAttribs + 0], vertex[i * numAttribs + 1], vertex[i * numAttribs + 2]); }
+
+glm::vec3 PlanetPatch::getNormal(size_t i) const { return glm::vec3(vertex[i * numAttribs + 3], vertex[i * numAttribs + 4], vertex[i * numAttribs + 5]); }
+
+void PlanetPatch::packVertices()
+{
+    size_t numVertex = numHorVertex * numVertVertex;
+    compactVertex.resize(numVertex);
+    glm::vec3 normal;
+    glm::vec2 oct;
+    size_t index;
+
+    for (size_t i = 0; i < numVertex; i++)
+    {
+        index = i * numAttribs;
+        compactVertex[i].height = glm::length(getVertex(i)) - radius;     // Same as generate(): ground = normalize(cube - nucleus) * (radius + height)
+
+        // Octahedral encoding: project on the octahedron |x|+|y|+|z| = 1 and unfold the lower half (z < 0) over the upper one.
+        normal = getNormal(i);
+        normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        oct = glm::vec2(normal.x, normal.y);
+        if (normal.z < 0)
+            oct = glm::vec2(
+                (1 - std::abs(normal.y)) * (normal.x >= 0 ? 1 : -1),
+                (1 - std::abs(normal.x)) * (normal.y >= 0 ? 1 : -1));
+
+        compactVertex[i].normal[0] = glm::packSnorm1x16(oct.x);
+        compactVertex[i].normal[1] = glm::packSnorm1x16(oct.y);
+        compactVertex[i].gapFix[0] = glm::packHalf1x16(vertex[index + 7]);
+        compactVertex[i].gapFix[1] = glm::packHalf1x16(vertex[index + 8]);
+    }
+
+    PooledVector<float>().swap(vertex);     // Free memory (back to its pool)
+}
+
+void PlanetPatch::computeGridNormals(unsigned numHorV, unsigned numVerV)
+{
+    // Initialize normals to 0
+    unsigned numVertex = numHorV * numVerV;
+    PooledVector<glm::vec3> tempNormals(numVertex, glm::vec3(0));
+
+    size_t posA, posB, posC, posD;
+    glm::vec3 A, B, C, D;
+    glm::vec3 Aside, Bside, Cside, Dside;
+    glm::vec3 Anormal, Bnormal, Cnormal, Dnormal;
+
+    // Compute normals
+    for (size_t y = 0; y < (numVerV - 1); y++)
+        for (size_t x = 0; x < (numHorV - 1); x++)
+        {
+            /*
+                In each iteration, we operate in each square of the grid (4 vertex):
+
+                           Cside
+                       (D)------>(C)
+                        |         |
+                  Dside |         | Bside
+                        v         v
+                       (A)------>(B)
+                           Aside
+             */
+
+            // Vertex positions in the array
+            posA = y * numHorV + x;
+            posB = y * numHorV + (x+1);
+            posC = (y+1) * numHorV + (x+1);
+            posD = (y+1) * numHorV + x;
+
+            // Vertex world coordinates
+            A = getVertex(posA);
+            B = getVertex(posB);
+            C = getVertex(posC);
+            D = getVertex(posD);
+
+            // Vector representing each side
+            Aside = B - A;
+            Bside = B - C;
+            Cside = C - D;
+            Dside = A - D;
+
+            // Normal computed for each vertex from the two side vectors it has attached
+            Anormal = glm::cross(Aside, -Dside);
+            Bnormal = glm::cross(-Bside, -Aside);
+            Cnormal = glm::cross(-Cside, Bside);
+            Dnormal = glm::cross(Dside, Cside);
+
+            // Add to the existing normal of the vertex
+            tempNormals[posA] += Anormal;
+            tempNormals[posB] += Bnormal;
+            tempNormals[posC] += Cnormal;
+            tempNormals[posD] += Dnormal;
+        }
+
+    // Normalize the normals
+    size_t j;
+    for (size_t i = 0; i < numVertex; i++)
+    {
+        j = i * numAttribs;
+
+        tempNormals[i] = glm::normalize(tempNormals[i]);
+        vertex[j + 3] = tempNormals[i].x;
+        vertex[j + 4] = tempNormals[i].y;
+        vertex[j + 5] = tempNormals[i].z;
+    }
+}
+
+void PlanetPatch::computeGapFixes()
+{
+    // Attributes: 6 (vertex type: 0,1,2,3,4), 7 (extra height for x2 difference), 8 (for x4 difference).
+    // Shader: If vertex type != 0 or 1000, fix vertex position (if required) using side depths (uniform) and extra height (attribute).
+
+    glm::vec3 current, average;
+    unsigned remain, prev, next;
+    float ratio;
+    size_t index;
+
+    for (size_t v = 1; v < numVertVertex - 1; v++)
+        if (v % 4)
+        {
+            if (v % 2)
+            {
+                // x2 left
+                index = (numHorVertex * v) * numAttribs;
+                prev = index - numHorVertex * numAttribs;
+                next = index + numHorVertex * numAttribs;
+                current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
+                average.x = (vertex[prev + 0] + vertex[next + 0]) / 2;
+                average.y = (vertex[prev + 1] + vertex[next + 1]) / 2;
+                average.z = (vertex[prev + 2] + vertex[next + 2]) / 2;
+                vertex[index + 6] = side::left + 1;
+                vertex[index + 7] = glm::length(average - nucleus) - glm::length(current - nucleus);
+
+                // x2 right
+                index = (numHorVertex * (v + 1) - 1) * numAttribs;
+                prev = index - numHorVertex * numAttribs;
+                next = index + numHorVertex * numAttribs;
+                current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
+                average.x = (vertex[prev + 0] + vertex[next + 0]) / 2;
+                average.y = (vertex[prev + 1] + vertex[next + 1]) / 2;
+                average.z = (vertex[prev + 2] + vertex[next + 2]) / 2;
+                vertex[index + 6] = side::right + 1;
+                vertex[index + 7] = glm::length(average - nucleus) - glm::length(current - nucleus);
+            }
+
+            remain = v % 4;
+            ratio = remain / 4.f;
+
+            // x4 left
+            index = (numHorVertex * v) * numAttribs;
+            prev = index - numHorVertex * numAttribs * remain;
+            next = index + numHorVertex * numAttribs * (4 - remain);
+            current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
+            average.x = vertex[prev + 0] + (vertex[next + 0] - vertex[prev + 0]) * ratio;
+            average.y = vertex[prev + 1] + (vertex[next + 1] - vertex[prev + 1]) * ratio;
+            average.z = vertex[prev + 2] + (vertex[next + 2] - vertex[prev + 2]) * ratio;
+            vertex[index + 6] = side::left + 1;
+            vertex[index + 8] = glm::length(average - nucleus) - glm::length(current - nucleus);
+
+            // x4 right
+            index = (numHorVertex * (v + 1) - 1) * numAttribs;
+            prev = index - numHorVertex * numAttribs * remain;
+            next = index + numHorVertex * numAttribs * (4 - remain);
+            current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
+            average.x = vertex[prev + 0] + (vertex[next + 0] - vertex[prev + 0]) * ratio;
+            average.y = vertex[prev + 1] + (vertex[next + 1] - vertex[prev + 1]) * ratio;
+            average.z = vertex[prev + 2] + (vertex[next + 2] - vertex[prev + 2]) * ratio;
+            vertex[index + 6] = side::right + 1;
+            vertex[index + 8] = glm::length(average - nucleus) - glm::length(current - nucleus);
+        }
+
+    for (size_t h = 1; h < numHorVertex - 1; h++)
+        if (h % 4)
+        {
+            if (h % 2)
+            {
+                // x2 up
+                index = (numHorVertex * (numVertVertex - 1) + h) * numAttribs;
+                prev = index - numAttribs;
+                next = index + numAttribs;
+                current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
+                average.x = (vertex[prev + 0] + vertex[next + 0]) / 2;
+                average.y = (vertex[prev + 1] + vertex[next + 1]) / 2;
+                average.z = (vertex[prev + 2] + vertex[next + 2]) / 2;
+                vertex[index + 6] = side::up + 1;
+                vertex[index + 7] = glm::length(average - nucleus) - glm::length(current - nucleus);
+                
+                // x2 down
+                index = h * numAttribs;
+                prev = index - numAttribs;
+                next = index + numAttribs;
+                current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
+                average.x = (vertex[prev + 0] + vertex[next + 0]) / 2;
+                average.y = (vertex[prev + 1] + vertex[next + 1]) / 2;
+                average.z = (vertex[prev + 2] + vertex[next + 2]) / 2;
+                vertex[index + 6] = side::down + 1;
+                vertex[index + 7] = glm::length(average - nucleus) - glm::length(current - nucleus);
+            }
+
+            remain = h % 4;
+            ratio = remain / 4.f;
+
+            // x4 up
+            index = (numHorVertex * (numVertVertex - 1) + h) * numAttribs;
+            prev = index - remain * numAttribs;
+            next = index + (4 - remain) * numAttribs;
+            current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
+            average.x = vertex[prev + 0] + (vertex[next + 0] - vertex[prev + 0]) * ratio;
+            average.y = vertex[prev + 1] + (vertex[next + 1] - vertex[prev + 1]) * ratio;
+            average.z = vertex[prev + 2] + (vertex[next + 2] - vertex[prev + 2]) * ratio;
+            vertex[index + 6] = side::up + 1;
+            vertex[index + 8] = glm::length(average - nucleus) - glm::length(current - nucleus);
+
+            // x4 down
+            index = h * numAttribs;
+            prev = index - remain * numAttribs;
+            next = index + (4 - remain) * numAttribs;
+            current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
+            average.x = vertex[prev + 0] + (vertex[next + 0] - vertex[prev + 0]) * ratio;
+            average.y = vertex[prev + 1] + (vertex[next + 1] - vertex[prev + 1]) * ratio;
+            average.z = vertex[prev + 2] + (vertex[next + 2] - vertex[prev + 2]) * ratio;
+            vertex[index + 6] = side::down + 1;
+            vertex[index + 8] = glm::length(average - nucleus) - glm::length(current - nucleus);
+        }
+}
+
+void computeGridIndices(std::vector<uint16_t>& indices, unsigned numHorVertex, unsigned numVertVertex)
+{
+    indices.reserve((numHorVertex - 1) * (numVertVertex - 1) * 2 * 3);
+
+    for (size_t v = 0; v < numVertVertex - 1; v++)
+        for (size_t h = 0; h < numHorVertex - 1; h++)
+        {
+            unsigned int pos = v * numHorVertex + h;
+
+            indices.push_back(pos);
+            indices.push_back(pos + numHorVertex + 1);
+            indices.push_back(pos + numHorVertex);
+
+            indices.push_back(pos);
+            indices.push_back(pos + 1);
+            indices.push_back(pos + numHorVertex + 1);
+        }
+}
+
+glm::vec2 getFaceCoords(const glm::vec3& dir, const glm::vec3& cubeSideCenter, const glm::vec3& cubePlane, const glm::vec3& xAxis, const glm::vec3& yAxis, float faceSide, const glm::vec3& nucleus)
+{
+    glm::vec3 facePoint = nucleus + dir * (glm::dot(cubeSideCenter - nucleus, cubePlane) / glm::dot(dir, cubePlane));
+    glm::vec3 rel = facePoint - cubeSideCenter;
+
+    return glm::vec2(
+        glm::clamp(glm::dot(rel, xAxis) / faceSide + 0.5f, 0.f, 1.f),
+        glm::clamp(0.5f - glm::dot(rel, yAxis) / faceSide, 0.f, 1.f));
+}
@@ -0,0 +1,116 @@
+#include "noiseGraph.hpp"
+
+#include "planetScene.hpp"
+
+
+std::shared_ptr<Noiser> createPlanetNoise()
+{
+    // Spline noises: FBm of Perlin (frequency = 0.01 * scale) remapped by spline points.
+
+    auto continentalness = NoiseSpline<NoiseFbm<>>(     // Range [-1, 1]
+        NoiseFbm<>(4952, 4, 4.f, 0.3f, 0.01f * 0.1f),       // Seed, Octaves, Lacunarity (for frequency), Persistence (for amplitude), Frequency
+        std::vector<std::array<float, 2>>{ {-1, -0.5}, {-0.1, -0.1}, { 0.1, 0.1 }, { 1, 1 } } );
+
+    auto erosion = NoiseSpline<NoiseFbm<>>(             // Range [0, 1]
+        NoiseFbm<>(4953, 2, 5.f, 0.3f, 0.01f * 0.1f),
+        std::vector<std::array<float, 2>>{ {-1, 1}, { 0, 0.3 }, { 1, 0} } );
+
+    auto PV = NoiseSpline<NoiseFbm<>>(                  // Range [-1, 1]
+        NoiseFbm<>(4954, 2, 2.f, 0.3f, 0.01f * 0.5f),
+        std::vector<std::array<float, 2>>{ {-1, 0}, { -0.3, 1 }, { 0.6, 0 }, { 1, 1 } });
+
+    return makeNoiseGraph(noiseCombine(
+        [](auto c, auto e, auto pv) { return e * (c * 200.f + pv * 600.f * noiseMax(c, 0.f)); },       // Same as getNoise_C_E_PV()
+        continentalness, erosion, PV));
+}
+
+PlanetItems getGrassItems()
+{
+    return { 6, 6, 0, { zAxisRandom, 2, true, grass_callback, {} } };
+}
+
+PlanetItems getPlantItems()
+{
+    std::vector<std::shared_ptr<Noiser>> noiseSet;
+    noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 1, 1111));
+    noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 0.1, 1112));
+
+    return { 6, 6, 0, { zAxisRandom, 2, false, plant_callback, noiseSet } };
+}
+
+PlanetItems getStoneItems()
+{
+    std::vector<std::shared_ptr<Noiser>> noiseSet;
+    noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 1, 1113));
+    noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 0.0001, 1114));
+
+    return { 6, 6, 0, { allAxesRandom, 5, false, stone_callback, noiseSet } };
+}
+
+PlanetItems getTreeItems()
+{
+    std::vector<std::shared_ptr<Noiser>> noiseSet;
+    noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 1, 1115));
+    noiseSet.push_back(std::make_shared<SimpleNoise>(FastNoiseLite::NoiseType_Value, 0.0001, 1116));
+
+    return { 6, 6, 0, { zAxisRandom, 2, false, tree_callback, noiseSet } };
+}
+
+PlanetItems getTreeBillboardItems()
+{
+    PlanetItems items = getTreeItems();
+    items.maxDepth = 5;
+    items.minDepth = 4;
+    items.subGeometry = 1;
+    return items;
+}
+
+bool grass_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>&)
+{
+    float height = glm::distance(pos, glm::vec3(0, 0, 0));
+    if (groundSlope > 0.1 ||
+        height < 2010 ||
+        height > 2100)
+        return false;
+
+    return true;
+}
+
+bool plant_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers)
+{
+    float height = glm::distance(pos, glm::vec3(0, 0, 0));
+    if (groundSlope > 0.22 ||
+        height < 2010 ||
+        height > 2100 ||
+        noisers[0]->getNoise(pos.x, pos.y, pos.z) < 0 ||
+        noisers[1]->getNoise(pos.x, pos.y, pos.z) < 0.7)
+        return false;
+
+    return true;
+}
+
+bool stone_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers)
+{
+    float height = glm::distance(pos, glm::vec3(0, 0, 0));
+    if (groundSlope > 0.22 ||
+        height < 2000 ||
+        height > 2100 ||
+        noisers[0]->getNoise(pos.x, pos.y, pos.z) < 0 ||
+        noisers[1]->getNoise(pos.x, pos.y, pos.z) < 0.95)
+        return false;
+
+    return true;
+}
+
+bool tree_callback(const glm::vec3& pos, float groundSlope, const std::vector<std::shared_ptr<Noiser>>& noisers)
+{
+    float height = glm::distance(pos, glm::vec3(0, 0, 0));
+    if (groundSlope > 0.22 ||
+        height < 2010 ||
+        height > 2100 ||
+        noisers[0]->getNoise(pos.x, pos.y, pos.z) < 0 ||
+        noisers[1]->getNoise(pos.x, pos.y, pos.z) < 0.90)
+        return false;
+
+    return true;
+}
@@ -0,0 +1,98 @@
+#include "physics.hpp"
+
+#include "population.hpp"
+
+
+/// Rotation around the vertical axis (random, from the position)
+static glm::vec4 getSecondQuat(const glm::vec3& pos, RotType rotationType)
+{
+    switch (rotationType)
+    {
+    case zAxisRandom:     // Z axis, random
+        return getRotQuat(zAxis, pos.x * pos.y * pos.z + pos.x + pos.y + pos.z);
+    case allAxesRandom:     // all axes, random
+        return productQuat(
+            getRotQuat(xAxis, pos.x * pos.y + pos.z),
+            getRotQuat(yAxis, pos.x * pos.z + pos.y),
+            getRotQuat(zAxis, pos.y * pos.z + pos.x));
+    case faceCam:     // face cam
+        return noRotQuat;
+    default:
+        return noRotQuat;
+    }
+}
+
+/// Scale in the range [1, maxScale] (random, from the position)
+static glm::vec3 getScale(const glm::vec3& pos, unsigned maxScale)
+{
+    switch (maxScale)
+    {
+    case 0:
+    case 1:     // scale == 1
+        return glm::vec3(1);
+    default:    // scale > 1
+        return glm::vec3(1 +
+            (glm::abs((int)(pos.x * pos.y * pos.z + pos.x + pos.y + pos.z)) % 9) *     // range [0, 10]
+            maxScale / 10.f);
+    }
+}
+
+void computePopulation(const ChunkSurface& surface, const PopulationRules& rules, const glm::vec4& latLonQuat, std::vector<ModelParams>& items)
+{
+    glm::vec3 terrainNormal, terrainVertNormal;
+    glm::vec4 randomQuat, normalQuat;       // rotation for additional randomness / for adapting to terrain normal
+    float slope;
+
+    for (size_t i = 0; i < surface.positions.size(); i++)
+    {
+        const glm::vec3& position = surface.positions[i];
+
+        terrainVertNormal = glm::normalize(position);
+        terrainNormal = glm::normalize(surface.normals[i]);
+        slope = 1.f - glm::dot(terrainNormal, terrainVertNormal);                     // 1 - dot(groundNormal, sphereNormal)
+        if (!rules.itemSupported(position, slope, rules.noisers)) continue;            // user condition
+
+        randomQuat = getSecondQuat(position, rules.rotType);    // rotation around vertical axis
+
+        normalQuat = noRotQuat;
+        if (rules.adaptToTerrainNormal && glm::dot(terrainVertNormal, terrainNormal) < 0.99)   // rotation for adapting to terrain normal
+            normalQuat = getRotQuat(glm::cross(terrainVertNormal, terrainNormal), angleBetween(terrainVertNormal, terrainNormal));
+
+        items.push_back(ModelParams(
+            getScale(position, rules.maxScale),             // scale
+            productQuat(randomQuat, latLonQuat, normalQuat),    // rotation
+            position));                                     // position
+    }
+}
+
+PopulationQueue::PopulationQueue(std::shared_ptr<ThreadPool> threadPool, size_t capacity)
+    : threadPool(threadPool), ready(std::make_shared<LockFreeQueue<ChunkPopulation>>(capacity)), capacity(capacity), inFlight(0)
+{ }
+
+bool PopulationQueue::order(uint32_t owner, std::shared_ptr<const ChunkSurface> surface, const PopulationRules& rules, const glm::vec4& latLonQuat)
+{
+    if (inFlight >= capacity) return false;
+    inFlight++;
+
+    std::shared_ptr<LockFreeQueue<ChunkPopulation>> readyQueue = ready;
+    auto job = [readyQueue, owner, surface, rules, latLonQuat]()
+    {
+        ChunkPopulation population{ owner, surface->chunkID, std::make_shared<std::vector<ModelParams>>() };
+        computePopulation(*surface, rules, latLonQuat, *population.items);
+        readyQueue->push(population);       // Never full (see capacity)
+    };
+
+    if (threadPool) threadPool->submit(job);
+    else job();
+
+    return true;
+}
+
+bool PopulationQueue::pop(ChunkPopulation& population)
+{
+    if (!ready->pop(population)) return false;
+    inFlight--;
+    return true;
+}
+
+size_t PopulationQueue::getNumInFlight() const { return inFlight; }
@@ -0,0 +1,131 @@
+#include <memory>
+#include <algorithm>
+
+#include "slabPool.hpp"
+
+
+std::atomic<bool> SlabPool::enabled(true);
+
+/// Process-wide pools (sorted by slot size). Never destroyed, so memory can be returned to them by static objects destroyed at exit.
+struct PoolRegistry
+{
+    std::vector<std::unique_ptr<SlabPool>> pools;
+    std::mutex mutPools;
+};
+
+static PoolRegistry& getRegistry()
+{
+    static PoolRegistry* registry = new PoolRegistry;
+    return *registry;
+}
+
+SlabPool::SlabPool(size_t slotSize, size_t slotsPerSlab)
+    : slotSize(std::max(slotSize, sizeof(FreeSlot))), slotsPerSlab(std::max<size_t>(slotsPerSlab, 1)), freeList(nullptr), numInUse(0), numAllocations(0)
+{ }
+
+SlabPool::~SlabPool()
+{
+    for (void* slab : slabs)
+        ::operator delete(slab);
+}
+
+void* SlabPool::allocate()
+{
+    const std::lock_guard<std::mutex> lock(mutPool);
+
+    if (!freeList)      // New slab: its slots are linked into the free list
+    {
+        char* slab = static_cast<char*>(::operator new(slotSize * slotsPerSlab));
+        slabs.push_back(slab);
+
+        for (size_t i = slotsPerSlab; i-- > 0; )
+        {
+            FreeSlot* slot = reinterpret_cast<FreeSlot*>(slab + i * slotSize);
+            slot->next = freeList;
+            freeList = slot;
+        }
+    }
+
+    FreeSlot* slot = freeList;
+    freeList = slot->next;
+    numInUse++;
+    numAllocations++;
+    return slot;
+}
+
+void SlabPool::deallocate(void* slot)
+{
+    const std::lock_guard<std::mutex> lock(mutPool);
+
+    FreeSlot* freeSlot = static_cast<FreeSlot*>(slot);
+    freeSlot->next = freeList;
+    freeList = freeSlot;
+    numInUse--;
+}
+
+size_t SlabPool::getSlotSize() const { return slotSize; }
+
+size_t SlabPool::getNumSlabs()
+{
+    const std::lock_guard<std::mutex> lock(mutPool);
+    return slabs.size();
+}
+
+size_t SlabPool::getNumInUse()
+{
+    const std::lock_guard<std::mutex> lock(mutPool);
+    return numInUse;
+}
+
+size_t SlabPool::getNumAllocations()
+{
+    const std::lock_guard<std::mutex> lock(mutPool);
+    return numAllocations;
+}
+
+SlabPool* SlabPool::get(size_t bytes)
+{
+    if (!enabled || !bytes || bytes > maxSlotSize) return nullptr;
+
+    // Last pool used by this thread (pools are never destroyed). bytes is never 0 here, so the initial state never hits.
+    thread_local size_t lastBytes = 0;
+    thread_local SlabPool* lastPool = nullptr;
+    if (bytes == lastBytes) return lastPool;
+
+    // Slots are multiples of the alignment of operator new, so every slot of a slab is aligned
+    const size_t align = alignof(std::max_align_t);
+    size_t slotSize = (bytes + align - 1) / align * align;
+
+    PoolRegistry& registry = getRegistry();
+    const std::lock_guard<std::mutex> lock(registry.mutPools);
+    std::vector<std::unique_ptr<SlabPool>>& pools = registry.pools;
+
+    auto it = std::lower_bound(pools.begin(), pools.end(), slotSize, [](const std::unique_ptr<SlabPool>& pool, size_t size) { return pool->slotSize < size; });
+    if (it == pools.end() || (*it)->slotSize != slotSize)
+        it = pools.insert(it, std::make_unique<SlabPool>(slotSize, slabSize / slotSize));
+
+    lastBytes = bytes;
+    lastPool = it->get();
+    return lastPool;
+}
+
+void SlabPool::setEnabled(bool enabled) { SlabPool::enabled = enabled; }
+
+SlabPool::Stats SlabPool::getStats()
+{
+    Stats stats{ 0, 0, 0, 0, 0 };
+    PoolRegistry& registry = getRegistry();
+    const std::lock_guard<std::mutex> lock(registry.mutPools);
+
+    for (const std::unique_ptr<SlabPool>& pool : registry.pools)
+    {
+        const std::lock_guard<std::mutex> poolLock(pool->mutPool);
+        stats.pools++;
+        stats.slabs += pool->slabs.size();
+        stats.reservedBytes += pool->slabs.size() * pool->slotsPerSlab * pool->slotSize;
+        stats.inUseBytes += pool->numInUse * pool->slotSize;
+        stats.allocations += pool->numAllocations;
+    }
+
+    return stats;
+}
@@ -749,6 +749,7 @@ void s_Model::update(float timeStep)
             }
         case UboType::planet:
             {
+                ((c_Model_planet*)c_model)->planet->setScreenSpaceError(c_cam->fov, c_eng->getHeight());
                 ((c_Model_planet*)c_model)->planet->updateState(c_cam->camPos, c_cam->view, c_cam->proj, c_lights->lights, c_eng->time, 100);   // <<< groundHeight
                 ((c_Model_planet*)c_model)->planet->toLastDraw();
                 break;
@@ -805,8 +806,30 @@ void s_Distributor::update(float timeStep)
     c_Model_planet* c_mPlanet = getPlanetComponent();
     if (!c_mPlanet) return;
 
-    std::vector<const Chunk*> chunks;
-    c_mPlanet->planet->getActiveLeafChunks(chunks, 0);      // Get all chunks
+    // Populations are computed in the planet's worker threads (orders of a former planet are forgotten)
+    if (!populations || c_mPlanet->planet != subscribedPlanet)
+    {
+        populations = std::make_unique<PopulationQueue>(c_mPlanet->planet->getThreadPool());
+        for (uint32_t eId : entities)
+            ((c_Distributor*)em->getComponent(CT::distributor, eId))->orderedChunks.clear();
+    }
+
+    // Chunk deltas (events) and populations computed since the last update
+    std::vector<unsigned> evictedIds;
+    bool resynced;
+    bool chunksChanged = updateChunks(c_mPlanet->planet, evictedIds, resynced);
+    bool populated = receivePopulations(c_mPlanet->planet, entities);
+
+    // Items only change if drawn chunks, populations, camera or entities changed (a static camera costs nothing)
+    if (!chunksChanged && !populated && !populationsRefused && evictedIds.empty() && c_cam->camPos == lastCamPos && c_cam->front == lastCamDir && c_cam->fov == lastFov && entities.size() == lastNumEntities)
+        return;
+
+    lastCamPos = c_cam->camPos;
+    lastCamDir = c_cam->front;
+    lastFov = c_cam->fov;
+    lastNumEntities = entities.size();
+    populationsRefused = false;
+    const std::vector<const Chunk*>& chunks = activeChunks;
 
     // Precalculations
     glm::vec3 camNormal = glm::normalize(c_cam->camPos - c_mPlanet->planet->nucleus);  // Cam's normal is considered the normal for all items.
@@ -816,15 +839,9 @@ void s_Distributor::update(float timeStep)
     c_ModelParams* c_mParams;   // component to update
     c_Distributor* c_distrib;
 
-    unsigned i, j, chunkId;
-    const std::vector<float>* vertices;
-    std::vector<float> vertices_subGeometry;
-    glm::vec3 position;
-    float slope;
-    glm::vec4 randomQuat, normalQuat = { 1,0,0,0 };        // rotation for additional randomness / for adapting to terrain normal
-    glm::vec3 terrainNormal, terrainVertNormal;
-    bool getNormalQuat;
+    unsigned chunkId;
     std::vector<unsigned> keys;
+    std::map<const Chunk*, std::shared_ptr<const ChunkSurface>> surfaces;     // Chunks copied for the worker threads in this update
 
     // Traverse each entity
     for (uint32_t eId : entities)
@@ -832,69 +849,135 @@ void s_Distributor::update(float timeStep)
         c_mParams = (c_ModelParams*)em->getComponent(CT::modelParams, eId);
         if (!c_mParams) continue;
         c_distrib = (c_Distributor*)em->getComponent(CT::distributor, eId);
-        getNormalQuat = c_distrib->adaptToTerrainNormal;
 
         c_mParams->mp.clear();
-        normalQuat = { 1,0,0,0 };
 
         // Traverse each chunk
-        for (i = 0; i < chunks.size(); i++)
+        for (size_t i = 0; i < chunks.size(); i++)
         {
             if (chunks[i]->depth < c_distrib->minDepth || chunks[i]->depth > c_distrib->maxDepth) continue;
             chunkId = chunks[i]->chunkID;
 
-            if (c_distrib->filledChunks.find(chunkId) == c_distrib->filledChunks.end()) // If chunk's population was not found, compute it
+            auto filled = c_distrib->filledChunks.find(chunkId);
+            if (filled == c_distrib->filledChunks.end())     // If chunk's population was not found, compute it (its items are taken when it's ready)
             {
-                vertices = chunks[i]->getVertices();
-
-                // Traverse each vertex (3, 3, 3) > Compute all chunk's population
-                for (j = 0; j < vertices->size(); j += 9)
-                {
-                    position = glm::vec3((*vertices)[j + 0], (*vertices)[j + 1], (*vertices)[j + 2]);
-                    //if (!withinFOV(position, c_cam->camPos, c_cam->front, c_cam->fov * 1.2, 5)) continue;       // is outside fov?
-
-                    terrainVertNormal = normalize(glm::vec3((*vertices)[j + 0], (*vertices)[j + 1], (*vertices)[j + 2]));
-                    terrainNormal = normalize(glm::vec3((*vertices)[j + 3], (*vertices)[j + 4], (*vertices)[j + 5]));
-                    slope = 1.f - glm::dot(terrainNormal, terrainVertNormal);                                   // 1 - dot(groundNormal, sphereNormal)
-                    if (!c_distrib->itemSupported(position, slope, c_distrib->noisers)) continue;               // user condition
-
-                    randomQuat = getSecondQuat(position, c_distrib->rotType);   // rotation around vertical axis
-
-                    if (getNormalQuat)                                           // rotation for adapting to terrain normal
-                        if (glm::dot(terrainVertNormal, terrainNormal) < 0.99)
-                            normalQuat = getRotQuat(glm::cross(terrainVertNormal, terrainNormal), angleBetween(terrainVertNormal, terrainNormal));
-
-                    c_distrib->filledChunks[chunkId].push_back(ModelParams(
-                        getScale(position, c_distrib->maxScale),            // scale
-                        productQuat(randomQuat, latLonQuat, normalQuat),    // rotation
-                        position));                                         // position)
-                }
-
-                if (c_distrib->subGeometry)     // Compute population for additional vertices (between the existing ones).
-                {
-                    
-                }
+                if (c_distrib->orderedChunks.find(chunkId) == c_distrib->orderedChunks.end())
+                    orderPopulation(eId, c_distrib, chunks[i], latLonQuat, surfaces);
+                continue;
             }
 
             // Take visible objects from storage
-            for (unsigned i = 0; i < c_distrib->filledChunks[chunkId].size(); i++)
+            for (const ModelParams& item : filled->second)
             {
-                if (!withinFOV(c_distrib->filledChunks[chunkId][i].pos, c_cam->camPos, c_cam->front, c_cam->fov * 1.2, 10)) continue;       // is outside fov?
-                else c_mParams->mp.push_back(c_distrib->filledChunks[chunkId][i]);
+                if (!withinFOV(item.pos, c_cam->camPos, c_cam->front, c_cam->fov * 1.2, 10)) continue;       // is outside fov?
+                else c_mParams->mp.push_back(item);
             }
         }
 
-        // Delete population from no-longer existing chunks
+        // Delete population from no-longer existing chunks (evicted ones; all of them if events were lost)
         keys.clear();
 
-        for (auto it = c_distrib->filledChunks.begin(); it != c_distrib->filledChunks.end(); it++)
-            if (!c_mPlanet->planet->contains(it->first)) keys.push_back(it->first);
+        if (resynced)
+        {
+            for (auto it = c_distrib->filledChunks.begin(); it != c_distrib->filledChunks.end(); it++)
+                if (!c_mPlanet->planet->contains(it->first)) keys.push_back(it->first);
+        }
+        else
+            for (unsigned id : evictedIds)
+                if (!c_mPlanet->planet->contains(id)) keys.push_back(id);
 
         for(unsigned i = 0; i < keys.size(); i++)
             c_distrib->filledChunks.erase(keys[i]);
     }
 }
 
+bool s_Distributor::receivePopulations(Planet* planet, const std::vector<uint32_t>& entities)
+{
+    bool received = false;
+    ChunkPopulation population;
+
+    while (populations->pop(population))
+    {
+        if (std::find(entities.begin(), entities.end(), population.owner) == entities.end()) continue;     // Entity removed
+
+        c_Distributor* c_distrib = (c_Distributor*)em->getComponent(CT::distributor, population.owner);
+        c_distrib->orderedChunks.erase(population.chunkID);
+        if (!planet->contains(population.chunkID)) continue;                                                // Chunk evicted meanwhile
+
+        c_distrib->filledChunks[population.chunkID] = std::move(*population.items);
+        received = true;
+    }
+
+    return received;
+}
+
+void s_Distributor::orderPopulation(uint32_t eId, c_Distributor* c_distrib, const Chunk* chunk, const glm::vec4& latLonQuat, std::map<const Chunk*, std::shared_ptr<const ChunkSurface>>& surfaces)
+{
+    std::shared_ptr<const ChunkSurface>& surface = surfaces[chunk];
+
+    if (!surface)       // Copy of chunk's vertices (the chunk may be evicted while the job runs)
+    {
+        std::shared_ptr<ChunkSurface> copy = std::make_shared<ChunkSurface>();
+        chunk->getSurface(*copy);
+        surface = copy;
+    }
+
+    PopulationRules rules{ c_distrib->rotType, c_distrib->maxScale, c_distrib->adaptToTerrainNormal, c_distrib->itemSupported, c_distrib->noisers };
+
+    if (populations->order(eId, surface, rules, latLonQuat)) c_distrib->orderedChunks.insert(chunk->chunkID);
+    else populationsRefused = true;     // Ordered again in the next update
+}
+
+bool s_Distributor::updateChunks(Planet* planet, std::vector<unsigned>& evictedIds, bool& resynced)
+{
+    resynced = false;
+
+    if (planet != subscribedPlanet)
+    {
+        subscribedPlanet = planet;
+        chunkEvents = planet->subscribeChunkEvents();
+        resynced = true;
+    }
+
+    bool changed = false;
+    ChunkEvent event;
+
+    if (chunkEvents)
+        while (chunkEvents->pop(event))
+            switch (event.type)
+            {
+            case ChunkEvent::activated:
+                activeChunks.push_back(event.chunk);
+                changed = true;
+                break;
+            case ChunkEvent::evicted:
+                evictedIds.push_back(event.chunkID);
+                [[fallthrough]];
+            case ChunkEvent::deactivated:
+                {
+                    auto it = std::find(activeChunks.begin(), activeChunks.end(), event.chunk);
+                    if (it == activeChunks.end()) break;
+                    *it = activeChunks.back();
+                    activeChunks.pop_back();
+                    changed = true;
+                    break;
+                }
+            default:
+                break;
+            }
+
+    if (!chunkEvents || chunkEvents->overflowed()) resynced = true;
+
+    if (resynced)
+    {
+        activeChunks.clear();
+        planet->getActiveLeafChunks(activeChunks, 0);
+        return true;
+    }
+
+    return changed;
+}
+
 bool s_Distributor::withinFOV(const glm::vec3& itemPos, const glm::vec3& camPos, const glm::vec3& camDir, float fov, float minDist) const
 {
     /* Readable version
@@ -950,44 +1033,6 @@ c_Model_planet* s_Distributor::getPlanetComponent()
     return nullptr;
 }
 
-glm::vec4 s_Distributor::getSecondQuat(const glm::vec3& pos, RotType rotationType)
-{
-    switch (rotationType)
-    {
-    case zAxisRandom:     // Z axis, random
-        return getRotQuat(zAxis, pos.x * pos.y * pos.z + pos.x + pos.y + pos.z);
-        break;
-    case allAxesRandom:     // all axes, random
-        return productQuat(
-            getRotQuat(xAxis, pos.x * pos.y + pos.z),
-            getRotQuat(yAxis, pos.x * pos.z + pos.y),
-            getRotQuat(zAxis, pos.y * pos.z + pos.x));
-        break;
-    case faceCam:     // face cam
-        return noRotQuat;
-        break;
-    default:
-        return noRotQuat;
-        break;
-    }
-}
-
-glm::vec3 s_Distributor::getScale(const glm::vec3& pos, unsigned maxScale)
-{
-    switch (maxScale)
-    {
-    case 0:
-    case 1:     // scale == 1
-        return glm::vec3(1);
-        break;
-    default:    // scale > 1
-        return glm::vec3(1 +
-            (glm::abs((int)(pos.x * pos.y * pos.z + pos.x + pos.y + pos.z)) % 9) *     // range [0, 10]
-            maxScale / 10.f);
-        break;
-    }
-}
-
 bool s_Distributor::renderRequired(const Planet& planet, float minDepth, unsigned chunksCount)
 {
     std::vector<const Chunk*> availableChunks;
@@ -1,6 +1,11 @@
 ﻿#include <algorithm>
 #include <random>
 #include <string>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+
+#include "glm/gtc/packing.hpp"
 
 #include "physics.hpp"
 
@@ -10,6 +15,8 @@
 
 // Chunk ----------------------------------------------------------------------
 
+const VertexType vt_planetCompact({ sizeof(float), 2 * sizeof(uint16_t), 2 * sizeof(uint16_t) }, { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16_SFLOAT });
+
 Chunk::Chunk(Renderer& renderer, glm::vec3 center, float stride, unsigned numHorVertex, unsigned numVertVertex, unsigned depth, unsigned chunkID)
     : renderer(renderer),
     baseCenter(center),
@@ -22,7 +29,19 @@ Chunk::Chunk(Renderer& renderer, glm::vec3 center, float stride, unsigned numHor
     vertexData(nullptr),
     depth(depth),
     modelOrdered(false),
+    batchSlot(VertexArena::noSlot),
     isVisible(true),
+    numNodes(0),
+    priority(0),
+    geometricError(-1),
+    detailError(-1),
+    boundMin(center),
+    boundMax(center),
+    boundCenter(center),
+    boundRadius(0),
+    minHeight(0),
+    maxHeight(0),
+    terrainState(TerrainState::none),
     chunkID(chunkID),
     majorAxis(getMajorAxis(baseCenter)) { }
 
@@ -37,6 +56,19 @@ Chunk::~Chunk()
     //    renderer.deleteModel(model);
 }
 
+void* Chunk::operator new(size_t size)
+{
+    SlabPool* pool = SlabPool::get(size);
+    return (pool ? pool->allocate() : ::operator new(size));
+}
+
+void Chunk::operator delete(void* chunk, size_t size)
+{
+    SlabPool* pool = SlabPool::get(size);
+    if (pool) pool->deallocate(chunk);
+    else ::operator delete(chunk);
+}
+
 glm::vec3 Chunk::getVertex(size_t position) const
 { 
     return glm::vec3(
@@ -66,15 +98,16 @@ glm::vec3 Chunk::getMajorAxis(glm::vec3 dir)
     else return glm::normalize(glm::vec3(0, 0, dir.z));
 }
 
-void Chunk::render(std::vector<ShaderLoader>& shaders, std::vector<TextureLoader>& textures, std::vector<uint16_t>* indices, unsigned numLights, bool transparency)
+void Chunk::render(std::vector<ShaderLoader>& shaders, std::vector<TextureLoader>& textures, std::shared_ptr<SharedIndexBuffer> indices, std::shared_ptr<VertexArena> arena, unsigned numLights, bool transparency)
 {
     // <<< Compute terrain and render here. No need to store vertices, indices or VertexInfo in Chunk object.
 
-    vertexData = new VerticesLoader(
-        vt_333.vertexSize,
-        vertex.data(), 
-        numHorVertex * numVertVertex,
-        indices ? *indices : this->indices);
+    const VertexType& vertexType = getVertexType();
+
+    if (indices)
+        vertexData = new VerticesLoader(vertexType.vertexSize, getVertexData(), numHorVertex * numVertVertex, indices, arena);
+    else
+        vertexData = new VerticesLoader(vertexType.vertexSize, getVertexData(), numHorVertex * numVertVertex, this->indices);
     
     std::string chunkName = std::string("chunk_") + 
         "[" + std::to_string((int)majorAxis.x) + "," + std::to_string((int)majorAxis.y) + "," + std::to_string((int)majorAxis.z) + "]_" +
@@ -86,12 +119,12 @@ void Chunk::render(std::vector<ShaderLoader>& shaders, std::vector<TextureLoader
     modelInfo.layer = 1;
     modelInfo.activeInstances = 1;
     modelInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    modelInfo.vertexType = vt_333;
+    modelInfo.vertexType = vertexType;
     modelInfo.verticesLoader = vertexData;
     modelInfo.shadersInfo = &shaders;
     modelInfo.texturesInfo = &textures;
     modelInfo.maxDescriptorsCount_vs = 1;
-    modelInfo.UBOsize_vs = 4 * size.mat4 + 3 * size.vec4 + numLights * sizeof(LightPosDir);   // MM (mat4), VM (mat4), PM (mat4), MMN (mat3), camPos (vec3), time (float), n * LightPosDir (2*vec4), sideDepth (vec3)
+    modelInfo.UBOsize_vs = 4 * size.mat4 + 3 * size.vec4 + numLights * sizeof(LightPosDir) + 4 * size.vec4;   // MM (mat4), VM (mat4), PM (mat4), MMN (mat3), camPos (vec3), time (float), n * LightPosDir (2*vec4), sideDepth (vec3), shader params (4*vec4)
     modelInfo.UBOsize_fs = numLights * sizeof(LightProps);                                    // n * LightProps (6*vec4)
     modelInfo.transparency = transparency;
     modelInfo.renderPassIndex = 0;
@@ -99,17 +132,26 @@ void Chunk::render(std::vector<ShaderLoader>& shaders, std::vector<TextureLoader
     
     model = renderer.newModel(modelInfo);
 
+    glm::vec4 params[4];
+    getShaderParams(params);
+
+    const glm::mat4 modelMatrix = getModelMatrix();
+    const glm::mat4 normalsMatrix = getModelMatrixForNormals(modelMatrix);
+
     uint8_t* dest;
     for (size_t i = 0; i < model->activeInstances; i++)
     {
+        dest = model->vsUBO.getUBOptr(i) + 4 * size.mat4 + 3 * size.vec4 + numLights * sizeof(LightPosDir);
+        memcpy(dest, params, 4 * size.vec4);
+
         dest = model->vsUBO.getUBOptr(i);
-        memcpy(dest, &getModelMatrix(), size.mat4);
+        memcpy(dest, &modelMatrix, size.mat4);
         dest += size.mat4;
         //memcpy(dest, &view, mat4size);
         dest += size.mat4;
         //memcpy(dest, &proj, mat4size);
         dest += size.mat4;
-        memcpy(dest, &getModelMatrixForNormals(getModelMatrix()), size.mat4);
+        memcpy(dest, &normalsMatrix, size.mat4);
         dest += size.mat4;
         //memcpy(dest, &camPos, vec3size);
         //dest += vec4size;
@@ -167,21 +209,7 @@ void Chunk::updateUBOs(const glm::mat4& view, const glm::mat4& proj, const glm::
 
 void Chunk::computeIndices(std::vector<uint16_t>& indices, unsigned numHorVertex, unsigned numVertVertex)
 {
-    indices.resize((numHorVertex - 1) * (numVertVertex - 1) * 2 * 3);
-
-    for (size_t v = 0; v < numVertVertex - 1; v++)
-        for (size_t h = 0; h < numHorVertex - 1; h++)
-        {
-            unsigned int pos = v * numHorVertex + h;
-
-            indices.push_back(pos);
-            indices.push_back(pos + numHorVertex + 1);
-            indices.push_back(pos + numHorVertex);
-
-            indices.push_back(pos);
-            indices.push_back(pos + 1);
-            indices.push_back(pos + numHorVertex + 1);
-        }
+    computeGridIndices(indices, numHorVertex, numVertVertex);
 }
 
 void Chunk::setSideDepths(unsigned a, unsigned b, unsigned c, unsigned d)
@@ -194,6 +222,94 @@ void Chunk::setSideDepths(unsigned a, unsigned b, unsigned c, unsigned d)
 
 glm::vec3 Chunk::getCenter() { return groundCenter; }
 
+glm::vec3 Chunk::getVertexPos(size_t i) const { return getVertex(i); }
+
+glm::vec3 Chunk::getVertexNormal(size_t i) const { return getNormal(i); }
+
+size_t Chunk::getVertexBytes() const { return getNumVertex() * getVertexType().vertexSize; }
+
+const VertexType& Chunk::getVertexType() const { return vt_333; }
+
+const void* Chunk::getVertexData() const { return vertex.data(); }
+
+void Chunk::getShaderParams(glm::vec4* params) const
+{
+    for (size_t i = 0; i < 4; i++)
+        params[i] = glm::vec4(0, 0, 0, 0);
+}
+
+void Chunk::computeGeometricError()
+{
+    // The parent's grid has 1 of each 2 vertices (per side) of this chunk (the even ones), so the other ones are compared with the interpolation of their even neighbours (number of side vertices is odd).
+    float error = 0;
+    glm::vec3 interp;
+
+    for (size_t y = 0; y < numVertVertex; y++)
+        for (size_t x = 0; x < numHorVertex; x++)
+        {
+            if (x % 2 == 0 && y % 2 == 0) continue;
+
+            if (y % 2 == 0)
+                interp = (getVertexPos(y * numHorVertex + x - 1) + getVertexPos(y * numHorVertex + x + 1)) / 2.f;
+            else if (x % 2 == 0)
+                interp = (getVertexPos((y - 1) * numHorVertex + x) + getVertexPos((y + 1) * numHorVertex + x)) / 2.f;
+            else
+                interp = (getVertexPos((y - 1) * numHorVertex + x - 1) + getVertexPos((y - 1) * numHorVertex + x + 1) + getVertexPos((y + 1) * numHorVertex + x - 1) + getVertexPos((y + 1) * numHorVertex + x + 1)) / 4.f;
+
+            error = std::max(error, glm::distance(getVertexPos(y * numHorVertex + x), interp));
+        }
+
+    geometricError = error;
+}
+
+void Chunk::computeBounds()
+{
+    size_t numVertex = getNumVertex();
+    if (!numVertex) return;
+
+    glm::vec3 pos = getVertexPos(0);
+    boundMin = boundMax = pos;
+    minHeight = maxHeight = getVertexHeight(0);
+
+    for (size_t i = 1; i < numVertex; i++)
+    {
+        pos = getVertexPos(i);
+        boundMin = glm::min(boundMin, pos);
+        boundMax = glm::max(boundMax, pos);
+
+        float height = getVertexHeight(i);
+        minHeight = std::min(minHeight, height);
+        maxHeight = std::max(maxHeight, height);
+    }
+
+    boundCenter = (boundMin + boundMax) / 2.f;
+    boundRadius = 0;
+
+    for (size_t i = 0; i < numVertex; i++)
+        boundRadius = std::max(boundRadius, glm::distance(boundCenter, getVertexPos(i)));
+}
+
+float Chunk::getVertexHeight(size_t i) const { return getVertexPos(i).z; }
+
+float Chunk::getHeight(float col, float row) const
+{
+    return interpolateGridHeight([this](size_t i) { return getVertexHeight(i); }, numHorVertex, numVertVertex, col, row);
+}
+
+void Chunk::getSurface(ChunkSurface& surface) const
+{
+    unsigned numVertex = getNumVertex();
+    surface.chunkID = chunkID;
+    surface.positions.resize(numVertex);
+    surface.normals.resize(numVertex);
+
+    for (unsigned i = 0; i < numVertex; i++)
+    {
+        surface.positions[i] = getVertexPos(i);
+        surface.normals[i] = getVertexNormal(i);
+    }
+}
+
 void Chunk::deleteModel() { renderer.deleteModel(model); }
 
 
@@ -214,22 +330,34 @@ void PlainChunk::computeTerrain(bool computeIndices)   // <<< Fix function to ma
     float y0 = baseCenter.y - vertChunkSize / 2;
 
     // Vertex data
-    vertex.resize(numHorVertex * numVertVertex * 6);
+    size_t numVertex = numHorVertex * numVertVertex;
+    vertex.resize(numVertex * 6);
+    PooledVector<float> xs(numVertex), ys(numVertex), heights(numVertex);
 
     for (size_t y = 0; y < numVertVertex; y++)
         for (size_t x = 0; x < numHorVertex; x++)
         {
             index = y * numHorVertex + x;
-
-            // Positions (0, 1, 2)
-            vertex[index * 6 + 0] = x0 + x * stride;
-            vertex[index * 6 + 1] = y0 + y * stride;
-            vertex[index * 6 + 2] = noiseGen->getNoise((float)vertex[index * 6 + 0], (float)vertex[index * 6 + 1]);
+            xs[index] = x0 + x * stride;
+            ys[index] = y0 + y * stride;
         }
 
+    noiseGen->getNoiseBatch(xs.data(), ys.data(), heights.data(), numVertex);   // Whole grid in one call
+
+    for (index = 0; index < numVertex; index++)
+    {
+        // Positions (0, 1, 2)
+        vertex[index * 6 + 0] = xs[index];
+        vertex[index * 6 + 1] = ys[index];
+        vertex[index * 6 + 2] = heights[index];
+    }
+
     // Normals (3, 4, 5)
     computeGridNormals();
 
+    computeGeometricError();
+    computeBounds();
+
     // Indices
     if (computeIndices)
         this->computeIndices(indices, numHorVertex, numVertVertex);
@@ -321,153 +449,203 @@ void PlainChunk::computeSizes()
 
 // PlanetChunk ----------------------------------------------------------------------
 
-PlanetChunk::PlanetChunk(Renderer& renderer, std::shared_ptr<Noiser> noiseGenerator, glm::vec3 cubeSideCenter, float stride, unsigned numHorVertex, unsigned numVertVertex, float radius, glm::vec3 nucleus, glm::vec3 cubePlane, unsigned depth, unsigned chunkID)
-    : Chunk(renderer, cubeSideCenter, stride, numHorVertex, numVertVertex, depth, chunkID), noiseGen(noiseGenerator), nucleus(nucleus), radius(radius)
+PlanetChunk::PlanetChunk(Renderer& renderer, std::shared_ptr<Noiser> noiseGenerator, glm::vec3 cubeSideCenter, float stride, unsigned numHorVertex, unsigned numVertVertex, float radius, glm::vec3 nucleus, glm::vec3 cubePlane, unsigned depth, unsigned chunkID, std::shared_ptr<HeightCache> heightCache, bool skipFineOctaves)
+    : Chunk(renderer, cubeSideCenter, stride, numHorVertex, numVertVertex, depth, chunkID), noiseGen(noiseGenerator), heightCache(heightCache), diskKey(0), skipFineOctaves(skipFineOctaves), nucleus(nucleus), radius(radius)
 {
     glm::vec3 unitVec = glm::normalize(baseCenter - nucleus);
     geoideCenter = unitVec * radius;
     if(noiseGenerator) groundCenter = geoideCenter + unitVec * noiseGen->getNoise(geoideCenter.x, geoideCenter.y, geoideCenter.z);  // if added due to SphereChunk
 
     // Set relative axes of the cube face (needed for computing indices in good order)
-     if (cubePlane.x != 0)           // 1: (y, z)  // -1: (-y, z)
-    {
-        xAxis = glm::vec3(0, cubePlane.x, 0);
-        yAxis = glm::vec3(0, 0, 1);
-    }
-    else if (cubePlane.y != 0)      // 1: (-x, z)  // -1: (x, z)
-    {
-        xAxis = glm::vec3(-cubePlane.y, 0, 0);
-        yAxis = glm::vec3(0, 0, 1);
-    }
-    else if (cubePlane.z != 0)       // 1: (x, y)  // -1: (-x, y)
-    {
-        xAxis = glm::vec3(cubePlane.z, 0, 0);
-        yAxis = glm::vec3(0, 1, 0);
-    }
-    //else std::cout << "cubePlane parameter has wrong format" << std::endl;   // cubePlane must contain 2 zeros
+    PlanetPatch::getFaceAxes(cubePlane, xAxis, yAxis);
 
     computeSizes();
 }
 
 void PlanetChunk::computeTerrain(bool computeIndices)
 {
-    // Vertex data (+ frame)
-    glm::vec3 pos0 = baseCenter - (xAxis * horBaseSize / 2.f + yAxis * vertBaseSize / 2.f);   // Position of the initial coordinate in the cube side plane (lower left).
-    pos0 -= (xAxis * stride + yAxis * stride);      // Set frame
-    unsigned tempNumHorV = numHorVertex  + 2;
-    unsigned tempNumVerV = numVertVertex + 2;
-    vertex.resize(tempNumHorV * tempNumVerV * numAttribs);
-    glm::vec3 unitVec, cube, sphere, ground;
-    size_t index;
+    auto start = std::chrono::steady_clock::now();
 
-    for (size_t v = 0; v < tempNumVerV; v++)
-        for (size_t h = 0; h < tempNumHorV; h++)
-        {
-            index = (v * tempNumHorV + h) * numAttribs;
-
-            // Positions (0, 1, 2)
-            cube = pos0 + (xAxis * (float)h * stride) + (yAxis * (float)v * stride);
-            unitVec = glm::normalize(cube - nucleus);
-            sphere = unitVec * radius;
-            ground = sphere + unitVec * noiseGen->getNoise(sphere.x, sphere.y, sphere.z);
-            vertex[index + 0] = ground.x;
-            vertex[index + 1] = ground.y;
-            vertex[index + 2] = ground.z;
-            vertex[index + 6] = 0;          // Vertex type (default = 0)
-        }
-    
-    // Normals (3, 4, 5) (+ frame)
-    computeGridNormals(pos0, xAxis, yAxis, tempNumHorV, tempNumVerV);
+    // Persistent cache: chunks found there only need the data derived from their vertices
+    if (diskCache && readDiskRecord())
+    {
+        diskCache->addLoadTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
 
-    // Crop frame (relocate vertices in the vector and crop it)
-    size_t i = 0, j = 0;
-    for (size_t v = 1; v < (tempNumVerV - 1); v++)
-        for (size_t h = 1; h < (tempNumHorV - 1); h++)
-        {
-            index = (v * tempNumHorV + h) * numAttribs;
+        computeGeometricError();
+        computeBounds();
+        if (computeIndices) this->computeIndices(indices, numHorVertex, numVertVertex);
+        return;
+    }
 
-            for(j = 0; j < numAttribs; j++)
-                vertex[i++] = vertex[index + j];
-        }
-    vertex.resize(numHorVertex * numVertVertex * numAttribs);
+    // Heights, normals, gap-fixing data and compact format (height, normal, gap fixes)
+    PlanetPatch patch = getPatch(noiseGen.get(), heightCache.get());
+    patch.generate(true);
+    compactVertex = std::move(patch.compactVertex);
+
+    if (diskCache)
+    {
+        writeDiskRecord();
+        diskCache->addGenerationTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
 
-    // Compute gap-fixing data (6, 7, 8).
-    computeGapFixes();
+    computeGeometricError();
+    computeBounds();
 
     // Indices
     if (computeIndices)
         this->computeIndices(indices, numHorVertex, numVertVertex);
 }
 
-void PlanetChunk::computeGridNormals(glm::vec3 pos0, glm::vec3 xAxis, glm::vec3 yAxis, unsigned numHorV, unsigned numVerV)
+void PlanetChunk::setDiskCache(std::shared_ptr<ChunkDiskCache> diskCache, uint64_t key)
 {
-    // Initialize normals to 0
-    unsigned numVertex = numHorV * numVerV;
-    std::vector<glm::vec3> tempNormals(numVertex, glm::vec3(0));
-
-    size_t posA, posB, posC, posD;
-    glm::vec3 A, B, C, D;
-    glm::vec3 Aside, Bside, Cside, Dside;
-    glm::vec3 Anormal, Bnormal, Cnormal, Dnormal;
-
-    // Compute normals
-    for (size_t y = 0; y < (numVerV - 1); y++)
-        for (size_t x = 0; x < (numHorV - 1); x++)
-        {
-            /*
-                In each iteration, we operate in each square of the grid (4 vertex):
+    this->diskCache = diskCache;
+    diskKey = key;
+}
 
-                           Cside
-                       (D)------>(C)
-                        |         |
-                  Dside |         | Bside
-                        v         v
-                       (A)------>(B)
-                           Aside
-             */
+size_t PlanetChunk::getDiskRecordSize(size_t numHorVertex, size_t numVertVertex)
+{
+    size_t numVertex = numHorVertex * numVertVertex;
+    size_t numBorder = 2 * (numHorVertex + numVertVertex) - 4;
 
-            // Vertex positions in the array
-            posA = y * numHorV + x;
-            posB = y * numHorV + (x+1);
-            posC = (y+1) * numHorV + (x+1);
-            posD = (y+1) * numHorV + x;
+    return 2 * sizeof(float) + numBorder * sizeof(float) + (numVertex - numBorder) * sizeof(uint16_t) + numVertex * 4 * sizeof(uint16_t);
+}
 
-            // Vertex world coordinates
-            A = getVertex(posA);
-            B = getVertex(posB);
-            C = getVertex(posC);
-            D = getVertex(posD);
+bool PlanetChunk::readDiskRecord()
+{
+    size_t numVertex = numHorVertex * numVertVertex;
+    size_t numBorder = 2 * (numHorVertex + numVertVertex) - 4;
+    compactVertex.resize(numVertex);
 
-            // Vector representing each side
-            Aside = B - A;
-            Bside = B - C;
-            Cside = C - D;
-            Dside = A - D;
+    // Decoded from the mapped file (no intermediate copy)
+    return diskCache->read(diskKey, [&](const unsigned char* record)
+    {
+        float heightRange[2];       // Min. height, height step (interior)
+        const unsigned char* borderHeights = record + sizeof(heightRange);
+        const unsigned char* heights = borderHeights + numBorder * sizeof(float);
+        const unsigned char* attribs = heights + (numVertex - numBorder) * sizeof(uint16_t);
+        memcpy(heightRange, record, sizeof(heightRange));
+
+        uint16_t height;
+        size_t i = 0;
+        for (unsigned y = 0; y < numVertVertex; y++)
+            for (unsigned x = 0; x < numHorVertex; x++, i++)
+            {
+                if (x == 0 || y == 0 || x == numHorVertex - 1 || y == numVertVertex - 1)
+                {
+                    memcpy(&compactVertex[i].height, borderHeights, sizeof(float));
+                    borderHeights += sizeof(float);
+                }
+                else
+                {
+                    memcpy(&height, heights, sizeof(uint16_t));
+                    compactVertex[i].height = heightRange[0] + height * heightRange[1];
+                    heights += sizeof(uint16_t);
+                }
+
+                memcpy(compactVertex[i].normal, attribs + i * 4 * sizeof(uint16_t), 4 * sizeof(uint16_t));     // normal and gapFix
+            }
+    });
+}
 
-            // Normal computed for each vertex from the two side vectors it has attached
-            Anormal = glm::cross(Aside, -Dside);
-            Bnormal = glm::cross(-Bside, -Aside);
-            Cnormal = glm::cross(-Cside, Bside);
-            Dnormal = glm::cross(Dside, Cside);
+void PlanetChunk::writeDiskRecord()
+{
+    size_t numVertex = compactVertex.size();
+    size_t numBorder = 2 * (numHorVertex + numVertVertex) - 4;
+    std::vector<unsigned char> record(getDiskRecordSize(numHorVertex, numVertVertex));
+    auto isBorder = [this](size_t i) { size_t x = i % numHorVertex, y = i / numHorVertex; return x == 0 || y == 0 || x == numHorVertex - 1 || y == numVertVertex - 1; };
 
-            // Add to the existing normal of the vertex
-            tempNormals[posA] += Anormal;
-            tempNormals[posB] += Bnormal;
-            tempNormals[posC] += Cnormal;
-            tempNormals[posD] += Dnormal;
+    // Border heights are stored as they are, so they match the neighbours' ones (and their gap fixes) exactly. Interior heights are stored as steps over the interior's min. height (rounded: max. error = half a step = height range / 131070).
+    float minHeight = 0, maxHeight = 0;
+    bool first = true;
+    for (size_t i = 0; i < numVertex; i++)
+        if (!isBorder(i))
+        {
+            minHeight = (first ? compactVertex[i].height : std::min(minHeight, compactVertex[i].height));
+            maxHeight = (first ? compactVertex[i].height : std::max(maxHeight, compactVertex[i].height));
+            first = false;
         }
 
-    // Normalize the normals
-    size_t j;
+    float heightRange[2] = { minHeight, (maxHeight - minHeight) / 65535 };
+    unsigned char* borderHeights = record.data() + sizeof(heightRange);
+    unsigned char* heights = borderHeights + numBorder * sizeof(float);
+    unsigned char* attribs = heights + (numVertex - numBorder) * sizeof(uint16_t);
+    memcpy(record.data(), heightRange, sizeof(heightRange));
+
+    uint16_t height;
     for (size_t i = 0; i < numVertex; i++)
     {
-        j = i * numAttribs;
+        if (isBorder(i))
+        {
+            memcpy(borderHeights, &compactVertex[i].height, sizeof(float));
+            borderHeights += sizeof(float);
+        }
+        else
+        {
+            height = (heightRange[1] > 0 ? (uint16_t)std::min(65535.f, std::round((compactVertex[i].height - minHeight) / heightRange[1])) : 0);
+            memcpy(heights, &height, sizeof(uint16_t));
+            heights += sizeof(uint16_t);
+        }
 
-        tempNormals[i] = glm::normalize(tempNormals[i]);
-        vertex[j + 3] = tempNormals[i].x;
-        vertex[j + 4] = tempNormals[i].y;
-        vertex[j + 5] = tempNormals[i].z;
+        memcpy(attribs + i * 4 * sizeof(uint16_t), compactVertex[i].normal, 4 * sizeof(uint16_t));
     }
+
+    diskCache->write(diskKey, record.data());
+}
+
+PlanetPatch PlanetChunk::getPatch(Noiser* noiseGen, HeightCache* heightCache) const
+{
+    return PlanetPatch(baseCenter, xAxis, yAxis, stride, numHorVertex, numVertVertex, radius, nucleus, noiseGen, heightCache, skipFineOctaves);
+}
+
+glm::vec3 PlanetChunk::getGridPoint(size_t i) const
+{
+    return getFacePoint((float)(i % numHorVertex), (float)(i / numHorVertex));
+}
+
+glm::vec3 PlanetChunk::getFacePoint(float col, float row) const
+{
+    glm::vec3 pos0 = baseCenter - (xAxis * horBaseSize / 2.f + yAxis * vertBaseSize / 2.f);
+
+    return pos0 + (xAxis * col * stride) + (yAxis * row * stride);
+}
+
+glm::vec3 PlanetChunk::getVertexPos(size_t i) const
+{
+    if (compactVertex.empty()) return getVertex(i);
+
+    return glm::normalize(getGridPoint(i) - nucleus) * (radius + compactVertex[i].height);
+}
+
+float PlanetChunk::getVertexHeight(size_t i) const
+{
+    if (compactVertex.empty()) return glm::length(getVertex(i) - nucleus) - radius;
+
+    return compactVertex[i].height;
+}
+
+glm::vec3 PlanetChunk::getVertexNormal(size_t i) const
+{
+    if (compactVertex.empty()) return getNormal(i);
+
+    glm::vec3 normal(glm::unpackSnorm1x16(compactVertex[i].normal[0]), glm::unpackSnorm1x16(compactVertex[i].normal[1]), 0);
+    normal.z = 1 - std::abs(normal.x) - std::abs(normal.y);
+    float t = std::max(-normal.z, 0.f);
+    normal.x += (normal.x >= 0 ? -t : t);
+    normal.y += (normal.y >= 0 ? -t : t);
+
+    return glm::normalize(normal);
+}
+
+const VertexType& PlanetChunk::getVertexType() const { return compactVertex.empty() ? vt_333 : vt_planetCompact; }
+
+const void* PlanetChunk::getVertexData() const { return compactVertex.empty() ? (const void*)vertex.data() : (const void*)compactVertex.data(); }
+
+void PlanetChunk::getShaderParams(glm::vec4* params) const
+{
+    params[0] = glm::vec4(getGridPoint(0), radius);
+    params[1] = glm::vec4(xAxis * stride, numHorVertex);
+    params[2] = glm::vec4(yAxis * stride, numHorVertex * numVertVertex);     // Vertices per chunk (vertex arena slots are multiples of it, so gl_VertexIndex % w is the index in the chunk)
+    params[3] = glm::vec4(nucleus, 0);
 }
 
 void PlanetChunk::getSubBaseCenters(std::tuple<float, float, float>* centers)
@@ -501,125 +679,6 @@ void PlanetChunk::computeSizes()
     vertChunkSize = glm::length(bottom - top);
 }
 
-void PlanetChunk::computeGapFixes()
-{
-    // Attributes: 6 (vertex type: 0,1,2,3,4), 7 (extra height for x2 difference), 8 (for x4 difference).
-    // Shader: If vertex type != 0 or 1000, fix vertex position (if required) using side depths (uniform) and extra height (attribute).
-
-    glm::vec3 current, average;
-    unsigned remain, prev, next;
-    float ratio;
-    size_t index;
-
-    for (size_t v = 1; v < numVertVertex - 1; v++)
-        if (v % 4)
-        {
-            if (v % 2)
-            {
-                // x2 left
-                index = (numHorVertex * v) * numAttribs;
-                prev = index - numHorVertex * numAttribs;
-                next = index + numHorVertex * numAttribs;
-                current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
-                average.x = (vertex[prev + 0] + vertex[next + 0]) / 2;
-                average.y = (vertex[prev + 1] + vertex[next + 1]) / 2;
-                average.z = (vertex[prev + 2] + vertex[next + 2]) / 2;
-                vertex[index + 6] = side::left + 1;
-                vertex[index + 7] = glm::length(average - nucleus) - glm::length(current - nucleus);
-
-                // x2 right
-                index = (numHorVertex * (v + 1) - 1) * numAttribs;
-                prev = index - numHorVertex * numAttribs;
-                next = index + numHorVertex * numAttribs;
-                current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
-                average.x = (vertex[prev + 0] + vertex[next + 0]) / 2;
-                average.y = (vertex[prev + 1] + vertex[next + 1]) / 2;
-                average.z = (vertex[prev + 2] + vertex[next + 2]) / 2;
-                vertex[index + 6] = side::right + 1;
-                vertex[index + 7] = glm::length(average - nucleus) - glm::length(current - nucleus);
-            }
-
-            remain = v % 4;
-            ratio = remain / 4.f;
-
-            // x4 left
-            index = (numHorVertex * v) * numAttribs;
-            prev = index - numHorVertex * numAttribs * remain;
-            next = index + numHorVertex * numAttribs * (4 - remain);
-            current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
-            average.x = vertex[prev + 0] + (vertex[next + 0] - vertex[prev + 0]) * ratio;
-            average.y = vertex[prev + 1] + (vertex[next + 1] - vertex[prev + 1]) * ratio;
-            average.z = vertex[prev + 2] + (vertex[next + 2] - vertex[prev + 2]) * ratio;
-            vertex[index + 6] = side::left + 1;
-            vertex[index + 8] = glm::length(average - nucleus) - glm::length(current - nucleus);
-
-            // x4 right
-            index = (numHorVertex * (v + 1) - 1) * numAttribs;
-            prev = index - numHorVertex * numAttribs * remain;
-            next = index + numHorVertex * numAttribs * (4 - remain);
-            current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
-            average.x = vertex[prev + 0] + (vertex[next + 0] - vertex[prev + 0]) * ratio;
-            average.y = vertex[prev + 1] + (vertex[next + 1] - vertex[prev + 1]) * ratio;
-            average.z = vertex[prev + 2] + (vertex[next + 2] - vertex[prev + 2]) * ratio;
-            vertex[index + 6] = side::right + 1;
-            vertex[index + 8] = glm::length(average - nucleus) - glm::length(current - nucleus);
-        }
-
-    for (size_t h = 1; h < numHorVertex - 1; h++)
-        if (h % 4)
-        {
-            if (h % 2)
-            {
-                // x2 up
-                index = (numHorVertex * (numVertVertex - 1) + h) * numAttribs;
-                prev = index - numAttribs;
-                next = index + numAttribs;
-                current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
-                average.x = (vertex[prev + 0] + vertex[next + 0]) / 2;
-                average.y = (vertex[prev + 1] + vertex[next + 1]) / 2;
-                average.z = (vertex[prev + 2] + vertex[next + 2]) / 2;
-                vertex[index + 6] = side::up + 1;
-                vertex[index + 7] = glm::length(average - nucleus) - glm::length(current - nucleus);
-                
-                // x2 down
-                index = h * numAttribs;
-                prev = index - numAttribs;
-                next = index + numAttribs;
-                current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
-                average.x = (vertex[prev + 0] + vertex[next + 0]) / 2;
-                average.y = (vertex[prev + 1] + vertex[next + 1]) / 2;
-                average.z = (vertex[prev + 2] + vertex[next + 2]) / 2;
-                vertex[index + 6] = side::down + 1;
-                vertex[index + 7] = glm::length(average - nucleus) - glm::length(current - nucleus);
-            }
-
-            remain = h % 4;
-            ratio = remain / 4.f;
-
-            // x4 up
-            index = (numHorVertex * (numVertVertex - 1) + h) * numAttribs;
-            prev = index - remain * numAttribs;
-            next = index + (4 - remain) * numAttribs;
-            current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
-            average.x = vertex[prev + 0] + (vertex[next + 0] - vertex[prev + 0]) * ratio;
-            average.y = vertex[prev + 1] + (vertex[next + 1] - vertex[prev + 1]) * ratio;
-            average.z = vertex[prev + 2] + (vertex[next + 2] - vertex[prev + 2]) * ratio;
-            vertex[index + 6] = side::up + 1;
-            vertex[index + 8] = glm::length(average - nucleus) - glm::length(current - nucleus);
-
-            // x4 down
-            index = h * numAttribs;
-            prev = index - remain * numAttribs;
-            next = index + (4 - remain) * numAttribs;
-            current = glm::vec3(vertex[index + 0], vertex[index + 1], vertex[index + 2]);
-            average.x = vertex[prev + 0] + (vertex[next + 0] - vertex[prev + 0]) * ratio;
-            average.y = vertex[prev + 1] + (vertex[next + 1] - vertex[prev + 1]) * ratio;
-            average.z = vertex[prev + 2] + (vertex[next + 2] - vertex[prev + 2]) * ratio;
-            vertex[index + 6] = side::down + 1;
-            vertex[index + 8] = glm::length(average - nucleus) - glm::length(current - nucleus);
-        }
-}
-
 // SphereChunk ----------------------------------------------------------------------
 
 SphereChunk::SphereChunk(Renderer& renderer, glm::vec3 cubeSideCenter, float stride, unsigned numHorVertex, unsigned numVertVertex, float radius, glm::vec3 nucleus, glm::vec3 cubePlane, unsigned depth, unsigned chunkID)
@@ -631,395 +690,1144 @@ SphereChunk::SphereChunk(Renderer& renderer, glm::vec3 cubeSideCenter, float str
 
 void SphereChunk::computeTerrain(bool computeIndices)
 {
-    // Vertex data (+ frame)
-    glm::vec3 pos0 = baseCenter - (xAxis * horBaseSize / 2.f + yAxis * vertBaseSize / 2.f);   // Position of the initial coordinate in the cube side plane (lower left).
-    pos0 -= (xAxis * stride + yAxis * stride);      // Set frame
-    unsigned tempNumHorV = numHorVertex + 2;
-    unsigned tempNumVerV = numVertVertex + 2;
-    vertex.resize(tempNumHorV * tempNumVerV * numAttribs);
-    glm::vec3 unitVec, cube, ground;
-    size_t index;
-
-    for (size_t v = 0; v < tempNumVerV; v++)
-        for (size_t h = 0; h < tempNumHorV; h++)
-        {
-            index = (v * tempNumHorV + h) * numAttribs;
-
-            // Positions (0, 1, 2)
-            cube = pos0 + (xAxis * (float)h * stride) + (yAxis * (float)v * stride);
-            ground = glm::normalize(cube - nucleus) * radius;
-            vertex[index + 0] = ground.x;
-            vertex[index + 1] = ground.y;
-            vertex[index + 2] = ground.z;
-            vertex[index + 6] = 0;          // Vertex type (default = 0)
-        }
-
-    // Normals (3, 4, 5) (+ frame)
-    computeGridNormals(pos0, xAxis, yAxis, tempNumHorV, tempNumVerV);
-
-    // Crop frame (relocate vertices in the vector and crop it)
-    size_t i = 0, j = 0;
-    for (size_t v = 1; v < (tempNumVerV - 1); v++)
-        for (size_t h = 1; h < (tempNumHorV - 1); h++)
-        {
-            index = (v * tempNumHorV + h) * numAttribs;
-
-            for (j = 0; j < numAttribs; j++)
-                vertex[i++] = vertex[index + j];
-        }
-    vertex.resize(numHorVertex * numVertVertex * numAttribs);
+    // Positions (radius), normals and gap-fixing data (vt_333)
+    PlanetPatch patch = getPatch(nullptr);
+    patch.generate(false);
+    vertex = std::move(patch.vertex);
 
-    // Compute gap-fixing data (6, 7, 8).
-    computeGapFixes();
+    computeGeometricError();
+    computeBounds();
 
     // Indices
     if (computeIndices)
         this->computeIndices(indices, numHorVertex, numVertVertex);
 }
 
-// DynamicGrid ----------------------------------------------------------------------
+// ChunkBatch ----------------------------------------------------------------------
 
-DynamicGrid::DynamicGrid(glm::vec3 camPos, Renderer* renderer, unsigned activeTree, size_t rootCellSize, size_t numSideVertex, size_t numLevels, size_t minLevel, float distMultiplier, bool transparency)
-    : camPos(camPos),
-    numLights(0),
-    renderer(renderer), 
-    activeTree(activeTree),
-    nonActiveTree((activeTree + 1) % 2),
-    rootCellSize(rootCellSize), 
-    numSideVertex(numSideVertex), 
-    numLevels(numLevels), 
-    minLevel(minLevel), 
-    distMultiplier(distMultiplier),
-    distMultRemove(distMultiplier * 2),
-    transparency(transparency)
+ChunkBatch::ChunkBatch(Renderer* renderer, const std::string& name, std::vector<ShaderLoader>& shaders, std::vector<TextureLoader>& textures, std::shared_ptr<SharedIndexBuffer> indices, size_t chunkBytes, unsigned capacity, unsigned numLights, bool transparency)
+    : capacity(capacity),
+    renderer(renderer),
+    arena(std::make_shared<VertexArena>(chunkBytes, vt_planetCompact.vertexSize, capacity, 1)),
+    indices(indices),
+    numChunks(0),
+    chunkDataOffset(4 * size.mat4 + 2 * size.vec4 + numLights * sizeof(LightPosDir))
 {
-    root[0] = root[1] = nullptr;
-    Chunk::computeIndices(indices, numSideVertex, numSideVertex);
-};
+    VerticesLoader vertexData(arena, indices);
 
-DynamicGrid::~DynamicGrid()
-{
-    if (root[0]) delete root[0];
-    if (root[1]) delete root[1];
+    ModelDataInfo modelInfo;
+    modelInfo.name = name.c_str();
+    modelInfo.layer = 1;
+    modelInfo.activeInstances = 1;
+    modelInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    modelInfo.vertexType = vt_planetCompact;
+    modelInfo.verticesLoader = &vertexData;
+    modelInfo.shadersInfo = &shaders;
+    modelInfo.texturesInfo = &textures;
+    modelInfo.maxDescriptorsCount_vs = 1;
+    modelInfo.UBOsize_vs = chunkDataOffset + capacity * chunkDataSize;     // MM (mat4), VM (mat4), PM (mat4), MMN (mat3), camPos (vec3), time (time, camHeight), n * LightPosDir (2*vec4), and per slot: sideDepth (vec4), shader params (4*vec4)
+    modelInfo.UBOsize_fs = numLights * sizeof(LightProps);                 // n * LightProps (6*vec4)
+    modelInfo.storageBuffer_vs = true;
+    modelInfo.maxIndirectDraws = capacity;
+    modelInfo.transparency = transparency;
+    modelInfo.renderPassIndex = 0;
+    modelInfo.cullMode = VK_CULL_MODE_BACK_BIT;
 
-    for (auto it = chunks.begin(); it != chunks.end(); it++)
-        delete it->second;
+    model = renderer->newModel(modelInfo);
 
-    chunks.clear();
-}
+    glm::mat4 modelMatrix = getModelMatrix();
+    glm::mat4 normalMatrix = getModelMatrixForNormals(modelMatrix);
+    float verticesPerChunk = chunkBytes / vt_planetCompact.vertexSize;
 
-void DynamicGrid::addResources(const std::vector<ShaderLoader>& shadersInfo, const std::vector<TextureLoader>& texturesInfo)
-{
-    this->shaders = shadersInfo;
-    this->textures = texturesInfo;
+    uint8_t* dest = model->vsUBO.getUBOptr(0);
+    memcpy(dest, &modelMatrix, size.mat4);
+    memcpy(dest + 3 * size.mat4, &normalMatrix, size.mat4);
+
+    for (unsigned slot = 0; slot < capacity; slot++)        // gridRowStep.w of every slot (even unused ones), so the shader can find the slot of a vertex before knowing its chunk (see v_planetChunkBatch.vert)
+        memcpy(dest + chunkDataOffset + slot * chunkDataSize + 3 * size.vec4 + 3 * sizeof(float), &verticesPerChunk, sizeof(float));
 }
 
-void DynamicGrid::updateTree(glm::vec3 newCamPos, unsigned numLights)
+void ChunkBatch::addChunks(const std::vector<Chunk*>& newChunks)
 {
-    if (!numLevels) return;
+    std::vector<Chunk*> batchable;
+    std::vector<const void*> vertexSets;
 
-    // Return if CamPos has not changed, Active tree exists, and Non-active tree is nullptr.
-    if (root[activeTree] && !root[nonActiveTree] && camPos.x == newCamPos.x && camPos.y == newCamPos.y && camPos.z == newCamPos.z)
-        return;  // ERROR: When updateTree doesn't run in each frame (i.e., when command buffer isn't created each frame), no validation error appears after resizing window
-    
-    // Build tree if the non-active tree is nullptr
-    if (!root[nonActiveTree])
-    {
-        camPos = newCamPos;
-        this->numLights = numLights;
-        updateVisibilityState();        // overridden method
-
-        visibleLeafChunks[nonActiveTree].clear();
-        root[nonActiveTree] = getNode(closestCenter(), rootCellSize, 0, 1);
-        createTree(root[nonActiveTree], 0);                         // Build tree and load leaf-chunks
-    }
-
-    // <<< Why is executed each time I move? Why is only executed in one plane for fixing gaps?
-    // Check whether non-active tree has fully constructed leaf-chunks. If so, switch trees
-    if (fullConstChunks(nonActiveTree))
-    {
-        updateChunksSideDepths(root[nonActiveTree]);
-        
-        changeRenders(activeTree, false);
-        if (root[activeTree]) delete root[activeTree];
-        root[activeTree] = nullptr;
-        
-        changeRenders(nonActiveTree, true);
+    for (Chunk* chunk : newChunks)
+        if (&chunk->getVertexType() == &vt_planetCompact && chunk->getVertexBytes() == arena->slotSize)
+        {
+            batchable.push_back(chunk);
+            vertexSets.push_back(chunk->getVertexData());
+        }
 
-        removeFarChunks(distMultRemove, newCamPos);
+    std::vector<unsigned> slots;
+    renderer->uploadVertices(arena, vertexSets, arena->slotSize, slots);
 
-        resetVisibility(root[nonActiveTree]);
+    glm::vec4 params[4];
+    uint8_t* dest;
+    VkDrawIndexedIndirectCommand* command;
 
-        std::swap(activeTree, nonActiveTree);
+    for (size_t i = 0; i < batchable.size(); i++)
+    {
+        if (slots[i] == VertexArena::noSlot) break;     // Arena is full
+
+        Chunk* chunk = batchable[i];
+        chunk->batchSlot = slots[i];
+        numChunks++;
+
+        chunk->getShaderParams(params);
+        dest = model->vsUBO.getUBOptr(0) + chunkDataOffset + slots[i] * chunkDataSize;
+        memcpy(dest, &chunk->sideDepths, size.vec4);
+        memcpy(dest + size.vec4, params, 4 * size.vec4);
+
+        command = getDrawCommand(slots[i]);
+        command->indexCount = indices->indices.size();
+        command->instanceCount = 0;
+        command->firstIndex = 0;
+        command->vertexOffset = arena->getFirstVertex(slots[i]);
+        command->firstInstance = 0;
     }
 }
 
-void DynamicGrid::createTree(QuadNode<Chunk*>* node, size_t depth)
+void ChunkBatch::removeChunk(Chunk* chunk)
 {
-    Chunk* chunk = node->getElement();
-    glm::vec3 gCenter = getChunkCenter(chunk);
-    float dist = sqrt((camPos.x - gCenter.x) * (camPos.x - gCenter.x) + (camPos.y - gCenter.y) * (camPos.y - gCenter.y) + (camPos.z - gCenter.z) * (camPos.z - gCenter.z));
+    if (chunk->batchSlot == VertexArena::noSlot) return;
 
-    // Is leaf node > Compute terrain > Children are nullptr by default
-    if (depth >= minLevel && (dist > chunk->getHorChunkSide() * distMultiplier || depth == numLevels - 1))// <<<<<<< squaring distances is correct here?
-    {
-        if (!isVisible(chunk)) { 
-            node->getElement()->isVisible = false; 
-            return; 
-        }
+    getDrawCommand(chunk->batchSlot)->instanceCount = 0;
+    renderer->releaseVertices(arena, chunk->batchSlot);
+    chunk->batchSlot = VertexArena::noSlot;
+    numChunks--;
+}
 
-        if (chunk->modelOrdered == false) {
-            chunk->computeTerrain(false);
-            chunk->render(shaders, textures, &indices, numLights, transparency);
-            renderer->setRenders(chunk->model, 0);
-        }
+void ChunkBatch::setDrawn(Chunk* chunk, bool drawn) { getDrawCommand(chunk->batchSlot)->instanceCount = (drawn ? 1 : 0); }
 
-        visibleLeafChunks[nonActiveTree].push_back(node->getElement());
-    }
-    // Is not leaf node > Create children > Recursion
-    else
-    {
-        depth++;
-        std::tuple<float, float, float> subBaseCenters[4];
-        chunk->getSubBaseCenters(subBaseCenters);
-        float halfSide = chunk->getHorBaseSide() / 2;
-        glm::vec4 chunkIDs = getChunkIDs(chunk->chunkID, depth);
-        
-        node->setA(getNode(subBaseCenters[0], halfSide, depth, chunkIDs[0]));    // - x + y
-        createTree(node->getA(), depth);
+bool ChunkBatch::isDrawn(const Chunk* chunk) { return getDrawCommand(chunk->batchSlot)->instanceCount; }
 
-        node->setB(getNode(subBaseCenters[1], halfSide, depth, chunkIDs[1]));    // + x + y
-        createTree(node->getB(), depth);
+bool ChunkBatch::isReady() { return model->fullyConstructed; }
 
-        node->setC(getNode(subBaseCenters[2], halfSide, depth, chunkIDs[2]));    // - x - y
-        createTree(node->getC(), depth);
+void ChunkBatch::updateUBOs(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos, const LightSet& lights, float time, float camHeight, const std::vector<Chunk*>& drawnChunks)
+{
+    uint8_t* dest = model->vsUBO.getUBOptr(0);
 
-        node->setD(getNode(subBaseCenters[3], halfSide, depth, chunkIDs[3]));    // + x - y
-        createTree(node->getD(), depth);
-    }
+    dest += size.mat4;
+    memcpy(dest, &view, size.mat4);
+    dest += size.mat4;
+    memcpy(dest, &proj, size.mat4);
+    dest += 2 * size.mat4;
+    memcpy(dest, &camPos, size.vec3);
+    dest += size.vec4;
+    memcpy(dest, &time, sizeof(float));
+    memcpy(dest + sizeof(float), &camHeight, sizeof(float));
+    dest += size.vec4;
+    memcpy(dest, lights.posDir, lights.posDirBytes);
+
+    for (Chunk* chunk : drawnChunks)        // Side depths change when trees are switched
+        if (chunk->batchSlot != VertexArena::noSlot)
+            memcpy(model->vsUBO.getUBOptr(0) + chunkDataOffset + chunk->batchSlot * chunkDataSize, &chunk->sideDepths, size.vec4);
+
+    dest = model->fsUBO.getUBOptr(0);
+    memcpy(dest, lights.props, lights.propsBytes);
 }
 
-bool DynamicGrid::fullConstChunks(unsigned treeIndex)
+void ChunkBatch::toLastDraw() { renderer->toLastDraw(model); }
+
+unsigned ChunkBatch::getNumChunks() const { return numChunks; }
+
+VkDrawIndexedIndirectCommand* ChunkBatch::getDrawCommand(unsigned slot) { return (VkDrawIndexedIndirectCommand*)model->drawCommands.getUBOptr(0) + slot; }
+
+// ChunkEventStream ----------------------------------------------------------------------
+
+ChunkEventQueue* ChunkEventStream::subscribe(size_t capacity)
 {
-    for (Chunk* chunk : visibleLeafChunks[treeIndex])
-        if (!chunk->model->fullyConstructed)
-            return false;
+    unsigned count = numSubscribers.load();
+    if (count == maxSubscribers)
+    {
+        std::cout << "Too many chunk event subscribers (max. " << maxSubscribers << ")" << std::endl;
+        return nullptr;
+    }
 
-    return true;
+    queues[count] = std::make_unique<ChunkEventQueue>(capacity);
+    numSubscribers.store(count + 1, std::memory_order_release);
+    return queues[count].get();
 }
 
-void DynamicGrid::updateChunksSideDepths(QuadNode<Chunk*>* node)
+void ChunkEventStream::publish(const ChunkEvent& event)
 {
-    restartSideDepths(node);                                    // Set nodes' side depths to 0
-    node->getElement()->setSideDepths(1000, 1000, 1000, 1000);  // Initialize root side depths to 1000 (flag for grid boundaries). The rest of nodes have side depths of 0 (set previously). 
+    unsigned count = numSubscribers.load(std::memory_order_acquire);
 
-    QuadNode<Chunk*>* currentNode;
-    std::list<Chunk*> allLeaves;
-    std::list<QuadNode<Chunk*>*> queue;
-    queue.push_back(node);
-
-    // Get depths of neighbour chunks (breadth-first traversal) (result = depth each side should keep to make its borders fit)
-    while (queue.size())
-    {
-        // Dequeue firt element
-        currentNode = queue.front();
-        queue.pop_front();
+    for (unsigned i = 0; i < count; i++)
+        queues[i]->push(event);
+}
 
-        // Modify data
-        updateChunksSideDepths_help(queue, currentNode);
-        if (currentNode->isLeaf())
-            allLeaves.push_back(currentNode->getElement());
+// ChunkScheduler ----------------------------------------------------------------------
 
-        // Enqueue childs
-        if (!currentNode->isLeaf())
-        {
-            queue.push_back(currentNode->getA());
-            queue.push_back(currentNode->getB());
-            queue.push_back(currentNode->getC());
-            queue.push_back(currentNode->getD());
-        }
-    }
+ChunkScheduler::ChunkScheduler(std::shared_ptr<ThreadPool> threadPool, float frameBudget)
+    : threadPool(threadPool), inFlight(0), frameBudget(frameBudget), frame(0), spent(0), uploadCost(0), uploads(0), dropped(0) { }
 
-    // Get depth differences of neigbour leaves and pass them as UBO
-    for (auto& it : allLeaves)
-    {
-        if (it->sideDepths[0] != 1000) it->sideDepths[0] = it->depth - it->sideDepths[0];
-        if (it->sideDepths[1] != 1000) it->sideDepths[1] = it->depth - it->sideDepths[1];
-        if (it->sideDepths[2] != 1000) it->sideDepths[2] = it->depth - it->sideDepths[2];
-        if (it->sideDepths[3] != 1000) it->sideDepths[3] = it->depth - it->sideDepths[3];
-    }
+ChunkScheduler::~ChunkScheduler()
+{
+    while (inFlight)                    // Jobs in the ThreadPool use this scheduler
+        std::this_thread::yield();
 }
 
-void DynamicGrid::changeRenders(unsigned treeIndex, bool renderMode)
+void ChunkScheduler::setFrameBudget(float ms) { frameBudget = ms; }
+
+void ChunkScheduler::request(DynamicGrid* grid, Chunk* chunk)
 {
-    for (Chunk*& chunk : visibleLeafChunks[treeIndex])
-        renderer->setRenders(chunk->model, renderMode);
+    const std::lock_guard<std::mutex> lock(mutRequests);
+    requests.push_back({ grid, chunk });
 }
 
-void DynamicGrid::resetVisibility(QuadNode<Chunk*>* node)
+void ChunkScheduler::cancel(DynamicGrid* grid)
 {
-    if (!node) return;
+    const std::lock_guard<std::mutex> lock(mutRequests);
+    requests.erase(std::remove_if(requests.begin(), requests.end(), [grid](const Request& request) { return request.grid == grid; }), requests.end());
+}
 
-    if (node->isLeaf())
-        node->getElement()->isVisible = true;
-    else
+void ChunkScheduler::dispatch(size_t frame)
+{
+    if (frame != this->frame)
     {
-        resetVisibility(node->getA());
-        resetVisibility(node->getB());
-        resetVisibility(node->getC());
-        resetVisibility(node->getD());
+        this->frame = frame;
+        spent = 0;
+        uploads = 0;
     }
-}
 
-void DynamicGrid::removeFarChunks(unsigned relDist, glm::vec3 camPosNow)
+    const std::lock_guard<std::mutex> lock(mutRequests);
+
+    // Drop stale requests
+    for (size_t i = 0; i < requests.size(); )
+    {
+        Chunk* chunk = requests[i].chunk;
+
+        if (!chunk->numNodes || !chunk->isVisible)
+        {
+            chunk->terrainState = TerrainState::none;      // It will be requested again if it's required
+            requests[i] = requests.back();
+            requests.pop_back();
+            dropped++;
+        }
+        else i++;
+    }
+
+    if (requests.empty()) return;
+
+    // Run the most important requests (at the back)
+    std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b) { return a.chunk->priority < b.chunk->priority; });
+
+    unsigned maxInFlight = threadPool ? 2 * std::max(threadPool->getNumThreads(), 1u) : 0;
+
+    while (requests.size())
+    {
+        if (threadPool) { if (inFlight >= maxInFlight) break; }
+        else if (spent >= frameBudget) break;
+
+        run(requests.back());
+        requests.pop_back();
+    }
+}
+
+void ChunkScheduler::run(const Request& request)
 {
-    glm::vec3 center;
-    glm::vec3 distVec;
-    float targetDist;
-    float targetSqrDist;
-    std::map<std::tuple<float, float, float>, Chunk*>::iterator it = chunks.begin();
-    std::map<std::tuple<float, float, float>, Chunk*>::iterator nextIt;
-    Chunk* chunk;
+    DynamicGrid* grid = request.grid;
+    Chunk* chunk = request.chunk;
+    chunk->terrainState = TerrainState::computing;
+
+    if (!threadPool)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        chunk->computeTerrain(false);
+        grid->terrainComputed(chunk);
+
+        spent += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        return;
+    }
+
+    grid->pendingJobs++;
+    inFlight++;
+
+    threadPool->submit([this, grid, chunk]()
+    {
+        chunk->computeTerrain(false);
+        grid->terrainComputed(chunk);
+        grid->pendingJobs--;
+        inFlight--;
+    });
+}
+
+size_t ChunkScheduler::getUploadQuota() const
+{
+    float remaining = frameBudget - spent;
+
+    if (remaining <= 0) return uploads ? 0 : 1;     // At least 1 upload per frame
+    if (uploadCost <= 0) return 1;                  // Cost unknown yet
+
+    return std::max<size_t>(remaining / uploadCost, 1);
+}
+
+void ChunkScheduler::chargeUploads(float ms, size_t count)
+{
+    if (!count) return;
+
+    spent += ms;
+    uploads += count;
+
+    float cost = ms / count;
+    uploadCost = (uploadCost > 0 ? 0.9f * uploadCost + 0.1f * cost : cost);     // Moving average
+}
+
+size_t ChunkScheduler::getQueueDepth()
+{
+    const std::lock_guard<std::mutex> lock(mutRequests);
+    return requests.size();
+}
+
+unsigned ChunkScheduler::getNumInFlight() const { return inFlight; }
+
+size_t ChunkScheduler::getNumDropped() const { return dropped; }
+
+float ChunkScheduler::getFrameTime() const { return spent; }
+
+// DynamicGrid ----------------------------------------------------------------------
+
+DynamicGrid::DynamicGrid(glm::vec3 camPos, Renderer* renderer, size_t rootCellSize, size_t numSideVertex, size_t numLevels, size_t minLevel, float distMultiplier, bool transparency)
+    : camPos(camPos),
+    numLights(0),
+    memoryBudget(32 * 1024 * 1024),
+    registryHits(0),
+    registryMisses(0),
+    evictions(0),
+    vertexSize(vt_333.vertexSize),
+    uploadedBytes(0),
+    root(ChunkTree::none),
+    newRoot(ChunkTree::none),
+    rootKey(0),
+    newRootKey(0),
+    treeChanged(false),
+    updateCamPos(camPos),
+    treeSettled(false),
+    drawnDirty(false),
+    gridHidden(false),
+    useFrustum(false),
+    viewDir(0, 0, 0),
+    updateViewDir(0, 0, 0),
+    lastProj(1),
+    heightMin(0),
+    heightMax(0),
+    culledChunks(0),
+    renderer(renderer), 
+    threadPool(nullptr),
+    scheduler(nullptr),
+    pendingJobs(0),
+    computedChunks(0),
+    rootCellSize(rootCellSize), 
+    numSideVertex(numSideVertex), 
+    numLevels(numLevels), 
+    minLevel(minLevel), 
+    distMultiplier(distMultiplier),
+    transparency(transparency),
+    moveThreshold(numLevels ? rootCellSize / pow(2, numLevels - 1) / 10 : 0),
+    lodHysteresis(0.1f),
+    sseFactor(0),
+    maxPixelError(2.f),
+    sseCoarser(0),
+    sseFiner(0),
+    progressiveActivation(true)
+{
+    std::vector<uint16_t> gridIndices;
+    Chunk::computeIndices(gridIndices, numSideVertex, numSideVertex);
+    indices = std::make_shared<SharedIndexBuffer>(gridIndices);
+};
+
+DynamicGrid::~DynamicGrid()
+{
+    if (scheduler) scheduler->cancel(this);
+
+    while (pendingJobs)                 // Worker threads may be computing some of our chunks
+        std::this_thread::yield();
+
+    for (auto it = chunks.begin(); it != chunks.end(); it++)
+        delete it->second.chunk;
+
+    chunks.clear();
+}
+
+void DynamicGrid::addResources(const std::vector<ShaderLoader>& shadersInfo, const std::vector<TextureLoader>& texturesInfo)
+{
+    this->shaders = shadersInfo;
+    this->textures = texturesInfo;
+}
+
+void DynamicGrid::setThreadPool(std::shared_ptr<ThreadPool> threadPool) { this->threadPool = threadPool; }
+
+void DynamicGrid::setScheduler(std::shared_ptr<ChunkScheduler> scheduler)
+{
+    if (this->scheduler) this->scheduler->cancel(this);
+    this->scheduler = scheduler;
+}
+
+void DynamicGrid::setBatchShader(const ShaderLoader& vertexShader)
+{
+    batchShaders.clear();
+    batchShaders.push_back(vertexShader);
+
+    for (size_t i = 1; i < shaders.size(); i++)     // Same fragment shader
+        batchShaders.push_back(shaders[i]);
+}
+
+void DynamicGrid::setFrustum(const glm::mat4& view, const glm::mat4& proj)
+{
+    // Planes from the rows of the view-projection matrix (Gribb-Hartmann). Near plane assumes depth in [-1, 1], which is conservative for [0, 1].
+    glm::mat4 m = glm::transpose(proj * view);
 
-    while (it != chunks.end())
+    frustumPlanes[0] = m[3] + m[0];     // left
+    frustumPlanes[1] = m[3] - m[0];     // right
+    frustumPlanes[2] = m[3] + m[1];     // bottom
+    frustumPlanes[3] = m[3] - m[1];     // top
+    frustumPlanes[4] = m[3] + m[2];     // near
+    frustumPlanes[5] = m[3] - m[2];     // far
+
+    for (glm::vec4& plane : frustumPlanes)
+        plane /= glm::length(glm::vec3(plane));
+
+    useFrustum = true;
+
+    // Update the tree if the camera turned (~5 deg) or the projection changed, even if the camera doesn't move
+    viewDir = -glm::vec3(view[0][2], view[1][2], view[2][2]);
+    if (glm::dot(viewDir, updateViewDir) < 0.996f || proj != lastProj)
+        treeSettled = false;
+
+    lastProj = proj;
+}
+
+void DynamicGrid::setScreenSpaceError(float fov, float viewportHeight, float maxPixelError)
+{
+    float factor = viewportHeight / (2 * tan(fov / 2));
+    if (factor == sseFactor && maxPixelError == this->maxPixelError) return;
+
+    sseFactor = factor;
+    this->maxPixelError = maxPixelError;
+    treeSettled = false;
+}
+
+void DynamicGrid::setLodUpdate(float moveThreshold, float hysteresis)
+{
+    this->moveThreshold = moveThreshold;
+    this->lodHysteresis = hysteresis;
+    treeSettled = false;
+}
+
+void DynamicGrid::setProgressiveActivation(bool enabled) { progressiveActivation = enabled; }
+
+void DynamicGrid::updateTree(glm::vec3 newCamPos, unsigned numLights)
+{
+    updateTree_build(newCamPos, numLights);
+    updateTree_load();
+}
+
+void DynamicGrid::updateTree_build(glm::vec3 newCamPos, unsigned numLights)
+{
+    if (!numLevels) return;
+
+    // Return if the drawn tree exists, no LOD change is waiting, and the camera moved less than the threshold
+    glm::vec3 move = newCamPos - updateCamPos;
+    if (root != ChunkTree::none && newRoot == ChunkTree::none && treeSettled && glm::dot(move, move) < moveThreshold * moveThreshold)
+        return;  // ERROR: When updateTree doesn't run in each frame (i.e., when command buffer isn't created each frame), no validation error appears after resizing window
+
+    camPos = updateCamPos = newCamPos;
+    updateViewDir = viewDir;
+    this->numLights = numLights;
+    updateVisibilityState();        // overridden method
+
+    treeSettled = true;
+    sseCoarser = sseFiner = culledChunks = 0;
+    pendingNodes.clear();
+    loadingChunks.clear();
+
+    // Skip the whole grid if it's not visible (example: a planet face that faces away)
+    if (root != ChunkTree::none && newRoot == ChunkTree::none && !isVisible(tree[root].element))
+    {
+        if (!gridHidden) gridHidden = drawnDirty = true;
+        return;
+    }
+
+    if (gridHidden)
+    {
+        gridHidden = false;
+        drawnDirty = true;
+    }
+
+    std::tuple<float, float, float> rootCenter = closestCenter();
+    uint64_t key = getChunkKey(rootCenter, 0, 1);
+
+    // Same root: Update the drawn tree incrementally
+    if (root != ChunkTree::none && key == rootKey)
+    {
+        if (newRoot != ChunkTree::none) { deleteTree(newRoot); newRoot = ChunkTree::none; }
+        updateDrawnTree();
+        return;
+    }
+
+    // New root: Build a new tree, which replaces the drawn one once it's loaded
+    if (newRoot != ChunkTree::none && key != newRootKey) { deleteTree(newRoot); newRoot = ChunkTree::none; }
+
+    if (newRoot == ChunkTree::none)
+    {
+        newRoot = tree.addRoot(getChunk(rootCenter, rootCellSize, 0, 1));
+        newRootKey = key;
+    }
+
+    updateHiddenTree(newRoot, progressiveActivation && root == ChunkTree::none);     // A new tree replacing a drawn one is swapped in at once (see updateTree_load())
+}
+
+void DynamicGrid::updateTree_load()
+{
+    treeChanged = false;
+    if (root == ChunkTree::none && newRoot == ChunkTree::none) return;
+
+    if (scheduler)
+        scheduler->dispatch(renderer->getTimer().getFrameCounter());
+
+    if (renderChunks())                                             // Upload chunks whose terrain is already computed
+        drawnDirty = true;                                          // Leaves that became visible are drawn once they are rendered
+
+    bool changed = false;
+
+    // Replace the drawn tree when the new one is ready. If there's no drawn tree, the new one is drawn as soon as its root chunk is ready, and then refined like splitting nodes.
+    if (newRoot != ChunkTree::none && (root == ChunkTree::none && progressiveActivation ? isReady(tree[newRoot].element) : isSubtreeReady(newRoot)))
     {
-        nextIt = it;
-        nextIt++;
-        targetDist = it->second->getHorChunkSide() * relDist;
-        chunk = it->second;
-        
-        if(chunk->isVisible && (!chunk->modelOrdered || !chunk->model->activeInstances))    // traverse chunks that are not in the active tree
+        if (root != ChunkTree::none) deleteTree(root);
+        else if (!tree.isLeaf(newRoot) && progressiveActivation)
         {
-            center = getChunkCenter(it->second);    // it->second->getGroundCenter();
-            distVec.x = center.x - camPosNow.x;
-            distVec.y = center.y - camPosNow.y;
-            distVec.z = center.z - camPosNow.z;
-            targetSqrDist = targetDist * targetDist;
+            tree[newRoot].state = NodeState::splitting;
+            pendingNodes.push_back(newRoot);
+        }
+
+        root = newRoot;
+        rootKey = newRootKey;
+        newRoot = ChunkTree::none;
+        changed = true;
+    }
+
+    // Complete the splits and merges whose chunks are ready. A split is completed when its 4 children are ready, and the children that are split start splitting in turn (refinement is progressive, and each subtree is activated on its own).
+    for (size_t i = 0; i < pendingNodes.size(); )
+    {
+        uint32_t node = pendingNodes[i];
 
-            if ((distVec.x * distVec.x + distVec.y * distVec.y + distVec.z * distVec.z) > targetSqrDist)
+        if (tree[node].state == NodeState::splitting)
+        {
+            if (progressiveActivation)
             {
-                if(chunks[it->first]->modelOrdered) chunks[it->first]->deleteModel();
-                delete chunks[it->first];
-                chunks.erase(it->first);
+                if (!isReady(tree[tree.getChild(node, 0)].element) || !isReady(tree[tree.getChild(node, 1)].element) || !isReady(tree[tree.getChild(node, 2)].element) || !isReady(tree[tree.getChild(node, 3)].element)) { i++; continue; }
+                activateChildren(node);
             }
+            else if (!isSubtreeReady(tree.getChild(node, 0)) || !isSubtreeReady(tree.getChild(node, 1)) || !isSubtreeReady(tree.getChild(node, 2)) || !isSubtreeReady(tree.getChild(node, 3))) { i++; continue; }
+
+            tree[node].state = NodeState::split;
+        }
+        else    // merging
+        {
+            if (!isReady(tree[node].element)) { i++; continue; }
+            removeChildren(node);
+            tree[node].state = NodeState::leaf;
+        }
+
+        pendingNodes[i] = pendingNodes.back();
+        pendingNodes.pop_back();
+        changed = true;
+    }
+
+    if (changed)
+    {
+        drawnNodes.clear();
+        tree.indexNodes(root, [this](uint32_t node) { return isDrawnLeaf(node); }, drawnNodes);
+        treeChanged = true;
+
+        updateSideDepths();
+        updateDrawnChunks();
+        evictChunks();
+        treeSettled = false;                                        // Parents of merged nodes may be merged now, and loadingChunks may contain evicted chunks
+    }
+    else if (drawnDirty)
+        updateDrawnChunks();
+}
+
+bool DynamicGrid::wantsSplit(uint32_t node)
+{
+    size_t depth = tree[node].depth;
+    if (depth < minLevel) return true;
+    if (depth >= numLevels - 1) return false;
+
+    Chunk* chunk = tree[node].element;
+    glm::vec3 gCenter = getChunkCenter(chunk);
+    float dist = glm::distance(camPos, gCenter);
+
+    // Leaves are split a bit after crossing the threshold, and split nodes are merged a bit after crossing it back
+    bool isSplit = (tree[node].state == NodeState::split || tree[node].state == NodeState::splitting);
+    float band = isSplit ? 1 + lodHysteresis : 1 - lodHysteresis;
+    bool splitByDist = dist < chunk->getHorChunkSide() * distMultiplier * band;
+
+    float error = (sseFactor ? getNodeError(node) : -1);
+    if (error < 0) return splitByDist;
+
+    // Projected error (pixels) = error * sseFactor / dist
+    bool splitBySSE = error * sseFactor * band > maxPixelError * std::max(dist, 0.001f);
+
+    if (splitBySSE != splitByDist)
+        (splitBySSE ? sseFiner : sseCoarser)++;
+
+    return splitBySSE;
+}
+
+float DynamicGrid::getNodeError(uint32_t node)
+{
+    Chunk* chunk = tree[node].element;
+
+    // Exact: Children's deviation from this chunk. It's kept for when the node becomes a leaf again.
+    if (!tree.isLeaf(node))
+    {
+        float error = 0;
+
+        for (unsigned i = 0; i < 4; i++)
+        {
+            Chunk* child = tree[tree.getChild(node, i)].element;
+            if (child->terrainState != TerrainState::computed) { error = -1; break; }
+            error = std::max(error, child->geometricError);
         }
 
-        it = nextIt;
+        if (error >= 0) chunk->detailError = error;
+    }
+
+    if (chunk->detailError >= 0) return chunk->detailError;
+
+    // Estimate: Terrain detail roughly halves with each level (like noise octaves)
+    if (chunk->terrainState == TerrainState::computed) return chunk->geometricError / 2;
+
+    return -1;
+}
+
+void DynamicGrid::updateDrawnTree()
+{
+    mergeCandidates.clear();
+
+    tree.traverse(root, [this](uint32_t node)
+    {
+        Chunk* chunk = tree[node].element;
+        bool split = wantsSplit(node);
+
+        switch (tree[node].state)
+        {
+        case NodeState::leaf:
+            if (!split || !isVisible(chunk))        // Culled leaves aren't split
+            {
+                requireChunk(chunk);
+                return false;
+            }
+
+            splitNode(node);
+            tree[node].state = NodeState::splitting;
+            [[fallthrough]];
+
+        case NodeState::splitting:
+            if (split)          // Children subtrees are prepared while the node is drawn
+            {
+                requireChunk(chunk);
+                pendingNodes.push_back(node);
+                for (unsigned i = 0; i < 4; i++)
+                    updateHiddenTree(tree.getChild(node, i), progressiveActivation);
+            }
+            else                // Cancel split (the node is still drawn)
+            {
+                removeChildren(node);
+                tree[node].state = NodeState::leaf;
+                requireChunk(chunk);
+            }
+            return false;
+
+        case NodeState::split:
+            if (!split) mergeCandidates.push_back(node);        // Checked once its children are updated
+            return true;
+
+        case NodeState::merging:
+            if (split)          // Cancel merge (children are still drawn)
+            {
+                tree[node].state = NodeState::split;
+                return true;
+            }
+
+            // Children are drawn until the node's chunk is ready, so only their visibility is updated
+            requireChunk(chunk);
+            pendingNodes.push_back(node);
+            for (unsigned i = 0; i < 4; i++)
+                requireChunk(tree[tree.getChild(node, i)].element);
+            return false;
+        }
+
+        return false;
+    });
+
+    // Merge only when all children are leaves (deeper nodes are merged first). In reverse preorder, children come before their parents.
+    for (auto it = mergeCandidates.rbegin(); it != mergeCandidates.rend(); it++)
+    {
+        uint32_t node = *it;
+
+        if (tree[tree.getChild(node, 0)].state != NodeState::leaf || tree[tree.getChild(node, 1)].state != NodeState::leaf || tree[tree.getChild(node, 2)].state != NodeState::leaf || tree[tree.getChild(node, 3)].state != NodeState::leaf)
+        {
+            treeSettled = false;
+            continue;
+        }
+
+        tree[node].state = NodeState::merging;
+        requireChunk(tree[node].element);
+        pendingNodes.push_back(node);
+    }
+}
+
+void DynamicGrid::updateHiddenTree(uint32_t node, bool progressive)
+{
+    tree.traverse(node, [this, progressive](uint32_t node)
+    {
+        bool split = wantsSplit(node) && isVisible(tree[node].element);     // Culled nodes aren't split
+
+        if (!split)
+        {
+            removeChildren(node);
+            tree[node].state = NodeState::leaf;
+            requireChunk(tree[node].element);
+            return false;
+        }
+
+        if (progressive)
+            requireChunk(tree[node].element);      // Split nodes are drawn while their children load (see updateTree_load())
+
+        if (tree.isLeaf(node))
+            splitNode(node);
+
+        tree[node].state = NodeState::split;
+        return true;
+    });
+}
+
+void DynamicGrid::splitNode(uint32_t node)
+{
+    Chunk* chunk = tree[node].element;
+
+    unsigned depth = tree[node].depth + 1;
+    std::tuple<float, float, float> subBaseCenters[4];
+    chunk->getSubBaseCenters(subBaseCenters);
+    float halfSide = chunk->getHorBaseSide() / 2;
+    glm::vec4 chunkIDs = getChunkIDs(chunk->chunkID, depth);
+
+    // Morton order (row 0 is +y)
+    Chunk* children[4] = {
+        getChunk(subBaseCenters[0], halfSide, depth, chunkIDs[0]),      // - x + y
+        getChunk(subBaseCenters[1], halfSide, depth, chunkIDs[1]),      // + x + y
+        getChunk(subBaseCenters[2], halfSide, depth, chunkIDs[2]),      // - x - y
+        getChunk(subBaseCenters[3], halfSide, depth, chunkIDs[3]) };    // + x - y
+
+    tree.split(node, children);
+}
+
+void DynamicGrid::removeChildren(uint32_t node)
+{
+    tree.removeChildren(node, [](Chunk* chunk) { chunk->numNodes--; });
+}
+
+void DynamicGrid::deleteTree(uint32_t root)
+{
+    tree.removeTree(root, [](Chunk* chunk) { chunk->numNodes--; });
+}
+
+void DynamicGrid::requireChunk(Chunk* chunk)
+{
+    bool visible = isVisible(chunk);
+    if (visible != chunk->isVisible)
+    {
+        chunk->isVisible = visible;
+        drawnDirty = true;
+    }
+
+    if (!visible)
+    {
+        culledChunks++;
+        return;
+    }
+
+    if (chunk->terrainState == TerrainState::computed)
+    {
+        heightMin = std::min(heightMin, chunk->minHeight);
+        heightMax = std::max(heightMax, chunk->maxHeight);
+    }
+
+    chunk->priority = chunk->getHorChunkSide() / std::max(glm::distance(camPos, getChunkCenter(chunk)), 0.001f);
+
+    if (chunk->terrainState == TerrainState::none)
+        orderTerrain(chunk);
+
+    if (!chunk->modelOrdered && chunk->batchSlot == VertexArena::noSlot)
+        loadingChunks.push_back(chunk);
+}
+
+void DynamicGrid::terrainComputed(Chunk* chunk)
+{
+    chunk->terrainState = TerrainState::computed;
+    computedChunks++;
+    publish(ChunkEvent::generated, chunk);
+}
+
+void DynamicGrid::publish(ChunkEvent::Type type, const Chunk* chunk)
+{
+    if (events) events->publish({ type, this, chunk, chunk->depth, chunk->chunkID });
+}
+
+void DynamicGrid::orderTerrain(Chunk* chunk)
+{
+    if (scheduler)
+    {
+        chunk->terrainState = TerrainState::queued;
+        scheduler->request(this, chunk);
+        return;
+    }
+
+    if (!threadPool)
+    {
+        chunk->computeTerrain(false);
+        terrainComputed(chunk);
+        return;
+    }
+
+    chunk->terrainState = TerrainState::computing;
+    pendingJobs++;
+
+    threadPool->submit([this, chunk]()
+    {
+        chunk->computeTerrain(false);
+        terrainComputed(chunk);
+        pendingJobs--;
+    });
+}
+
+bool DynamicGrid::renderChunks()
+{
+    std::vector<Chunk*> newChunks;
+
+    for (size_t i = 0; i < loadingChunks.size(); )
+    {
+        Chunk* chunk = loadingChunks[i];
+
+        if (chunk->modelOrdered || chunk->batchSlot != VertexArena::noSlot || chunk->terrainState == TerrainState::computed)
+        {
+            if (!chunk->modelOrdered && chunk->batchSlot == VertexArena::noSlot)
+                newChunks.push_back(chunk);
+
+            loadingChunks[i] = loadingChunks.back();
+            loadingChunks.pop_back();
+        }
+        else i++;
+    }
+
+    if (newChunks.empty()) return false;
+
+    // Upload the most important chunks first, within the frame budget. The rest wait for the next frames.
+    if (scheduler)
+    {
+        std::sort(newChunks.begin(), newChunks.end(), [](const Chunk* a, const Chunk* b) { return a->priority > b->priority; });
+
+        size_t quota = scheduler->getUploadQuota();
+        if (quota < newChunks.size())
+        {
+            loadingChunks.insert(loadingChunks.end(), newChunks.begin() + quota, newChunks.end());
+            newChunks.resize(quota);
+        }
+
+        if (newChunks.empty()) return false;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (batchShaders.size())
+    {
+        if (!batch)
+        {
+            glm::vec3 axis = newChunks[0]->majorAxis;
+            std::string batchName = std::string("chunkBatch_") + "[" + std::to_string((int)axis.x) + "," + std::to_string((int)axis.y) + "," + std::to_string((int)axis.z) + "]";
+            unsigned capacity = std::max<size_t>(memoryBudget / getChunkMemory(), 1);      // Chunks that fit in the memory budget
+
+            batch = std::make_shared<ChunkBatch>(renderer, batchName, batchShaders, textures, indices, newChunks[0]->getVertexBytes(), capacity, numLights, transparency);
+        }
+
+        batch->addChunks(newChunks);
+    }
+
+    for (Chunk* chunk : newChunks)
+    {
+        if (chunk->batchSlot == VertexArena::noSlot)      // Not batched (no batch, batch is full, or vertex format not supported)
+        {
+            if (!vertexArena)
+                vertexArena = std::make_shared<VertexArena>(chunk->getVertexBytes(), chunk->getVertexBytes() / chunk->getNumVertex(), arenaSlotsPerPage);
+
+            chunk->render(shaders, textures, indices, vertexArena, numLights, transparency);
+            renderer->setRenders(chunk->model, 0);
+        }
+
+        uploadedBytes += chunk->getVertexBytes();
+        publish(ChunkEvent::uploaded, chunk);
+    }
+
+    if (scheduler)
+        scheduler->chargeUploads(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count(), newChunks.size());
+
+    return true;
+}
+
+bool DynamicGrid::isReady(Chunk* chunk)
+{
+    if (!chunk->isVisible) return true;
+
+    if (chunk->batchSlot != VertexArena::noSlot)
+        return batch->isReady();
+
+    return chunk->modelOrdered && chunk->model->fullyConstructed;
+}
+
+bool DynamicGrid::isSubtreeReady(uint32_t node)
+{
+    bool ready = true;
+
+    tree.traverse(node, [&](uint32_t i)
+    {
+        if (!ready) return false;
+        if (tree.isLeaf(i)) ready = isReady(tree[i].element);
+        return true;
+    });
+
+    return ready;
+}
+
+bool DynamicGrid::isDrawnLeaf(uint32_t node) { return tree.isLeaf(node) || tree[node].state == NodeState::splitting; }
+
+void DynamicGrid::activateChildren(uint32_t node)
+{
+    for (unsigned i = 0; i < 4; i++)
+    {
+        uint32_t child = tree.getChild(node, i);
+        if (tree.isLeaf(child)) continue;
+
+        tree[child].state = NodeState::splitting;       // Drawn until its own children are ready
+        pendingNodes.push_back(child);
+    }
+}
+
+void DynamicGrid::updateDrawnChunks()
+{
+    std::vector<Chunk*> newDrawnChunks, hidden, shown;
+    if (root != ChunkTree::none && !gridHidden) getDrawnChunks(root, newDrawnChunks);
+    std::sort(newDrawnChunks.begin(), newDrawnChunks.end());
+
+    std::set_difference(drawnChunks.begin(), drawnChunks.end(), newDrawnChunks.begin(), newDrawnChunks.end(), std::back_inserter(hidden));
+    for (Chunk* chunk : hidden)
+    {
+        setDrawn(chunk, false);
+        publish(ChunkEvent::deactivated, chunk);
+    }
+
+    for (Chunk* chunk : newDrawnChunks)
+        setDrawn(chunk, true);
+
+    if (events)
+    {
+        std::set_difference(newDrawnChunks.begin(), newDrawnChunks.end(), drawnChunks.begin(), drawnChunks.end(), std::back_inserter(shown));
+        for (Chunk* chunk : shown)
+            publish(ChunkEvent::activated, chunk);
+    }
+
+    drawnChunks.swap(newDrawnChunks);       // Sorted (by address), so the next update can compare them
+    drawnDirty = false;
+}
+
+void DynamicGrid::getDrawnChunks(uint32_t node, std::vector<Chunk*>& dest)
+{
+    tree.traverse(node, [&](uint32_t i)
+    {
+        if (!isDrawnLeaf(i)) return true;
+
+        Chunk* chunk = tree[i].element;
+        if (chunk->isVisible && (chunk->modelOrdered || chunk->batchSlot != VertexArena::noSlot))
+            dest.push_back(chunk);
+        return false;
+    });
+}
+
+void DynamicGrid::getBounds(const Chunk* chunk, glm::vec3& center, float& radius)
+{
+    if (chunk->terrainState == TerrainState::computed)
+    {
+        center = chunk->boundCenter;
+        radius = chunk->boundRadius;
+        return;
     }
+
+    center = chunk->getGroundCenter();
+    radius = 0.75f * chunk->getHorChunkSide() + std::max(-heightMin, heightMax);     // Half diagonal + heights
 }
 
-void DynamicGrid::updateUBOs(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos, const LightSet& lights, float time, float groundHeight)
+bool DynamicGrid::inFrustum(const glm::vec3& center, float radius)
 {
-    this->camPos = camPos;
+    if (!useFrustum) return true;
 
-    for (Chunk* chunk : visibleLeafChunks[activeTree])
-        chunk->updateUBOs(view, proj, camPos, lights, time, groundHeight);
-}
+    for (const glm::vec4& plane : frustumPlanes)
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
 
-void DynamicGrid::toLastDraw() { putToLastDraw(activeTree); }
+    return true;
+}
 
-void DynamicGrid::putToLastDraw(unsigned treeIndex)
+void DynamicGrid::setDrawn(Chunk* chunk, bool drawn)
 {
-    for (Chunk* chunk : visibleLeafChunks[treeIndex])
-        renderer->toLastDraw(chunk->model);
+    if (chunk->batchSlot != VertexArena::noSlot)
+        batch->setDrawn(chunk, drawn);
+    else
+        renderer->setRenders(chunk->model, drawn);
 }
 
-void DynamicGrid::updateChunksSideDepths_help(std::list<QuadNode<Chunk*>*>& queue, QuadNode<Chunk*>* currentNode)
-{   
+void DynamicGrid::updateSideDepths()
+{
     /*
-        Setting side depths of a chunk requires knowing side depths of neighbor chunks, so we use breath-first search.
-        Each step updates some chunks' side depths: current chunk (right & down), right chunk (left), lower chunk (up).
-        When a depth level starts to be checked, the whole depth level is already in the queue.
-        Due to the way the tree was built, the traversal goes left-right up-down through the grid.
-        Convention: At the beginning, all side depths are 0, but root chunk ones are 1000 (flag for grid boundaries).
-        Process:
-            - Get right and lower node
-            - If any of the 3 nodes is leaf, update corresponding side depths (if they are 0).
-            - Compare adjacent side depths between the 3 of them and update them if required.
-            - Pass side depths from current chunk to its children (if it's not leaf).
+        For each side of each drawn leaf, the neighbour cell of the same depth is looked up by its locational code (if it's not there, its parent, and so on):
+            - Coarser neighbour (drawn leaf of lower depth): The side must fit it (depth difference).
+            - Neighbour of the same depth or finer: 0 (the finer one fits this side).
+            - Cell out of the grid: getBorderSideDepth().
     */
 
-    Chunk * currentChunk = currentNode->getElement(), * rightChunk = nullptr, * lowerChunk = nullptr;
-    QuadNode<Chunk*>* rightNode = nullptr, * lowerNode = nullptr;
-    unsigned sideSize = pow(2, currentChunk->depth);
+    if (root == ChunkTree::none) return;
 
-    // Get right node
-    for (auto iter = queue.begin(); iter != queue.end(); iter++)
+    const int offsets[4][2] = { { 1, 0 }, { -1, 0 }, { 0, -1 }, { 0, 1 } };     // (column, row) offsets of the neighbours at right, left, up, down (row 0 is +y)
+
+    tree.traverse(root, [&](uint32_t node)
     {
-        if ((*iter)->getElement()->chunkID == currentChunk->chunkID + 1 && (*iter)->getElement()->depth == currentChunk->depth)
-        {
-            rightNode = *iter;
-            rightChunk = rightNode->getElement();
-            break;
-        }
-        else if ((*iter)->getElement()->depth != currentChunk->depth)
-            break;
-    }
+        if (!isDrawnLeaf(node)) return true;
 
-    // Get lower node
-    for (auto iter = queue.begin(); iter != queue.end(); iter++)
-        if ((*iter)->getElement()->chunkID == currentChunk->chunkID + sideSize && (*iter)->getElement()->depth == currentChunk->depth)
+        Chunk* chunk = tree[node].element;
+        unsigned depth = tree[node].depth;
+        uint32_t numCells = 1u << depth, x, y;
+        mortonDecode(tree[node].code, x, y);
+
+        for (unsigned s = 0; s < 4; s++)
         {
-            lowerNode = *iter;
-            lowerChunk = lowerNode->getElement();
-            break;
+            uint32_t nx = x + offsets[s][0], ny = y + offsets[s][1];       // -1 wraps around, so it's out of the grid too
+
+            if (nx >= numCells || ny >= numCells)
+                chunk->sideDepths[s] = getBorderSideDepth(node, s);
+            else if ((nx >> 1) == (x >> 1) && (ny >> 1) == (y >> 1))       // Sibling: same depth or finer
+                chunk->sideDepths[s] = 0;
+            else
+                chunk->sideDepths[s] = depth - getDrawnDepth(depth, mortonEncode(nx, ny));
         }
-        else if ((*iter)->getElement()->depth != currentChunk->depth)
-            break;
-    
-    // Modify side depths
-    if (currentNode->isLeaf())
+
+        return false;
+    });
+}
+
+unsigned DynamicGrid::getDrawnDepth(unsigned depth, uint64_t code) const
+{
+    // The first cell found (this one or an ancestor) is in the drawn tree. An ancestor must be a drawn leaf, since its child on the way isn't there.
+    uint64_t key = locationalCode(depth, code);
+
+    for (unsigned d = depth + 1; d-- > 0; key >>= 2)
+        if (drawnNodes.find(key) != LocationalIndex::none)
+            return d;
+
+    return depth;
+}
+
+bool DynamicGrid::drawnTreeChanged() const { return treeChanged; }
+
+float DynamicGrid::getBorderSideDepth(uint32_t, unsigned) { return 1000; }
+
+Chunk* DynamicGrid::getChunk(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID)
+{
+    uint64_t key = getChunkKey(center, depth, chunkID);
+    auto it = chunks.find(key);
+
+    if (it == chunks.end())     // if chunk was not created previously
     {
-        if (!currentChunk->sideDepths[side::right]) currentChunk->sideDepths[side::right] = currentChunk->depth;
-        if (!currentChunk->sideDepths[side::down]) currentChunk->sideDepths[side::down] = currentChunk->depth;
+        registryMisses++;
+        Chunk* chunk = newChunk(center, sideLength, depth, chunkID);
+        lru.push_front(key);
+        it = chunks.insert({ key, { chunk, lru.begin() } }).first;
+        chunkIdCount[chunkID]++;
     }
-
-    if (rightNode)
+    else
     {
-        if (rightNode->isLeaf() && !rightChunk->sideDepths[side::left])
-            rightChunk->sideDepths[side::left] = currentChunk->depth;
-
-        if (currentChunk->sideDepths[side::right] && !rightChunk->sideDepths[side::left])
-            rightChunk->sideDepths[side::left] = currentChunk->sideDepths[side::right];
-        if (!currentChunk->sideDepths[side::right] && rightChunk->sideDepths[side::left])
-            currentChunk->sideDepths[side::right] = rightChunk->sideDepths[side::left];
+        registryHits++;
+        lru.splice(lru.begin(), lru, it->second.lruPos);      // Move to front (iterators remain valid)
     }
 
-    if (lowerNode)
-    {
-        if (lowerNode->isLeaf() && !lowerChunk->sideDepths[side::up])
-            lowerChunk->sideDepths[side::up] = currentChunk->depth;
+    it->second.chunk->numNodes++;
+    return it->second.chunk;
+}
 
-        if (currentChunk->sideDepths[side::down] && !lowerChunk->sideDepths[side::up])
-            lowerChunk->sideDepths[side::up] = currentChunk->sideDepths[side::down];
-        if (!currentChunk->sideDepths[side::down] && lowerChunk->sideDepths[side::up])
-            currentChunk->sideDepths[side::down] = lowerChunk->sideDepths[side::up];
-    }
-    
-    // Pass sides from parent to children
-    if (!currentNode->isLeaf())
-    {
-        currentNode->getA()->getElement()->sideDepths[side::left ] = currentChunk->sideDepths[side::left ];
-        currentNode->getC()->getElement()->sideDepths[side::left ] = currentChunk->sideDepths[side::left ];
-        currentNode->getB()->getElement()->sideDepths[side::right] = currentChunk->sideDepths[side::right];
-        currentNode->getD()->getElement()->sideDepths[side::right] = currentChunk->sideDepths[side::right];
-        currentNode->getA()->getElement()->sideDepths[side::up   ] = currentChunk->sideDepths[side::up   ];
-        currentNode->getB()->getElement()->sideDepths[side::up   ] = currentChunk->sideDepths[side::up   ];
-        currentNode->getC()->getElement()->sideDepths[side::down ] = currentChunk->sideDepths[side::down ];
-        currentNode->getD()->getElement()->sideDepths[side::down ] = currentChunk->sideDepths[side::down ];
+void DynamicGrid::evictChunks()
+{
+    size_t chunkMemory = getChunkMemory();
+    auto it = lru.end();
+    Chunk* chunk;
+    uint64_t key;
+
+    // Traverse from the least recently used chunk. Chunks in a tree are skipped.
+    while (chunks.size() * chunkMemory > memoryBudget && it != lru.begin())
+    {
+        it--;
+        chunk = chunks[*it].chunk;
+        if (chunk->numNodes || chunk->terrainState == TerrainState::queued || chunk->terrainState == TerrainState::computing || (chunk->modelOrdered && chunk->model->activeInstances) || (chunk->batchSlot != VertexArena::noSlot && batch->isDrawn(chunk)))
+            continue;
+
+        key = *it;
+        it++;               // removeChunk() invalidates the current iterator
+        removeChunk(key);
+        evictions++;
     }
 }
 
-void DynamicGrid::restartSideDepths(QuadNode<Chunk*>* node)
+void DynamicGrid::removeChunk(uint64_t key)
+{
+    auto it = chunks.find(key);
+    if (it == chunks.end()) return;
+
+    Chunk* chunk = it->second.chunk;
+    if (--chunkIdCount[chunk->chunkID] == 0) chunkIdCount.erase(chunk->chunkID);
+    if (chunk->modelOrdered) chunk->deleteModel();
+    if (chunk->batchSlot != VertexArena::noSlot) batch->removeChunk(chunk);
+    publish(ChunkEvent::evicted, chunk);
+    delete chunk;
+
+    lru.erase(it->second.lruPos);
+    chunks.erase(it);
+}
+
+size_t DynamicGrid::getChunkMemory() const
+{
+    return numSideVertex * numSideVertex * vertexSize * 2;      // Vertex data in CPU and GPU
+}
+
+void DynamicGrid::updateUBOs(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos, const LightSet& lights, float time, float groundHeight)
 {
-    if (!node) return;
+    this->camPos = camPos;
+
+    for (Chunk* chunk : drawnChunks)
+        chunk->updateUBOs(view, proj, camPos, lights, time, groundHeight);
+
+    if (batch)
+        batch->updateUBOs(view, proj, camPos, lights, time, groundHeight, drawnChunks);
+}
 
-    node->getElement()->setSideDepths(0, 0, 0, 0);
+void DynamicGrid::toLastDraw()
+{
+    for (Chunk* chunk : drawnChunks)
+        if (chunk->modelOrdered)
+            renderer->toLastDraw(chunk->model);
 
-    restartSideDepths(node->getA());
-    restartSideDepths(node->getB());
-    restartSideDepths(node->getC());
-    restartSideDepths(node->getD());
+    if (batch) batch->toLastDraw();
 }
 
 glm::vec3 DynamicGrid::getChunkCenter(Chunk* chunk) { return chunk->getGroundCenter(); }
@@ -1041,31 +1849,66 @@ glm::vec4 DynamicGrid::getChunkIDs(unsigned parentID, unsigned depth)
 
 void DynamicGrid::updateVisibilityState() { }
 
-bool DynamicGrid::isVisible(const Chunk* chunk) { return true; }
+bool DynamicGrid::isVisible(const Chunk* chunk)
+{
+    glm::vec3 center;
+    float radius;
+    getBounds(chunk, center, radius);
+
+    return inFrustum(center, radius);
+}
 
 void DynamicGrid::getActiveLeafChunks(std::vector<const Chunk*>& dest, unsigned depth)
 {
-    for (Chunk* chunk : visibleLeafChunks[activeTree])
+    for (Chunk* chunk : drawnChunks)
         if (chunk->depth >= depth)
             dest.push_back(chunk);
 }
 
-bool DynamicGrid::contains(unsigned chunkId)
+bool DynamicGrid::contains(unsigned chunkId) { return chunkIdCount.find(chunkId) != chunkIdCount.end(); }
+
+void DynamicGrid::setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+
+void DynamicGrid::setEventStream(std::shared_ptr<ChunkEventStream> events) { this->events = events; }
+
+unsigned DynamicGrid::numActiveLeafChunks() { return drawnChunks.size(); }
+
+unsigned DynamicGrid::numPendingNodes() { return pendingNodes.size(); }
+
+unsigned DynamicGrid::numChunksOrdered()
 {
+    unsigned count = 0;
+
     for (auto it = chunks.begin(); it != chunks.end(); it++)
-        if (it->second->chunkID == chunkId) return true;
+        if (it->second.chunk->modelOrdered || it->second.chunk->batchSlot != VertexArena::noSlot)
+            count++;
 
-    return false;
+    return count;
 }
 
-unsigned DynamicGrid::numActiveLeafChunks() { return visibleLeafChunks[activeTree].size(); }
+size_t DynamicGrid::getNumSideVertex() const { return numSideVertex; }
 
-unsigned DynamicGrid::numChunksOrdered()
+unsigned DynamicGrid::numCulledChunks() const { return culledChunks; }
+
+float DynamicGrid::getMinHeight() const { return heightMin; }
+
+float DynamicGrid::getMaxHeight() const { return heightMax; }
+
+unsigned DynamicGrid::numCoarserBySSE() const { return sseCoarser; }
+
+unsigned DynamicGrid::numFinerBySSE() const { return sseFiner; }
+
+bool DynamicGrid::isSettled() const
 {
-    unsigned count = 0;
+    return !numLevels || (root != ChunkTree::none && newRoot == ChunkTree::none && treeSettled && pendingNodes.empty() && loadingChunks.empty());
+}
+
+unsigned DynamicGrid::numModels()
+{
+    unsigned count = (batch ? 1 : 0);
 
     for (auto it = chunks.begin(); it != chunks.end(); it++)
-        if (it->second->modelOrdered)
+        if (it->second.chunk->modelOrdered)
             count++;
 
     return count;
@@ -1073,27 +1916,52 @@ unsigned DynamicGrid::numChunksOrdered()
 
 unsigned DynamicGrid::numChunks() { return chunks.size(); }
 
+unsigned DynamicGrid::numChunksComputed() { return computedChunks; }
+
+size_t DynamicGrid::numRegistryHits() const { return registryHits; }
+
+size_t DynamicGrid::numRegistryMisses() const { return registryMisses; }
+
+size_t DynamicGrid::numEvictions() const { return evictions; }
+
+size_t DynamicGrid::getMemoryUsed() const { return chunks.size() * getChunkMemory(); }
+
+size_t DynamicGrid::getUploadedBytes() const { return uploadedBytes; }
+
+uint64_t DynamicGrid::getChunkKey(std::tuple<float, float, float>, unsigned depth, unsigned chunkID)
+{
+    return (uint64_t)depth << 48 | chunkID;
+}
+
 
 // TerrainGrid ----------------------------------------------------------------------
 
 TerrainGrid::TerrainGrid(Renderer* renderer, Noiser* noiseGenerator, size_t rootCellSize, size_t numSideVertex, size_t numLevels, size_t minLevel, float distMultiplier, bool transparency)
-    : DynamicGrid(glm::vec3(0.1f, 0.1f, 0.1f), renderer, 0, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, transparency), noiseGen(noiseGenerator)
+    : DynamicGrid(glm::vec3(0.1f, 0.1f, 0.1f), renderer, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, transparency), noiseGen(noiseGenerator)
 { }
 
-QuadNode<Chunk*>* TerrainGrid::getNode(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID)
+Chunk* TerrainGrid::newChunk(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID)
+{
+    return new PlainChunk(
+        *renderer, 
+        noiseGen, 
+        glm::vec3(std::get<0>(center), std::get<1>(center), std::get<2>(center)), 
+        sideLength / (numSideVertex - 1), 
+        numSideVertex, 
+        numSideVertex, 
+        depth,
+        chunkID);
+}
+
+uint64_t TerrainGrid::getChunkKey(std::tuple<float, float, float> center, unsigned depth, unsigned)
 {
-    if (chunks.find(center) == chunks.end())
-        chunks[center] = new PlainChunk(
-            *renderer, 
-            noiseGen, 
-            glm::vec3(std::get<0>(center), std::get<1>(center), std::get<2>(center)), 
-            sideLength / (numSideVertex - 1), 
-            numSideVertex, 
-            numSideVertex, 
-            depth,
-            chunkID);
+    const uint64_t mask = (1 << 24) - 1;
+    float cellSize = rootCellSize / std::pow(2.f, depth);     // Chunk centers are multiples of half this size
 
-    return new QuadNode<Chunk*>(chunks[center]);
+    return
+        (uint64_t)depth << 48 |
+        ((uint64_t)std::lround(2 * std::get<0>(center) / cellSize) & mask) << 24 |
+        ((uint64_t)std::lround(2 * std::get<1>(center) / cellSize) & mask);
 }
 
 std::tuple<float, float, float> TerrainGrid::closestCenter()
@@ -1110,29 +1978,186 @@ std::tuple<float, float, float> TerrainGrid::closestCenter()
 // PlanetGrid ----------------------------------------------------------------------
 
 PlanetGrid::PlanetGrid(Renderer* renderer, std::shared_ptr<Noiser> noiseGenerator, size_t rootCellSize, size_t numSideVertex, size_t numLevels, size_t minLevel, float distMultiplier, float radius, glm::vec3 nucleus, glm::vec3 cubePlane, glm::vec3 cubeSideCenter, bool transparency)
-    : DynamicGrid(glm::vec3(0.1f, 0.1f, 0.1f), renderer, 0, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, transparency), 
-    noiseGen(noiseGenerator), radius(radius), nucleus(nucleus), cubePlane(cubePlane), cubeSideCenter(cubeSideCenter) 
-{ }
+    : DynamicGrid(glm::vec3(0.1f, 0.1f, 0.1f), renderer, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, transparency), 
+    noiseGen(noiseGenerator), skipFineOctaves(false), radius(radius), nucleus(nucleus), cubePlane(cubePlane), cubeSideCenter(cubeSideCenter), occluderRadius(radius), horizonCulling(false), horizonAxis(0, 0, 1), horizonPlane(0), horizonCone(0)
+{
+    if (noiseGen) vertexSize = sizeof(PlanetVertex);      // PlanetChunk uses the compact format (SphereChunk doesn't)
+
+    if (cubePlane.x != 0) face = (cubePlane.x > 0 ? 0 : 1);
+    else if (cubePlane.y != 0) face = (cubePlane.y > 0 ? 2 : 3);
+    else face = (cubePlane.z > 0 ? 4 : 5);
+
+    PlanetPatch::getFaceAxes(cubePlane, xAxis, yAxis);
+    for (PlanetGrid*& neighbour : neighbourFaces) neighbour = nullptr;
+
+    float deepestStride = rootCellSize / ((numSideVertex - 1) * std::pow(2.f, numLevels - 1));
+
+    if (noiseGen)
+    {
+        heightCache = std::make_shared<HeightCache>(
+            cubeSideCenter, 
+            deepestStride, 
+            numSideVertex * numSideVertex * 128);                                       // Up to 128 chunks
+
+        // Skip octaves only if the deepest chunks skip some too (their vertex spacing on the sphere is up to deepestStride * radius / sideDist, at the face's center)
+        skipFineOctaves = (noiseGen->getLodFootprint(deepestStride * radius / glm::length(cubeSideCenter)) > 0);
+    }
+}
 
 float PlanetGrid::getRadius() { return radius; }
 
-QuadNode<Chunk*>* PlanetGrid::getNode(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID)
-{
-    if (chunks.find(center) == chunks.end())
-        chunks[center] = new PlanetChunk(
-            *renderer, 
-            noiseGen, 
-            glm::vec3(std::get<0>(center), std::get<1>(center), std::get<2>(center)), 
-            sideLength / (numSideVertex - 1), 
-            numSideVertex, 
-            numSideVertex, 
-            radius, 
-            nucleus, 
-            cubePlane, 
-            depth,
-            chunkID);
-    
-    return new QuadNode<Chunk*>(chunks[center]);
+void PlanetGrid::setHeightCacheSize(size_t maxSamples) { if (heightCache) heightCache->setMaxSamples(maxSamples); }
+
+void PlanetGrid::setOccluderRadius(float occluderRadius) { this->occluderRadius = occluderRadius; }
+
+void PlanetGrid::setDiskCache(std::shared_ptr<ChunkDiskCache> diskCache) { this->diskCache = diskCache; }
+
+void PlanetGrid::setNeighbourFaces(PlanetGrid* const faces[6])
+{
+    // The face across each edge is the one whose normal points in the direction of that side
+    glm::vec3 sideDirs[4] = { xAxis, -xAxis, yAxis, -yAxis };     // right, left, up, down
+
+    for (unsigned s = 0; s < 4; s++)
+    {
+        neighbourFaces[s] = nullptr;
+
+        for (unsigned i = 0; i < 6; i++)
+            if (faces[i] && faces[i]->cubePlane == sideDirs[s])
+                neighbourFaces[s] = faces[i];
+    }
+}
+
+float PlanetGrid::getBorderSideDepth(uint32_t node, unsigned side)
+{
+    PlanetGrid* other = neighbourFaces[side];
+    if (!other) return 1000;
+
+    /*
+        Cube coordinates in half cells of the node's depth (integers), so the cube spans [-N, N] per axis (N = 2^depth).
+        The neighbour cell's center is the node's center moved half a cell towards the edge, and then half a cell along the other face (folding over the edge).
+        Its cell coordinates in the other face are found projecting that center on the other face's axes.
+    */
+    auto toInt = [](const glm::vec3& v) { return glm::ivec3((int)v.x, (int)v.y, (int)v.z); };
+    auto dot = [](const glm::ivec3& a, const glm::ivec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; };
+
+    unsigned depth = tree[node].depth;
+    int numCells = 1 << depth;
+    uint32_t x, y;
+    mortonDecode(tree[node].code, x, y);
+
+    glm::ivec3 normal = toInt(cubePlane), xDir = toInt(xAxis), yDir = toInt(yAxis);
+    glm::ivec3 sideDirs[4] = { xDir, -xDir, yDir, -yDir };        // right, left, up, down (row 0 is +y)
+    glm::ivec3 center = numCells * normal + (2 * (int)x + 1 - numCells) * xDir + (numCells - 1 - 2 * (int)y) * yDir;
+    glm::ivec3 neighbourCenter = center + sideDirs[side] - normal;
+
+    int u = dot(neighbourCenter, toInt(other->xAxis));
+    int v = dot(neighbourCenter, toInt(other->yAxis));
+    uint32_t nx = (u + numCells - 1) / 2, ny = (numCells - 1 - v) / 2;
+
+    return depth - other->getDrawnDepth(depth, mortonEncode(nx, ny));
+}
+
+bool PlanetGrid::getGroundHeight(const glm::vec3& dir, float maxError, float& height)
+{
+    uint32_t top = (root != ChunkTree::none ? root : newRoot);
+    if (top == ChunkTree::none || tree[top].element->terrainState != TerrainState::computed) return false;
+
+    // Cell of the deepest level that contains the point
+    glm::vec2 uv = getFaceCoords(dir, cubeSideCenter, cubePlane, xAxis, yAxis, rootCellSize, nucleus);
+    unsigned maxDepth = numLevels - 1;
+    uint32_t numCells = 1u << maxDepth;
+    uint64_t code = mortonEncode(std::min((uint32_t)(uv.x * numCells), numCells - 1), std::min((uint32_t)(uv.y * numCells), numCells - 1));
+
+    // Descend while the child that covers the point is computed
+    uint32_t node = tree.find(top, maxDepth, code, [&](uint32_t node)
+    {
+        uint32_t child = tree.getChild(node, (code >> 2 * (maxDepth - tree[node].depth - 1)) & 3);
+        return tree[child].element->terrainState != TerrainState::computed;
+    });
+
+    unsigned depth = tree[node].depth;
+    if (depth < maxDepth)
+    {
+        float error = getNodeError(node);
+        if (error < 0 || error > maxError) return false;
+    }
+
+    // Grid coordinates in the chunk (vertex rows grow along yAxis, cell rows along -yAxis)
+    uint32_t x, y;
+    mortonDecode(code >> 2 * (maxDepth - depth), x, y);
+    float cells = (float)(1u << depth);
+    float numSegments = numSideVertex - 1.f;
+
+    height = tree[node].element->getHeight(
+        (uv.x * cells - x) * numSegments,
+        (1 - (uv.y * cells - y)) * numSegments);
+
+    return true;
+}
+
+uint64_t PlanetGrid::getConfigHash() const
+{
+    uint64_t hash = (noiseGen ? noiseGen->getConfigHash() : 0);
+    if (!hash) return 0;
+
+    float sideDist = glm::length(cubeSideCenter);       // The same for the 6 faces (faces are told apart by the chunk key)
+    hash = hashBytes(&skipFineOctaves, sizeof(skipFineOctaves), hash);    // Coarse chunks differ if they skip octaves
+    hash = hashBytes(&radius, sizeof(radius), hash);
+    hash = hashBytes(&sideDist, sizeof(sideDist), hash);
+    hash = hashBytes(&rootCellSize, sizeof(rootCellSize), hash);
+    hash = hashBytes(&numSideVertex, sizeof(numSideVertex), hash);
+
+    // Noise output at fixed points spread over the sphere (Fibonacci lattice): covers what the parameters don't (combiner and Multinoise callbacks are code)
+    const size_t numProbes = 64;
+    float xs[numProbes], ys[numProbes], zs[numProbes], heights[numProbes];
+    glm::vec3 grads[numProbes];
+    for (size_t i = 0; i < numProbes; i++)
+    {
+        float z = 1 - (2 * i + 1) / (float)numProbes;
+        float r = std::sqrt(1 - z * z), angle = i * 2.39996323f;       // Golden angle
+        xs[i] = radius * r * std::cos(angle);
+        ys[i] = radius * r * std::sin(angle);
+        zs[i] = radius * z;
+    }
+
+    noiseGen->getNoiseGradBatch(xs, ys, zs, heights, grads, numProbes);
+    hash = hashBytes(heights, sizeof(heights), hash);
+    return hashBytes(grads, sizeof(grads), hash);
+}
+
+void PlanetGrid::setSkipFineOctaves(bool enabled) { skipFineOctaves = (noiseGen && enabled); }
+
+bool PlanetGrid::skipsFineOctaves() const { return skipFineOctaves; }
+
+size_t PlanetGrid::numNoiseCalls() const { return heightCache ? heightCache->numNoiseCalls() : 0; }
+
+size_t PlanetGrid::numNoiseRequests() const { return heightCache ? heightCache->numRequested() : 0; }
+
+Chunk* PlanetGrid::newChunk(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID)
+{
+    PlanetChunk* chunk = new PlanetChunk(
+        *renderer, 
+        noiseGen, 
+        glm::vec3(std::get<0>(center), std::get<1>(center), std::get<2>(center)), 
+        sideLength / (numSideVertex - 1), 
+        numSideVertex, 
+        numSideVertex, 
+        radius, 
+        nucleus, 
+        cubePlane, 
+        depth,
+        chunkID,
+        heightCache,
+        skipFineOctaves);
+
+    if (diskCache) chunk->setDiskCache(diskCache, getChunkKey(center, depth, chunkID));
+
+    return chunk;
+}
+
+uint64_t PlanetGrid::getChunkKey(std::tuple<float, float, float>, unsigned depth, unsigned chunkID)
+{
+    return (uint64_t)face << 56 | (uint64_t)depth << 48 | chunkID;
 }
 
 std::tuple<float, float, float> PlanetGrid::closestCenter()
@@ -1142,27 +2167,41 @@ std::tuple<float, float, float> PlanetGrid::closestCenter()
 
 void PlanetGrid::updateVisibilityState()
 {
-    float camDist = glm::length(camPos - nucleus);
-    camDist += 0.15 * radius;               // Small addition for ensuring minimal rendering
-    if (camDist < radius) { dotHorizon = 1; return; }
+    // Occluder: sphere below all the terrain computed so far
+    float occluder = std::min(occluderRadius, radius + std::min(heightMin, 0.f));
+    glm::vec3 nucleusToCam = camPos - nucleus;
+    float camDist = glm::length(nucleusToCam);
 
-    float angle = acos(radius / camDist);
-    float relX = cos(angle) * radius;
-    float relY = sqrt(radius * radius - relX * relX);   //sin(angle) * radius;
+    horizonCulling = (camDist > occluder);
+    if (!horizonCulling) return;
 
-    dotHorizon = glm::dot(
-        glm::normalize(glm::vec3(relX, relY, 0)),
-        glm::normalize(glm::vec3(camDist, 0, 0)));
+    horizonAxis = nucleusToCam / camDist;
+    horizonPlane = occluder * occluder / camDist;
+    horizonCone = asin(occluder / camDist);
 }
 
 bool PlanetGrid::isVisible(const Chunk* chunk)
 {
-    float dotChunk = glm::dot(
-        glm::normalize(((PlanetChunk*)chunk)->getGroundCenter()),
-        glm::normalize(camPos - nucleus));
+    glm::vec3 center;
+    float radius;
+    getBounds(chunk, center, radius);
+
+    return inFrustum(center, radius) && !isOccluded(center, radius);
+}
+
+bool PlanetGrid::isOccluded(const glm::vec3& center, float radius)
+{
+    if (!horizonCulling) return false;
 
-    if (dotChunk > dotHorizon) return true;
-    else return false;
+    // Hidden if the sphere is behind the plane of the horizon circle and inside the shadow cone of the occluder (every ray inside the cone hits the occluder before crossing that plane)
+    if (glm::dot(center - nucleus, horizonAxis) + radius >= horizonPlane) return false;
+
+    glm::vec3 camToCenter = center - camPos;
+    float dist = glm::length(camToCenter);
+    if (dist <= radius) return false;
+
+    float angle = acos(glm::clamp(glm::dot(camToCenter / dist, -horizonAxis), -1.f, 1.f));
+    return angle + asin(radius / dist) < horizonCone;
 }
 
 glm::vec3 PlanetGrid::getChunkCenter(Chunk* chunk)
@@ -1180,22 +2219,19 @@ SphereGrid::SphereGrid(Renderer* renderer, size_t rootCellSize, size_t numSideVe
     : PlanetGrid::PlanetGrid(renderer, nullptr, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, radius, nucleus, cubePlane, cubeSideCenter, transparency)
 { }
 
-QuadNode<Chunk*>* SphereGrid::getNode(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID)
-{
-    if (chunks.find(center) == chunks.end())    // if chunk was not created previously
-        chunks[center] = new SphereChunk(
-            *renderer,
-            glm::vec3(std::get<0>(center), std::get<1>(center), std::get<2>(center)),
-            sideLength / (numSideVertex - 1),
-            numSideVertex,
-            numSideVertex,
-            radius,
-            nucleus,
-            cubePlane,
-            depth,
-            chunkID);
-    
-    return new QuadNode<Chunk*>(chunks[center]);
+Chunk* SphereGrid::newChunk(std::tuple<float, float, float> center, float sideLength, unsigned depth, unsigned chunkID)
+{
+    return new SphereChunk(
+        *renderer,
+        glm::vec3(std::get<0>(center), std::get<1>(center), std::get<2>(center)),
+        sideLength / (numSideVertex - 1),
+        numSideVertex,
+        numSideVertex,
+        radius,
+        nucleus,
+        cubePlane,
+        depth,
+        chunkID);
 }
 
 // Planet ----------------------------------------------------------------------
@@ -1203,8 +2239,15 @@ QuadNode<Chunk*>* SphereGrid::getNode(std::tuple<float, float, float> center, fl
 Planet::Planet(Renderer* renderer, std::shared_ptr<Noiser> noiseGenerator, size_t rootCellSize, size_t numSideVertex, size_t numLevels, size_t minLevel, float distMultiplier, float radius, glm::vec3 nucleus, bool transparency)
     : radius(radius), 
     nucleus(nucleus), 
+    renderer(renderer),
     noiseGen(noiseGenerator),
-    readyForUpdate(false)
+    threadPool(nullptr),
+    scheduler(nullptr),
+    chunkEvents(std::make_shared<ChunkEventStream>()),
+    readyForUpdate(false),
+    heightQueryError(0.1f),
+    heightQueries(0),
+    heightFallbacks(0)
 {
     planetGrid_pZ = new PlanetGrid(renderer, noiseGenerator, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, radius, nucleus, glm::vec3( 0,  0,  1), glm::vec3( 0,  0, 50), transparency);
     planetGrid_nZ = new PlanetGrid(renderer, noiseGenerator, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, radius, nucleus, glm::vec3( 0,  0, -1), glm::vec3( 0,  0,-50), transparency);
@@ -1212,6 +2255,8 @@ Planet::Planet(Renderer* renderer, std::shared_ptr<Noiser> noiseGenerator, size_
     planetGrid_nY = new PlanetGrid(renderer, noiseGenerator, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, radius, nucleus, glm::vec3( 0, -1,  0), glm::vec3( 0,-50,  0), transparency);
     planetGrid_pX = new PlanetGrid(renderer, noiseGenerator, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, radius, nucleus, glm::vec3( 1,  0,  0), glm::vec3( 50, 0,  0), transparency);
     planetGrid_nX = new PlanetGrid(renderer, noiseGenerator, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, radius, nucleus, glm::vec3(-1,  0,  0), glm::vec3(-50, 0,  0), transparency);
+
+    linkFaces();
 }
 
 Planet::~Planet()
@@ -1236,22 +2281,167 @@ void Planet::addResources(const std::vector<ShaderLoader>& shaders, const std::v
     readyForUpdate = true;
 }
 
+void Planet::setThreadPool(std::shared_ptr<ThreadPool> threadPool)
+{
+    this->threadPool = threadPool;
+
+    planetGrid_pZ->setThreadPool(threadPool);
+    planetGrid_nZ->setThreadPool(threadPool);
+    planetGrid_pY->setThreadPool(threadPool);
+    planetGrid_nY->setThreadPool(threadPool);
+    planetGrid_pX->setThreadPool(threadPool);
+    planetGrid_nX->setThreadPool(threadPool);
+}
+
+void Planet::setMemoryBudget(size_t bytes)
+{
+    planetGrid_pZ->setMemoryBudget(bytes / 6);
+    planetGrid_nZ->setMemoryBudget(bytes / 6);
+    planetGrid_pY->setMemoryBudget(bytes / 6);
+    planetGrid_nY->setMemoryBudget(bytes / 6);
+    planetGrid_pX->setMemoryBudget(bytes / 6);
+    planetGrid_nX->setMemoryBudget(bytes / 6);
+}
+
+void Planet::setHeightCacheSize(size_t maxSamples)
+{
+    planetGrid_pZ->setHeightCacheSize(maxSamples);
+    planetGrid_nZ->setHeightCacheSize(maxSamples);
+    planetGrid_pY->setHeightCacheSize(maxSamples);
+    planetGrid_nY->setHeightCacheSize(maxSamples);
+    planetGrid_pX->setHeightCacheSize(maxSamples);
+    planetGrid_nX->setHeightCacheSize(maxSamples);
+}
+
+void Planet::setSkipFineOctaves(bool enabled)
+{
+    planetGrid_pZ->setSkipFineOctaves(enabled);
+    planetGrid_nZ->setSkipFineOctaves(enabled);
+    planetGrid_pY->setSkipFineOctaves(enabled);
+    planetGrid_nY->setSkipFineOctaves(enabled);
+    planetGrid_pX->setSkipFineOctaves(enabled);
+    planetGrid_nX->setSkipFineOctaves(enabled);
+}
+
+bool Planet::skipsFineOctaves() const { return planetGrid_pZ->skipsFineOctaves(); }
+
+void Planet::setDiskCache(const std::string& path, uint64_t version)
+{
+    uint64_t hash = planetGrid_pZ->getConfigHash();
+    if (!hash)
+    {
+        std::cout << "Chunk cache not used (the noise generator has no configuration hash): " << path << std::endl;
+        return;
+    }
+
+    hash = hashBytes(&version, sizeof(version), hash);
+    diskCache = std::make_shared<ChunkDiskCache>(path, hash, PlanetChunk::getDiskRecordSize(planetGrid_pZ->getNumSideVertex(), planetGrid_pZ->getNumSideVertex()));
+    if (!diskCache->isOpen()) diskCache = nullptr;
+
+    planetGrid_pZ->setDiskCache(diskCache);
+    planetGrid_nZ->setDiskCache(diskCache);
+    planetGrid_pY->setDiskCache(diskCache);
+    planetGrid_nY->setDiskCache(diskCache);
+    planetGrid_pX->setDiskCache(diskCache);
+    planetGrid_nX->setDiskCache(diskCache);
+}
+
+void Planet::setBatchShader(const ShaderLoader& vertexShader)
+{
+    planetGrid_pZ->setBatchShader(vertexShader);
+    planetGrid_nZ->setBatchShader(vertexShader);
+    planetGrid_pY->setBatchShader(vertexShader);
+    planetGrid_nY->setBatchShader(vertexShader);
+    planetGrid_pX->setBatchShader(vertexShader);
+    planetGrid_nX->setBatchShader(vertexShader);
+}
+
+void Planet::setScheduler(std::shared_ptr<ChunkScheduler> scheduler)
+{
+    this->scheduler = scheduler;
+
+    planetGrid_pZ->setScheduler(scheduler);
+    planetGrid_nZ->setScheduler(scheduler);
+    planetGrid_pY->setScheduler(scheduler);
+    planetGrid_nY->setScheduler(scheduler);
+    planetGrid_pX->setScheduler(scheduler);
+    planetGrid_nX->setScheduler(scheduler);
+}
+
+void Planet::setScreenSpaceError(float fov, float viewportHeight, float maxPixelError)
+{
+    planetGrid_pZ->setScreenSpaceError(fov, viewportHeight, maxPixelError);
+    planetGrid_nZ->setScreenSpaceError(fov, viewportHeight, maxPixelError);
+    planetGrid_pY->setScreenSpaceError(fov, viewportHeight, maxPixelError);
+    planetGrid_nY->setScreenSpaceError(fov, viewportHeight, maxPixelError);
+    planetGrid_pX->setScreenSpaceError(fov, viewportHeight, maxPixelError);
+    planetGrid_nX->setScreenSpaceError(fov, viewportHeight, maxPixelError);
+}
+
+void Planet::setProgressiveActivation(bool enabled)
+{
+    planetGrid_pZ->setProgressiveActivation(enabled);
+    planetGrid_nZ->setProgressiveActivation(enabled);
+    planetGrid_pY->setProgressiveActivation(enabled);
+    planetGrid_nY->setProgressiveActivation(enabled);
+    planetGrid_pX->setProgressiveActivation(enabled);
+    planetGrid_nX->setProgressiveActivation(enabled);
+}
+
 void Planet::updateState(const glm::vec3& camPos, const glm::mat4& view, const glm::mat4& proj, const LightSet& lights, float frameTime, float groundHeight)
 {
     if (readyForUpdate)
     {
-        planetGrid_pZ->updateTree(camPos, lights.numLights);
-        planetGrid_pZ->updateUBOs(view, proj, camPos, lights, frameTime, groundHeight);
-        planetGrid_nZ->updateTree(camPos, lights.numLights);
-        planetGrid_nZ->updateUBOs(view, proj, camPos, lights, frameTime, groundHeight);
-        planetGrid_pY->updateTree(camPos, lights.numLights);
-        planetGrid_pY->updateUBOs(view, proj, camPos, lights, frameTime, groundHeight);
-        planetGrid_nY->updateTree(camPos, lights.numLights);
-        planetGrid_nY->updateUBOs(view, proj, camPos, lights, frameTime, groundHeight);
-        planetGrid_pX->updateTree(camPos, lights.numLights);
-        planetGrid_pX->updateUBOs(view, proj, camPos, lights, frameTime, groundHeight);
-        planetGrid_nX->updateTree(camPos, lights.numLights);
-        planetGrid_nX->updateUBOs(view, proj, camPos, lights, frameTime, groundHeight);
+        PlanetGrid* grids[6] = { planetGrid_pZ, planetGrid_nZ, planetGrid_pY, planetGrid_nY, planetGrid_pX, planetGrid_nX };
+
+        // Culling: view frustum, and horizon (occluder below the lowest terrain of the 6 faces)
+        float minHeight = 0;
+        for (PlanetGrid* grid : grids)
+            minHeight = std::min(minHeight, grid->getMinHeight());
+
+        for (PlanetGrid* grid : grids)
+        {
+            grid->setFrustum(view, proj);
+            grid->setOccluderRadius(radius + minHeight);
+        }
+
+        // Build trees (each grid only touches its own chunks, so they can be built in parallel)
+        if (threadPool)
+            threadPool->parallelFor(6, [&grids, &camPos, &lights](size_t i) { grids[i]->updateTree_build(camPos, lights.numLights); });
+        else
+            for (PlanetGrid* grid : grids)
+                grid->updateTree_build(camPos, lights.numLights);
+
+        // Load chunks and switch trees (render thread)
+        for (PlanetGrid* grid : grids)
+            grid->updateTree_load();
+
+        // Chunks at a cube edge fit the chunks of the adjacent face, so a face's side depths change when its neighbours' trees change
+        bool changed[6];
+        for (unsigned i = 0; i < 6; i++)
+            changed[i] = grids[i]->drawnTreeChanged();
+
+        for (unsigned i = 0; i < 6; i++)
+            for (unsigned j = 0; j < 6; j++)
+                if (changed[j] && j != i && j != (i ^ 1))       // Every face except itself and the opposite one (i ^ 1) is adjacent
+                {
+                    grids[i]->updateSideDepths();
+                    break;
+                }
+
+        for (PlanetGrid* grid : grids)
+            grid->updateUBOs(view, proj, camPos, lights, frameTime, groundHeight);
+    }
+}
+
+void Planet::linkFaces()
+{
+    PlanetGrid* grids[6] = { planetGrid_pZ, planetGrid_nZ, planetGrid_pY, planetGrid_nY, planetGrid_pX, planetGrid_nX };
+
+    for (PlanetGrid* grid : grids)
+    {
+        grid->setNeighbourFaces(grids);
+        grid->setEventStream(chunkEvents);
     }
 }
 
@@ -1267,6 +2457,8 @@ void Planet::toLastDraw()
 
 std::shared_ptr<Noiser> Planet::getNoiseGen() const { return noiseGen; }
 
+std::shared_ptr<ThreadPool> Planet::getThreadPool() const { return threadPool; }
+
 float Planet::getSphereArea() { return 4 * pi * radius * radius; }
 
 glm::vec3 Planet::getBasicNormal(glm::vec3& camPos) { return glm::normalize(camPos - nucleus); }
@@ -1283,24 +2475,133 @@ bool Planet::contains(unsigned chunkId)
     return false;
 }
 
+bool Planet::isSettled() const
+{
+    const PlanetGrid* grids[6] = { planetGrid_pZ, planetGrid_nZ, planetGrid_pY, planetGrid_nY, planetGrid_pX, planetGrid_nX };
+
+    for (const PlanetGrid* grid : grids)
+        if (!grid->isSettled()) return false;
+
+    return true;
+}
+
+Planet::Counts Planet::getCounts()
+{
+    PlanetGrid* grids[6] = { planetGrid_pZ, planetGrid_nZ, planetGrid_pY, planetGrid_nY, planetGrid_pX, planetGrid_nX };
+    Counts counts{};
+
+    for (PlanetGrid* grid : grids)
+    {
+        counts.chunks += grid->numChunks();
+        counts.orderedChunks += grid->numChunksOrdered();
+        counts.activeLeafChunks += grid->numActiveLeafChunks();
+        counts.computedChunks += grid->numChunksComputed();
+        counts.culledChunks += grid->numCulledChunks();
+        counts.models += grid->numModels();
+        counts.noiseCalls += grid->numNoiseCalls();
+        counts.noiseRequests += grid->numNoiseRequests();
+        counts.registryHits += grid->numRegistryHits();
+        counts.registryMisses += grid->numRegistryMisses();
+        counts.evictions += grid->numEvictions();
+        counts.memory += grid->getMemoryUsed();
+        counts.uploaded += grid->getUploadedBytes();
+        counts.coarserBySSE += grid->numCoarserBySSE();
+        counts.finerBySSE += grid->numFinerBySSE();
+    }
+
+    counts.heightQueries = heightQueries;
+    counts.heightFallbacks = heightFallbacks;
+    return counts;
+}
+
 void Planet::printCounts()
 {
-    unsigned nChunks = planetGrid_pZ->numChunks() + planetGrid_nZ->numChunks() + planetGrid_pY->numChunks() + planetGrid_nY->numChunks() + planetGrid_pX->numChunks() + planetGrid_nX->numChunks();
-    unsigned nOrderedChunks = planetGrid_pZ->numChunksOrdered() + planetGrid_nZ->numChunksOrdered() + planetGrid_pY->numChunksOrdered() + planetGrid_nY->numChunksOrdered() + planetGrid_pX->numChunksOrdered() + planetGrid_nX->numChunksOrdered();
-    unsigned nActiveLeafChunks = planetGrid_pZ->numActiveLeafChunks() + planetGrid_nZ->numActiveLeafChunks() + planetGrid_pY->numActiveLeafChunks() + planetGrid_nY->numActiveLeafChunks() + planetGrid_pX->numActiveLeafChunks() + planetGrid_nX->numActiveLeafChunks();
+    Counts c = getCounts();
 
-    std::cout << "C: " << nChunks << " / OC: " << nOrderedChunks << ", / ALF: " << nActiveLeafChunks << std::endl;
+    std::cout << "C: " << c.chunks << " / OC: " << c.orderedChunks << " / ALF: " << c.activeLeafChunks << " / CU: " << c.culledChunks << " / CC: " << c.computedChunks << " / NC: " << c.noiseCalls << " (of " << c.noiseRequests << " samples)" << " / H: " << c.registryHits << " / M: " << c.registryMisses << " / E: " << c.evictions << " / VM: " << c.memory / 1024 << " KB / UB: " << c.uploaded / 1024 << " KB / MA: " << renderer->getMemAllocObjects() << " / CM: " << c.models << " / DC: " << renderer->getCommandsCount() << " / RT: " << renderer->getRecordingTime() << " ms / SSE: -" << c.coarserBySSE << " +" << c.finerBySSE << " (vs. distance)";
+    if (diskCache) std::cout << " / DK: " << diskCache->numHits() << " / " << diskCache->numMisses() << " (load: " << diskCache->getLoadTime() << " ms, gen: " << diskCache->getGenerationTime() << " ms)";
+    if (c.heightQueries) std::cout << " / GH: " << c.heightQueries << " (noise: " << c.heightFallbacks << ")";
+    if (scheduler) std::cout << " / Q: " << scheduler->getQueueDepth() << " (IF: " << scheduler->getNumInFlight() << ", D: " << scheduler->getNumDropped() << ", FT: " << scheduler->getFrameTime() << " ms)";
+    std::cout << std::endl;
 }
 
-float Planet::getGroundHeight(const glm::vec3& camPos)
+float Planet::getGroundHeight(const glm::vec3& pos)
 {
-    if (readyForUpdate)
+    if (!readyForUpdate) return 0;
+
+    glm::vec3 dir = pos - nucleus;
+    float height;
+    heightQueries++;
+    if (getFace(dir)->getGroundHeight(dir, heightQueryError, height)) return radius + height;
+
+    heightFallbacks++;
+    if (!noiseGen) return radius;
+    glm::vec3 ground = glm::normalize(dir) * radius;
+    return radius + noiseGen->getNoise(ground.x, ground.y, ground.z);
+}
+
+void Planet::getGroundHeights(const glm::vec3* points, float* heights, size_t count)
+{
+    if (!readyForUpdate)
+    {
+        std::fill(heights, heights + count, 0.f);
+        return;
+    }
+
+    // Loaded chunks
+    std::vector<size_t> missing;
+    std::vector<float> xs, ys, zs, noise;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 dir = points[i] - nucleus;
+        if (getFace(dir)->getGroundHeight(dir, heightQueryError, heights[i])) heights[i] += radius;
+        else
+        {
+            glm::vec3 ground = glm::normalize(dir) * radius;
+            missing.push_back(i);
+            xs.push_back(ground.x);
+            ys.push_back(ground.y);
+            zs.push_back(ground.z);
+        }
+    }
+
+    heightQueries += count;
+    heightFallbacks += missing.size();
+    if (missing.empty()) return;
+
+    // Noise (batches of 256 points)
+    noise.assign(missing.size(), 0.f);
+
+    if (noiseGen)
     {
-        glm::vec3 ground = glm::normalize(camPos - nucleus) * radius;
-        return radius + noiseGen->getNoise(ground.x, ground.y, ground.z);
+        const size_t batchSize = 256;
+        size_t numBatches = (missing.size() + batchSize - 1) / batchSize;
+        auto evaluate = [&](size_t batch)
+        {
+            size_t first = batch * batchSize;
+            noiseGen->getNoiseBatch(&xs[first], &ys[first], &zs[first], &noise[first], std::min(batchSize, missing.size() - first));
+        };
+
+        if (threadPool && numBatches > 1) threadPool->parallelFor(numBatches, evaluate);
+        else for (size_t batch = 0; batch < numBatches; batch++) evaluate(batch);
     }
 
-    return 0;
+    for (size_t i = 0; i < missing.size(); i++)
+        heights[missing[i]] = radius + noise[i];
+}
+
+void Planet::setHeightQueryError(float maxError) { heightQueryError = maxError; }
+
+ChunkEventQueue* Planet::subscribeChunkEvents(size_t capacity) { return chunkEvents->subscribe(capacity); }
+
+PlanetGrid* Planet::getFace(const glm::vec3& dir)
+{
+    glm::vec3 absDir = glm::abs(dir);
+
+    if (absDir.x >= absDir.y && absDir.x >= absDir.z) return (dir.x > 0 ? planetGrid_pX : planetGrid_nX);
+    if (absDir.y >= absDir.z) return (dir.y > 0 ? planetGrid_pY : planetGrid_nY);
+    return (dir.z > 0 ? planetGrid_pZ : planetGrid_nZ);
 }
 
 void Planet::getActiveLeafChunks(std::vector<const Chunk*>& dest, unsigned depth) const
@@ -1315,10 +2616,7 @@ void Planet::getActiveLeafChunks(std::vector<const Chunk*>& dest, unsigned depth
 
 float Planet::callBack_getFloorHeight(const glm::vec3& pos)
 {
-    glm::vec3 nucleus(0.f, 0.f, 0.f);
-    float radius = planetGrid_pZ->getRadius();
-    glm::vec3 espheroid = glm::normalize(pos - nucleus) * radius;
-    return 1.70 + radius + noiseGen->getNoise(espheroid.x, espheroid.y, espheroid.z);
+    return 1.70 + getGroundHeight(pos);
 }
 
 // Sphere ----------------------------------------------------------------------
@@ -1339,6 +2637,8 @@ Sphere::Sphere(Renderer* renderer, size_t rootCellSize, size_t numSideVertex, si
     planetGrid_nY = new SphereGrid(renderer, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, radius, nucleus, glm::vec3( 0,-1, 0), glm::vec3(  0,-50,  0), transparency);
     planetGrid_pX = new SphereGrid(renderer, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, radius, nucleus, glm::vec3( 1, 0, 0), glm::vec3( 50,  0,  0), transparency);
     planetGrid_nX = new SphereGrid(renderer, rootCellSize, numSideVertex, numLevels, minLevel, distMultiplier, radius, nucleus, glm::vec3(-1, 0, 0), glm::vec3(-50,  0,  0), transparency);
+
+    linkFaces();
 }
 
 Sphere::~Sphere()
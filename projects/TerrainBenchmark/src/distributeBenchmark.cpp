@@ -0,0 +1,263 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <unordered_set>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+#include "glm/glm.hpp"
+
+#include "terrain.hpp"
+#include "planetScene.hpp"
+#include "population.hpp"
+#include "planetFlight.hpp"
+#include "distributeBenchmark.hpp"
+
+const double frameBudget = 1000. / 60;		//!< ms
+
+/// Item entity of the planet scene
+struct SceneDistributor
+{
+	const char* name;
+	PlanetItems items;
+};
+
+/// Drawn chunk, and the frame it arrived
+struct Arrival
+{
+	unsigned frame;
+	std::shared_ptr<const ChunkSurface> surface;
+	unsigned depth;
+};
+
+/// Render thread's work in a fly-in
+struct FlightTrace
+{
+	std::vector<double> frameMs;	//!< CPU time of the render thread
+	std::vector<double> wallMs;		//!< Wall time (includes the time the render thread waits for a core, if the workers have them all)
+	size_t populations = 0;
+	size_t items = 0;
+	double latencySum = 0;		//!< Frames from arrival to ready
+	unsigned maxLatency = 0;
+	unsigned drainFrames = 0;	//!< Frames after the fly-in until the last population was ready
+};
+
+/// CPU time used by the calling thread (ms)
+double getThreadCpuTime()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0;
+	return ((double)(((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) + (double)(((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime)) / 1e4;		// 100 ns units
+#else
+	timespec time;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time)) return 0;
+	return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+#endif
+}
+
+/// Item entities of EntityFactory (createGrass(), createPlant(), createRock(), createTree() (trunk and branches), createTreeBillboard())
+std::vector<SceneDistributor> getSceneDistributors()
+{
+	PlanetItems tree = getTreeItems();
+
+	return { { "grass", getGrassItems() }, { "plant", getPlantItems() }, { "stone", getStoneItems() }, { "trunk", tree }, { "branches", tree }, { "treeBillboard", getTreeBillboardItems() } };
+}
+
+/// Chunks arrived in each frame of the fly-in: the planet is settled at each camera position, and its new drawn chunks that some distributor uses are copied (as s_Distributor::orderPopulation())
+std::vector<Arrival> getArrivals(std::shared_ptr<Noiser> noiseGen, std::shared_ptr<ThreadPool> threadPool, unsigned numSteps, unsigned numLevels, unsigned minDepth, unsigned maxDepth)
+{
+	Renderer renderer;
+	LightSet lights(2);
+	Planet planet(&renderer, noiseGen, planetRootCellSize, planetSideVertex, numLevels, planetMinLevel, planetDistMultiplier, planetRadius, planetNucleus, false);
+	planet.addResources({}, {});
+	planet.setThreadPool(threadPool);
+	planet.setScheduler(std::make_shared<ChunkScheduler>(threadPool));
+
+	std::unordered_set<unsigned> known;
+	std::vector<const Chunk*> leaves;
+	std::vector<Arrival> arrivals;
+
+	for (unsigned frame = 0; frame < numSteps; frame++)
+	{
+		settlePlanet(planet, renderer, lights, getCamPos(frame, numSteps));
+		leaves.clear();
+		planet.getActiveLeafChunks(leaves, minDepth);
+
+		for (const Chunk* leaf : leaves)
+		{
+			if (leaf->depth > maxDepth || !known.insert(leaf->chunkID).second) continue;
+
+			std::shared_ptr<ChunkSurface> surface = std::make_shared<ChunkSurface>();
+			leaf->getSurface(*surface);
+			surface->chunkID = (unsigned)arrivals.size();		// Populations are matched with their arrival (see flyIn())
+			arrivals.push_back({ frame, surface, leaf->depth });
+		}
+	}
+
+	return arrivals;
+}
+
+/// Fly-in with populations computed in the render thread (threadPool == nullptr) or in worker threads
+FlightTrace flyIn(const std::vector<Arrival>& arrivals, const std::vector<SceneDistributor>& distributors, unsigned numSteps, std::shared_ptr<ThreadPool> threadPool)
+{
+	typedef std::chrono::steady_clock Clock;
+	FlightTrace trace;
+	PopulationQueue populations(threadPool);
+	std::vector<std::pair<uint32_t, size_t>> refused;		// (distributor, arrival) not ordered yet
+	std::vector<ModelParams> items;
+	glm::vec4 latLonQuat(1, 0, 0, 0);
+	size_t next = 0;
+
+	auto collect = [&](unsigned frame)
+	{
+		ChunkPopulation population;
+		while (populations.pop(population))
+		{
+			unsigned latency = frame - arrivals[population.chunkID].frame;
+			trace.populations++;
+			trace.items += population.items->size();
+			trace.latencySum += latency;
+			trace.maxLatency = std::max(trace.maxLatency, latency);
+		}
+	};
+
+	for (unsigned frame = 0; frame < numSteps || populations.getNumInFlight(); frame++)
+	{
+		auto frameStart = Clock::now();
+		double cpuStart = getThreadCpuTime();
+
+		if (frame >= numSteps) trace.drainFrames++;
+		else if (!threadPool)		// Former s_Distributor::update(): every population of the new chunks, now
+		{
+			for (; next < arrivals.size() && arrivals[next].frame == frame; next++)
+				for (const SceneDistributor& distributor : distributors)
+				{
+					if (arrivals[next].depth < distributor.items.minDepth || arrivals[next].depth > distributor.items.maxDepth) continue;
+					items.clear();
+					computePopulation(*arrivals[next].surface, distributor.items.rules, latLonQuat, items);
+					trace.populations++;
+					trace.items += items.size();
+				}
+		}
+		else		// Copy the new chunks (as s_Distributor::orderPopulation()) and order their populations. Take the ready ones.
+		{
+			std::vector<std::pair<uint32_t, size_t>> orders;
+			orders.swap(refused);
+
+			for (; next < arrivals.size() && arrivals[next].frame == frame; next++)
+				for (uint32_t d = 0; d < distributors.size(); d++)
+					if (arrivals[next].depth >= distributors[d].items.minDepth && arrivals[next].depth <= distributors[d].items.maxDepth)
+						orders.push_back({ d, next });
+
+			std::shared_ptr<const ChunkSurface> copy;
+			size_t copied = arrivals.size();
+
+			for (const auto& order : orders)
+			{
+				if (order.second != copied)
+				{
+					copy = std::make_shared<ChunkSurface>(*arrivals[order.second].surface);
+					copied = order.second;
+				}
+
+				if (!populations.order(order.first, copy, distributors[order.first].items.rules, latLonQuat))
+					refused.push_back(order);
+			}
+
+			collect(frame);
+		}
+
+		if (frame < numSteps)
+		{
+			trace.frameMs.push_back(getThreadCpuTime() - cpuStart);
+			trace.wallMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count());
+		}
+
+		std::this_thread::sleep_until(frameStart + std::chrono::duration<double, std::milli>(frameBudget));		// Rest of the frame (workers keep going)
+		if (frame >= numSteps) collect(frame);
+	}
+
+	return trace;
+}
+
+bool runDistributeBenchmark(std::shared_ptr<Noiser> noiseGen, unsigned numThreads, unsigned numSteps, unsigned numLevels, const std::string& tracePath)
+{
+	std::vector<SceneDistributor> distributors = getSceneDistributors();
+	unsigned minDepth = distributors[0].items.minDepth, maxDepth = distributors[0].items.maxDepth;
+	for (const SceneDistributor& distributor : distributors)
+	{
+		minDepth = std::min(minDepth, distributor.items.minDepth);
+		maxDepth = std::max(maxDepth, distributor.items.maxDepth);
+	}
+
+	std::shared_ptr<ThreadPool> threadPool = std::make_shared<ThreadPool>(std::max(numThreads, 2u) - 1);		// The render thread isn't a worker
+	std::vector<Arrival> arrivals = getArrivals(noiseGen, threadPool, numSteps, numLevels, minDepth, maxDepth);
+
+	FlightTrace traces[2] = { flyIn(arrivals, distributors, numSteps, nullptr), flyIn(arrivals, distributors, numSteps, threadPool) };
+	const char* names[2] = { "Former (render thread)", "Worker threads" };
+
+	std::cout << "Distributor benchmark (fly-in: " << numSteps << " frames, " << arrivals.size() << " chunks of depth " << minDepth << "-" << maxDepth << ", " << distributors.size() << " distributors, " << threadPool->getNumThreads() << " workers)" << std::endl
+		<< std::fixed << std::setprecision(3)
+		<< "   Render thread per frame (CPU ms):   mean      p95      max   frames > " << frameBudget << " ms / max wall ms / populations / items / latency (frames: mean, max)" << std::endl;
+
+	double stats[2][4];
+	for (int m = 0; m < 2; m++)
+	{
+		FlightTrace& trace = traces[m];
+		std::vector<double> sorted = trace.frameMs;
+		std::sort(sorted.begin(), sorted.end());
+
+		double sum = 0;
+		size_t overBudget = 0;
+		for (double ms : sorted)
+		{
+			sum += ms;
+			overBudget += (ms > frameBudget);
+		}
+
+		stats[m][0] = sorted.empty() ? 0 : sum / sorted.size();
+		stats[m][1] = sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+		stats[m][2] = sorted.empty() ? 0 : sorted.back();
+		stats[m][3] = trace.wallMs.empty() ? 0 : *std::max_element(trace.wallMs.begin(), trace.wallMs.end());
+
+		std::cout << "      " << std::left << std::setw(28) << names[m] << std::right << std::setw(9) << stats[m][0] << std::setw(9) << stats[m][1] << std::setw(9) << stats[m][2] << std::setw(8) << overBudget
+			<< "   / " << stats[m][3] << " / " << trace.populations << " / " << trace.items << " / " << (trace.populations ? trace.latencySum / trace.populations : 0) << ", " << trace.maxLatency
+			<< (m ? " (" + std::to_string(trace.drainFrames) + " frames after the fly-in)" : "") << std::endl;
+	}
+
+	if (!tracePath.empty())
+	{
+		std::ofstream file(tracePath);
+		file << "frame,arrived,former_ms,workers_ms,former_wall_ms,workers_wall_ms\n";
+
+		size_t next = 0;
+		for (unsigned frame = 0; frame < numSteps; frame++)
+		{
+			size_t arrived = 0;
+			for (; next < arrivals.size() && arrivals[next].frame == frame; next++) arrived++;
+			file << frame << "," << arrived << "," << traces[0].frameMs[frame] << "," << traces[1].frameMs[frame] << "," << traces[0].wallMs[frame] << "," << traces[1].wallMs[frame] << "\n";
+		}
+
+		std::cout << "   Trace: " << tracePath << (file.good() ? "" : " (cannot be written)") << std::endl;
+	}
+
+	bool match = (traces[0].populations == traces[1].populations && traces[0].items == traces[1].items);
+	if (!match) std::cout << "   Populations don't match" << std::endl;
+
+	std::cout << "RESULT distribute frames=" << numSteps << " chunks=" << arrivals.size() << " former_mean_ms=" << stats[0][0] << " former_p95_ms=" << stats[0][1] << " former_max_ms=" << stats[0][2]
+		<< " workers_mean_ms=" << stats[1][0] << " workers_p95_ms=" << stats[1][1] << " workers_max_ms=" << stats[1][2] << " former_max_wall_ms=" << stats[0][3] << " workers_max_wall_ms=" << stats[1][3]
+		<< " latency_frames=" << (traces[1].populations ? traces[1].latencySum / traces[1].populations : 0) << " max_latency_frames=" << traces[1].maxLatency << " items=" << traces[1].items << std::endl;
+
+	return match;
+}
@@ -0,0 +1,20 @@
+#ifndef DISTRIBUTEBENCHMARK_HPP
+#define DISTRIBUTEBENCHMARK_HPP
+
+#include <string>
+#include <memory>
+
+#include "noise.hpp"
+
+/**
+	Frame times of the render thread while populating chunks with items (s_Distributor) during a planet fly-in.
+	The camera follows the path of the flight benchmark ("numSteps" frames, see getCamPos()). Each frame, the real Planet (see planetScene.hpp) is settled on the headless renderer, its new drawn chunks arrive, and the item entities of the planet scene (grass, plant, stone, 2 tree parts, tree billboard; see getGrassItems() and the like) populate them:
+		- Former: populations computed in the render thread, in the frame the chunks arrive.
+		- Worker threads: chunks copied and populations ordered to a PopulationQueue, and the populations computed so far taken from it.
+	Frames last at least 1/60 s (workers keep running meanwhile). Chunks are generated before the frames, so only populations are timed.
+	Prints the render thread's CPU time per frame (mean, 95th percentile, max, frames over budget; also max. wall time) and the latency of the populations (frames). If "tracePath" isn't empty, it writes the time of each frame in both modes there (CSV).
+	Returns false if both modes don't produce the same items.
+*/
+bool runDistributeBenchmark(std::shared_ptr<Noiser> noiseGen, unsigned numThreads, unsigned numSteps, unsigned numLevels, const std::string& tracePath);
+
+#endif
@@ -0,0 +1,118 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include "glm/glm.hpp"
+
+#include "graphBenchmark.hpp"
+
+const float graphRadius = 2000;			//!< Planet radius
+const size_t numSamples = 1 << 18;
+const size_t graphBatchSize = 29 * 29;	//!< Points per batch call (vertices of a chunk)
+
+/// Throughput of a noise generator (ns/sample)
+struct NoiseTimes
+{
+	double scalar;
+	double batch;
+	double gradBatch;
+};
+
+NoiseTimes measureNoise(Noiser& noise, const std::vector<float>& xs, const std::vector<float>& ys, const std::vector<float>& zs, std::vector<float>& out, std::vector<glm::vec3>& grads)
+{
+	typedef std::chrono::steady_clock Clock;
+	auto ns = [](Clock::time_point start) { return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / numSamples; };
+	NoiseTimes times;
+
+	auto start = Clock::now();
+	for (size_t i = 0; i < numSamples; i++)
+		out[i] = noise.getNoise(xs[i], ys[i], zs[i]);
+	times.scalar = ns(start);
+
+	start = Clock::now();
+	for (size_t first = 0; first < numSamples; first += graphBatchSize)
+		noise.getNoiseBatch(&xs[first], &ys[first], &zs[first], &out[first], std::min(graphBatchSize, numSamples - first));
+	times.batch = ns(start);
+
+	start = Clock::now();
+	for (size_t first = 0; first < numSamples; first += graphBatchSize)
+		noise.getNoiseGradBatch(&xs[first], &ys[first], &zs[first], &out[first], &grads[first], std::min(graphBatchSize, numSamples - first));
+	times.gradBatch = ns(start);
+
+	return times;
+}
+
+bool runGraphBenchmark(Noiser& graph, Noiser& multinoise)
+{
+	std::mt19937 rng(2468);
+	std::normal_distribution<float> normal;
+	std::vector<float> xs(numSamples), ys(numSamples), zs(numSamples);
+
+	for (size_t i = 0; i < numSamples; i++)
+	{
+		glm::vec3 point = glm::normalize(glm::vec3(normal(rng), normal(rng), normal(rng))) * graphRadius;
+		xs[i] = point.x;
+		ys[i] = point.y;
+		zs[i] = point.z;
+	}
+
+	// Accuracy (batch with gradients)
+	std::vector<float> graphHeights(numSamples), heights(numSamples);
+	std::vector<glm::vec3> graphGrads(numSamples), grads(numSamples);
+
+	graph.getNoiseGradBatch(xs.data(), ys.data(), zs.data(), graphHeights.data(), graphGrads.data(), numSamples);
+	multinoise.getNoiseGradBatch(xs.data(), ys.data(), zs.data(), heights.data(), grads.data(), numSamples);
+
+	double maxError = 0, sumError = 0, maxGradError = 0;
+	float minHeight = heights[0], maxHeight = heights[0];
+
+	for (size_t i = 0; i < numSamples; i++)
+	{
+		double error = std::abs(graphHeights[i] - heights[i]);
+		maxError = std::max(maxError, error);
+		sumError += error;
+		maxGradError = std::max(maxGradError, (double)glm::length(graphGrads[i] - grads[i]));
+		minHeight = std::min(minHeight, heights[i]);
+		maxHeight = std::max(maxHeight, heights[i]);
+	}
+
+	// Graph's batches (node by node) vs. its scalar path (point by point)
+	double maxBatchError = 0, maxBatchGradError = 0;
+	glm::vec3 grad;
+
+	for (size_t i = 0; i < numSamples; i++)
+	{
+		maxBatchError = std::max(maxBatchError, (double)std::abs(graph.getNoiseGrad(xs[i], ys[i], zs[i], grad) - graphHeights[i]));
+		maxBatchGradError = std::max(maxBatchGradError, (double)glm::length(grad - graphGrads[i]));
+	}
+
+	graph.getNoiseBatch(xs.data(), ys.data(), zs.data(), heights.data(), numSamples);
+	for (size_t i = 0; i < numSamples; i++)
+		maxBatchError = std::max(maxBatchError, (double)std::abs(graph.getNoise(xs[i], ys[i], zs[i]) - heights[i]));
+
+	// Throughput
+	std::vector<float> out(numSamples);
+	std::vector<glm::vec3> outGrads(numSamples);
+	NoiseTimes graphTimes = measureNoise(graph, xs, ys, zs, out, outGrads);
+	NoiseTimes oldTimes = measureNoise(multinoise, xs, ys, zs, out, outGrads);
+	auto speedup = [](double oldTime, double newTime) { return (newTime > 0 ? oldTime / newTime : 0); };
+
+	std::cout << "Noise graph benchmark (planet noise, " << numSamples << " points on the surface)" << std::endl
+		<< std::fixed << std::setprecision(3)
+		<< "   Accuracy (graph - Multinoise): mean " << sumError / numSamples << " / max " << maxError << " (height range: [" << minHeight << ", " << maxHeight << "]) / max gradient error " << maxGradError << std::endl
+		<< "   Graph batch - scalar: max " << maxBatchError << " / max gradient error " << maxBatchGradError << std::endl
+		<< "   Throughput (ns/sample):    Multinoise   Graph" << std::endl
+		<< "      getNoise():            " << std::setw(9) << oldTimes.scalar << std::setw(9) << graphTimes.scalar << " (x" << speedup(oldTimes.scalar, graphTimes.scalar) << ")" << std::endl
+		<< "      getNoiseBatch():       " << std::setw(9) << oldTimes.batch << std::setw(9) << graphTimes.batch << " (x" << speedup(oldTimes.batch, graphTimes.batch) << ")" << std::endl
+		<< "      getNoiseGradBatch():   " << std::setw(9) << oldTimes.gradBatch << std::setw(9) << graphTimes.gradBatch << " (x" << speedup(oldTimes.gradBatch, graphTimes.gradBatch) << ")" << std::endl;
+
+	std::cout << "RESULT graph scalar_ns=" << graphTimes.scalar << " batch_ns=" << graphTimes.batch << " grad_batch_ns=" << graphTimes.gradBatch
+		<< " multinoise_scalar_ns=" << oldTimes.scalar << " multinoise_batch_ns=" << oldTimes.batch << " multinoise_grad_batch_ns=" << oldTimes.gradBatch
+		<< " max_error=" << maxError << " mean_error=" << sumError / numSamples << " batch_error=" << maxBatchError << std::endl;
+
+	return maxError <= 0.01 * (maxHeight - minHeight) && maxBatchError <= 1e-4 * (maxHeight - minHeight);
+}
@@ -0,0 +1,15 @@
+#ifndef GRAPHBENCHMARK_HPP
+#define GRAPHBENCHMARK_HPP
+
+#include "noise.hpp"
+
+/**
+	Compare the planet noise built as a compile-time graph (NoiseGraph, see noiseGraph.hpp) with the same noise built as a Multinoise set (virtual noisers, callbacks and linear spline search).
+	Points: random points on the planet's surface (radius 2000).
+		- Accuracy: Heights and gradients of the graph compared with the Multinoise ones (the spline LUT is the only approximation), and the graph's batches compared with its scalar path.
+		- Throughput: ns per sample through getNoise() (one call per sample), getNoiseBatch() and getNoiseGradBatch() (chunk-sized batches).
+	Returns false if the graph doesn't match the Multinoise set (height error > 1 % of the height range) or its batches don't match its scalar path.
+*/
+bool runGraphBenchmark(Noiser& graph, Noiser& multinoise);
+
+#endif
@@ -0,0 +1,189 @@
+#include <algorithm>
+
+#include "renderer.hpp"
+
+
+Sizes size;
+
+LightSet::LightSet(unsigned numLights)
+	: numLights(numLights), posDirBytes(numLights * sizeof(LightPosDir)), propsBytes(numLights * sizeof(LightProps))
+{
+	this->posDir = new LightPosDir[numLights];
+	this->props = new LightProps[numLights];
+
+	for (size_t i = 0; i < numLights; i++)
+		props[i].type = 0;
+}
+
+LightSet::~LightSet()
+{
+	delete[] posDir;
+	delete[] props;
+}
+
+const VertexType vt_3  ({ 3 * sizeof(float) }, { VK_FORMAT_R32G32B32_SFLOAT });
+const VertexType vt_32 ({ 3 * sizeof(float), 2 * sizeof(float) }, { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32_SFLOAT });
+const VertexType vt_33 ({ 3 * sizeof(float), 3 * sizeof(float) }, { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT });
+const VertexType vt_332({ 3 * sizeof(float), 3 * sizeof(float), 2 * sizeof(float) }, { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32_SFLOAT });
+const VertexType vt_333({ 3 * sizeof(float), 3 * sizeof(float), 3 * sizeof(float) }, { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT });
+
+std::vector<TextureLoader> noTextures;
+std::vector<uint16_t> noIndices;
+
+VertexType::VertexType(std::initializer_list<size_t> attribsSizes, std::initializer_list<VkFormat> attribsFormats)
+	: attribsFormats(attribsFormats), attribsSizes(attribsSizes), vertexSize(0)
+{
+	for (unsigned i = 0; i < this->attribsSizes.size(); i++)
+		vertexSize += this->attribsSizes[i];
+}
+
+VertexType::VertexType() : vertexSize(0) { }
+
+SharedIndexBuffer::SharedIndexBuffer(const std::vector<uint16_t>& indices) : indices(indices) { }
+
+unsigned SharedIndexBuffer::getCounter() { return 0; }
+
+const unsigned VertexArena::noSlot;
+
+VertexArena::VertexArena(size_t slotSize, size_t vertexSize, unsigned slotsPerPage, unsigned maxPages)
+	: slotSize(slotSize), vertexSize(vertexSize), slotsPerPage(slotsPerPage), maxPages(maxPages), numPages(0), slotsUsed(0) { }
+
+uint32_t VertexArena::getFirstVertex(unsigned slot) { return (slot % slotsPerPage) * (slotSize / vertexSize); }
+
+size_t VertexArena::getNumPages()
+{
+	const std::lock_guard<std::mutex> lock(mutArena);
+	return numPages;
+}
+
+size_t VertexArena::getNumSlotsUsed()
+{
+	const std::lock_guard<std::mutex> lock(mutArena);
+	return slotsUsed;
+}
+
+bool VertexArena::takeSlot(unsigned& slot)
+{
+	if (freeSlots.empty())
+	{
+		if (maxPages && numPages >= maxPages) return false;
+
+		for (unsigned i = slotsPerPage; i > 0; i--)		// Reversed, so the first slots are taken first
+			freeSlots.push_back(numPages * slotsPerPage + i - 1);
+		numPages++;
+	}
+
+	slot = freeSlots.back();
+	freeSlots.pop_back();
+	slotsUsed++;
+	return true;
+}
+
+void VertexArena::release(unsigned slot)
+{
+	freeSlots.push_back(slot);
+	slotsUsed--;
+}
+
+VerticesLoader::VerticesLoader(size_t, const void*, size_t, std::vector<uint16_t>&) { }
+
+VerticesLoader::VerticesLoader(size_t, const void*, size_t, std::shared_ptr<SharedIndexBuffer>, std::shared_ptr<VertexArena>) { }
+
+VerticesLoader::VerticesLoader(std::shared_ptr<VertexArena>, std::shared_ptr<SharedIndexBuffer>) { }
+
+UBO::UBO(size_t count, size_t range) : range(range), ubos(count * range) { }
+
+uint8_t* UBO::getUBOptr(size_t uboIndex) { return ubos.data() + uboIndex * range; }
+
+ModelDataInfo::ModelDataInfo()
+	: name("noName"),
+	layer(1),
+	activeInstances(0),
+	topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST),
+	vertexType(vt_332),
+	verticesLoader(nullptr),
+	shadersInfo(nullptr),
+	texturesInfo(nullptr),
+	maxDescriptorsCount_vs(1),
+	maxDescriptorsCount_fs(1),
+	UBOsize_vs(8),
+	UBOsize_fs(8),
+	storageBuffer_vs(false),
+	maxIndirectDraws(0),
+	transparency(false),
+	renderPassIndex(0),
+	cullMode(VK_CULL_MODE_BACK_BIT)
+{ }
+
+ModelData::ModelData(ModelDataInfo& modelInfo)
+	: name(modelInfo.name),
+	layer(modelInfo.layer),
+	activeInstances(modelInfo.activeInstances),
+	fullyConstructed(false),
+	vsUBO(modelInfo.maxDescriptorsCount_vs, modelInfo.UBOsize_vs),
+	fsUBO(modelInfo.maxDescriptorsCount_fs, modelInfo.UBOsize_fs),
+	drawCommands(modelInfo.maxIndirectDraws, sizeof(VkDrawIndexedIndirectCommand))
+{ }
+
+TimerSet::TimerSet() : frameCounter(0) { }
+
+void TimerSet::computeDeltaTime() { frameCounter++; }
+
+size_t TimerSet::getFrameCounter() { return frameCounter; }
+
+Renderer::Renderer() { }
+
+void Renderer::newFrame()
+{
+	for (modelIter model : modelsToLoad)
+		model->fullyConstructed = true;
+	modelsToLoad.clear();
+
+	timer.computeDeltaTime();
+}
+
+modelIter Renderer::newModel(ModelDataInfo& modelInfo)
+{
+	models.emplace_back(modelInfo);
+	modelsToLoad.push_back(std::prev(models.end()));
+	return modelsToLoad.back();
+}
+
+void Renderer::deleteModel(modelIter model)
+{
+	auto it = std::find(modelsToLoad.begin(), modelsToLoad.end(), model);
+	if (it != modelsToLoad.end()) modelsToLoad.erase(it);
+
+	models.erase(model);
+}
+
+void Renderer::setRenders(modelIter model, size_t numberOfRenders) { model->activeInstances = numberOfRenders; }
+
+void Renderer::toLastDraw(modelIter model) { models.splice(models.end(), models, model); }
+
+void Renderer::uploadVertices(std::shared_ptr<VertexArena> arena, const std::vector<const void*>& vertexSets, size_t bytes, std::vector<unsigned>& slots)
+{
+	const std::lock_guard<std::mutex> lock(arena->mutArena);
+
+	slots.assign(vertexSets.size(), VertexArena::noSlot);
+	if (bytes > arena->slotSize) return;
+
+	for (size_t i = 0; i < vertexSets.size(); i++)
+		if (!arena->takeSlot(slots[i])) break;
+}
+
+void Renderer::releaseVertices(std::shared_ptr<VertexArena> arena, unsigned slot)
+{
+	const std::lock_guard<std::mutex> lock(arena->mutArena);
+	arena->release(slot);
+}
+
+TimerSet& Renderer::getTimer() { return timer; }
+
+size_t Renderer::getModelsCount() { return models.size(); }
+
+size_t Renderer::getCommandsCount() { return 0; }
+
+float Renderer::getRecordingTime() { return 0; }
+
+int Renderer::getMemAllocObjects() { return 0; }
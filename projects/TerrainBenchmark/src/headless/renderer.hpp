@@ -0,0 +1,223 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+/*
+	Headless stand-in for the Renderer's renderer.hpp, so TerrainBenchmark runs the real terrain (terrain.cpp) without Vulkan nor a window.
+	It declares only what the terrain uses, with the same signatures. Since this folder is searched before Renderer/include, the terrain
+	includes these headers instead of the real ones.
+		- Models live in a list. Their UBOs and indirect draw commands are host memory (the terrain writes them as usual).
+		- Vertex data isn't kept: VerticesLoader is empty and VertexArena only tracks its slots.
+		- A model is fully constructed in the first newFrame() after newModel() (the loading thread of the real renderer takes at least a frame).
+*/
+
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <initializer_list>
+
+#include "ubo.hpp"
+
+
+// Vulkan types used by the terrain ----------
+
+enum VkFormat
+{
+	VK_FORMAT_UNDEFINED = 0,
+	VK_FORMAT_R16G16_SNORM = 78,
+	VK_FORMAT_R16G16_SFLOAT = 83,
+	VK_FORMAT_R32_SFLOAT = 100,
+	VK_FORMAT_R32G32_SFLOAT = 103,
+	VK_FORMAT_R32G32B32_SFLOAT = 106
+};
+
+enum VkPrimitiveTopology
+{
+	VK_PRIMITIVE_TOPOLOGY_POINT_LIST = 0,
+	VK_PRIMITIVE_TOPOLOGY_LINE_LIST = 1,
+	VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST = 3
+};
+
+enum VkCullModeFlagBits
+{
+	VK_CULL_MODE_NONE = 0,
+	VK_CULL_MODE_FRONT_BIT = 1,
+	VK_CULL_MODE_BACK_BIT = 2
+};
+
+struct VkDrawIndexedIndirectCommand
+{
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t firstInstance;
+};
+
+
+// Definitions ----------
+
+class VertexType
+{
+public:
+	VertexType(std::initializer_list<size_t> attribsSizes, std::initializer_list<VkFormat> attribsFormats);
+	VertexType();
+
+	std::vector<VkFormat> attribsFormats;
+	std::vector<size_t> attribsSizes;
+	size_t vertexSize;								//!< Size (bytes) of a vertex object
+};
+
+extern const VertexType vt_3;					//!< (Vert)
+extern const VertexType vt_32;					//!< (Vert, UV)
+extern const VertexType vt_33;					//!< (Vert, Color)
+extern const VertexType vt_332;					//!< (Vert, Normal, UV)
+extern const VertexType vt_333;					//!< (Vert, Normal, vertexFixes)
+
+class ShaderLoader { };
+class TextureLoader { };
+
+extern std::vector<TextureLoader> noTextures;	//!< Vector with 0 TextureLoader objects
+extern std::vector<uint16_t> noIndices;			//!< Vector with 0 indices
+
+class SharedIndexBuffer
+{
+public:
+	SharedIndexBuffer(const std::vector<uint16_t>& indices);
+
+	const std::vector<uint16_t> indices;
+
+	unsigned getCounter();					//!< Number of models using the index buffer (always 0: nothing is uploaded)
+};
+
+/// Slots of a vertex arena (see Renderer::uploadVertices()). No vertex data is stored.
+class VertexArena
+{
+public:
+	VertexArena(size_t slotSize, size_t vertexSize, unsigned slotsPerPage = 128, unsigned maxPages = 0);
+
+	static const unsigned noSlot = ~0u;		//!< Returned when the arena is full
+	const size_t slotSize;					//!< Bytes per slot
+	const size_t vertexSize;				//!< Bytes per vertex
+	const unsigned slotsPerPage;
+	const unsigned maxPages;				//!< Max. number of pages (0: no limit)
+
+	uint32_t getFirstVertex(unsigned slot);	//!< First vertex of a slot in its page (vertexOffset for draws)
+	size_t getNumPages();
+	size_t getNumSlotsUsed();
+
+private:
+	friend class Renderer;
+
+	std::vector<unsigned> freeSlots;		//!< Free list (slot = page * slotsPerPage + position in page)
+	unsigned numPages;
+	unsigned slotsUsed;
+	std::mutex mutArena;					//!< for freeSlots, numPages & slotsUsed
+
+	bool takeSlot(unsigned& slot);			//!< Take a free slot (a new page is added if there is none). Returns false if maxPages is reached.
+	void release(unsigned slot);
+};
+
+/// Vertices of a model. Nothing is loaded.
+class VerticesLoader
+{
+public:
+	VerticesLoader(size_t vertexSize, const void* verticesData, size_t vertexCount, std::vector<uint16_t>& indices);
+	VerticesLoader(size_t vertexSize, const void* verticesData, size_t vertexCount, std::shared_ptr<SharedIndexBuffer> sharedIndices, std::shared_ptr<VertexArena> arena = nullptr);
+	VerticesLoader(std::shared_ptr<VertexArena> arena, std::shared_ptr<SharedIndexBuffer> sharedIndices);
+};
+
+/// Set of UBOs of a model, in host memory
+struct UBO
+{
+	UBO(size_t count, size_t range);
+
+	uint8_t* getUBOptr(size_t uboIndex);	//!< Get a pointer to one of the UBOs
+
+	const size_t range;						//!< Bytes per UBO
+	std::vector<uint8_t> ubos;
+};
+
+struct ModelDataInfo
+{
+	ModelDataInfo();
+
+	const char* name;
+	size_t layer;
+	size_t activeInstances;						// <= maxDescriptorsCount_vs
+	VkPrimitiveTopology topology;
+	VertexType vertexType;
+	VerticesLoader* verticesLoader;
+	std::vector<ShaderLoader>* shadersInfo;
+	std::vector<TextureLoader>* texturesInfo;
+	size_t maxDescriptorsCount_vs;				// max. number of active instances
+	size_t maxDescriptorsCount_fs;
+	size_t UBOsize_vs;
+	size_t UBOsize_fs;
+	bool storageBuffer_vs;
+	uint32_t maxIndirectDraws;					// If > 0, the model has maxIndirectDraws commands (ModelData::drawCommands)
+	bool transparency;
+	uint32_t renderPassIndex;
+	VkCullModeFlagBits cullMode;
+};
+
+class ModelData
+{
+public:
+	ModelData(ModelDataInfo& modelInfo);
+
+	std::string name;
+	size_t layer;
+	size_t activeInstances;					//!< Number of renderings (<= vsUBO.count)
+	bool fullyConstructed;					//!< Set in the first Renderer::newFrame() after Renderer::newModel()
+
+	UBO vsUBO;
+	UBO fsUBO;
+	UBO drawCommands;						//!< Indirect draw commands (VkDrawIndexedIndirectCommand[maxIndirectDraws])
+};
+
+typedef std::list<ModelData>::iterator modelIter;
+
+class TimerSet
+{
+	size_t frameCounter;
+
+public:
+	TimerSet();
+
+	void computeDeltaTime();				//!< Count a frame
+	size_t getFrameCounter();				//!< Get number of calls made to computeDeltaTime()
+};
+
+/// Keeps the models and vertex slots the terrain asks for, so it can be updated frame after frame (call newFrame() in each one).
+class Renderer
+{
+	std::list<ModelData> models;
+	std::vector<modelIter> modelsToLoad;	//!< Models fully constructed in the next newFrame()
+	TimerSet timer;
+
+public:
+	Renderer();
+
+	void newFrame();						//!< Count a frame and fully construct the models ordered in the previous one (what the render loop does each frame)
+
+	modelIter newModel(ModelDataInfo& modelInfo);
+	void deleteModel(modelIter model);
+	void setRenders(modelIter model, size_t numberOfRenders);
+	void toLastDraw(modelIter model);
+
+	/// Take free slots of a vertex arena for some vertex sets (bytes each). slots[i] == noSlot if there was no room for vertexSets[i].
+	void uploadVertices(std::shared_ptr<VertexArena> arena, const std::vector<const void*>& vertexSets, size_t bytes, std::vector<unsigned>& slots);
+
+	/// Give back a slot taken with uploadVertices().
+	void releaseVertices(std::shared_ptr<VertexArena> arena, unsigned slot);
+
+	TimerSet&	getTimer();
+	size_t		getModelsCount();
+	size_t		getCommandsCount();
+	float		getRecordingTime();
+	int			getMemAllocObjects();
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef UBO_HPP
+#define UBO_HPP
+
+/*
+	Headless stand-in for the Renderer's ubo.hpp (see headless/renderer.hpp). Only the light data and the uniform sizes used by the terrain.
+*/
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE			// GLM uses OpenGL depth range [-1.0, 1.0]. This macro forces GLM to use Vulkan range [0.0, 1.0].
+#define GLM_ENABLE_EXPERIMENTAL				// Required for using std::hash functions for the GLM types (since gtx folder contains experimental extensions)
+#include <glm/glm.hpp>
+
+
+// Definitions ----------
+
+struct Sizes
+{
+	size_t UniformAlignment = 16;	// Alignment required for each uniform in the UBO (usually, 16 bytes).
+	size_t vec2 = sizeof(glm::vec2);
+	size_t vec3 = sizeof(glm::vec3);
+	size_t vec4 = sizeof(glm::vec4);
+	size_t ivec4 = sizeof(glm::ivec4);
+	size_t mat4 = sizeof(glm::mat4);
+};
+
+extern Sizes size;
+
+struct LightPosDir
+{
+	alignas(16) glm::vec3 position;
+	alignas(16) glm::vec3 direction;	//!< Direction FROM the light source
+};
+
+struct LightProps
+{
+	alignas(16) int type;				//!< 0: no light, 1: directional, 2: point, 3: spot
+
+	alignas(16) glm::vec3 ambient;
+	alignas(16) glm::vec3 diffuse;
+	alignas(16) glm::vec3 specular;
+
+	alignas(16) glm::vec3 degree;		//!< vec3( constant, linear, quadratic )
+	alignas(16) glm::vec2 cutOff;		//!< vec2( cutOff, outerCutOff )
+};
+
+/// Lights (all turned off at construction). Copied to the chunks' UBOs.
+struct LightSet
+{
+	LightSet(unsigned numLights);
+	~LightSet();
+
+	LightPosDir* posDir;	// To vertex & fragment shader
+	LightProps* props;		// To fragment shader
+
+	const int numLights;
+	const size_t posDirBytes;
+	const size_t propsBytes;
+};
+
+#endif
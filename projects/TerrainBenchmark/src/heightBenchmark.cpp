@@ -0,0 +1,140 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include "glm/glm.hpp"
+
+#include "terrain.hpp"
+#include "planetScene.hpp"
+#include "planetFlight.hpp"
+#include "heightBenchmark.hpp"
+
+const unsigned samplesPerChunk = 256;	//!< Accuracy samples per chunk
+const size_t numQueries = 200000;		//!< Throughput queries per path
+const size_t noiseBatchSize = 256;		//!< Points per getNoiseBatch() call (as Planet::getGroundHeights())
+
+bool runHeightBenchmark(std::shared_ptr<Noiser> noiseGen, unsigned numLevels)
+{
+	typedef std::chrono::steady_clock Clock;
+	auto ns = [](Clock::time_point start, size_t count) { return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count; };
+
+	unsigned maxDepth = numLevels - 1;
+	float lastCell = planetSideVertex - 1.f;
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::uniform_real_distribution<float> inner(0.01f * lastCell, 0.99f * lastCell);		// Away from chunk borders, where rounding may select the adjacent chunk
+
+	// Planet settled at the end of the descent
+	Renderer renderer;
+	LightSet lights(2);
+	Planet planet(&renderer, noiseGen, planetRootCellSize, planetSideVertex, numLevels, planetMinLevel, planetDistMultiplier, planetRadius, planetNucleus, false);
+	planet.addResources({}, {});
+
+	auto start = Clock::now();
+	unsigned frames = settlePlanet(planet, renderer, lights, getCamPos(1, 5));
+	double settling = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::vector<const Chunk*> leaves;
+	std::vector<const PlanetChunk*> deepest;
+	planet.getActiveLeafChunks(leaves, 0);
+	for (const Chunk* leaf : leaves)
+		if (leaf->depth == maxDepth) deepest.push_back(static_cast<const PlanetChunk*>(leaf));
+
+	std::cout << "Ground height query benchmark" << std::endl
+		<< std::fixed << std::setprecision(3)
+		<< "   Levels: " << numLevels << " / Drawn chunks: " << leaves.size() << " (deepest: " << deepest.size() << "; settled in " << frames << " frames, " << settling << " ms) / Side vertices: " << planetSideVertex << std::endl;
+
+	if (!planet.isSettled() || deepest.empty())
+	{
+		std::cout << "   The planet didn't settle with chunks of the deepest level" << std::endl;
+		return false;
+	}
+
+	// Accuracy per depth
+	std::vector<double> sumError(numLevels, 0), sumSquared(numLevels, 0), maxError(numLevels, 0);
+	std::vector<size_t> numSamples(numLevels, 0);
+
+	for (const Chunk* leaf : leaves)
+	{
+		const PlanetChunk* chunk = static_cast<const PlanetChunk*>(leaf);
+
+		for (unsigned s = 0; s < samplesPerChunk; s++)
+		{
+			float col = unit(rng) * lastCell, row = unit(rng) * lastCell;
+			glm::vec3 ground = glm::normalize(chunk->getFacePoint(col, row) - planetNucleus) * planetRadius;
+			double error = std::abs(chunk->getHeight(col, row) - noiseGen->getNoise(ground.x, ground.y, ground.z));
+
+			sumError[chunk->depth] += error;
+			sumSquared[chunk->depth] += error * error;
+			maxError[chunk->depth] = std::max(maxError[chunk->depth], error);
+			numSamples[chunk->depth]++;
+		}
+	}
+
+	std::cout << "   Accuracy (interpolated height - noise):" << std::endl;
+	for (unsigned d = 0; d < numLevels; d++)
+		if (numSamples[d])
+			std::cout << "      Depth " << std::setw(2) << d << ": mean " << sumError[d] / numSamples[d] << " / rms " << std::sqrt(sumSquared[d] / numSamples[d]) << " / max " << maxError[d] << " (" << numSamples[d] << " samples)" << std::endl;
+
+	// Throughput: random points of the deepest chunks
+	std::vector<glm::vec3> points(numQueries);
+	for (glm::vec3& point : points)
+		point = deepest[rng() % deepest.size()]->getFacePoint(inner(rng), inner(rng));
+
+	std::vector<float> chunkHeights(numQueries), groupHeights(numQueries), noiseHeights(numQueries), batchHeights(numQueries);
+	std::vector<float> xs(numQueries), ys(numQueries), zs(numQueries);
+	size_t fallbacks = planet.getCounts().heightFallbacks;
+
+	start = Clock::now();
+	for (size_t i = 0; i < numQueries; i++)
+		chunkHeights[i] = planet.getGroundHeight(points[i]);
+	double chunkTime = ns(start, numQueries);
+
+	start = Clock::now();
+	planet.getGroundHeights(points.data(), groupHeights.data(), numQueries);
+	double groupTime = ns(start, numQueries);
+
+	size_t misses = planet.getCounts().heightFallbacks - fallbacks;
+
+	start = Clock::now();
+	for (size_t i = 0; i < numQueries; i++)
+	{
+		glm::vec3 ground = glm::normalize(points[i] - planetNucleus) * planetRadius;
+		noiseHeights[i] = planetRadius + noiseGen->getNoise(ground.x, ground.y, ground.z);
+	}
+	double noiseTime = ns(start, numQueries);
+
+	start = Clock::now();
+	for (size_t i = 0; i < numQueries; i++)
+	{
+		glm::vec3 ground = glm::normalize(points[i] - planetNucleus) * planetRadius;
+		xs[i] = ground.x;
+		ys[i] = ground.y;
+		zs[i] = ground.z;
+	}
+	for (size_t first = 0; first < numQueries; first += noiseBatchSize)
+		noiseGen->getNoiseBatch(&xs[first], &ys[first], &zs[first], &batchHeights[first], std::min(noiseBatchSize, numQueries - first));
+	for (float& height : batchHeights) height += planetRadius;
+	double batchTime = ns(start, numQueries);
+
+	double queryError = 0;
+	for (size_t i = 0; i < numQueries; i++)
+		queryError = std::max(queryError, (double)std::max(std::abs(chunkHeights[i] - noiseHeights[i]), std::abs(groupHeights[i] - noiseHeights[i])));
+
+	auto speedup = [chunkTime](double time) { return (chunkTime > 0 ? time / chunkTime : 0); };
+
+	std::cout << "   Throughput (" << numQueries << " queries in the deepest chunks, ns/query):" << std::endl
+		<< "      Chunks:          " << chunkTime << " (max. error: " << queryError << ", answered with noise: " << misses << ")" << std::endl
+		<< "      Chunks (group):  " << groupTime << " (x" << speedup(groupTime) << ")" << std::endl
+		<< "      Noise:           " << noiseTime << " (x" << speedup(noiseTime) << ")" << std::endl
+		<< "      Noise (batch):   " << batchTime << " (x" << speedup(batchTime) << ")" << std::endl;
+
+	std::cout << "RESULT heights levels=" << numLevels << " chunk_ns=" << chunkTime << " chunk_group_ns=" << groupTime << " noise_ns=" << noiseTime << " noise_batch_ns=" << batchTime
+		<< " speedup=" << speedup(noiseTime) << " speedup_batch=" << speedup(batchTime) << " max_error=" << queryError << " mean_error=" << sumError[maxDepth] / numSamples[maxDepth] << std::endl;
+
+	return misses == 0;
+}
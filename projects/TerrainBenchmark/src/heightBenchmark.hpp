@@ -0,0 +1,17 @@
+#ifndef HEIGHTBENCHMARK_HPP
+#define HEIGHTBENCHMARK_HPP
+
+#include <memory>
+
+#include "noise.hpp"
+
+/**
+	Compare ground height queries answered from chunks (Planet::getGroundHeight()) with the noise evaluation they replace.
+	The real Planet (see planetScene.hpp) is settled on the headless renderer with the camera at the start of the low-altitude flight (see getCamPos()), so the tree below it is split down to the deepest level.
+		- Accuracy: For each depth, heights interpolated in the drawn chunks (Chunk::getHeight()) at random points are compared with the noise at those points.
+		- Throughput: Queries at random points of the drawn chunks of the deepest level, through the planet (getGroundHeight() and getGroundHeights()) and through the noise (one getNoise() per point, and getNoiseBatch()).
+	Returns false if some query isn't answered from a chunk.
+*/
+bool runHeightBenchmark(std::shared_ptr<Noiser> noiseGen, unsigned numLevels);
+
+#endif
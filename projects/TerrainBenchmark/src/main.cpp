@@ -0,0 +1,453 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>				// EXIT_SUCCESS, EXIT_FAILURE
+#include <new>
+#include <atomic>
+#include <fstream>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+	#include <unistd.h>
+#endif
+
+#include "noise.hpp"
+#include "noiseGraph.hpp"
+#include "jobs.hpp"
+#include "planetPatch.hpp"
+#include "slabPool.hpp"
+#include "terrain.hpp"
+#include "planetScene.hpp"
+#include "planetFlight.hpp"
+#include "treeBenchmark.hpp"
+#include "heightBenchmark.hpp"
+#include "popinBenchmark.hpp"
+#include "graphBenchmark.hpp"
+#include "noiseBenchmark.hpp"
+#include "distributeBenchmark.hpp"
+
+/*
+	Headless benchmark of planet terrain generation (no window, no GPU device). It runs the real Planet (terrain.cpp) on a headless Renderer (see headless/renderer.hpp), with the settings of the planet entity (see planetScene.hpp).
+	A camera follows a scripted path: descent from orbit and low-altitude flight across 2 cube faces, looking ahead and down. At each step, the planet is updated frame after frame until it's settled (see Planet::isSettled()), so every chunk its 6 faces require (LOD and culling of DynamicGrid) is generated.
+	Chunks are computed in a ThreadPool and ordered by a ChunkScheduler, as in the planet entity (unless --noscheduler is used). Frame times are reported as p50, p99 and max. Without --budget, chunks are kept. With it, the planet evicts the least recently used ones (see DynamicGrid::setMemoryBudget()), so memory is reused while flying.
+	Heap allocations (operator new) are counted during the flight.
+	Chunks skip the octaves finer than their vertex spacing if the noise has octaves finer than the deepest chunks' spacing (e.g. --noise detail; see PlanetGrid::setSkipFineOctaves()), unless --nolod is used. The first drawn chunks of each depth at the end of the flight are generated again in isolation with all the octaves and with footprints (time and height difference).
+
+	Usage: TerrainBenchmark [--threads N] [--noise planet|multinoise|fractal|simplex|detail] [--steps N] [--levels N] [--cache file] [--budget MB] [--nopools] [--nolod] [--sse pixels] [--noscheduler] [--tree] [--heights] [--popin] [--graph] [--noisebench [--json file]] [--distribute [--trace file]]
+		--threads	Threads generating chunks (default: hardware concurrency) (1: chunks are generated in the render thread)
+		--noise		Noise preset (default: planet, the noise of the planet entity; multinoise: the same noise with Multinoise)
+		--steps		Camera positions along the path (default: 200)
+		--levels	Quadtree levels (default: 7)
+		--cache		Read/store chunks in this persistent cache (run twice for comparing cold and warm starts) (see Planet::setDiskCache())
+		--budget	Memory budget of the planet's chunks (MB) (default: 0, no limit)
+		--nopools	Allocate chunk arrays in the heap instead of slab pools (for comparison) (see slabPool.hpp)
+		--nolod		Compute every octave in every chunk (for comparison) (see Noiser::getNoiseBatch())
+		--noscheduler	Compute chunks as soon as they are required, without a ChunkScheduler (for comparing frame times)
+		--sse		Split chunks by screen-space error instead of by distance: max. projected geometric error, in pixels of the benchmark's camera (see Planet::setScreenSpaceError()). Drawn leaves and LOD decisions that differ from distance LOD are reported.
+		--tree		Benchmark the quadtree instead (build, traversal and side depths; from 7 levels to --levels) (see treeBenchmark.hpp)
+		--heights	Benchmark ground height queries instead (chunk interpolation vs. noise: accuracy and throughput) (see heightBenchmark.hpp)
+		--popin		Benchmark pop-in latency instead (frames from camera arrival to full detail, former vs. progressive activation of splits; from 7 levels to --levels) (see popinBenchmark.hpp)
+		--graph		Benchmark the planet noise graph instead (against the same noise with Multinoise: accuracy and throughput) (see graphBenchmark.hpp)
+		--noisebench	Benchmark every Noiser implementation instead (samples/s of each noise type and octave count; 2D/3D, scalar/batch, batch loops for each instruction set, 1/--threads threads), and check that batch and scalar outputs match (see noiseBenchmark.hpp)
+		--json		JSON output of --noisebench (default: noiseBenchmark.json)
+		--distribute	Benchmark the render thread's frame times while chunks are populated with items instead (populations computed in the render thread vs. in worker threads; --steps frames) (see distributeBenchmark.hpp)
+		--trace		CSV output of --distribute (time of each frame)
+*/
+
+const size_t numErrorSamples = 8;		//!< Chunks per depth generated again in isolation (with and without footprints)
+
+struct Settings
+{
+	unsigned numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::string noise = "planet";
+	unsigned numSteps = 200;
+	unsigned numLevels = planetLevels;
+	std::string cachePath;
+	size_t budget = 0;
+	bool noPools = false;
+	bool noLod = false;
+	float ssePixels = 0;			//!< 0: LOD by distance
+	bool noScheduler = false;
+	bool tree = false;
+	bool heights = false;
+	bool popin = false;
+	bool graph = false;
+	bool noiseBench = false;
+	std::string jsonPath = "noiseBenchmark.json";
+	bool distribute = false;
+	std::string tracePath;
+};
+
+/// Chunks of a depth generated again in isolation
+struct DepthStats
+{
+	unsigned samples = 0;
+	double isolatedFull = 0;	//!< ms per sample chunk, with all the octaves
+	double isolatedLod = 0;		//!< ms per sample chunk, with footprint
+	float footprint = 0;		//!< Largest LOD footprint of the sample chunks
+	double maxError = 0;		//!< Max. |height difference| between both
+	double maxEdgeError = 0;	//!< Same, next to the border (the border has all the octaves, so this is the step at the chunk's edges)
+};
+
+bool parseArgs(int argc, char* argv[], Settings& settings);
+std::shared_ptr<Noiser> createNoise(const std::string& preset);
+size_t getPeakMemory();		//!< Peak resident memory of the process (bytes)
+size_t getCurrentMemory();		//!< Resident memory of the process (bytes)
+
+std::atomic<size_t> numHeapAllocations(0);		//!< Calls to operator new (see below)
+
+
+// main ---------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+	Settings settings;
+	if (!parseArgs(argc, argv, settings)) return EXIT_FAILURE;
+	SlabPool::setEnabled(!settings.noPools);
+	if (settings.tree)
+		return runTreeBenchmark(settings.numSteps, settings.numLevels) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	std::shared_ptr<Noiser> noiseGen = createNoise(settings.noise);
+	if (!noiseGen)
+	{
+		std::cout << "Unknown noise preset: " << settings.noise << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (settings.popin)
+	{
+		runPopinBenchmark(noiseGen, settings.numThreads, settings.numLevels);
+		return EXIT_SUCCESS;
+	}
+
+	if (settings.heights)
+		return runHeightBenchmark(noiseGen, settings.numLevels) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	if (settings.graph)
+		return runGraphBenchmark(*createNoise("planet"), *createNoise("multinoise")) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	if (settings.noiseBench)
+		return runNoiseBenchmark(*createNoise("multinoise"), *createNoise("planet"), settings.numThreads, settings.jsonPath) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	if (settings.distribute)
+		return runDistributeBenchmark(noiseGen, settings.numThreads, settings.numSteps, settings.numLevels, settings.tracePath) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	// Planet entity on a headless renderer
+	Renderer renderer;
+	LightSet lights(2);
+	Planet planet(&renderer, noiseGen, planetRootCellSize, planetSideVertex, settings.numLevels, planetMinLevel, planetDistMultiplier, planetRadius, planetNucleus, false);
+	planet.addResources({}, {});
+
+	std::shared_ptr<ThreadPool> threadPool;
+	if (settings.numThreads > 1) threadPool = std::make_shared<ThreadPool>(settings.numThreads);
+	planet.setThreadPool(threadPool);
+	if (!settings.noScheduler) planet.setScheduler(std::make_shared<ChunkScheduler>(threadPool));
+	if (settings.budget) planet.setMemoryBudget(settings.budget * 1024 * 1024);
+	if (settings.noLod) planet.setSkipFineOctaves(false);
+	if (settings.ssePixels) planet.setScreenSpaceError(flightFov, flightViewportHeight, settings.ssePixels);
+	if (!settings.cachePath.empty()) planet.setDiskCache(settings.cachePath);
+
+	std::cout << "Terrain benchmark" << std::endl
+		<< "   Noise: " << settings.noise << (noiseGen->analyticGradient() ? " (analytic normals)" : " (grid normals)") << std::endl
+		<< "   Threads: " << settings.numThreads << " / Steps: " << settings.numSteps << " / Levels: " << settings.numLevels << " / Side vertices: " << planetSideVertex << std::endl;
+
+	PlanetPatch::Stats patchesStart = PlanetPatch::getStats();
+	size_t allocationsStart = numHeapAllocations;
+	size_t numFrames = 0, unsettledSteps = 0;
+	size_t drawnLeaves = 0, sseCoarser = 0, sseFiner = 0;		// Sums of the steps (LOD decisions: last tree update of each step)
+	std::vector<double> frameTimes;		// ms
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned step = 0; step < settings.numSteps; step++)
+	{
+		numFrames += settlePlanet(planet, renderer, lights, getCamPos(step, settings.numSteps), &frameTimes);
+		if (!planet.isSettled()) unsettledSteps++;
+
+		Planet::Counts stepCounts = planet.getCounts();
+		drawnLeaves += stepCounts.activeLeafChunks;
+		sseCoarser += stepCounts.coarserBySSE;
+		sseFiner += stepCounts.finerBySSE;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	size_t numAllocations = numHeapAllocations - allocationsStart;
+
+	// Results
+	PlanetPatch::Stats patchesEnd = PlanetPatch::getStats();
+	Planet::Counts counts = planet.getCounts();
+	size_t numGenerated = patchesEnd.patches - patchesStart.patches;
+	size_t numChunks = counts.computedChunks;
+	PlanetPatch::Times total{
+		patchesEnd.times.heights - patchesStart.times.heights,
+		patchesEnd.times.normals - patchesStart.times.normals,
+		patchesEnd.times.gapFixes - patchesStart.times.gapFixes,
+		patchesEnd.times.packing - patchesStart.times.packing };
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+	auto framePercentile = [&](double p) { return (frameTimes.empty() ? 0 : frameTimes[std::min((size_t)(p / 100 * frameTimes.size()), frameTimes.size() - 1)]); };
+	double slowestFrame = (frameTimes.empty() ? 0 : frameTimes.back());
+
+	double cpuTime = total.heights + total.normals + total.gapFixes + total.packing;
+	double chunksPerSecond = numChunks / seconds;
+	double samplesPerSecond = counts.noiseCalls / seconds;
+	double peakMB = getPeakMemory() / (1024. * 1024.);
+	double currentMB = getCurrentMemory() / (1024. * 1024.);
+	double allocationsPerChunk = (numChunks ? (double)numAllocations / numChunks : 0);
+	SlabPool::Stats pools = SlabPool::getStats();
+	auto perChunk = [&](double time) { return (numGenerated ? time / numGenerated : 0); };
+	auto percent = [&](double time) { return (cpuTime > 0 ? 100 * time / cpuTime : 0); };
+
+	std::cout << std::fixed << std::setprecision(3)
+		<< "   Chunks: " << numChunks << " (generated: " << numGenerated << ", loaded from disk: " << numChunks - numGenerated << ") in " << seconds << " s -> " << chunksPerSecond << " chunks/s" << std::endl
+		<< "   Noise samples: " << counts.noiseCalls << " computed (of " << counts.noiseRequests << " requested) -> " << samplesPerSecond << " samples/s" << std::endl
+		<< "   Time per generated chunk (ms, one thread):" << std::endl
+		<< "      Heights:   " << perChunk(total.heights) << " (" << percent(total.heights) << " %)" << std::endl
+		<< "      Normals:   " << perChunk(total.normals) << " (" << percent(total.normals) << " %)" << std::endl
+		<< "      Gap fixes: " << perChunk(total.gapFixes) << " (" << percent(total.gapFixes) << " %)" << std::endl
+		<< "      Packing:   " << perChunk(total.packing) << " (" << percent(total.packing) << " %)" << std::endl
+		<< "      Indices:   shared by the chunks of each face (computed once per face)" << std::endl
+		<< "   LOD: max. screen-space error " << settings.ssePixels << " px (0: by distance) / drawn chunks: " << (double)drawnLeaves / settings.numSteps << " per step (" << counts.activeLeafChunks << " at the end) / decisions vs. distance: " << sseCoarser << " coarser, " << sseFiner << " finer" << std::endl
+		<< "   Frames: " << numFrames << " (" << (settings.noScheduler ? "no scheduler" : "scheduler") << "; ms: p50 " << framePercentile(50) << ", p99 " << framePercentile(99) << ", max " << slowestFrame << "; steps not settled: " << unsettledSteps << ")" << std::endl
+		<< "   Memory: " << peakMB << " MB peak, " << currentMB << " MB at the end (chunks kept: " << counts.chunks << ", evicted: " << counts.evictions << ")" << std::endl
+		<< "   Heap allocations: " << numAllocations << " (" << allocationsPerChunk << " per chunk)" << std::endl
+		<< "   Slab pools: " << pools.pools << " (" << pools.slabs << " slabs, " << pools.reservedBytes / (1024. * 1024.) << " MB reserved, " << pools.inUseBytes / (1024. * 1024.) << " MB in use, " << pools.allocations << " slots served)" << std::endl
+		<< "   Planet: ";
+	planet.printCounts();
+
+	// Per depth: the first drawn chunks generated again in isolation (no height cache, best of 3) with all the octaves and with footprints (time and max. height difference)
+	std::vector<const Chunk*> leaves;
+	std::vector<DepthStats> depths(settings.numLevels);
+	planet.getActiveLeafChunks(leaves, 0);
+
+	for (const Chunk* leaf : leaves)
+	{
+		DepthStats& depth = depths[leaf->depth];
+		if (depth.samples == numErrorSamples) continue;
+		depth.samples++;
+
+		const PlanetChunk* chunk = static_cast<const PlanetChunk*>(leaf);
+		PooledVector<PlanetVertex> vertices[2];
+
+		for (int lod = 0; lod < 2; lod++)
+		{
+			double best = 0;
+			for (int rep = 0; rep < 3; rep++)
+			{
+				PlanetPatch patch = chunk->getPatch(noiseGen.get());
+				patch.skipFineOctaves = lod;
+				patch.generate(true);
+				double time = patch.times.heights + patch.times.normals + patch.times.gapFixes + patch.times.packing;
+				if (!rep || time < best) best = time;
+				if (lod) depth.footprint = std::max(depth.footprint, patch.footprint);
+				vertices[lod] = std::move(patch.compactVertex);
+			}
+
+			(lod ? depth.isolatedLod : depth.isolatedFull) += best;
+		}
+
+		for (size_t i = 0; i < vertices[0].size(); i++)
+		{
+			size_t v = i / planetSideVertex, h = i % planetSideVertex;
+			double error = std::abs(vertices[1][i].height - vertices[0][i].height);
+			depth.maxError = std::max(depth.maxError, error);
+			if (std::min({ v, h, planetSideVertex - 1 - v, planetSideVertex - 1 - h }) == 1) depth.maxEdgeError = std::max(depth.maxEdgeError, error);
+		}
+	}
+
+	// Disk cache: drawn chunks vs. the same chunks generated again (loaded chunks have quantized interior heights), and seams (a border vertex shared by two drawn chunks of the same depth must have the same height in both)
+	if (!settings.cachePath.empty())
+	{
+		double borderError = 0, interiorError = 0, seamError = 0;
+		std::unordered_map<std::string, float> borderHeights;		// "depth direction" -> height
+		size_t numSeamVertex = 0;
+
+		for (const Chunk* leaf : leaves)
+		{
+			const PlanetChunk* chunk = static_cast<const PlanetChunk*>(leaf);
+			PlanetPatch patch = chunk->getPatch(noiseGen.get());
+			patch.generate(true);
+
+			for (size_t i = 0; i < patch.compactVertex.size(); i++)
+			{
+				size_t v = i / planetSideVertex, h = i % planetSideVertex;
+				double error = std::abs(chunk->getVertexHeight(i) - patch.compactVertex[i].height);
+				double& maxError = (std::min({ v, h, planetSideVertex - 1 - v, planetSideVertex - 1 - h }) == 0 ? borderError : interiorError);
+				maxError = std::max(maxError, error);
+			}
+
+			for (size_t i = 0; i < chunk->getNumVertex(); i++)
+			{
+				size_t v = i / planetSideVertex, h = i % planetSideVertex;
+				if (std::min({ v, h, planetSideVertex - 1 - v, planetSideVertex - 1 - h }) != 0) continue;
+
+				glm::vec3 dir = glm::normalize(chunk->getVertexPos(i));
+				std::string key = std::to_string(chunk->depth) + ' ' + std::to_string(std::lround(dir.x * 1e6)) + ' ' + std::to_string(std::lround(dir.y * 1e6)) + ' ' + std::to_string(std::lround(dir.z * 1e6));
+				auto result = borderHeights.emplace(key, chunk->getVertexHeight(i));
+				if (result.second) continue;
+
+				numSeamVertex++;
+				seamError = std::max(seamError, (double)std::abs(result.first->second - chunk->getVertexHeight(i)));
+			}
+		}
+
+		std::cout << "   Disk cache (" << leaves.size() << " drawn chunks vs. generated again): max. height error " << std::scientific << borderError << " at the borders, " << interiorError << " inside; seams: " << numSeamVertex << " shared vertices, max. height difference " << seamError << std::fixed << std::endl
+			<< "RESULT_CACHE chunks=" << leaves.size() << " loaded=" << numChunks - numGenerated << " border_error=" << borderError << " interior_error=" << interiorError << " seam_vertices=" << numSeamVertex << " seam_error=" << seamError << std::endl;
+
+		if (seamError > 0) return EXIT_FAILURE;
+	}
+
+	std::cout << "   Per depth (drawn chunks at the end; isolated: first " << numErrorSamples << " chunks without cache, ms per chunk with all octaves vs. footprint; error: max |height difference|, and next to the border):" << std::endl;
+
+	for (unsigned d = 0; d < depths.size(); d++)
+	{
+		DepthStats& depth = depths[d];
+		if (!depth.samples) continue;
+		depth.isolatedFull /= depth.samples;
+		depth.isolatedLod /= depth.samples;
+
+		std::cout << "      Depth " << d << ": " << depth.samples << " chunks, isolated: " << depth.isolatedFull << " vs. " << depth.isolatedLod
+			<< " (x" << (depth.isolatedLod > 0 ? depth.isolatedFull / depth.isolatedLod : 0) << ") / footprint " << depth.footprint << " / error " << depth.maxError << " / edge error " << depth.maxEdgeError << std::endl;
+	}
+
+	// Single line for tracking regressions (key=value)
+	std::cout << "RESULT_DEPTHS lod=" << planet.skipsFineOctaves();
+	for (unsigned d = 0; d < depths.size(); d++)
+		if (depths[d].samples) std::cout << " d" << d << "_full_ms=" << depths[d].isolatedFull << " d" << d << "_lod_ms=" << depths[d].isolatedLod << " d" << d << "_error=" << depths[d].maxError << " d" << d << "_edge_error=" << depths[d].maxEdgeError;
+	std::cout << std::endl;
+
+	std::cout << "RESULT noise=" << settings.noise << " threads=" << settings.numThreads << " chunks=" << numChunks << " seconds=" << seconds << " chunks_per_s=" << chunksPerSecond << " samples_per_s=" << samplesPerSecond
+		<< " heights_ms=" << perChunk(total.heights) << " normals_ms=" << perChunk(total.normals) << " gapfixes_ms=" << perChunk(total.gapFixes) << " packing_ms=" << perChunk(total.packing) << " frames=" << numFrames << " frame_p50_ms=" << framePercentile(50) << " frame_p99_ms=" << framePercentile(99) << " slowest_frame_ms=" << slowestFrame
+		<< " peak_mb=" << peakMB << " end_mb=" << currentMB << " allocations=" << numAllocations << " allocations_per_chunk=" << allocationsPerChunk << " pools=" << (settings.noPools ? 0 : 1) << std::endl;
+	std::cout << "RESULT_LOD sse_px=" << settings.ssePixels << " chunks=" << numChunks << " drawn_per_step=" << (double)drawnLeaves / settings.numSteps << " drawn_end=" << counts.activeLeafChunks << " coarser=" << sseCoarser << " finer=" << sseFiner << std::endl;
+
+	return EXIT_SUCCESS;
+}
+
+bool parseArgs(int argc, char* argv[], Settings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
+
+		if (arg == "--threads" && hasValue) settings.numThreads = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--noise" && hasValue) settings.noise = argv[++i];
+		else if (arg == "--steps" && hasValue) settings.numSteps = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--levels" && hasValue) settings.numLevels = std::clamp(std::atoi(argv[++i]), (int)planetMinLevel + 1, 20);
+		else if (arg == "--cache" && hasValue) settings.cachePath = argv[++i];
+		else if (arg == "--budget" && hasValue) settings.budget = std::max(std::atoi(argv[++i]), 0);
+		else if (arg == "--nopools") settings.noPools = true;
+		else if (arg == "--nolod") settings.noLod = true;
+		else if (arg == "--noscheduler") settings.noScheduler = true;
+		else if (arg == "--sse" && hasValue) settings.ssePixels = std::max((float)std::atof(argv[++i]), 0.f);
+		else if (arg == "--tree") settings.tree = true;
+		else if (arg == "--heights") settings.heights = true;
+		else if (arg == "--popin") settings.popin = true;
+		else if (arg == "--graph") settings.graph = true;
+		else if (arg == "--noisebench") settings.noiseBench = true;
+		else if (arg == "--json" && hasValue) settings.jsonPath = argv[++i];
+		else if (arg == "--distribute") settings.distribute = true;
+		else if (arg == "--trace" && hasValue) settings.tracePath = argv[++i];
+		else
+		{
+			std::cout << "Usage: TerrainBenchmark [--threads N] [--noise planet|multinoise|fractal|simplex|detail] [--steps N] [--levels N] [--cache file] [--budget N] [--nopools] [--nolod] [--sse pixels] [--noscheduler] [--tree] [--heights] [--popin] [--graph] [--noisebench [--json file]] [--distribute [--trace file]]" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::shared_ptr<Noiser> createNoise(const std::string& preset)
+{
+	if (preset == "planet")		// Same as the planet entity (see planetScene.hpp)
+		return createPlanetNoise();
+	else if (preset == "multinoise")	// Same noise as "planet", with the former Multinoise set (callbacks and virtual noisers)
+	{
+		std::shared_ptr<Noiser> continentalness = std::make_shared<FractalNoise_SplinePts>(
+			FastNoiseLite::NoiseType_Perlin, 4, 4.f, 0.3f, 0.1, 4952,
+			std::vector<std::array<float, 2>>{ {-1, -0.5}, {-0.1, -0.1}, { 0.1, 0.1 }, { 1, 1 } });
+
+		std::shared_ptr<Noiser> erosion = std::make_shared<FractalNoise_SplinePts>(
+			FastNoiseLite::NoiseType_Perlin, 2, 5.f, 0.3f, 0.1, 4953,
+			std::vector<std::array<float, 2>>{ {-1, 1}, { 0, 0.3 }, { 1, 0} });
+
+		std::shared_ptr<Noiser> PV = std::make_shared<FractalNoise_SplinePts>(
+			FastNoiseLite::NoiseType_Perlin, 2, 2.f, 0.3f, 0.5, 4954,
+			std::vector<std::array<float, 2>>{ {-1, 0}, { -0.3, 1 }, { 0.6, 0 }, { 1, 1 } });
+
+		std::vector<std::shared_ptr<Noiser>> noiserSet = { continentalness, erosion, PV, nullptr, nullptr };
+		return std::make_shared<Multinoise>(noiserSet, getNoise_C_E_PV, default2D_callback, getNoiseBatch_C_E_PV, getNoiseGradBatch_C_E_PV);
+	}
+	else if (preset == "fractal")	// 8 octaves of Perlin noise (analytic gradients)
+		return std::make_shared<FractalNoise>(FastNoiseLite::NoiseType_Perlin, 8, 2.f, 0.5f, 50.f, 1.f, 1234);
+	else if (preset == "simplex")	// 8 octaves of OpenSimplex2 noise (normals from the grid)
+		return std::make_shared<FractalNoise>(FastNoiseLite::NoiseType_OpenSimplex2, 8, 2.f, 0.5f, 50.f, 1.f, 1234);
+	else if (preset == "detail")	// 12 octaves of Perlin noise, from 2000 to 1 units of wavelength (coarse chunks skip most of them)
+		return std::make_shared<FractalNoise>(FastNoiseLite::NoiseType_Perlin, 12, 2.f, 0.5f, 20.f, 5.f, 1234);
+
+	return nullptr;
+}
+
+size_t getPeakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage)) return 0;
+	#ifdef __APPLE__
+		return usage.ru_maxrss;			// bytes
+	#else
+		return usage.ru_maxrss * 1024;	// KB
+	#endif
+#endif
+}
+
+size_t getCurrentMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.WorkingSetSize;
+	return 0;
+#else
+	std::ifstream statm("/proc/self/statm");		// Linux: size and resident (pages)
+	size_t size = 0, resident = 0;
+	if (!(statm >> size >> resident)) return 0;
+	return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Counting of heap allocations: replacement of the global operator new (array and nothrow versions call it).
+// GCC flags free() of memory from operator new (-Wmismatched-new-delete) where these are inlined, but here operator new does use malloc().
+#if defined(__GNUC__) && !defined(__clang__)
+	#pragma GCC diagnostic push
+	#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size)
+{
+	numHeapAllocations++;
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+#if defined(__GNUC__) && !defined(__clang__)
+	#pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,341 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+
+#include "jobs.hpp"
+#include "noiseBenchmark.hpp"
+
+const float noiseExtent = 2000;				//!< Points are taken from [-noiseExtent, noiseExtent]^3
+const size_t noiseSamples = 1 << 14;		//!< Points per measurement
+const size_t noiseBatchSize = 29 * 29;		//!< Points per batch call (vertices of a chunk). Also the points per job in multithreaded runs.
+const unsigned noiseRepetitions = 3;		//!< Each measurement is repeated, and the best time is taken
+const size_t rangeSize = 256;				//!< Grid side for the range (see Noiser::getNoiseRange())
+const int maxOctaves = 12;
+const double maxBatchError = 1e-5;			//!< Max. allowed difference between the batch and the scalar outputs (relative to the value, or absolute below 1)
+
+const FastNoiseLite::NoiseType noiseTypes[] = { FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::NoiseType_OpenSimplex2S, FastNoiseLite::NoiseType_Cellular, FastNoiseLite::NoiseType_Perlin, FastNoiseLite::NoiseType_ValueCubic, FastNoiseLite::NoiseType_Value };
+const char* noiseTypeNames[] = { "OpenSimplex2", "OpenSimplex2S", "Cellular", "Perlin", "ValueCubic", "Value" };
+
+/// Generator to measure
+struct NoiseCase
+{
+	std::string noiser;			//!< Class
+	std::string noiseType;		//!< FastNoiseLite noise type
+	int octaves;
+	std::shared_ptr<Noiser> noise;
+	std::array<float, 2> range = { 0, 0 };
+	double rangeMs = 0;
+	double batchError = 0;		//!< Biggest difference between getNoiseBatch() and getNoise() (2D or 3D), or between getNoiseGradBatch() and getNoiseGrad() (analytic gradients), with any instruction set (see getBatchError())
+};
+
+/// Time of a generator in a given path (ns/sample)
+struct NoiseRecord
+{
+	size_t caseIndex;
+	unsigned dims;
+	bool batch;
+	NoiseIsa isa;				//!< Of the batch loops (see runNoiseKernel())
+	unsigned threads;
+	double ns;
+};
+
+std::vector<NoiseCase> getNoiseCases(Noiser& planetMultinoise, Noiser& planetGraph)
+{
+	std::vector<NoiseCase> cases;
+	std::vector<std::array<float, 2>> splinePts = { {-1, -1}, { -0.3f, -0.1f }, { 0.4f, 0.2f }, { 1, 1 } };
+	int seed = 1234;
+
+	for (size_t t = 0; t < std::size(noiseTypes); t++)
+	{
+		cases.push_back({ "SimpleNoise", noiseTypeNames[t], 1, std::make_shared<SimpleNoise>(noiseTypes[t], 50.f, seed) });
+
+		for (int octaves = 1; octaves <= maxOctaves; octaves++)
+		{
+			std::shared_ptr<Noiser> fractal = std::make_shared<FractalNoise>(noiseTypes[t], octaves, 2.f, 0.5f, 50.f, 1.f, seed);
+			std::vector<std::shared_ptr<Noiser>> noiserSet = { fractal };
+
+			cases.push_back({ "FractalNoise", noiseTypeNames[t], octaves, fractal });
+			cases.push_back({ "FractalNoise_Exp", noiseTypeNames[t], octaves, std::make_shared<FractalNoise_Exp>(noiseTypes[t], octaves, 2.f, 0.5f, 50.f, 1.f, seed, 2) });
+			cases.push_back({ "FractalNoise_SplinePts", noiseTypeNames[t], octaves, std::make_shared<FractalNoise_SplinePts>(noiseTypes[t], octaves, 2.f, 0.5f, 50.f, seed, splinePts) });
+			cases.push_back({ "Multinoise", noiseTypeNames[t], octaves, std::make_shared<Multinoise>(noiserSet) });
+		}
+	}
+
+	// The planet noise (3 FractalNoise_SplinePts with Perlin noise; 8 octaves in total), as a Multinoise set and as a noise graph. They aren't owned here.
+	cases.push_back({ "planetMultinoise", "Perlin", 8, std::shared_ptr<Noiser>(&planetMultinoise, [](Noiser*) { }) });
+	cases.push_back({ "planetGraph", "Perlin", 8, std::shared_ptr<Noiser>(&planetGraph, [](Noiser*) { }) });
+
+	return cases;
+}
+
+/// Best time (ns/sample) of computing the noise at every point, in the calling thread (threadPool == nullptr) or in the thread pool too.
+double measureNoisePath(Noiser& noise, unsigned dims, bool batch, ThreadPool* threadPool, const std::vector<float>& xs, const std::vector<float>& ys, const std::vector<float>& zs, std::vector<float>& out)
+{
+	typedef std::chrono::steady_clock Clock;
+	size_t numBatches = (noiseSamples + noiseBatchSize - 1) / noiseBatchSize;
+
+	auto runBatch = [&](size_t b)
+	{
+		size_t first = b * noiseBatchSize;
+		size_t n = std::min(noiseBatchSize, noiseSamples - first);
+
+		if (batch)
+		{
+			if (dims == 3) noise.getNoiseBatch(&xs[first], &ys[first], &zs[first], &out[first], n);
+			else noise.getNoiseBatch(&xs[first], &ys[first], &out[first], n);
+		}
+		else if (dims == 3)
+			for (size_t i = first; i < first + n; i++) out[i] = noise.getNoise(xs[i], ys[i], zs[i]);
+		else
+			for (size_t i = first; i < first + n; i++) out[i] = noise.getNoise(xs[i], ys[i]);
+	};
+
+	double best = 0;
+	for (unsigned r = 0; r < noiseRepetitions; r++)
+	{
+		auto start = Clock::now();
+
+		if (threadPool) threadPool->parallelFor(numBatches, runBatch);
+		else for (size_t b = 0; b < numBatches; b++) runBatch(b);
+
+		double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / noiseSamples;
+		if (!r || ns < best) best = ns;
+	}
+
+	return best;
+}
+
+/// Biggest difference between the batch outputs and the scalar ones at the same points, relative to the scalar value (absolute if it's below 1). NaN in both counts as equal.
+double getBatchError(const std::vector<float>& scalar, const std::vector<float>& batch)
+{
+	double error = 0;
+
+	for (size_t i = 0; i < scalar.size(); i++)
+	{
+		if (std::isnan(scalar[i]) && std::isnan(batch[i])) continue;
+
+		double diff = std::abs((double)batch[i] - scalar[i]) / std::max(1., std::abs((double)scalar[i]));
+		if (!(diff <= error)) error = diff;		// NaN in only one of them propagates
+	}
+
+	return error;
+}
+
+/// getBatchError() of getNoiseGradBatch() (values and gradient components) with respect to getNoiseGrad(), over chunk-sized batches
+double getGradBatchError(Noiser& noise, const std::vector<float>& xs, const std::vector<float>& ys, const std::vector<float>& zs)
+{
+	std::vector<float> scalar(4 * noiseSamples), batch(4 * noiseSamples), out(noiseSamples);
+	std::vector<glm::vec3> grads(noiseSamples);
+	glm::vec3 grad;
+
+	for (size_t first = 0; first < noiseSamples; first += noiseBatchSize)
+		noise.getNoiseGradBatch(&xs[first], &ys[first], &zs[first], &out[first], &grads[first], std::min(noiseBatchSize, noiseSamples - first));
+
+	for (size_t i = 0; i < noiseSamples; i++)
+	{
+		scalar[4 * i] = noise.getNoiseGrad(xs[i], ys[i], zs[i], grad);
+		for (unsigned c = 0; c < 3; c++) scalar[4 * i + 1 + c] = grad[c];
+
+		batch[4 * i] = out[i];
+		for (unsigned c = 0; c < 3; c++) batch[4 * i + 1 + c] = grads[i][c];
+	}
+
+	return getBatchError(scalar, batch);
+}
+
+/// JSON number, or null if it's NaN or infinite (JSON has no representation for them)
+struct JsonNumber
+{
+	double value;
+};
+
+std::ostream& operator<<(std::ostream& os, JsonNumber number)
+{
+	if (std::isfinite(number.value)) return os << number.value;
+	return os << "null";
+}
+
+bool writeNoiseJson(const std::string& path, unsigned numThreads, const std::vector<NoiseIsa>& isas, const std::vector<NoiseCase>& cases, const std::vector<NoiseRecord>& records)
+{
+	std::ofstream file(path);
+	if (!file.is_open()) return false;
+
+	file << std::setprecision(6)
+		<< "{\n"
+		<< "\t\"benchmark\": \"noise\",\n"
+		<< "\t\"samples\": " << noiseSamples << ",\n"
+		<< "\t\"batch_size\": " << noiseBatchSize << ",\n"
+		<< "\t\"repetitions\": " << noiseRepetitions << ",\n"
+		<< "\t\"threads\": " << numThreads << ",\n"
+		<< "\t\"range_size\": " << rangeSize << ",\n"
+		<< "\t\"isas\": [";
+
+	for (size_t i = 0; i < isas.size(); i++)
+		file << (i ? ", " : " ") << "\"" << getNoiseIsaName(isas[i]) << "\"" << (i + 1 < isas.size() ? "" : " ");
+
+	file << "],\n"
+		<< "\t\"noisers\": [\n";
+
+	for (size_t i = 0; i < cases.size(); i++)
+		file << "\t\t{ \"id\": " << i << ", \"noiser\": \"" << cases[i].noiser << "\", \"noise_type\": \"" << cases[i].noiseType << "\", \"octaves\": " << cases[i].octaves
+			<< ", \"min\": " << JsonNumber{ cases[i].range[0] } << ", \"max\": " << JsonNumber{ cases[i].range[1] } << ", \"range_ms\": " << cases[i].rangeMs << ", \"batch_error\": " << JsonNumber{ cases[i].batchError } << " }" << (i + 1 < cases.size() ? "," : "") << "\n";
+
+	file << "\t],\n"
+		<< "\t\"results\": [\n";
+
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		const NoiseRecord& record = records[i];
+		const NoiseCase& noiseCase = cases[record.caseIndex];
+
+		file << "\t\t{ \"id\": " << record.caseIndex << ", \"noiser\": \"" << noiseCase.noiser << "\", \"noise_type\": \"" << noiseCase.noiseType << "\", \"octaves\": " << noiseCase.octaves
+			<< ", \"dims\": " << record.dims << ", \"path\": \"" << (record.batch ? "batch" : "scalar") << "\", \"isa\": \"" << getNoiseIsaName(record.isa) << "\", \"threads\": " << record.threads
+			<< ", \"ns_per_sample\": " << record.ns << ", \"samples_per_s\": " << JsonNumber{ record.ns > 0 ? 1e9 / record.ns : 0 } << " }" << (i + 1 < records.size() ? "," : "") << "\n";
+	}
+
+	file << "\t]\n"
+		<< "}\n";
+
+	return file.good();
+}
+
+bool runNoiseBenchmark(Noiser& planetMultinoise, Noiser& planetGraph, unsigned numThreads, const std::string& jsonPath)
+{
+	typedef std::chrono::steady_clock Clock;
+	auto benchmarkStart = Clock::now();
+
+	std::mt19937 rng(1357);
+	std::uniform_real_distribution<float> coord(-noiseExtent, noiseExtent);
+	std::vector<float> xs(noiseSamples), ys(noiseSamples), zs(noiseSamples), out(noiseSamples), scalarOut;
+
+	for (size_t i = 0; i < noiseSamples; i++)
+	{
+		xs[i] = coord(rng);
+		ys[i] = coord(rng);
+		zs[i] = coord(rng);
+	}
+
+	std::unique_ptr<ThreadPool> threadPool;
+	if (numThreads > 1) threadPool = std::make_unique<ThreadPool>(numThreads - 1);		// parallelFor() uses the calling thread too
+
+	std::vector<NoiseCase> cases = getNoiseCases(planetMultinoise, planetGraph);
+	std::vector<NoiseRecord> records;
+
+	// Instruction sets of the batch loops: every one this CPU supports (the scalar path isn't dispatched)
+	NoiseIsa bestIsa = getNoiseIsa();
+	std::vector<NoiseIsa> isas;
+	for (NoiseIsa isa : { NoiseIsa::generic, NoiseIsa::avx2 })
+		if (setNoiseIsa(isa)) isas.push_back(isa);
+	setNoiseIsa(bestIsa);
+
+	for (size_t c = 0; c < cases.size(); c++)
+	{
+		NoiseCase& noiseCase = cases[c];
+
+		auto start = Clock::now();
+		noiseCase.range = noiseCase.noise->getNoiseRange(rangeSize, threadPool.get());
+		noiseCase.rangeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		for (unsigned dims : { 3u, 2u })
+		{
+			records.push_back({ c, dims, false, bestIsa, 1, measureNoisePath(*noiseCase.noise, dims, false, nullptr, xs, ys, zs, out) });
+			if (threadPool) records.push_back({ c, dims, false, bestIsa, numThreads, measureNoisePath(*noiseCase.noise, dims, false, threadPool.get(), xs, ys, zs, out) });
+			scalarOut = out;
+
+			for (NoiseIsa isa : isas)
+			{
+				setNoiseIsa(isa);
+				records.push_back({ c, dims, true, isa, 1, measureNoisePath(*noiseCase.noise, dims, true, nullptr, xs, ys, zs, out) });
+				if (threadPool && isa == bestIsa) records.push_back({ c, dims, true, isa, numThreads, measureNoisePath(*noiseCase.noise, dims, true, threadPool.get(), xs, ys, zs, out) });
+				noiseCase.batchError = std::max(noiseCase.batchError, getBatchError(scalarOut, out));		// Both paths wrote the same points
+				if (dims == 3 && noiseCase.noise->analyticGradient()) noiseCase.batchError = std::max(noiseCase.batchError, getGradBatchError(*noiseCase.noise, xs, ys, zs));
+			}
+
+			setNoiseIsa(bestIsa);
+		}
+	}
+
+	size_t worstCase = 0;
+	for (size_t c = 0; c < cases.size(); c++)
+		if (!(cases[c].batchError <= cases[worstCase].batchError)) worstCase = c;
+
+	double seconds = std::chrono::duration<double>(Clock::now() - benchmarkStart).count();
+
+	// Summary (3D, some octave counts; the JSON file has all of them)
+	auto getNs = [&records](size_t caseIndex, unsigned dims, bool batch, NoiseIsa isa, bool multithreaded)
+	{
+		for (const NoiseRecord& record : records)
+			if (record.caseIndex == caseIndex && record.dims == dims && record.batch == batch && (!batch || record.isa == isa) && (record.threads > 1) == multithreaded) return record.ns;
+		return 0.;
+	};
+
+	std::cout << "Noise benchmark (" << cases.size() << " generators, " << noiseSamples << " random points, best of " << noiseRepetitions << ", " << numThreads << " threads, batch loops for";
+	for (NoiseIsa isa : isas) std::cout << " " << getNoiseIsaName(isa);
+	std::cout << ")" << std::endl
+		<< std::fixed << std::setprecision(1)
+		<< "   3D, ns/sample:                               scalar    batch (" << getNoiseIsaName(isas.back()) << ": x speedup vs. " << getNoiseIsaName(isas.front()) << ")   scalar MT  batch MT    range" << std::endl;
+
+	for (size_t c = 0; c < cases.size(); c++)
+	{
+		const NoiseCase& noiseCase = cases[c];
+		if (noiseCase.octaves != 1 && noiseCase.octaves != 4 && noiseCase.octaves != 8 && noiseCase.octaves != 12) continue;
+
+		double batchNs = getNs(c, 3, true, isas.back(), false), genericNs = getNs(c, 3, true, isas.front(), false);
+		std::cout << "      " << std::left << std::setw(24) << noiseCase.noiser << std::setw(15) << noiseCase.noiseType << std::right << std::setw(3) << noiseCase.octaves << " oct "
+			<< std::setw(9) << getNs(c, 3, false, bestIsa, false) << std::setw(9) << batchNs << " (x" << std::setprecision(2) << (batchNs > 0 ? genericNs / batchNs : 0) << ")" << std::setprecision(1);
+
+		if (threadPool) std::cout << std::setw(11) << getNs(c, 3, false, bestIsa, true) << std::setw(10) << getNs(c, 3, true, bestIsa, true);
+		else std::cout << std::setw(11) << "-" << std::setw(10) << "-";
+
+		std::cout << "   [" << std::setprecision(3) << noiseCase.range[0] << ", " << noiseCase.range[1] << "]" << std::setprecision(1) << std::endl;
+	}
+
+	// Batch throughput of each instruction set (geometric mean of the speedups over the first one, per noise type; all generators and octave counts)
+	for (unsigned dims : { 3u, 2u })
+		for (size_t i = 1; i < isas.size(); i++)
+		{
+			std::cout << "   " << dims << "D batch, " << getNoiseIsaName(isas[i]) << " vs. " << getNoiseIsaName(isas[0]) << " (geometric mean):";
+
+			for (const char* type : noiseTypeNames)
+			{
+				double logSum = 0;
+				size_t count = 0;
+
+				for (size_t c = 0; c < cases.size(); c++)
+				{
+					double ns = getNs(c, dims, true, isas[i], false), base = getNs(c, dims, true, isas[0], false);
+					if (cases[c].noiseType != type || ns <= 0 || base <= 0) continue;
+					logSum += std::log(base / ns);
+					count++;
+				}
+
+				if (count) std::cout << " " << type << " x" << std::setprecision(2) << std::exp(logSum / count);
+			}
+
+			for (const char* planetCase : { "planetMultinoise", "planetGraph" })
+				for (size_t c = 0; c < cases.size(); c++)
+					if (cases[c].noiser == planetCase)
+						std::cout << ", " << planetCase << " x" << getNs(c, dims, true, isas[0], false) / getNs(c, dims, true, isas[i], false);
+
+			std::cout << std::setprecision(1) << std::endl;
+		}
+
+	const NoiseCase& worst = cases[worstCase];
+	bool batchMatches = worst.batchError <= maxBatchError;
+	std::cout << "   Batch vs. scalar (values and analytic gradients): max error " << std::scientific << std::setprecision(2) << worst.batchError << std::fixed;
+	if (worst.batchError > 0) std::cout << " (" << worst.noiser << ", " << worst.noiseType << ", " << worst.octaves << " oct)";
+	std::cout << (batchMatches ? "" : "  <<< MISMATCH") << std::endl;
+
+	bool written = writeNoiseJson(jsonPath, numThreads, isas, cases, records);
+	if (!written) std::cout << "Cannot write " << jsonPath << std::endl;
+
+	std::cout << std::setprecision(3) << "RESULT noisebench generators=" << cases.size() << " records=" << records.size() << " seconds=" << seconds << " max_batch_error=" << std::scientific << worst.batchError << std::fixed << " json=" << (written ? jsonPath : "none") << std::endl;
+
+	return written && batchMatches;
+}
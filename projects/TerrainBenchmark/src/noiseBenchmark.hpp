@@ -0,0 +1,18 @@
+#ifndef NOISEBENCHMARK_HPP
+#define NOISEBENCHMARK_HPP
+
+#include <string>
+
+#include "noise.hpp"
+
+/**
+	Throughput of every Noiser implementation (samples/s), for regression tracking.
+	Generators: SimpleNoise, FractalNoise, FractalNoise_Exp, FractalNoise_SplinePts and Multinoise (default callbacks, over a FractalNoise), for every FastNoiseLite noise type and 1 to 12 octaves. Plus the planet noise as a Multinoise set ("planetMultinoise") and as a noise graph ("planetGraph").
+	Measurements (each one over the same random points): 2D and 3D, scalar (getNoise()) and batch (getNoiseBatch(), chunk-sized batches, with each instruction set the CPU supports, see runNoiseKernel()), in 1 thread and in "numThreads" threads (ThreadPool::parallelFor() over batches; batch with the best instruction set). Best of a few repetitions.
+	Also the range of each generator (Noiser::getNoiseRange(), computed in parallel), and how much its batch outputs (and analytic gradients) differ from its scalar ones (they should be the same with every instruction set).
+	Results are written to "jsonPath" as JSON (one record per generator and measurement). A summary is printed (3D, ns/sample).
+	Returns false if the JSON file can't be written or some batch output doesn't match the scalar one.
+*/
+bool runNoiseBenchmark(Noiser& planetMultinoise, Noiser& planetGraph, unsigned numThreads, const std::string& jsonPath);
+
+#endif
@@ -0,0 +1,59 @@
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "planetScene.hpp"
+#include "planetFlight.hpp"
+
+glm::vec3 getCamPos(unsigned step, unsigned numSteps)
+{
+	// First quarter: descent from 3 radius of altitude to 10 (exponential). Then: flight along a great circle, from face +Z to face +Y.
+	float t = (float)step / std::max(numSteps - 1, 1u);
+	float descent = std::min(t * 4, 1.f);
+	float altitude = 3 * planetRadius * std::pow(10 / (3 * planetRadius), descent);
+	float angle = (t > 0.25f ? (t - 0.25f) / 0.75f : 0) * glm::radians(100.f);
+
+	glm::vec3 dir = glm::normalize(glm::vec3(0.3f, -0.2f, 1));
+	glm::vec3 axis(1, 0, 0);
+	dir = dir * std::cos(-angle) + glm::cross(axis, dir) * std::sin(-angle) + axis * glm::dot(axis, dir) * (1 - std::cos(-angle));	// Rodrigues' rotation
+
+	return planetNucleus + dir * (planetRadius + altitude);
+}
+
+glm::mat4 getViewMatrix(const glm::vec3& camPos)
+{
+	glm::vec3 up = glm::normalize(camPos - planetNucleus);
+	glm::vec3 ahead = -glm::cross(glm::vec3(1, 0, 0), up);		// Direction of the flight (see getCamPos())
+
+	return glm::lookAt(camPos, camPos + glm::normalize(ahead - up), up);
+}
+
+glm::mat4 getProjMatrix()
+{
+	glm::mat4 proj = glm::perspective(flightFov, flightViewportWidth / flightViewportHeight, 0.2f, 4 * planetRadius);
+	proj[1][1] *= -1;
+	return proj;
+}
+
+unsigned settlePlanet(Planet& planet, Renderer& renderer, const LightSet& lights, const glm::vec3& camPos, std::vector<double>* frameTimes)
+{
+	glm::mat4 view = getViewMatrix(camPos);
+	glm::mat4 proj = getProjMatrix();
+	bool workers = (planet.getThreadPool() != nullptr);
+
+	for (unsigned frame = 0; frame < maxFramesPerStep; frame++)
+	{
+		auto frameStart = std::chrono::steady_clock::now();
+		planet.updateState(camPos, view, proj, lights, 1 / 60.f, planet.getGroundHeight(camPos));
+		renderer.newFrame();
+		if (frameTimes) frameTimes->push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+
+		if (planet.isSettled()) return frame + 1;
+		if (workers) std::this_thread::yield();		// Let the workers progress
+	}
+
+	return maxFramesPerStep;
+}
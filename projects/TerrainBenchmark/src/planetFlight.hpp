@@ -0,0 +1,26 @@
+#ifndef PLANETFLIGHT_HPP
+#define PLANETFLIGHT_HPP
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "terrain.hpp"
+
+/*
+	Camera and frame loop of the benchmarks that run the real Planet (see planetScene.hpp) on the headless renderer (see headless/renderer.hpp).
+*/
+
+const unsigned maxFramesPerStep = 100000;	//!< Frames before giving up on settling the planet at a camera position
+const float flightFov = 1.f;				//!< Vertical field of view (radians) (see getProjMatrix())
+const float flightViewportWidth = 1920.f;
+const float flightViewportHeight = 1080.f;	//!< Pixels (used by the screen-space error, see Planet::setScreenSpaceError())
+
+glm::vec3 getCamPos(unsigned step, unsigned numSteps);		//!< Scripted path: descent from orbit, then low-altitude flight across 2 cube faces
+glm::mat4 getViewMatrix(const glm::vec3& camPos);			//!< Looking ahead (along the path) and down
+glm::mat4 getProjMatrix();									//!< Same camera as the planet scene (see c_Camera), with a far plane beyond the planet when seen from the start of the descent
+
+/// Update the planet frame after frame at camPos until it's settled (see Planet::isSettled()). Returns the frames run (maxFramesPerStep if it didn't settle). The time of each frame (ms) is appended to frameTimes, if not nullptr.
+unsigned settlePlanet(Planet& planet, Renderer& renderer, const LightSet& lights, const glm::vec3& camPos, std::vector<double>* frameTimes = nullptr);
+
+#endif
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <unordered_set>
+#include <random>
+#include <thread>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+#include "terrain.hpp"
+#include "planetScene.hpp"
+#include "planetFlight.hpp"
+#include "popinBenchmark.hpp"
+
+const unsigned numArrivals = 20;
+const unsigned maxFrames = 5000;		//!< Frames before giving up on reaching full detail
+const float arrivalAltitude = 10;		//!< Camera height over the ground
+
+typedef std::vector<std::pair<uint64_t, double>> DrawnLeaves;		//!< Drawn chunks: (depth and chunkID, area relative to a cube face)
+
+/// Camera over the ground, in direction "dir" from the nucleus
+glm::vec3 getGroundCam(Planet& planet, const glm::vec3& dir)
+{
+	return planetNucleus + glm::normalize(dir) * (planet.getGroundHeight(planetNucleus + dir) + arrivalAltitude);
+}
+
+void getDrawnLeaves(const Planet& planet, DrawnLeaves& drawn)
+{
+	std::vector<const Chunk*> leaves;
+	planet.getActiveLeafChunks(leaves, 0);
+
+	drawn.clear();
+	for (const Chunk* leaf : leaves)
+		drawn.push_back({ (uint64_t)leaf->depth << 32 | leaf->chunkID, 1. / ((uint64_t)1 << 2 * leaf->depth) });
+}
+
+/// Frames from the camera's arrival at "arrival" (from a settled place) until each fraction of full detail is reached (maxFrames if it isn't)
+void measureArrival(std::shared_ptr<Noiser> noiseGen, std::shared_ptr<ThreadPool> threadPool, unsigned numLevels, bool progressive, const glm::vec3& startDir, const glm::vec3& arrivalDir, const double* thresholds, unsigned* reached)
+{
+	Renderer renderer;
+	LightSet lights(2);
+	Planet planet(&renderer, noiseGen, planetRootCellSize, planetSideVertex, numLevels, planetMinLevel, planetDistMultiplier, planetRadius, planetNucleus, false);
+	planet.addResources({}, {});
+	planet.setThreadPool(threadPool);
+	planet.setScheduler(std::make_shared<ChunkScheduler>(threadPool));
+	planet.setProgressiveActivation(progressive);
+
+	settlePlanet(planet, renderer, lights, getGroundCam(planet, startDir));
+
+	// Arrival: drawn chunks of each frame until the planet is settled
+	glm::vec3 camPos = getGroundCam(planet, arrivalDir);
+	glm::mat4 view = getViewMatrix(camPos);
+	glm::mat4 proj = getProjMatrix();
+	std::vector<DrawnLeaves> frames;
+
+	while (frames.size() < maxFrames)
+	{
+		planet.updateState(camPos, view, proj, lights, 1 / 60.f, planet.getGroundHeight(camPos));
+		renderer.newFrame();
+
+		frames.emplace_back();
+		getDrawnLeaves(planet, frames.back());
+
+		if (planet.isSettled()) break;
+		if (threadPool) std::this_thread::yield();		// Let the workers progress
+	}
+
+	// Full detail: chunks drawn once settled
+	std::unordered_set<uint64_t> target;
+	double targetArea = 0;
+
+	for (const auto& leaf : frames.back())
+	{
+		target.insert(leaf.first);
+		targetArea += leaf.second;
+	}
+
+	for (unsigned t = 0; t < 3; t++) reached[t] = maxFrames;
+	if (!planet.isSettled()) return;
+
+	for (unsigned f = 0; f < frames.size(); f++)
+	{
+		double area = 0;
+		for (const auto& leaf : frames[f])
+			if (target.count(leaf.first)) area += leaf.second;
+
+		for (unsigned t = 0; t < 3; t++)
+			if (reached[t] == maxFrames && area >= thresholds[t] * targetArea) reached[t] = f + 1;
+	}
+}
+
+void runPopinBenchmark(std::shared_ptr<Noiser> noiseGen, unsigned numThreads, unsigned maxLevels)
+{
+	const double thresholds[3] = { 0.5, 0.9, 1.0 };
+	std::shared_ptr<ThreadPool> threadPool;
+	if (numThreads > 1) threadPool = std::make_shared<ThreadPool>(numThreads);
+
+	std::cout << "Pop-in latency benchmark (planet, " << numThreads << " threads, " << numArrivals << " arrivals over face +Z at " << arrivalAltitude << " over the ground)" << std::endl;
+
+	for (unsigned numLevels = std::min(7u, maxLevels); numLevels <= maxLevels; numLevels++)
+	{
+		double frames[2][3] = { };		// [former, progressive][threshold] (mean)
+		unsigned worst[2] = { };		// Frames to full detail (max)
+
+		for (unsigned mode = 0; mode < 2; mode++)
+		{
+			std::mt19937 rng(4321);
+			std::uniform_real_distribution<float> coord(-0.45f, 0.45f);
+
+			for (unsigned a = 0; a < numArrivals; a++)
+			{
+				glm::vec3 start(coord(rng), coord(rng), 1), arrival(coord(rng), coord(rng), 1);
+				unsigned reached[3];
+				measureArrival(noiseGen, threadPool, numLevels, mode == 1, start, arrival, thresholds, reached);
+
+				for (unsigned t = 0; t < 3; t++)
+					frames[mode][t] += (double)reached[t] / numArrivals;
+				worst[mode] = std::max(worst[mode], reached[2]);
+			}
+		}
+
+		std::cout << std::fixed << std::setprecision(1)
+			<< "   Levels: " << numLevels << " (frames from arrival to 50 % / 90 % / 100 % of full detail)" << std::endl
+			<< "      Former:      " << frames[0][0] << " / " << frames[0][1] << " / " << frames[0][2] << " (worst: " << worst[0] << ")" << std::endl
+			<< "      Progressive: " << frames[1][0] << " / " << frames[1][1] << " / " << frames[1][2] << " (worst: " << worst[1] << ")" << std::endl;
+
+		std::cout << "RESULT popin levels=" << numLevels
+			<< " former_50=" << frames[0][0] << " former_90=" << frames[0][1] << " former_100=" << frames[0][2]
+			<< " progressive_50=" << frames[1][0] << " progressive_90=" << frames[1][1] << " progressive_100=" << frames[1][2] << std::endl;
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef POPINBENCHMARK_HPP
+#define POPINBENCHMARK_HPP
+
+#include <memory>
+
+#include "noise.hpp"
+
+/**
+	Pop-in latency of DynamicGrid's LOD updates: frames from the arrival of the camera at a place until it's drawn with full detail.
+	It runs the real Planet (see planetScene.hpp) on the headless renderer, with chunks generated in a ThreadPool of "numThreads" threads (or in the render thread, if 1) through a ChunkScheduler, as in the planet entity.
+	Two ways of completing splits are compared (see DynamicGrid::setProgressiveActivation()):
+		- Former: A splitting node waits until every leaf of its hidden subtree is loaded (all-or-nothing).
+		- Progressive: A splitting node is replaced as soon as its 4 children are loaded, and then its split children start splitting.
+	For each of some random arrivals over face +Z (camera teleported from a settled place), it measures the frames until 50 %, 90 % and 100 % of the area of the chunks drawn once the planet is settled (see Planet::isSettled()) is drawn.
+	It runs for each number of levels in [7, maxLevels] (only maxLevels if it's lower).
+*/
+void runPopinBenchmark(std::shared_ptr<Noiser> noiseGen, unsigned numThreads, unsigned maxLevels);
+
+#endif
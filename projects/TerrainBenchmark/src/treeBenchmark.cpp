@@ -0,0 +1,446 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include "glm/glm.hpp"
+
+#include "quadtree.hpp"
+#include "planetPatch.hpp"		// enum side
+#include "treeBenchmark.hpp"
+
+// Grid parameters (same LOD parameters as the planet entity)
+const float gridSide = 100;
+const unsigned treeMinLevel = 2;
+const float treeDistMultiplier = 1.2f;
+const unsigned repetitions = 20;		//!< Trees built per step and implementation (a single tree takes microseconds)
+
+/// Element of the tree nodes (like Chunk, only with the data used here)
+struct TreeChunk
+{
+	unsigned depth;
+	unsigned chunkID;		//!< Same numbering as Chunk::chunkID: 1 + row * 2^depth + column (row 0 is +y)
+	glm::vec3 center;
+	float side;
+	glm::vec4 sideDepths;
+};
+
+/// Chunks are kept between trees (like in DynamicGrid), so building a tree only looks them up
+class TreeChunkRegistry
+{
+public:
+	TreeChunk* get(unsigned depth, unsigned chunkID);
+	void clear() { chunks.clear(); }
+
+private:
+	std::unordered_map<uint64_t, TreeChunk> chunks;
+};
+
+TreeChunk* TreeChunkRegistry::get(unsigned depth, unsigned chunkID)
+{
+	uint64_t key = (uint64_t)depth << 48 | chunkID;
+	auto it = chunks.find(key);
+	if (it != chunks.end()) return &it->second;
+
+	unsigned numCells = 1u << depth;
+	float side = gridSide / numCells;
+	float x = ((chunkID - 1) % numCells + 0.5f) * side - gridSide / 2;
+	float y = gridSide / 2 - ((chunkID - 1) / numCells + 0.5f) * side;
+
+	return &chunks.insert({ key, { depth, chunkID, glm::vec3(x, y, 0), side, glm::vec4(0) } }).first->second;
+}
+
+/// Distance LOD (as DynamicGrid::wantsSplit(), without hysteresis)
+bool wantsSplit(const TreeChunk* chunk, const glm::vec3& camPos, unsigned numLevels)
+{
+	if (chunk->depth < treeMinLevel) return true;
+	if (chunk->depth >= numLevels - 1) return false;
+	return glm::distance(camPos, chunk->center) < chunk->side * treeDistMultiplier;
+}
+
+/// IDs of the 4 children (same as DynamicGrid::getChunkIDs())
+void getChildrenIDs(unsigned parentID, unsigned depth, unsigned ids[4])
+{
+	unsigned sideLength = 1u << depth;
+	unsigned parentRows = (parentID - 1) / (sideLength / 2);
+	unsigned basicID = parentID + (parentID - 1);
+
+	ids[0] = basicID + 0 + (parentRows + 0) * sideLength;
+	ids[1] = basicID + 1 + (parentRows + 0) * sideLength;
+	ids[2] = basicID + 0 + (parentRows + 1) * sideLength;
+	ids[3] = basicID + 1 + (parentRows + 1) * sideLength;
+}
+
+
+// Former implementation (pointer-based) --------------------------------------
+
+/// Former quadtree node: each node is allocated on its own, and the destructor deletes its subtree recursively.
+template<typename T>
+class QuadNode
+{
+public:
+	QuadNode(const T& element, QuadNode* a = nullptr, QuadNode* b = nullptr, QuadNode* c = nullptr, QuadNode* d = nullptr) : element(element), a(a), b(b), c(c), d(d) { };
+	~QuadNode() { if (a) delete a; if (b) delete b; if (c) delete c; if (d) delete d; };
+
+	void setA(QuadNode<T>* node) { a = node; }
+	void setB(QuadNode<T>* node) { b = node; }
+	void setC(QuadNode<T>* node) { c = node; }
+	void setD(QuadNode<T>* node) { d = node; }
+
+	T& getElement() { return element; }
+	QuadNode<T>* getA() { return a; }
+	QuadNode<T>* getB() { return b; }
+	QuadNode<T>* getC() { return c; }
+	QuadNode<T>* getD() { return d; }
+
+	bool isLeaf() { return !(a || b || c || d); }
+
+private:
+	T element;
+	QuadNode<T>* a, *b, *c, *d;
+};
+
+typedef QuadNode<TreeChunk*> PointerNode;
+
+PointerNode* buildPointerTree(TreeChunkRegistry& registry, const glm::vec3& camPos, unsigned numLevels, unsigned depth, unsigned chunkID)
+{
+	PointerNode* node = new PointerNode(registry.get(depth, chunkID));
+	if (!wantsSplit(node->getElement(), camPos, numLevels)) return node;
+
+	unsigned ids[4];
+	getChildrenIDs(chunkID, depth + 1, ids);
+	node->setA(buildPointerTree(registry, camPos, numLevels, depth + 1, ids[0]));
+	node->setB(buildPointerTree(registry, camPos, numLevels, depth + 1, ids[1]));
+	node->setC(buildPointerTree(registry, camPos, numLevels, depth + 1, ids[2]));
+	node->setD(buildPointerTree(registry, camPos, numLevels, depth + 1, ids[3]));
+	return node;
+}
+
+void getPointerLeaves(PointerNode* node, std::vector<TreeChunk*>& dest)
+{
+	if (node->isLeaf())
+	{
+		dest.push_back(node->getElement());
+		return;
+	}
+
+	getPointerLeaves(node->getA(), dest);
+	getPointerLeaves(node->getB(), dest);
+	getPointerLeaves(node->getC(), dest);
+	getPointerLeaves(node->getD(), dest);
+}
+
+void restartPointerSideDepths(PointerNode* node)
+{
+	if (!node) return;
+
+	node->getElement()->sideDepths = glm::vec4(0);
+
+	restartPointerSideDepths(node->getA());
+	restartPointerSideDepths(node->getB());
+	restartPointerSideDepths(node->getC());
+	restartPointerSideDepths(node->getD());
+}
+
+/// Former DynamicGrid::updateChunksSideDepths_help()
+void updatePointerSideDepths_help(std::list<PointerNode*>& queue, PointerNode* currentNode)
+{
+	TreeChunk* currentChunk = currentNode->getElement(), * rightChunk = nullptr, * lowerChunk = nullptr;
+	PointerNode* rightNode = nullptr, * lowerNode = nullptr;
+	unsigned sideSize = pow(2, currentChunk->depth);
+
+	for (auto iter = queue.begin(); iter != queue.end(); iter++)
+	{
+		if ((*iter)->getElement()->chunkID == currentChunk->chunkID + 1 && (*iter)->getElement()->depth == currentChunk->depth)
+		{
+			rightNode = *iter;
+			rightChunk = rightNode->getElement();
+			break;
+		}
+		else if ((*iter)->getElement()->depth != currentChunk->depth)
+			break;
+	}
+
+	for (auto iter = queue.begin(); iter != queue.end(); iter++)
+		if ((*iter)->getElement()->chunkID == currentChunk->chunkID + sideSize && (*iter)->getElement()->depth == currentChunk->depth)
+		{
+			lowerNode = *iter;
+			lowerChunk = lowerNode->getElement();
+			break;
+		}
+		else if ((*iter)->getElement()->depth != currentChunk->depth)
+			break;
+
+	if (currentNode->isLeaf())
+	{
+		if (!currentChunk->sideDepths[side::right]) currentChunk->sideDepths[side::right] = currentChunk->depth;
+		if (!currentChunk->sideDepths[side::down]) currentChunk->sideDepths[side::down] = currentChunk->depth;
+	}
+
+	if (rightNode)
+	{
+		if (rightNode->isLeaf() && !rightChunk->sideDepths[side::left])
+			rightChunk->sideDepths[side::left] = currentChunk->depth;
+
+		if (currentChunk->sideDepths[side::right] && !rightChunk->sideDepths[side::left])
+			rightChunk->sideDepths[side::left] = currentChunk->sideDepths[side::right];
+		if (!currentChunk->sideDepths[side::right] && rightChunk->sideDepths[side::left])
+			currentChunk->sideDepths[side::right] = rightChunk->sideDepths[side::left];
+	}
+
+	if (lowerNode)
+	{
+		if (lowerNode->isLeaf() && !lowerChunk->sideDepths[side::up])
+			lowerChunk->sideDepths[side::up] = currentChunk->depth;
+
+		if (currentChunk->sideDepths[side::down] && !lowerChunk->sideDepths[side::up])
+			lowerChunk->sideDepths[side::up] = currentChunk->sideDepths[side::down];
+		if (!currentChunk->sideDepths[side::down] && lowerChunk->sideDepths[side::up])
+			currentChunk->sideDepths[side::down] = lowerChunk->sideDepths[side::up];
+	}
+
+	if (!currentNode->isLeaf())
+	{
+		currentNode->getA()->getElement()->sideDepths[side::left ] = currentChunk->sideDepths[side::left ];
+		currentNode->getC()->getElement()->sideDepths[side::left ] = currentChunk->sideDepths[side::left ];
+		currentNode->getB()->getElement()->sideDepths[side::right] = currentChunk->sideDepths[side::right];
+		currentNode->getD()->getElement()->sideDepths[side::right] = currentChunk->sideDepths[side::right];
+		currentNode->getA()->getElement()->sideDepths[side::up   ] = currentChunk->sideDepths[side::up   ];
+		currentNode->getB()->getElement()->sideDepths[side::up   ] = currentChunk->sideDepths[side::up   ];
+		currentNode->getC()->getElement()->sideDepths[side::down ] = currentChunk->sideDepths[side::down ];
+		currentNode->getD()->getElement()->sideDepths[side::down ] = currentChunk->sideDepths[side::down ];
+	}
+}
+
+/// Former DynamicGrid::updateChunksSideDepths() (breadth-first search)
+void updatePointerSideDepths(PointerNode* node)
+{
+	restartPointerSideDepths(node);
+	node->getElement()->sideDepths = glm::vec4(1000);
+
+	PointerNode* currentNode;
+	std::list<TreeChunk*> allLeaves;
+	std::list<PointerNode*> queue;
+	queue.push_back(node);
+
+	while (queue.size())
+	{
+		currentNode = queue.front();
+		queue.pop_front();
+
+		updatePointerSideDepths_help(queue, currentNode);
+		if (currentNode->isLeaf())
+			allLeaves.push_back(currentNode->getElement());
+		else
+		{
+			queue.push_back(currentNode->getA());
+			queue.push_back(currentNode->getB());
+			queue.push_back(currentNode->getC());
+			queue.push_back(currentNode->getD());
+		}
+	}
+
+	for (auto& it : allLeaves)
+		for (unsigned i = 0; i < 4; i++)
+			if (it->sideDepths[i] != 1000) it->sideDepths[i] = it->depth - it->sideDepths[i];
+}
+
+
+// Linear implementation ------------------------------------------------------
+
+typedef LinearQuadtree<TreeChunk*> LinearTree;
+
+uint32_t buildLinearTree(LinearTree& tree, std::vector<uint32_t>& stack, TreeChunkRegistry& registry, const glm::vec3& camPos, unsigned numLevels)
+{
+	uint32_t root = tree.addRoot(registry.get(0, 1));
+	stack.assign(1, root);
+
+	while (stack.size())
+	{
+		uint32_t node = stack.back();
+		stack.pop_back();
+
+		TreeChunk* chunk = tree[node].element;
+		if (!wantsSplit(chunk, camPos, numLevels)) continue;
+
+		unsigned ids[4];
+		getChildrenIDs(chunk->chunkID, chunk->depth + 1, ids);
+		TreeChunk* children[4] = { registry.get(chunk->depth + 1, ids[0]), registry.get(chunk->depth + 1, ids[1]), registry.get(chunk->depth + 1, ids[2]), registry.get(chunk->depth + 1, ids[3]) };
+		tree.split(node, children);
+
+		for (unsigned i = 0; i < 4; i++)
+			stack.push_back(tree.getChild(node, i));
+	}
+
+	return root;
+}
+
+void getLinearLeaves(LinearTree& tree, uint32_t root, std::vector<TreeChunk*>& dest)
+{
+	tree.traverse(root, [&](uint32_t node)
+	{
+		if (tree.isLeaf(node)) dest.push_back(tree[node].element);
+		return true;
+	});
+}
+
+/// Same as DynamicGrid::updateSideDepths() (including the index of locational codes, which DynamicGrid builds when the drawn tree changes)
+void updateLinearSideDepths(LinearTree& tree, uint32_t root, LocationalIndex& nodes)
+{
+	const int offsets[4][2] = { { 1, 0 }, { -1, 0 }, { 0, -1 }, { 0, 1 } };
+
+	nodes.clear();
+	tree.indexNodes(root, [&](uint32_t node) { return tree.isLeaf(node); }, nodes);
+
+	auto getDrawnDepth = [&](unsigned depth, uint64_t code)
+	{
+		uint64_t key = locationalCode(depth, code);
+
+		for (unsigned d = depth + 1; d-- > 0; key >>= 2)
+			if (nodes.find(key) != LocationalIndex::none)
+				return d;
+
+		return depth;
+	};
+
+	tree.traverse(root, [&](uint32_t node)
+	{
+		if (!tree.isLeaf(node)) return true;
+
+		TreeChunk* chunk = tree[node].element;
+		unsigned depth = tree[node].depth;
+		uint32_t numCells = 1u << depth, x, y;
+		mortonDecode(tree[node].code, x, y);
+
+		for (unsigned s = 0; s < 4; s++)
+		{
+			uint32_t nx = x + offsets[s][0], ny = y + offsets[s][1];
+
+			if (nx >= numCells || ny >= numCells)
+				chunk->sideDepths[s] = 1000;
+			else if ((nx >> 1) == (x >> 1) && (ny >> 1) == (y >> 1))
+				chunk->sideDepths[s] = 0;
+			else
+				chunk->sideDepths[s] = depth - getDrawnDepth(depth, mortonEncode(nx, ny));
+		}
+
+		return false;
+	});
+}
+
+
+// Benchmark ------------------------------------------------------------------
+
+struct TreeTimes
+{
+	double build = 0, traversal = 0, sideDepths = 0;	//!< Accumulated (ms)
+};
+
+glm::vec3 getTreeCamPos(unsigned step, unsigned numSteps, unsigned numLevels)
+{
+	// Diagonal flight across the grid, at the height of the smallest chunks
+	float t = (float)step / std::max(numSteps - 1, 1u);
+	float height = gridSide / (1u << numLevels);
+	return glm::vec3((t - 0.5f) * 0.9f * gridSide, (0.4f - 0.7f * t) * gridSide, height);
+}
+
+bool runTreeBenchmark(unsigned numSteps, unsigned maxLevels)
+{
+	typedef std::chrono::steady_clock Clock;
+	auto ms = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+	bool allMatch = true;
+
+	std::cout << "Quadtree benchmark (flat grid, distance LOD, " << numSteps << " steps x " << repetitions << " trees)" << std::endl;
+
+	for (unsigned numLevels = std::min(7u, maxLevels); numLevels <= maxLevels; numLevels++)
+	{
+		TreeChunkRegistry pointerRegistry, linearRegistry;
+		LinearTree tree;
+		std::vector<uint32_t> stack;
+		LocationalIndex nodeIndex;
+		std::vector<TreeChunk*> pointerLeaves, linearLeaves;
+		TreeTimes pointerTimes, linearTimes;
+		size_t numLeaves = 0, maxLeaves = 0, mismatches = 0;
+
+		for (unsigned step = 0; step < numSteps; step++)
+		{
+			glm::vec3 camPos = getTreeCamPos(step, numSteps, numLevels);
+			PointerNode* pointerRoot = nullptr;
+			uint32_t linearRoot = LinearTree::none;
+
+			for (unsigned rep = 0; rep < repetitions; rep++)
+			{
+				// Build (the former tree was deleted and built again in each update)
+				auto start = Clock::now();
+				if (pointerRoot) delete pointerRoot;
+				pointerRoot = buildPointerTree(pointerRegistry, camPos, numLevels, 0, 1);
+				pointerTimes.build += ms(start);
+
+				start = Clock::now();
+				tree.clear();
+				linearRoot = buildLinearTree(tree, stack, linearRegistry, camPos, numLevels);
+				linearTimes.build += ms(start);
+
+				// Traversal
+				start = Clock::now();
+				pointerLeaves.clear();
+				getPointerLeaves(pointerRoot, pointerLeaves);
+				pointerTimes.traversal += ms(start);
+
+				start = Clock::now();
+				linearLeaves.clear();
+				getLinearLeaves(tree, linearRoot, linearLeaves);
+				linearTimes.traversal += ms(start);
+
+				// Side depths
+				start = Clock::now();
+				updatePointerSideDepths(pointerRoot);
+				pointerTimes.sideDepths += ms(start);
+
+				start = Clock::now();
+				updateLinearSideDepths(tree, linearRoot, nodeIndex);
+				linearTimes.sideDepths += ms(start);
+			}
+
+			delete pointerRoot;
+
+			// Both must give the same leaves (Morton order) and side depths
+			numLeaves += linearLeaves.size();
+			maxLeaves = std::max(maxLeaves, linearLeaves.size());
+
+			if (pointerLeaves.size() != linearLeaves.size()) mismatches++;
+			else
+				for (size_t i = 0; i < linearLeaves.size(); i++)
+					if (pointerLeaves[i]->depth != linearLeaves[i]->depth || pointerLeaves[i]->chunkID != linearLeaves[i]->chunkID || pointerLeaves[i]->sideDepths != linearLeaves[i]->sideDepths)
+					{
+						mismatches++;
+						break;
+					}
+		}
+
+		double numTrees = (double)numSteps * repetitions;
+		auto us = [&](double total) { return 1000 * total / numTrees; };
+		auto speedup = [](double former, double linear) { return (linear > 0 ? former / linear : 0); };
+		allMatch = allMatch && !mismatches;
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< "   Levels: " << numLevels << " / Leaves per tree: " << (double)numLeaves / numSteps << " (max " << maxLeaves << ") / Pool capacity: " << tree.capacity() << " nodes" << std::endl
+			<< "      Time per tree (us)   Pointer      Linear       Speedup" << std::endl
+			<< "      Build:               " << std::setw(10) << us(pointerTimes.build) << "   " << std::setw(10) << us(linearTimes.build) << "   " << speedup(pointerTimes.build, linearTimes.build) << std::endl
+			<< "      Traversal:           " << std::setw(10) << us(pointerTimes.traversal) << "   " << std::setw(10) << us(linearTimes.traversal) << "   " << speedup(pointerTimes.traversal, linearTimes.traversal) << std::endl
+			<< "      Side depths:         " << std::setw(10) << us(pointerTimes.sideDepths) << "   " << std::setw(10) << us(linearTimes.sideDepths) << "   " << speedup(pointerTimes.sideDepths, linearTimes.sideDepths) << std::endl
+			<< "      Results: " << (mismatches ? std::to_string(mismatches) + " steps differ" : std::string("equal")) << std::endl;
+
+		std::cout << "RESULT tree levels=" << numLevels << " leaves=" << (double)numLeaves / numSteps
+			<< " build_pointer_us=" << us(pointerTimes.build) << " build_linear_us=" << us(linearTimes.build)
+			<< " traversal_pointer_us=" << us(pointerTimes.traversal) << " traversal_linear_us=" << us(linearTimes.traversal)
+			<< " sidedepths_pointer_us=" << us(pointerTimes.sideDepths) << " sidedepths_linear_us=" << us(linearTimes.sideDepths)
+			<< " mismatches=" << mismatches << std::endl;
+	}
+
+	return allMatch;
+}
@@ -0,0 +1,12 @@
+#ifndef TREEBENCHMARK_HPP
+#define TREEBENCHMARK_HPP
+
+/**
+	Compare the linear quadtree used by DynamicGrid (LinearQuadtree) with the former pointer-based quadtree (QuadNode, reproduced here) on a flat grid with distance LOD.
+	A camera flies over the grid at low altitude. At each step, both implementations build the tree from scratch (as the former DynamicGrid::createTree() did), traverse its leaves and compute the chunks' side depths. Results of both are checked to be equal.
+	It runs for each number of levels in [7, maxLevels] (only maxLevels if it's lower).
+	Returns false if the implementations disagree.
+*/
+bool runTreeBenchmark(unsigned numSteps, unsigned maxLevels);
+
+#endif